@@ -0,0 +1,229 @@
+﻿//-----------------------------------------------------------------------------
+// SoAccessPredictor
+// (C) oil
+// 2013-10-25
+//-----------------------------------------------------------------------------
+#include "SoAccessPredictor.h"
+#include "SoFileIO.h"
+#include <stdlib.h>
+#include <string.h>
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	//-----------------------------------------------------------------------------
+	SoAccessPredictor::SoAccessPredictor()
+	:m_pTable(0)
+	,m_nEntryCount(0)
+	,m_bDirty(false)
+	{
+		memset(m_Identity, 0, sizeof(m_Identity));
+	}
+	//-----------------------------------------------------------------------------
+	SoAccessPredictor::~SoAccessPredictor()
+	{
+		Release();
+	}
+	//-----------------------------------------------------------------------------
+	bool SoAccessPredictor::Init(soint64 nEntryCount, const soint64* pIdentity)
+	{
+		Release();
+		//FileID加1之后保存在souint32中。
+		if (nEntryCount <= 0 || nEntryCount >= 0xFFFFFFFF || pIdentity == 0)
+		{
+			return false;
+		}
+		SoAutoLock theAutoLock(m_Lock);
+		m_pTable = (stSuccessor*)calloc((size_t)nEntryCount * SoAccessPredictor_MaxSuccessor, sizeof(stSuccessor));
+		if (m_pTable == 0)
+		{
+			return false;
+		}
+		m_nEntryCount = nEntryCount;
+		memcpy(m_Identity, pIdentity, sizeof(m_Identity));
+		m_bDirty = false;
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	void SoAccessPredictor::Release()
+	{
+		SoAutoLock theAutoLock(m_Lock);
+		if (m_pTable)
+		{
+			free(m_pTable);
+			m_pTable = 0;
+		}
+		m_nEntryCount = 0;
+		memset(m_Identity, 0, sizeof(m_Identity));
+		m_bDirty = false;
+	}
+	//-----------------------------------------------------------------------------
+	void SoAccessPredictor::Record(soint64 nLastFileID, soint64 nFileID)
+	{
+		if (nLastFileID < 0 || nLastFileID == nFileID)
+		{
+			return;
+		}
+		SoAutoLock theAutoLock(m_Lock);
+		if (nFileID < 0 || nFileID >= m_nEntryCount || nLastFileID >= m_nEntryCount)
+		{
+			return;
+		}
+		const souint32 uiNextID = (souint32)nFileID + 1;
+		stSuccessor* pList = m_pTable + nLastFileID * SoAccessPredictor_MaxSuccessor;
+		stSuccessor* pMin = pList;
+		for (int i=0; i<SoAccessPredictor_MaxSuccessor; ++i)
+		{
+			if (pList[i].uiNextID == uiNextID)
+			{
+				if (pList[i].uiCount < 0xFFFFFFFF)
+				{
+					++pList[i].uiCount;
+				}
+				m_bDirty = true;
+				return;
+			}
+			if (pList[i].uiCount < pMin->uiCount)
+			{
+				pMin = &pList[i];
+			}
+		}
+		//替换次数最少的后继（空位置的次数为0）。
+		pMin->uiNextID = uiNextID;
+		++pMin->uiCount;
+		m_bDirty = true;
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoAccessPredictor::Predict(soint64 nFileID, soint64* pFileIDList, souint32 uiMaxCount, souint32 uiMinCount, souint32 uiMinShare)
+	{
+		SoAutoLock theAutoLock(m_Lock);
+		if (nFileID < 0 || nFileID >= m_nEntryCount || pFileIDList == 0)
+		{
+			return 0;
+		}
+		stSuccessor theList[SoAccessPredictor_MaxSuccessor];
+		memcpy(theList, m_pTable + nFileID * SoAccessPredictor_MaxSuccessor, sizeof(theList));
+		souint64 uiTotal = 0;
+		for (int i=0; i<SoAccessPredictor_MaxSuccessor; ++i)
+		{
+			uiTotal += theList[i].uiCount;
+		}
+		//按次数从大到小排序，元素很少，用插入排序。
+		for (int i=1; i<SoAccessPredictor_MaxSuccessor; ++i)
+		{
+			stSuccessor theTemp = theList[i];
+			int j = i - 1;
+			while (j >= 0 && theList[j].uiCount < theTemp.uiCount)
+			{
+				theList[j+1] = theList[j];
+				--j;
+			}
+			theList[j+1] = theTemp;
+		}
+		souint32 uiResult = 0;
+		for (int i=0; i<SoAccessPredictor_MaxSuccessor && uiResult<uiMaxCount; ++i)
+		{
+			if (theList[i].uiNextID == 0 || theList[i].uiCount < uiMinCount)
+			{
+				break;
+			}
+			if (uiMinShare > 0 && (souint64)theList[i].uiCount * uiMinShare < uiTotal)
+			{
+				break;
+			}
+			pFileIDList[uiResult++] = (soint64)theList[i].uiNextID - 1;
+		}
+		return uiResult;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoAccessPredictor::Load(const char* pszFile)
+	{
+		SoAutoLock theAutoLock(m_Lock);
+		if (m_pTable == 0 || pszFile == 0)
+		{
+			return false;
+		}
+		SoFileIO* pFile = SoFileIO_Create(SoFileIO::Backend_Default);
+		if (!pFile->Open(pszFile, SoFileIO::Open_Read))
+		{
+			delete pFile;
+			return false;
+		}
+		bool br = false;
+		stFileHead theHead;
+		const soint64 nTableSize = m_nEntryCount * SoAccessPredictor_MaxSuccessor * (soint64)sizeof(stSuccessor);
+		if (pFile->ReadAt(&theHead, sizeof(theHead), 0) == (soint64)sizeof(theHead)
+			&& memcmp(theHead.szFlag, SoAccessPredictorFlag, SoAccessPredictorFlagLength) == 0
+			&& theHead.nVersion == SoAccessPredictorVersion
+			&& theHead.nEntryCount == m_nEntryCount
+			&& memcmp(theHead.theIdentity, m_Identity, sizeof(m_Identity)) == 0
+			&& pFile->GetSize() == (soint64)sizeof(theHead) + nTableSize)
+		{
+			stSuccessor* pTable = (stSuccessor*)malloc((size_t)nTableSize);
+			if (pTable && pFile->ReadAt(pTable, nTableSize, sizeof(theHead)) == nTableSize)
+			{
+				//校验FileID的范围，避免损坏的文件导致越界。
+				br = true;
+				const soint64 nCount = m_nEntryCount * SoAccessPredictor_MaxSuccessor;
+				for (soint64 i=0; i<nCount; ++i)
+				{
+					if ((soint64)pTable[i].uiNextID > m_nEntryCount)
+					{
+						br = false;
+						break;
+					}
+				}
+			}
+			if (br)
+			{
+				free(m_pTable);
+				m_pTable = pTable;
+				m_bDirty = false;
+			}
+			else if (pTable)
+			{
+				free(pTable);
+			}
+		}
+		pFile->Close();
+		delete pFile;
+		return br;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoAccessPredictor::Save(const char* pszFile)
+	{
+		SoAutoLock theAutoLock(m_Lock);
+		if (m_pTable == 0 || pszFile == 0)
+		{
+			return false;
+		}
+		SoFileIO* pFile = SoFileIO_Create(SoFileIO::Backend_Default);
+		if (!pFile->Open(pszFile, SoFileIO::Open_Create))
+		{
+			delete pFile;
+			return false;
+		}
+		stFileHead theHead;
+		memset(&theHead, 0, sizeof(theHead));
+		memcpy(theHead.szFlag, SoAccessPredictorFlag, SoAccessPredictorFlagLength);
+		theHead.nVersion = SoAccessPredictorVersion;
+		theHead.nEntryCount = m_nEntryCount;
+		memcpy(theHead.theIdentity, m_Identity, sizeof(m_Identity));
+		const soint64 nTableSize = m_nEntryCount * SoAccessPredictor_MaxSuccessor * (soint64)sizeof(stSuccessor);
+		bool br = pFile->WriteAt(&theHead, sizeof(theHead), 0) == (soint64)sizeof(theHead)
+			&& pFile->WriteAt(m_pTable, nTableSize, sizeof(theHead)) == nTableSize
+			&& pFile->Flush();
+		pFile->Close();
+		delete pFile;
+		if (br)
+		{
+			m_bDirty = false;
+		}
+		return br;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoAccessPredictor::IsDirty() const
+	{
+		return m_bDirty;
+	}
+}
+//-----------------------------------------------------------------------------
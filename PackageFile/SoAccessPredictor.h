@@ -0,0 +1,79 @@
+﻿//-----------------------------------------------------------------------------
+// SoAccessPredictor
+// (C) oil
+// 2013-10-25
+//
+// 根据文件的访问顺序预测下一个要访问的文件（一阶马尔可夫链）。
+// 每个FileID记录最多SoAccessPredictor_MaxSuccessor个后继文件及其出现次数，
+// 后继位置已满时替换次数最少的那个，新的后继继承它的次数（Space-Saving算法），
+// 所以长期不再出现的后继会逐渐被替换掉。
+// 统计表可以保存到文件中，下次打开资源包时加载。
+// 所有函数都是线程安全的。
+//-----------------------------------------------------------------------------
+#ifndef _SoAccessPredictor_h_
+#define _SoAccessPredictor_h_
+//-----------------------------------------------------------------------------
+#include "SoBaseTypeDefine.h"
+#include "SoThread.h"
+//-----------------------------------------------------------------------------
+#define SoAccessPredictorFlag "SOPREDIC"
+#define SoAccessPredictorFlagLength 8
+#define SoAccessPredictorVersion 2
+#define SoAccessPredictor_MaxSuccessor 4
+//识别资源包的值的个数。
+#define SoAccessPredictor_IdentityCount 3
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	class SoAccessPredictor
+	{
+	public:
+		SoAccessPredictor();
+		~SoAccessPredictor();
+		//nEntryCount为FileID的个数。pIdentity指向SoAccessPredictor_IdentityCount个识别资源包的值，加载统计表时必须全部一致。
+		bool Init(soint64 nEntryCount, const soint64* pIdentity);
+		void Release();
+		//记录一次从nLastFileID到nFileID的访问。访问顺序由调用者按线程记录，nLastFileID为-1时忽略。
+		void Record(soint64 nLastFileID, soint64 nFileID);
+		//预测nFileID之后最可能访问的文件，按可能性从大到小排列。
+		//只返回次数不少于uiMinCount，并且占全部后继次数不少于1/uiMinShare的后继。返回个数。
+		souint32 Predict(soint64 nFileID, soint64* pFileIDList, souint32 uiMaxCount, souint32 uiMinCount, souint32 uiMinShare);
+		//从文件中加载统计表。文件不存在或者与资源包不匹配时返回false，统计表保持不变。
+		bool Load(const char* pszFile);
+		//把统计表保存到文件中。
+		bool Save(const char* pszFile);
+		//上次Load或者Save之后统计表是否有变化。
+		bool IsDirty() const;
+
+	private:
+		SoAccessPredictor(const SoAccessPredictor&);
+		SoAccessPredictor& operator = (const SoAccessPredictor&);
+
+	private:
+		//保存到文件中的结构，直接按内存布局读写。
+		struct stFileHead
+		{
+			char szFlag[SoAccessPredictorFlagLength];
+			soint64 nVersion;
+			soint64 nEntryCount;
+			soint64 theIdentity[SoAccessPredictor_IdentityCount];
+		};
+		struct stSuccessor
+		{
+			//后继文件的FileID加1，0表示空位置。
+			souint32 uiNextID;
+			souint32 uiCount;
+		};
+
+	private:
+		//每个FileID有SoAccessPredictor_MaxSuccessor个stSuccessor。
+		stSuccessor* m_pTable;
+		soint64 m_nEntryCount;
+		soint64 m_Identity[SoAccessPredictor_IdentityCount];
+		bool m_bDirty;
+		SoLock m_Lock;
+	};
+}
+//-----------------------------------------------------------------------------
+#endif //_SoAccessPredictor_h_
+//-----------------------------------------------------------------------------
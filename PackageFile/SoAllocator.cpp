@@ -0,0 +1,319 @@
+﻿//-----------------------------------------------------------------------------
+// SoAllocator
+// (C) oil
+// 2013-10-26
+//-----------------------------------------------------------------------------
+#include "SoAllocator.h"
+#include <stdlib.h>
+#include <string.h>
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	//-----------------------------------------------------------------------------
+	//SoAllocator_Malloc和SoAllocator_Pool在每个内存块前面记录的信息，16个字节，不破坏对齐。
+	struct stAllocatorBlockHead
+	{
+		//调用者要求的字节数。
+		soint64 nSize;
+		//SoAllocator_Pool的分级。
+		soint64 nClass;
+	};
+	#define SoAllocator_HeadSize ((soint64)sizeof(stAllocatorBlockHead))
+	#define SoAllocator_AlignUp(n) (((n) + 15) & ~(soint64)15)
+	//-----------------------------------------------------------------------------
+	SoAllocator_Malloc::SoAllocator_Malloc()
+	:m_nAllocCount(0)
+	,m_nAllocBytes(0)
+	,m_nInUseCount(0)
+	,m_nInUseBytes(0)
+	{
+	}
+	//-----------------------------------------------------------------------------
+	void* SoAllocator_Malloc::Alloc(soint64 nSize)
+	{
+		if (nSize < 0)
+		{
+			return 0;
+		}
+		stAllocatorBlockHead* pHead = (stAllocatorBlockHead*)malloc((size_t)(nSize + SoAllocator_HeadSize));
+		if (pHead == 0)
+		{
+			return 0;
+		}
+		pHead->nSize = nSize;
+		pHead->nClass = 0;
+		SoAtomic_Add64(&m_nAllocCount, 1);
+		SoAtomic_Add64(&m_nAllocBytes, nSize);
+		SoAtomic_Add64(&m_nInUseCount, 1);
+		SoAtomic_Add64(&m_nInUseBytes, nSize);
+		return pHead + 1;
+	}
+	//-----------------------------------------------------------------------------
+	void SoAllocator_Malloc::Free(void* pAddress)
+	{
+		if (pAddress == 0)
+		{
+			return;
+		}
+		stAllocatorBlockHead* pHead = (stAllocatorBlockHead*)pAddress - 1;
+		SoAtomic_Add64(&m_nInUseCount, -1);
+		SoAtomic_Add64(&m_nInUseBytes, -pHead->nSize);
+		free(pHead);
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoAllocator_Malloc::GetStats(stAllocatorStats* pStatsList, souint32 uiMaxCount)
+	{
+		if (pStatsList && uiMaxCount > 0)
+		{
+			memset(pStatsList, 0, sizeof(stAllocatorStats));
+			pStatsList->nAllocCount = m_nAllocCount;
+			pStatsList->nAllocBytes = m_nAllocBytes;
+			pStatsList->nInUseCount = m_nInUseCount;
+			pStatsList->nInUseBytes = m_nInUseBytes;
+		}
+		return 1;
+	}
+	//-----------------------------------------------------------------------------
+	SoAllocator_Pool::SoAllocator_Pool(soint64 nMaxCachedBytes)
+	:m_nMaxCachedBytes(nMaxCachedBytes)
+	{
+		for (int i=0; i<=SoAllocator_PoolClassCount; ++i)
+		{
+			stClass& theClass = m_ClassList[i];
+			theClass.pFreeList = 0;
+			theClass.nCachedCount = 0;
+			theClass.nAllocCount = 0;
+			theClass.nAllocBytes = 0;
+			theClass.nInUseCount = 0;
+			theClass.nInUseBytes = 0;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	SoAllocator_Pool::~SoAllocator_Pool()
+	{
+		Trim();
+	}
+	//-----------------------------------------------------------------------------
+	void* SoAllocator_Pool::Alloc(soint64 nSize)
+	{
+		if (nSize < 0)
+		{
+			return 0;
+		}
+		//找到放得下nSize加上块头的最小级别。
+		const soint64 nTotalSize = nSize + SoAllocator_HeadSize;
+		int nClass = 0;
+		while (nClass < SoAllocator_PoolClassCount && ((soint64)1 << (nClass + SoAllocator_PoolMinShift)) < nTotalSize)
+		{
+			++nClass;
+		}
+		stClass& theClass = m_ClassList[nClass];
+		stAllocatorBlockHead* pHead = 0;
+		theClass.theLock.Lock();
+		if (theClass.pFreeList)
+		{
+			pHead = (stAllocatorBlockHead*)theClass.pFreeList;
+			theClass.pFreeList = theClass.pFreeList->pNext;
+			--theClass.nCachedCount;
+		}
+		++theClass.nAllocCount;
+		theClass.nAllocBytes += nSize;
+		++theClass.nInUseCount;
+		theClass.nInUseBytes += nSize;
+		theClass.theLock.Unlock();
+		if (pHead == 0)
+		{
+			const soint64 nBlockSize = (nClass < SoAllocator_PoolClassCount) ? ((soint64)1 << (nClass + SoAllocator_PoolMinShift)) : nTotalSize;
+			pHead = (stAllocatorBlockHead*)malloc((size_t)nBlockSize);
+			if (pHead == 0)
+			{
+				SoAutoLock theAutoLock(theClass.theLock);
+				--theClass.nAllocCount;
+				theClass.nAllocBytes -= nSize;
+				--theClass.nInUseCount;
+				theClass.nInUseBytes -= nSize;
+				return 0;
+			}
+		}
+		pHead->nSize = nSize;
+		pHead->nClass = nClass;
+		return pHead + 1;
+	}
+	//-----------------------------------------------------------------------------
+	void SoAllocator_Pool::Free(void* pAddress)
+	{
+		if (pAddress == 0)
+		{
+			return;
+		}
+		stAllocatorBlockHead* pHead = (stAllocatorBlockHead*)pAddress - 1;
+		const int nClass = (int)pHead->nClass;
+		stClass& theClass = m_ClassList[nClass];
+		SoAutoLock theAutoLock(theClass.theLock);
+		--theClass.nInUseCount;
+		theClass.nInUseBytes -= pHead->nSize;
+		if (nClass < SoAllocator_PoolClassCount)
+		{
+			const soint64 nBlockSize = (soint64)1 << (nClass + SoAllocator_PoolMinShift);
+			if ((theClass.nCachedCount + 1) * nBlockSize <= m_nMaxCachedBytes)
+			{
+				//留给下次使用。
+				stFreeBlock* pBlock = (stFreeBlock*)pHead;
+				pBlock->pNext = theClass.pFreeList;
+				theClass.pFreeList = pBlock;
+				++theClass.nCachedCount;
+				return;
+			}
+		}
+		free(pHead);
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoAllocator_Pool::GetStats(stAllocatorStats* pStatsList, souint32 uiMaxCount)
+	{
+		for (souint32 i=0; i<=SoAllocator_PoolClassCount && i<uiMaxCount && pStatsList; ++i)
+		{
+			stClass& theClass = m_ClassList[i];
+			SoAutoLock theAutoLock(theClass.theLock);
+			stAllocatorStats& theStats = pStatsList[i];
+			theStats.nBlockSize = (i < SoAllocator_PoolClassCount) ? ((soint64)1 << (i + SoAllocator_PoolMinShift)) : 0;
+			theStats.nAllocCount = theClass.nAllocCount;
+			theStats.nAllocBytes = theClass.nAllocBytes;
+			theStats.nInUseCount = theClass.nInUseCount;
+			theStats.nInUseBytes = theClass.nInUseBytes;
+			theStats.nCachedCount = theClass.nCachedCount;
+			theStats.nCachedBytes = theClass.nCachedCount * theStats.nBlockSize;
+		}
+		return SoAllocator_PoolClassCount + 1;
+	}
+	//-----------------------------------------------------------------------------
+	void SoAllocator_Pool::Trim()
+	{
+		for (int i=0; i<SoAllocator_PoolClassCount; ++i)
+		{
+			stClass& theClass = m_ClassList[i];
+			theClass.theLock.Lock();
+			stFreeBlock* pBlock = theClass.pFreeList;
+			theClass.pFreeList = 0;
+			theClass.nCachedCount = 0;
+			theClass.theLock.Unlock();
+			while (pBlock)
+			{
+				stFreeBlock* pNext = pBlock->pNext;
+				free(pBlock);
+				pBlock = pNext;
+			}
+		}
+	}
+	//-----------------------------------------------------------------------------
+	SoAllocator_Arena::SoAllocator_Arena(soint64 nChunkSize)
+	:m_pChunkList(0)
+	,m_nChunkSize(nChunkSize > 0 ? nChunkSize : 65536)
+	,m_nAllocCount(0)
+	,m_nAllocBytes(0)
+	,m_nInUseCount(0)
+	,m_nInUseBytes(0)
+	,m_nChunkBytes(0)
+	{
+	}
+	//-----------------------------------------------------------------------------
+	SoAllocator_Arena::~SoAllocator_Arena()
+	{
+		Reset();
+		if (m_pChunkList)
+		{
+			free(m_pChunkList);
+			m_pChunkList = 0;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	void* SoAllocator_Arena::Alloc(soint64 nSize)
+	{
+		if (nSize < 0)
+		{
+			return 0;
+		}
+		const soint64 nChunkHeadSize = SoAllocator_AlignUp((soint64)sizeof(stChunk));
+		const soint64 nAlignedSize = SoAllocator_AlignUp(nSize > 0 ? nSize : 1);
+		SoAutoLock theAutoLock(m_Lock);
+		if (m_pChunkList == 0 || m_pChunkList->nUsed + nAlignedSize > m_pChunkList->nSize)
+		{
+			//当前内存块放不下，申请新的内存块。
+			const soint64 nChunkSize = (nAlignedSize > m_nChunkSize) ? nAlignedSize : m_nChunkSize;
+			stChunk* pChunk = (stChunk*)malloc((size_t)(nChunkHeadSize + nChunkSize));
+			if (pChunk == 0)
+			{
+				return 0;
+			}
+			pChunk->nSize = nChunkSize;
+			pChunk->nUsed = 0;
+			pChunk->pNext = m_pChunkList;
+			m_pChunkList = pChunk;
+			m_nChunkBytes += nChunkSize;
+		}
+		char* pAddress = (char*)m_pChunkList + nChunkHeadSize + m_pChunkList->nUsed;
+		m_pChunkList->nUsed += nAlignedSize;
+		++m_nAllocCount;
+		m_nAllocBytes += nSize;
+		++m_nInUseCount;
+		m_nInUseBytes += nSize;
+		return pAddress;
+	}
+	//-----------------------------------------------------------------------------
+	void SoAllocator_Arena::Free(void* /*pAddress*/)
+	{
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoAllocator_Arena::GetStats(stAllocatorStats* pStatsList, souint32 uiMaxCount)
+	{
+		if (pStatsList && uiMaxCount > 0)
+		{
+			SoAutoLock theAutoLock(m_Lock);
+			memset(pStatsList, 0, sizeof(stAllocatorStats));
+			pStatsList->nAllocCount = m_nAllocCount;
+			pStatsList->nAllocBytes = m_nAllocBytes;
+			pStatsList->nInUseCount = m_nInUseCount;
+			pStatsList->nInUseBytes = m_nInUseBytes;
+			//向系统申请了但还没有切分出去的部分。
+			pStatsList->nCachedBytes = m_nChunkBytes - m_nInUseBytes;
+		}
+		return 1;
+	}
+	//-----------------------------------------------------------------------------
+	void SoAllocator_Arena::Reset()
+	{
+		SoAutoLock theAutoLock(m_Lock);
+		stChunk* pKeep = 0;
+		stChunk* pChunk = m_pChunkList;
+		while (pChunk)
+		{
+			stChunk* pNext = pChunk->pNext;
+			if (pKeep == 0 && pChunk->nSize == m_nChunkSize)
+			{
+				pKeep = pChunk;
+			}
+			else
+			{
+				free(pChunk);
+			}
+			pChunk = pNext;
+		}
+		m_pChunkList = pKeep;
+		m_nChunkBytes = 0;
+		if (pKeep)
+		{
+			pKeep->pNext = 0;
+			pKeep->nUsed = 0;
+			m_nChunkBytes = pKeep->nSize;
+		}
+		m_nInUseCount = 0;
+		m_nInUseBytes = 0;
+	}
+	//-----------------------------------------------------------------------------
+	//放在文件作用域，避免函数内静态对象在多线程下的初始化问题。
+	static SoAllocator_Malloc s_theDefaultAllocator;
+	SoAllocator* SoAllocator_GetDefault()
+	{
+		return &s_theDefaultAllocator;
+	}
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,150 @@
+﻿//-----------------------------------------------------------------------------
+// SoAllocator
+// (C) oil
+// 2013-10-26
+//
+// 内存分配器接口，SoPackageFile申请的内存都通过它完成。
+// 1，SoAllocator_Malloc直接使用malloc/free，是默认的分配器。
+// 2，SoAllocator_Pool按大小分级，每一级维护一个空闲链表，释放的内存块留给下次使用，
+//    频繁地打开、读取、关闭文件时不会把堆弄得很零碎。
+// 3，SoAllocator_Arena从大块内存中顺序切分，Free什么也不做，Reset时一次性释放所有内存。
+//    适合每一帧（或者每个请求）读取的文件在结束时统一释放。
+// 所有分配器都是线程安全的，并且统计申请的次数和字节数。
+//-----------------------------------------------------------------------------
+#ifndef _SoAllocator_h_
+#define _SoAllocator_h_
+//-----------------------------------------------------------------------------
+#include "SoBaseTypeDefine.h"
+#include "SoThread.h"
+//-----------------------------------------------------------------------------
+//SoAllocator_Pool的分级：最小的内存块为2^SoAllocator_PoolMinShift字节，
+//最大的为2^SoAllocator_PoolMaxShift字节，更大的直接使用malloc。
+#define SoAllocator_PoolMinShift 6
+#define SoAllocator_PoolMaxShift 20
+#define SoAllocator_PoolClassCount (SoAllocator_PoolMaxShift - SoAllocator_PoolMinShift + 1)
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	//一类内存块的统计。
+	struct stAllocatorStats
+	{
+		//这一类内存块的大小，为0表示大小不固定。
+		soint64 nBlockSize;
+		//累计的申请次数和申请的字节数（调用者要求的字节数）。
+		soint64 nAllocCount;
+		soint64 nAllocBytes;
+		//正在使用的个数和字节数。
+		soint64 nInUseCount;
+		soint64 nInUseBytes;
+		//分配器保留的空闲内存块个数和字节数。
+		soint64 nCachedCount;
+		soint64 nCachedBytes;
+	};
+	//-----------------------------------------------------------------------------
+	class SoAllocator
+	{
+	public:
+		virtual ~SoAllocator() {}
+		//申请nSize个字节，按16字节对齐。失败返回0。
+		virtual void* Alloc(soint64 nSize) = 0;
+		//释放Alloc得到的内存，pAddress可以为0。
+		virtual void Free(void* pAddress) = 0;
+		//获取每一类内存块的统计，pStatsList最多填写uiMaxCount个元素，返回分类的个数。
+		virtual souint32 GetStats(stAllocatorStats* pStatsList, souint32 uiMaxCount) = 0;
+	};
+	//-----------------------------------------------------------------------------
+	//使用malloc/free，只有一类。
+	class SoAllocator_Malloc : public SoAllocator
+	{
+	public:
+		SoAllocator_Malloc();
+		virtual void* Alloc(soint64 nSize);
+		virtual void Free(void* pAddress);
+		virtual souint32 GetStats(stAllocatorStats* pStatsList, souint32 uiMaxCount);
+
+	private:
+		volatile soint64 m_nAllocCount;
+		volatile soint64 m_nAllocBytes;
+		volatile soint64 m_nInUseCount;
+		volatile soint64 m_nInUseBytes;
+	};
+	//-----------------------------------------------------------------------------
+	//按大小分级的内存池。最后一类是超过最大级别、直接使用malloc的内存块。
+	class SoAllocator_Pool : public SoAllocator
+	{
+	public:
+		//nMaxCachedBytes为每一级最多保留的空闲内存字节数，超过时直接释放。
+		SoAllocator_Pool(soint64 nMaxCachedBytes);
+		virtual ~SoAllocator_Pool();
+		virtual void* Alloc(soint64 nSize);
+		virtual void Free(void* pAddress);
+		virtual souint32 GetStats(stAllocatorStats* pStatsList, souint32 uiMaxCount);
+		//释放所有空闲的内存块。
+		void Trim();
+
+	private:
+		SoAllocator_Pool(const SoAllocator_Pool&);
+		SoAllocator_Pool& operator = (const SoAllocator_Pool&);
+		struct stFreeBlock
+		{
+			stFreeBlock* pNext;
+		};
+		struct stClass
+		{
+			stFreeBlock* pFreeList;
+			soint64 nCachedCount;
+			soint64 nAllocCount;
+			soint64 nAllocBytes;
+			soint64 nInUseCount;
+			soint64 nInUseBytes;
+			SoLock theLock;
+		};
+
+	private:
+		//最后一个元素是超过最大级别的内存块。
+		stClass m_ClassList[SoAllocator_PoolClassCount + 1];
+		soint64 m_nMaxCachedBytes;
+	};
+	//-----------------------------------------------------------------------------
+	//顺序切分的内存区，只有一类。
+	class SoAllocator_Arena : public SoAllocator
+	{
+	public:
+		//每次向系统申请nChunkSize个字节，比它大的申请单独占用一块。
+		SoAllocator_Arena(soint64 nChunkSize);
+		virtual ~SoAllocator_Arena();
+		virtual void* Alloc(soint64 nSize);
+		//什么也不做，内存在Reset时释放。
+		virtual void Free(void* pAddress);
+		virtual souint32 GetStats(stAllocatorStats* pStatsList, souint32 uiMaxCount);
+		//释放从上次Reset以来申请的所有内存。保留一块标准大小的内存给下次使用。
+		void Reset();
+
+	private:
+		SoAllocator_Arena(const SoAllocator_Arena&);
+		SoAllocator_Arena& operator = (const SoAllocator_Arena&);
+		struct stChunk
+		{
+			stChunk* pNext;
+			soint64 nSize;
+			soint64 nUsed;
+		};
+
+	private:
+		//m_pChunkList为当前正在切分的内存块。
+		stChunk* m_pChunkList;
+		soint64 m_nChunkSize;
+		soint64 m_nAllocCount;
+		soint64 m_nAllocBytes;
+		soint64 m_nInUseCount;
+		soint64 m_nInUseBytes;
+		soint64 m_nChunkBytes;
+		SoLock m_Lock;
+	};
+	//-----------------------------------------------------------------------------
+	//默认的分配器，即全局的SoAllocator_Malloc对象。
+	SoAllocator* SoAllocator_GetDefault();
+}
+//-----------------------------------------------------------------------------
+#endif //_SoAllocator_h_
+//-----------------------------------------------------------------------------
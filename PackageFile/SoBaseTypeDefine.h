@@ -4,9 +4,13 @@
 //-----------------------------------------------------------------------------
 #ifndef _SoBaseTypeDefine_h_
 #define _SoBaseTypeDefine_h_
+#if !defined(_MSC_VER)
+#include <stdint.h>
+#endif
 //-----------------------------------------------------------------------------
 namespace GGUI
 {
+#if defined(_MSC_VER)
 	typedef char    soint8;
 	typedef __int16 soint16;
 	typedef __int32 soint32;
@@ -18,6 +22,19 @@ namespace GGUI
 	typedef unsigned __int32 souint32;
 	typedef unsigned __int64 souint64;
 	typedef unsigned __int32 souint;
+#else
+	typedef char     soint8;
+	typedef int16_t  soint16;
+	typedef int32_t  soint32;
+	typedef int64_t  soint64;
+	typedef int32_t  soint;
+	//
+	typedef unsigned char souint8;
+	typedef uint16_t souint16;
+	typedef uint32_t souint32;
+	typedef uint64_t souint64;
+	typedef uint32_t souint;
+#endif
 	//
 	typedef float sofloat; //32λĸȷ6λЧ֡
 	typedef double sodouble; //64λĸȷ16λЧ֡
@@ -0,0 +1,233 @@
+﻿//-----------------------------------------------------------------------------
+// SoEntryCache
+// (C) oil
+// 2013-10-24
+//-----------------------------------------------------------------------------
+#include "SoEntryCache.h"
+#include <stdlib.h>
+#include <string.h>
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	//-----------------------------------------------------------------------------
+	SoEntryCache::SoEntryCache()
+	:m_pEntryList(0)
+	,m_nEntryCount(0)
+	,m_pHead(0)
+	,m_pTail(0)
+	,m_nSize(0)
+	,m_nMaxSize(0)
+	,m_pAllocator(SoAllocator_GetDefault())
+	,m_pEvictCallback(0)
+	,m_pEvictUserData(0)
+	,m_nLockWaitTime(0)
+	{
+	}
+	//-----------------------------------------------------------------------------
+	SoEntryCache::~SoEntryCache()
+	{
+		Release();
+	}
+	//-----------------------------------------------------------------------------
+	bool SoEntryCache::Init(soint64 nEntryCount, soint64 nMaxSize, SoAllocator* pAllocator)
+	{
+		Release();
+		if (nEntryCount <= 0 || nMaxSize <= 0)
+		{
+			return false;
+		}
+		SoTimedAutoLock theAutoLock(m_Lock, &m_nLockWaitTime);
+		m_pEntryList = (stEntry**)calloc((size_t)nEntryCount, sizeof(stEntry*));
+		if (m_pEntryList == 0)
+		{
+			return false;
+		}
+		m_nEntryCount = nEntryCount;
+		m_nMaxSize = nMaxSize;
+		m_pAllocator = pAllocator ? pAllocator : SoAllocator_GetDefault();
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	void SoEntryCache::Release()
+	{
+		SoTimedAutoLock theAutoLock(m_Lock, &m_nLockWaitTime);
+		Clear();
+		if (m_pEntryList)
+		{
+			free(m_pEntryList);
+			m_pEntryList = 0;
+		}
+		m_nEntryCount = 0;
+		m_nMaxSize = 0;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoEntryCache::Insert(soint64 nFileID, char* pBuff, soint64 nSize)
+	{
+		SoTimedAutoLock theAutoLock(m_Lock, &m_nLockWaitTime);
+		return (InsertEntry(nFileID, pBuff, nSize) != 0);
+	}
+	//-----------------------------------------------------------------------------
+	void* SoEntryCache::Acquire(soint64 nFileID, const char*& pBuff, soint64& nSize)
+	{
+		SoTimedAutoLock theAutoLock(m_Lock, &m_nLockWaitTime);
+		if (nFileID < 0 || nFileID >= m_nEntryCount || m_pEntryList[nFileID] == 0)
+		{
+			return 0;
+		}
+		stEntry* pEntry = m_pEntryList[nFileID];
+		++pEntry->nRefCount;
+		Unlink(pEntry);
+		PushFront(pEntry);
+		pBuff = pEntry->pBuff;
+		nSize = pEntry->nSize;
+		return pEntry;
+	}
+	//-----------------------------------------------------------------------------
+	void* SoEntryCache::InsertAndAcquire(soint64 nFileID, char* pBuff, soint64 nSize)
+	{
+		SoTimedAutoLock theAutoLock(m_Lock, &m_nLockWaitTime);
+		stEntry* pEntry = InsertEntry(nFileID, pBuff, nSize);
+		if (pEntry)
+		{
+			++pEntry->nRefCount;
+		}
+		return pEntry;
+	}
+	//-----------------------------------------------------------------------------
+	void SoEntryCache::Unacquire(void* pHandle)
+	{
+		if (pHandle == 0)
+		{
+			return;
+		}
+		stEntry* pEntry = (stEntry*)pHandle;
+		SoTimedAutoLock theAutoLock(m_Lock, &m_nLockWaitTime);
+		--pEntry->nRefCount;
+		if (pEntry->nRefCount == 0 && pEntry->bEvicted)
+		{
+			SoAtomic_Add64(&m_nSize, -pEntry->nSize);
+			pEntry->pAllocator->Free(pEntry->pBuff);
+			delete pEntry;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	bool SoEntryCache::Contains(soint64 nFileID)
+	{
+		SoTimedAutoLock theAutoLock(m_Lock, &m_nLockWaitTime);
+		return (nFileID >= 0 && nFileID < m_nEntryCount && m_pEntryList[nFileID] != 0);
+	}
+	//-----------------------------------------------------------------------------
+	void SoEntryCache::Clear()
+	{
+		SoTimedAutoLock theAutoLock(m_Lock, &m_nLockWaitTime);
+		while (m_pTail)
+		{
+			Evict(m_pTail);
+		}
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoEntryCache::GetSize() const
+	{
+		return m_nSize;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoEntryCache::GetMaxSize() const
+	{
+		return m_nMaxSize;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoEntryCache::GetLockWaitTime() const
+	{
+		return SoAtomic_Load64(&m_nLockWaitTime);
+	}
+	//-----------------------------------------------------------------------------
+	void SoEntryCache::SetEvictCallback(EvictCallback pCallback, void* pUserData)
+	{
+		SoTimedAutoLock theAutoLock(m_Lock, &m_nLockWaitTime);
+		m_pEvictCallback = pCallback;
+		m_pEvictUserData = pUserData;
+	}
+	//-----------------------------------------------------------------------------
+	SoEntryCache::stEntry* SoEntryCache::InsertEntry(soint64 nFileID, char* pBuff, soint64 nSize)
+	{
+		if (nFileID < 0 || nFileID >= m_nEntryCount || pBuff == 0 || nSize > m_nMaxSize)
+		{
+			return 0;
+		}
+		if (m_pEntryList[nFileID])
+		{
+			return 0;
+		}
+		//淘汰最久没有被访问的文件，直到放得下。
+		while (m_pTail && m_nSize + nSize > m_nMaxSize)
+		{
+			Evict(m_pTail);
+		}
+		stEntry* pEntry = new stEntry;
+		pEntry->nFileID = nFileID;
+		pEntry->pBuff = pBuff;
+		pEntry->nSize = nSize;
+		pEntry->nRefCount = 0;
+		pEntry->bEvicted = false;
+		pEntry->pAllocator = m_pAllocator;
+		PushFront(pEntry);
+		m_pEntryList[nFileID] = pEntry;
+		SoAtomic_Add64(&m_nSize, nSize);
+		return pEntry;
+	}
+	//-----------------------------------------------------------------------------
+	void SoEntryCache::Unlink(stEntry* pEntry)
+	{
+		if (pEntry->pPrev)
+		{
+			pEntry->pPrev->pNext = pEntry->pNext;
+		}
+		else
+		{
+			m_pHead = pEntry->pNext;
+		}
+		if (pEntry->pNext)
+		{
+			pEntry->pNext->pPrev = pEntry->pPrev;
+		}
+		else
+		{
+			m_pTail = pEntry->pPrev;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	void SoEntryCache::PushFront(stEntry* pEntry)
+	{
+		pEntry->pPrev = 0;
+		pEntry->pNext = m_pHead;
+		if (m_pHead)
+		{
+			m_pHead->pPrev = pEntry;
+		}
+		else
+		{
+			m_pTail = pEntry;
+		}
+		m_pHead = pEntry;
+	}
+	//-----------------------------------------------------------------------------
+	void SoEntryCache::Evict(stEntry* pEntry)
+	{
+		Unlink(pEntry);
+		m_pEntryList[pEntry->nFileID] = 0;
+		if (m_pEvictCallback)
+		{
+			m_pEvictCallback(pEntry->nFileID, pEntry->nSize, m_pEvictUserData);
+		}
+		if (pEntry->nRefCount > 0)
+		{
+			//还被引用着，等到Unacquire时再释放，内存释放之前一直计入m_nSize。
+			pEntry->bEvicted = true;
+			return;
+		}
+		SoAtomic_Add64(&m_nSize, -pEntry->nSize);
+		pEntry->pAllocator->Free(pEntry->pBuff);
+		delete pEntry;
+	}
+}
+//-----------------------------------------------------------------------------
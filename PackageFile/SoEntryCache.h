@@ -0,0 +1,96 @@
+﻿//-----------------------------------------------------------------------------
+// SoEntryCache
+// (C) oil
+// 2013-10-24
+//
+// 解压缩之后的SingleFile缓存，按照FileID索引。
+// 缓存总字节数超过上限时，淘汰最久没有被访问的文件（LRU）。
+// 所有函数都是线程安全的。
+// 文件内容可以被引用（Acquire），被引用的文件仍然可以被淘汰，但内存要等到引用全部释放之后才释放。
+// 这部分内存在释放之前仍然计入缓存的字节数，被引用的内存太多时缓存会暂时超过上限。
+//-----------------------------------------------------------------------------
+#ifndef _SoEntryCache_h_
+#define _SoEntryCache_h_
+//-----------------------------------------------------------------------------
+#include "SoBaseTypeDefine.h"
+#include "SoThread.h"
+#include "SoAllocator.h"
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	class SoEntryCache
+	{
+	public:
+		//文件被淘汰（包括Clear和Release）时的通知，在缓存的锁内调用，不能再调用缓存的函数。
+		typedef void (*EvictCallback)(soint64 nFileID, soint64 nSize, void* pUserData);
+
+	public:
+		SoEntryCache();
+		~SoEntryCache();
+		//nEntryCount为FileID的个数，nMaxSize为缓存的字节数上限。
+		//缓存的内存都由pAllocator申请和释放，为0时使用默认的分配器。
+		bool Init(soint64 nEntryCount, soint64 nMaxSize, SoAllocator* pAllocator);
+		void Release();
+		//放入一个文件，pBuff必须是Init时指定的分配器申请的内存。
+		//返回true时缓存接管pBuff；返回false时（文件已经在缓存中，或者文件太大）调用者负责释放pBuff。
+		bool Insert(soint64 nFileID, char* pBuff, soint64 nSize);
+		//如果文件在缓存中，则引用文件内容，返回引用句柄，否则返回0。
+		//引用期间pBuff一直有效，使用完毕后调用Unacquire。
+		void* Acquire(soint64 nFileID, const char*& pBuff, soint64& nSize);
+		//放入一个文件并引用它。返回0时（与Insert返回false的情况相同）调用者负责释放pBuff。
+		void* InsertAndAcquire(soint64 nFileID, char* pBuff, soint64 nSize);
+		//释放Acquire或者InsertAndAcquire得到的引用。可以在Clear和Release之后调用。
+		void Unacquire(void* pHandle);
+		bool Contains(soint64 nFileID);
+		//清空缓存，Init的设置保持不变。
+		void Clear();
+		//缓存占用的字节数，包括已经被淘汰但还被引用着的文件。
+		soint64 GetSize() const;
+		soint64 GetMaxSize() const;
+		//各个线程等待缓存的锁的累计时间，单位为纳秒。
+		soint64 GetLockWaitTime() const;
+		void SetEvictCallback(EvictCallback pCallback, void* pUserData);
+
+	private:
+		SoEntryCache(const SoEntryCache&);
+		SoEntryCache& operator = (const SoEntryCache&);
+		struct stEntry
+		{
+			soint64 nFileID;
+			char* pBuff;
+			soint64 nSize;
+			//被引用的次数。
+			soint32 nRefCount;
+			//已经被淘汰，引用全部释放时释放内存。
+			bool bEvicted;
+			//被淘汰之后缓存可能已经重新Init，所以每个文件记录自己的分配器。
+			SoAllocator* pAllocator;
+			//LRU链表，m_pHead为最近访问的文件。
+			stEntry* pPrev;
+			stEntry* pNext;
+		};
+		//以下函数在m_Lock内调用。
+		stEntry* InsertEntry(soint64 nFileID, char* pBuff, soint64 nSize);
+		void Unlink(stEntry* pEntry);
+		void PushFront(stEntry* pEntry);
+		void Evict(stEntry* pEntry);
+
+	private:
+		//按FileID索引。
+		stEntry** m_pEntryList;
+		soint64 m_nEntryCount;
+		stEntry* m_pHead;
+		stEntry* m_pTail;
+		//只在m_Lock内修改，GetSize不加锁读取，所以用原子操作修改。
+		volatile soint64 m_nSize;
+		soint64 m_nMaxSize;
+		SoAllocator* m_pAllocator;
+		EvictCallback m_pEvictCallback;
+		void* m_pEvictUserData;
+		volatile soint64 m_nLockWaitTime;
+		SoLock m_Lock;
+	};
+}
+//-----------------------------------------------------------------------------
+#endif //_SoEntryCache_h_
+//-----------------------------------------------------------------------------
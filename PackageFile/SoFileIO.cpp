@@ -0,0 +1,519 @@
+﻿//-----------------------------------------------------------------------------
+// SoFileIO
+// (C) oil
+// 2013-10-21
+//-----------------------------------------------------------------------------
+#if !defined(_WIN32)
+//32位系统上也使用64位的文件偏移量。必须在包含系统头文件之前定义。
+#define _FILE_OFFSET_BITS 64
+#endif
+#include "SoFileIO.h"
+#include <errno.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+//-----------------------------------------------------------------------------
+//CopyFrom一次系统调用复制的字节数上限，sendfile一次最多复制0x7FFFF000个字节。
+#define SoFileIO_MaxCopySize (1024*1024*1024)
+//SoFileIO_MakeParentDir能处理的路径长度。
+#define SoFileIO_MaxPath 1024
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	//-----------------------------------------------------------------------------
+	SoFileIO_Stdio::SoFileIO_Stdio()
+	:m_pFile(0)
+	{
+	}
+	//-----------------------------------------------------------------------------
+	SoFileIO_Stdio::~SoFileIO_Stdio()
+	{
+		Close();
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Stdio::Open(const char* pszFile, OpenMode eMode)
+	{
+		if (m_pFile)
+		{
+			return false;
+		}
+		const char* pszMode = "rb";
+		if (eMode == Open_ReadWrite)
+		{
+			pszMode = "r+b";
+		}
+		else if (eMode == Open_Create)
+		{
+			pszMode = "w+b";
+		}
+		m_pFile = fopen(pszFile, pszMode);
+		return (m_pFile != 0);
+	}
+	//-----------------------------------------------------------------------------
+	void SoFileIO_Stdio::Close()
+	{
+		if (m_pFile)
+		{
+			fclose(m_pFile);
+			m_pFile = 0;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Stdio::IsOpen() const
+	{
+		return (m_pFile != 0);
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoFileIO_Stdio::ReadAt(void* pBuff, soint64 nSize, soint64 nOffset)
+	{
+		SoAutoLock theAutoLock(m_Lock);
+		if (!SeekTo(nOffset))
+		{
+			return -1;
+		}
+		return (soint64)fread(pBuff, 1, (size_t)nSize, m_pFile);
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoFileIO_Stdio::WriteAt(const void* pBuff, soint64 nSize, soint64 nOffset)
+	{
+		SoAutoLock theAutoLock(m_Lock);
+		if (!SeekTo(nOffset))
+		{
+			return -1;
+		}
+		return (soint64)fwrite(pBuff, 1, (size_t)nSize, m_pFile);
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoFileIO_Stdio::GetSize()
+	{
+		SoAutoLock theAutoLock(m_Lock);
+		if (m_pFile == 0)
+		{
+			return -1;
+		}
+#if defined(_WIN32)
+		if (_fseeki64(m_pFile, 0, SEEK_END) != 0)
+		{
+			return -1;
+		}
+		return _ftelli64(m_pFile);
+#else
+		if (fseeko(m_pFile, 0, SEEK_END) != 0)
+		{
+			return -1;
+		}
+		return (soint64)ftello(m_pFile);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Stdio::Flush()
+	{
+		SoAutoLock theAutoLock(m_Lock);
+		return (m_pFile != 0 && fflush(m_pFile) == 0);
+	}
+	//-----------------------------------------------------------------------------
+	void SoFileIO_Stdio::Advise(soint64 /*nOffset*/, soint64 /*nSize*/, AccessHint /*eHint*/)
+	{
+		//C标准库没有对应的功能。
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Stdio::IsConcurrentRead() const
+	{
+		return false;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Stdio::SeekTo(soint64 nOffset)
+	{
+		if (m_pFile == 0)
+		{
+			return false;
+		}
+#if defined(_WIN32)
+		return (_fseeki64(m_pFile, nOffset, SEEK_SET) == 0);
+#else
+		return (fseeko(m_pFile, (off_t)nOffset, SEEK_SET) == 0);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+#if !defined(_WIN32)
+	SoFileIO_Posix::SoFileIO_Posix()
+	:m_nFD(-1)
+	,m_pMapped(0)
+	,m_nMappedSize(0)
+	{
+	}
+	//-----------------------------------------------------------------------------
+	SoFileIO_Posix::~SoFileIO_Posix()
+	{
+		Close();
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Posix::Open(const char* pszFile, OpenMode eMode)
+	{
+		if (m_nFD != -1)
+		{
+			return false;
+		}
+		int nFlags = O_RDONLY;
+		if (eMode == Open_ReadWrite)
+		{
+			nFlags = O_RDWR;
+		}
+		else if (eMode == Open_Create)
+		{
+			nFlags = O_RDWR | O_CREAT | O_TRUNC;
+		}
+#if defined(O_CLOEXEC)
+		nFlags |= O_CLOEXEC;
+#endif
+		do
+		{
+			m_nFD = open(pszFile, nFlags, 0644);
+		} while (m_nFD == -1 && errno == EINTR);
+		return (m_nFD != -1);
+	}
+	//-----------------------------------------------------------------------------
+	void SoFileIO_Posix::Close()
+	{
+		if (m_pMapped)
+		{
+			munmap(m_pMapped, (size_t)m_nMappedSize);
+			m_pMapped = 0;
+			m_nMappedSize = 0;
+		}
+		if (m_nFD != -1)
+		{
+			close(m_nFD);
+			m_nFD = -1;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Posix::IsOpen() const
+	{
+		return (m_nFD != -1);
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoFileIO_Posix::ReadAt(void* pBuff, soint64 nSize, soint64 nOffset)
+	{
+		//pread一次可能读不完，循环读取直到读满或者到达文件末尾。
+		soint64 nTotal = 0;
+		while (nTotal < nSize)
+		{
+			const ssize_t nResult = pread(m_nFD, (char*)pBuff + nTotal, (size_t)(nSize - nTotal), (off_t)(nOffset + nTotal));
+			if (nResult > 0)
+			{
+				nTotal += nResult;
+			}
+			else if (nResult == 0)
+			{
+				//到达文件末尾。
+				break;
+			}
+			else if (errno != EINTR)
+			{
+				return -1;
+			}
+		}
+		return nTotal;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoFileIO_Posix::WriteAt(const void* pBuff, soint64 nSize, soint64 nOffset)
+	{
+		soint64 nTotal = 0;
+		while (nTotal < nSize)
+		{
+			const ssize_t nResult = pwrite(m_nFD, (const char*)pBuff + nTotal, (size_t)(nSize - nTotal), (off_t)(nOffset + nTotal));
+			if (nResult > 0)
+			{
+				nTotal += nResult;
+			}
+			else if (nResult == 0)
+			{
+				//无法继续写入，例如磁盘已满。
+				break;
+			}
+			else if (errno != EINTR)
+			{
+				return -1;
+			}
+		}
+		return nTotal;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoFileIO_Posix::GetSize()
+	{
+		struct stat theStat;
+		if (fstat(m_nFD, &theStat) != 0)
+		{
+			return -1;
+		}
+		return (soint64)theStat.st_size;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Posix::Flush()
+	{
+		//没有用户态缓存，数据已经交给了操作系统。
+		return (m_nFD != -1);
+	}
+	//-----------------------------------------------------------------------------
+	void SoFileIO_Posix::Advise(soint64 nOffset, soint64 nSize, AccessHint eHint)
+	{
+#if defined(POSIX_FADV_NORMAL)
+		int nAdvice = POSIX_FADV_NORMAL;
+		switch (eHint)
+		{
+		case Access_Sequential:
+			nAdvice = POSIX_FADV_SEQUENTIAL;
+			break;
+		case Access_Random:
+			nAdvice = POSIX_FADV_RANDOM;
+			break;
+		case Access_WillNeed:
+			nAdvice = POSIX_FADV_WILLNEED;
+			break;
+		case Access_DontNeed:
+			nAdvice = POSIX_FADV_DONTNEED;
+			break;
+		default:
+			break;
+		}
+		posix_fadvise(m_nFD, (off_t)nOffset, (off_t)nSize, nAdvice);
+#else
+		(void)nOffset;
+		(void)nSize;
+		(void)eHint;
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Posix::IsConcurrentRead() const
+	{
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	int SoFileIO_Posix::GetFD() const
+	{
+		return m_nFD;
+	}
+	//-----------------------------------------------------------------------------
+	const char* SoFileIO_Posix::MapReadOnly()
+	{
+		SoAutoLock theAutoLock(m_MapLock);
+		if (m_pMapped || m_nFD == -1)
+		{
+			return (const char*)m_pMapped;
+		}
+		const soint64 nSize = GetSize();
+		if (nSize <= 0 || (souint64)nSize != (souint64)(size_t)nSize)
+		{
+			//文件为空，或者32位系统上文件太大。
+			return 0;
+		}
+		void* pMapped = mmap(0, (size_t)nSize, PROT_READ, MAP_SHARED, m_nFD, 0);
+		if (pMapped == MAP_FAILED)
+		{
+			return 0;
+		}
+		m_pMapped = pMapped;
+		m_nMappedSize = nSize;
+		return (const char*)m_pMapped;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoFileIO_Posix::CopyFrom(SoFileIO* pSrc, soint64 nSrcOffset, soint64 nSize, soint64 nDestOffset)
+	{
+		const int nSrcFD = pSrc ? pSrc->GetFD() : -1;
+		if (nSrcFD == -1 || m_nFD == -1)
+		{
+			return -1;
+		}
+#if defined(__linux__)
+		soint64 nTotal = 0;
+#if defined(__NR_copy_file_range)
+		bool bCopyRange = true;
+#else
+		bool bCopyRange = false;
+#endif
+		bool bSendFile = true;
+		while (nTotal < nSize)
+		{
+			const size_t nRequest = (size_t)((nSize - nTotal < SoFileIO_MaxCopySize) ? (nSize - nTotal) : SoFileIO_MaxCopySize);
+			ssize_t nResult = -1;
+			if (bCopyRange)
+			{
+#if defined(__NR_copy_file_range)
+				//glibc 2.27之前没有copy_file_range的封装，直接使用系统调用。
+				loff_t nInOffset = (loff_t)(nSrcOffset + nTotal);
+				loff_t nOutOffset = (loff_t)(nDestOffset + nTotal);
+				nResult = (ssize_t)syscall(__NR_copy_file_range, nSrcFD, &nInOffset, m_nFD, &nOutOffset, nRequest, 0u);
+				if (nResult < 0 && errno != EINTR)
+				{
+					//ENOSYS、EXDEV、EINVAL等，换用sendfile继续复制。
+					bCopyRange = false;
+					continue;
+				}
+#endif
+			}
+			else if (bSendFile)
+			{
+				//sendfile写入输出文件的当前位置。
+				off_t nInOffset = (off_t)(nSrcOffset + nTotal);
+				if (lseek(m_nFD, (off_t)(nDestOffset + nTotal), SEEK_SET) == (off_t)-1)
+				{
+					break;
+				}
+				nResult = sendfile(m_nFD, nSrcFD, &nInOffset, nRequest);
+				if (nResult < 0 && errno != EINTR)
+				{
+					bSendFile = false;
+					continue;
+				}
+			}
+			else
+			{
+				break;
+			}
+			if (nResult > 0)
+			{
+				nTotal += nResult;
+			}
+			else if (nResult == 0)
+			{
+				//到达源文件末尾。
+				break;
+			}
+		}
+		return (nTotal > 0) ? nTotal : -1;
+#else
+		(void)nSrcOffset;
+		(void)nSize;
+		(void)nDestOffset;
+		return -1;
+#endif
+	}
+#endif
+	//-----------------------------------------------------------------------------
+	SoFileIO_Memory::SoFileIO_Memory(const void* pData, soint64 nSize)
+	:m_pData((const char*)pData)
+	,m_nSize((pData && nSize > 0) ? nSize : 0)
+	,m_bOpen(false)
+	{
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Memory::Open(const char* /*pszFile*/, OpenMode eMode)
+	{
+		if (m_bOpen || eMode != Open_Read)
+		{
+			return false;
+		}
+		m_bOpen = true;
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	void SoFileIO_Memory::Close()
+	{
+		m_bOpen = false;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Memory::IsOpen() const
+	{
+		return m_bOpen;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoFileIO_Memory::ReadAt(void* pBuff, soint64 nSize, soint64 nOffset)
+	{
+		if (!m_bOpen || nSize < 0 || nOffset < 0)
+		{
+			return -1;
+		}
+		if (nOffset >= m_nSize)
+		{
+			return 0;
+		}
+		const soint64 nRead = (nSize < m_nSize - nOffset) ? nSize : (m_nSize - nOffset);
+		memcpy(pBuff, m_pData + nOffset, (size_t)nRead);
+		return nRead;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoFileIO_Memory::WriteAt(const void* /*pBuff*/, soint64 /*nSize*/, soint64 /*nOffset*/)
+	{
+		return -1;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoFileIO_Memory::GetSize()
+	{
+		return m_bOpen ? m_nSize : -1;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Memory::Flush()
+	{
+		return m_bOpen;
+	}
+	//-----------------------------------------------------------------------------
+	void SoFileIO_Memory::Advise(soint64 /*nOffset*/, soint64 /*nSize*/, AccessHint /*eHint*/)
+	{
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_Memory::IsConcurrentRead() const
+	{
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	const char* SoFileIO_Memory::MapReadOnly()
+	{
+		return (m_bOpen && m_nSize > 0) ? m_pData : 0;
+	}
+	//-----------------------------------------------------------------------------
+	SoFileIO* SoFileIO_Create(SoFileIO::Backend eBackend)
+	{
+#if !defined(_WIN32)
+		if (eBackend == SoFileIO::Backend_Default || eBackend == SoFileIO::Backend_Native)
+		{
+			return new SoFileIO_Posix;
+		}
+#endif
+		return new SoFileIO_Stdio;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_MakeDir(const char* pszDir)
+	{
+#if defined(_WIN32)
+		return (_mkdir(pszDir) == 0 || errno == EEXIST);
+#else
+		return (mkdir(pszDir, 0755) == 0 || errno == EEXIST);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	bool SoFileIO_MakeParentDir(const char* pszPath)
+	{
+		char szDir[SoFileIO_MaxPath];
+		const size_t nLength = strlen(pszPath);
+		if (nLength >= sizeof(szDir))
+		{
+			return false;
+		}
+		memcpy(szDir, pszPath, nLength + 1);
+		//从第二个字符开始，跳过绝对路径开头的'/'。
+		bool bOK = true;
+		for (size_t i=1; i<nLength; ++i)
+		{
+			if (szDir[i] == '/' || szDir[i] == '\\')
+			{
+				szDir[i] = 0;
+				bOK = SoFileIO_MakeDir(szDir);
+				szDir[i] = '/';
+			}
+		}
+		return bOK;
+	}
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,181 @@
+﻿//-----------------------------------------------------------------------------
+// SoFileIO
+// (C) oil
+// 2013-10-21
+//
+// 磁盘文件的读写接口。
+// 1，所有读写操作都指定文件偏移量（positional I/O），不依赖共享的文件指针。
+// 2，SoFileIO_Stdio使用C标准库实现，在任何平台上都可以使用；读写时需要加锁。
+// 3，SoFileIO_Posix使用open/pread/pwrite/fstat实现，没有C标准库的缓存，
+//    多个线程可以同时执行ReadAt，不需要加锁。
+// 4，SoFileIO_Posix支持把整个文件只读地映射到内存（MapReadOnly）。
+// 5，SoFileIO_Memory把调用者的一块内存当作只读文件，用于把内存中的数据直接写入资源包。
+// 6，SoFileIO_Posix在Linux下支持在内核中复制两个文件之间的数据（CopyFrom），不经过用户态的缓存。
+//-----------------------------------------------------------------------------
+#ifndef _SoFileIO_h_
+#define _SoFileIO_h_
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include "SoBaseTypeDefine.h"
+#include "SoThread.h"
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	class SoFileIO
+	{
+	public:
+		enum Backend
+		{
+			//根据平台自动选择，有原生实现时使用原生实现。
+			Backend_Default,
+			//C标准库。
+			Backend_Stdio,
+			//操作系统原生的文件接口。目前只有POSIX平台有原生实现。
+			Backend_Native,
+		};
+		enum OpenMode
+		{
+			//只读，文件必须存在。
+			Open_Read,
+			//读写，文件必须存在。
+			Open_ReadWrite,
+			//读写，文件不存在则创建，已存在则清空。
+			Open_Create,
+		};
+		//告诉操作系统接下来将如何访问文件，便于调整预读策略。
+		enum AccessHint
+		{
+			Access_Normal,
+			//顺序访问，例如打包时读取源文件。
+			Access_Sequential,
+			//随机访问，例如Mode_Read模式下按需读取各个SingleFile。
+			Access_Random,
+			//这段数据很快就会被访问，可以提前读入。
+			Access_WillNeed,
+			//这段数据不会再被访问，可以从系统缓存中移除。
+			Access_DontNeed,
+		};
+
+	public:
+		virtual ~SoFileIO() {}
+		virtual bool Open(const char* pszFile, OpenMode eMode) = 0;
+		virtual void Close() = 0;
+		virtual bool IsOpen() const = 0;
+		//从nOffset位置读取nSize个字节。返回实际读取的字节数，失败返回-1。
+		virtual soint64 ReadAt(void* pBuff, soint64 nSize, soint64 nOffset) = 0;
+		//向nOffset位置写入nSize个字节。返回实际写入的字节数，失败返回-1。
+		virtual soint64 WriteAt(const void* pBuff, soint64 nSize, soint64 nOffset) = 0;
+		//获取文件大小。失败返回-1。
+		virtual soint64 GetSize() = 0;
+		virtual bool Flush() = 0;
+		//访问模式提示。nSize为0表示从nOffset到文件末尾。不支持时什么也不做。
+		virtual void Advise(soint64 nOffset, soint64 nSize, AccessHint eHint) = 0;
+		//多个线程同时执行ReadAt时是否互不阻塞。
+		virtual bool IsConcurrentRead() const = 0;
+		//POSIX文件描述符，供io_uring等系统接口使用。没有文件描述符时返回-1。
+		virtual int GetFD() const
+		{
+			return -1;
+		}
+		//把整个文件只读地映射到内存，返回映射的起始地址。第一次调用时映射，Close时解除映射。
+		//不支持、文件为空或者映射失败时返回0。映射之后不能再修改文件大小。
+		virtual const char* MapReadOnly()
+		{
+			return 0;
+		}
+		//把pSrc从nSrcOffset开始的nSize个字节复制到本文件的nDestOffset位置，数据不经过用户态。
+		//返回复制的字节数，可能少于nSize，剩下的由调用者自己读写；不支持时返回-1。
+		virtual soint64 CopyFrom(SoFileIO* /*pSrc*/, soint64 /*nSrcOffset*/, soint64 /*nSize*/, soint64 /*nDestOffset*/)
+		{
+			return -1;
+		}
+	};
+	//-----------------------------------------------------------------------------
+	//使用C标准库实现，所有平台都可以使用。
+	class SoFileIO_Stdio : public SoFileIO
+	{
+	public:
+		SoFileIO_Stdio();
+		virtual ~SoFileIO_Stdio();
+		virtual bool Open(const char* pszFile, OpenMode eMode);
+		virtual void Close();
+		virtual bool IsOpen() const;
+		virtual soint64 ReadAt(void* pBuff, soint64 nSize, soint64 nOffset);
+		virtual soint64 WriteAt(const void* pBuff, soint64 nSize, soint64 nOffset);
+		virtual soint64 GetSize();
+		virtual bool Flush();
+		virtual void Advise(soint64 nOffset, soint64 nSize, AccessHint eHint);
+		virtual bool IsConcurrentRead() const;
+
+	private:
+		bool SeekTo(soint64 nOffset);
+
+	private:
+		FILE* m_pFile;
+		//FILE的文件指针是共享的，移动文件指针和读写数据必须一起完成。
+		SoLock m_Lock;
+	};
+	//-----------------------------------------------------------------------------
+#if !defined(_WIN32)
+	//使用POSIX接口实现。
+	class SoFileIO_Posix : public SoFileIO
+	{
+	public:
+		SoFileIO_Posix();
+		virtual ~SoFileIO_Posix();
+		virtual bool Open(const char* pszFile, OpenMode eMode);
+		virtual void Close();
+		virtual bool IsOpen() const;
+		virtual soint64 ReadAt(void* pBuff, soint64 nSize, soint64 nOffset);
+		virtual soint64 WriteAt(const void* pBuff, soint64 nSize, soint64 nOffset);
+		virtual soint64 GetSize();
+		virtual bool Flush();
+		virtual void Advise(soint64 nOffset, soint64 nSize, AccessHint eHint);
+		virtual bool IsConcurrentRead() const;
+		virtual int GetFD() const;
+		virtual const char* MapReadOnly();
+		//优先使用copy_file_range，不支持时（例如跨文件系统的老内核）使用sendfile。
+		virtual soint64 CopyFrom(SoFileIO* pSrc, soint64 nSrcOffset, soint64 nSize, soint64 nDestOffset);
+
+	private:
+		int m_nFD;
+		void* m_pMapped;
+		soint64 m_nMappedSize;
+		//多个线程可能同时第一次调用MapReadOnly。
+		SoLock m_MapLock;
+	};
+#endif
+	//-----------------------------------------------------------------------------
+	//只读的内存文件。不复制也不释放pData，使用期间调用者必须保证它有效。
+	//Open忽略文件名，只支持Open_Read。
+	class SoFileIO_Memory : public SoFileIO
+	{
+	public:
+		SoFileIO_Memory(const void* pData, soint64 nSize);
+		virtual bool Open(const char* pszFile, OpenMode eMode);
+		virtual void Close();
+		virtual bool IsOpen() const;
+		virtual soint64 ReadAt(void* pBuff, soint64 nSize, soint64 nOffset);
+		virtual soint64 WriteAt(const void* pBuff, soint64 nSize, soint64 nOffset);
+		virtual soint64 GetSize();
+		virtual bool Flush();
+		virtual void Advise(soint64 nOffset, soint64 nSize, AccessHint eHint);
+		virtual bool IsConcurrentRead() const;
+		virtual const char* MapReadOnly();
+
+	private:
+		const char* m_pData;
+		soint64 m_nSize;
+		bool m_bOpen;
+	};
+	//-----------------------------------------------------------------------------
+	//创建指定类型的SoFileIO对象，使用完毕后用delete释放。
+	SoFileIO* SoFileIO_Create(SoFileIO::Backend eBackend);
+	//创建一级目录，目录已经存在也返回true。
+	bool SoFileIO_MakeDir(const char* pszDir);
+	//创建文件pszPath所在的各级目录，'/'和'\\'都是分隔符。
+	bool SoFileIO_MakeParentDir(const char* pszPath);
+}
+//-----------------------------------------------------------------------------
+#endif //_SoFileIO_h_
+//-----------------------------------------------------------------------------
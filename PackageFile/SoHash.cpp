@@ -4,6 +4,35 @@
 // 2013-10-05
 //-----------------------------------------------------------------------------
 #include "SoHash.h"
+#include "SoThread.h"
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+	#define SoHash_X86
+	#include <emmintrin.h>
+	#include <nmmintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define SoHash_TargetSSE42
+		#if _MSC_VER >= 1700
+			#include <immintrin.h>
+			#define SoHash_AVX2
+			#define SoHash_TargetAVX2
+		#endif
+	#else
+		#include <immintrin.h>
+		#define SoHash_AVX2
+		#define SoHash_TargetAVX2 __attribute__((target("avx2")))
+		#define SoHash_TargetSSE42 __attribute__((target("sse4.2")))
+	#endif
+#endif
+//SIMD汾SoHash_FormatNameȡֽ֮ڣԽڴҳSoHash_CrossPage
+//AddressSanitizerԽȡЩַ顣
+#if defined(_MSC_VER) && _MSC_VER >= 1928
+	#define SoHash_NoSanitizeAddress __declspec(no_sanitize_address)
+#elif defined(__GNUC__) || defined(__clang__)
+	#define SoHash_NoSanitizeAddress __attribute__((no_sanitize_address))
+#else
+	#define SoHash_NoSanitizeAddress
+#endif
 //-----------------------------------------------------------------------------
 namespace GGUI
 {
@@ -46,5 +75,435 @@ namespace GGUI
 		}
 		return nHash;
 	}
+	//-----------------------------------------------------------------------------
+	//һַۼӵϣֵС
+	//theCǸʽַ֮SoHash_IndexSoHash_PHPSoHash_BKDRһ£
+	//charз㡣
+	inline void SoHash_AccumulateChar(char theC, souint32& uiHashA, souint32& uiHashB, souint32& uiHashC)
+	{
+		const souint32 uiC = (souint32)(soint32)(signed char)theC;
+		uiHashA = (uiHashA<<5) + uiHashA + uiC;
+		uiHashB = (uiHashB<<4) + uiC;
+		//gΪ0ʱıʡ֧
+		const souint32 g = uiHashB & 0xF0000000;
+		uiHashB = uiHashB ^ (g >> 24);
+		uiHashB = uiHashB ^ g;
+		uiHashC = uiHashC * 131 + uiC;
+	}
+	//-----------------------------------------------------------------------------
+	//ʽһַ
+	inline char SoHash_FormatChar(char theC)
+	{
+		if (theC >= 'A' && theC <= 'Z')
+		{
+			//дĸתΪСдĸ
+			theC += 32;
+		}
+		else if (theC == '\\')
+		{
+			theC = '/';
+		}
+		return theC;
+	}
+	//-----------------------------------------------------------------------------
+	//ֽڴuiStartλÿʼֱߴﵽuiLimitַ
+	//ֵΪʽַ֮ȡ
+	static souint32 SoHash_FormatNameTail(char* pszOut, const char* pszIn, souint32 uiStart, souint32 uiLimit,
+		souint32& uiHashA, souint32& uiHashB, souint32& uiHashC)
+	{
+		souint32 n = uiStart;
+		while (n < uiLimit && pszIn[n] != 0)
+		{
+			const char theC = SoHash_FormatChar(pszIn[n]);
+			pszOut[n] = theC;
+			SoHash_AccumulateChar(theC, uiHashA, uiHashB, uiHashC);
+			++n;
+		}
+		return n;
+	}
+	//-----------------------------------------------------------------------------
+	//һѾʽõַĹϣֵ
+	inline void SoHash_AccumulateBlock(const char* pBlock, souint32 uiCount, souint32& uiHashA, souint32& uiHashB, souint32& uiHashC)
+	{
+		for (souint32 i=0; i<uiCount; ++i)
+		{
+			SoHash_AccumulateChar(pBlock[i], uiHashA, uiHashB, uiHashC);
+		}
+	}
+	//-----------------------------------------------------------------------------
+	//жϴpʼȡuiBytesֽǷԽڴҳ
+	//ַĽλδ֪ȡʱԽַڵڴҳܷʵЧַ
+	inline bool SoHash_CrossPage(const char* p, souint32 uiBytes)
+	{
+		return ((size_t)p & 4095) > (size_t)(4096 - uiBytes);
+	}
+	//-----------------------------------------------------------------------------
+	inline souint32 SoHash_FirstBit(souint32 uiMask)
+	{
+#if defined(_MSC_VER)
+		unsigned long uiIndex = 0;
+		_BitScanForward(&uiIndex, uiMask);
+		return (souint32)uiIndex;
+#else
+		return (souint32)__builtin_ctz(uiMask);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	static souint32 SoHash_FormatName_Scalar(char* pszOut, const char* pszIn, souint32 uiLimit,
+		souint32& uiHashA, souint32& uiHashB, souint32& uiHashC)
+	{
+		return SoHash_FormatNameTail(pszOut, pszIn, 0, uiLimit, uiHashA, uiHashB, uiHashC);
+	}
+#if defined(SoHash_X86)
+	//-----------------------------------------------------------------------------
+	static SoHash_NoSanitizeAddress souint32 SoHash_FormatName_SSE2(char* pszOut, const char* pszIn, souint32 uiLimit,
+		souint32& uiHashA, souint32& uiHashB, souint32& uiHashC)
+	{
+		const __m128i vZero = _mm_setzero_si128();
+		const __m128i vBeforeA = _mm_set1_epi8('A' - 1);
+		const __m128i vAfterZ = _mm_set1_epi8('Z' + 1);
+		const __m128i vCaseBit = _mm_set1_epi8(32);
+		const __m128i vBackslash = _mm_set1_epi8('\\');
+		const __m128i vSlashXor = _mm_set1_epi8('\\' ^ '/');
+		souint32 n = 0;
+		while (n + 16 <= uiLimit)
+		{
+			if (SoHash_CrossPage(pszIn + n, 16))
+			{
+				//16ֽڿԽڴҳֽڴ
+				const souint32 uiEnd = SoHash_FormatNameTail(pszOut, pszIn, n, n + 16, uiHashA, uiHashB, uiHashC);
+				if (uiEnd < n + 16)
+				{
+					return uiEnd;
+				}
+				n = uiEnd;
+				continue;
+			}
+			__m128i v = _mm_loadu_si128((const __m128i*)(pszIn + n));
+			const souint32 uiZeroMask = (souint32)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vZero));
+			//дĸתΪСдĸ
+			//зȽϣASCIIַǸᱻ޸ġ
+			const __m128i vUpper = _mm_and_si128(_mm_cmpgt_epi8(v, vBeforeA), _mm_cmpgt_epi8(vAfterZ, v));
+			v = _mm_add_epi8(v, _mm_and_si128(vUpper, vCaseBit));
+			//'\\'޸ĳ'/'
+			v = _mm_xor_si128(v, _mm_and_si128(_mm_cmpeq_epi8(v, vBackslash), vSlashXor));
+			_mm_storeu_si128((__m128i*)(pszOut + n), v);
+			const souint32 uiCount = uiZeroMask ? SoHash_FirstBit(uiZeroMask) : 16;
+			SoHash_AccumulateBlock(pszOut + n, uiCount, uiHashA, uiHashB, uiHashC);
+			n += uiCount;
+			if (uiZeroMask)
+			{
+				return n;
+			}
+		}
+		return SoHash_FormatNameTail(pszOut, pszIn, n, uiLimit, uiHashA, uiHashB, uiHashC);
+	}
+#endif
+#if defined(SoHash_AVX2)
+	//-----------------------------------------------------------------------------
+	static SoHash_NoSanitizeAddress SoHash_TargetAVX2 souint32 SoHash_FormatName_AVX2(char* pszOut, const char* pszIn, souint32 uiLimit,
+		souint32& uiHashA, souint32& uiHashB, souint32& uiHashC)
+	{
+		const __m256i vZero = _mm256_setzero_si256();
+		const __m256i vBeforeA = _mm256_set1_epi8('A' - 1);
+		const __m256i vAfterZ = _mm256_set1_epi8('Z' + 1);
+		const __m256i vCaseBit = _mm256_set1_epi8(32);
+		const __m256i vBackslash = _mm256_set1_epi8('\\');
+		const __m256i vSlashXor = _mm256_set1_epi8('\\' ^ '/');
+		souint32 n = 0;
+		while (n + 32 <= uiLimit)
+		{
+			if (SoHash_CrossPage(pszIn + n, 32))
+			{
+				//32ֽڿԽڴҳֽڴ
+				const souint32 uiEnd = SoHash_FormatNameTail(pszOut, pszIn, n, n + 32, uiHashA, uiHashB, uiHashC);
+				if (uiEnd < n + 32)
+				{
+					return uiEnd;
+				}
+				n = uiEnd;
+				continue;
+			}
+			__m256i v = _mm256_loadu_si256((const __m256i*)(pszIn + n));
+			const souint32 uiZeroMask = (souint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vZero));
+			const __m256i vUpper = _mm256_and_si256(_mm256_cmpgt_epi8(v, vBeforeA), _mm256_cmpgt_epi8(vAfterZ, v));
+			v = _mm256_add_epi8(v, _mm256_and_si256(vUpper, vCaseBit));
+			v = _mm256_xor_si256(v, _mm256_and_si256(_mm256_cmpeq_epi8(v, vBackslash), vSlashXor));
+			_mm256_storeu_si256((__m256i*)(pszOut + n), v);
+			const souint32 uiCount = uiZeroMask ? SoHash_FirstBit(uiZeroMask) : 32;
+			SoHash_AccumulateBlock(pszOut + n, uiCount, uiHashA, uiHashB, uiHashC);
+			n += uiCount;
+			if (uiZeroMask)
+			{
+				return n;
+			}
+		}
+		//ʣ಻32ֽڵĲֽSSE2
+		souint32 uiRest = SoHash_FormatName_SSE2(pszOut + n, pszIn + n, uiLimit - n, uiHashA, uiHashB, uiHashC);
+		return n + uiRest;
+	}
+#endif
+	//-----------------------------------------------------------------------------
+	//CRC32Cķתʽ
+	#define SoHash_CRC32CPoly 0x82F63B78
+	//8ֽһg_CRC32CTable[k][i]Ϊֽiٸk0ֽڵУֵ
+	static souint32 g_CRC32CTable[8][256];
+	//-----------------------------------------------------------------------------
+	static void SoHash_InitCRC32CTable()
+	{
+		for (souint32 i=0; i<256; ++i)
+		{
+			souint32 uiCRC = i;
+			for (int j=0; j<8; ++j)
+			{
+				uiCRC = (uiCRC >> 1) ^ ((uiCRC & 1) ? SoHash_CRC32CPoly : 0);
+			}
+			g_CRC32CTable[0][i] = uiCRC;
+		}
+		for (souint32 i=0; i<256; ++i)
+		{
+			for (int k=1; k<8; ++k)
+			{
+				const souint32 uiPrev = g_CRC32CTable[k-1][i];
+				g_CRC32CTable[k][i] = (uiPrev >> 8) ^ g_CRC32CTable[0][uiPrev & 0xFF];
+			}
+		}
+	}
+	//-----------------------------------------------------------------------------
+	//uiCRCѾȡмֵ
+	static souint32 SoHash_CRC32C_Scalar(souint32 uiCRC, const unsigned char* p, soint64 nSize)
+	{
+		while (nSize > 0 && ((size_t)p & 7) != 0)
+		{
+			uiCRC = (uiCRC >> 8) ^ g_CRC32CTable[0][(uiCRC ^ *p) & 0xFF];
+			++p;
+			--nSize;
+		}
+		while (nSize >= 8)
+		{
+			//Сֽƴӣֽڼ˳һ¡
+			const souint32 uiLow = uiCRC ^ ((souint32)p[0] | ((souint32)p[1] << 8) | ((souint32)p[2] << 16) | ((souint32)p[3] << 24));
+			const souint32 uiHigh = (souint32)p[4] | ((souint32)p[5] << 8) | ((souint32)p[6] << 16) | ((souint32)p[7] << 24);
+			uiCRC = g_CRC32CTable[7][uiLow & 0xFF] ^ g_CRC32CTable[6][(uiLow >> 8) & 0xFF]
+				^ g_CRC32CTable[5][(uiLow >> 16) & 0xFF] ^ g_CRC32CTable[4][uiLow >> 24]
+				^ g_CRC32CTable[3][uiHigh & 0xFF] ^ g_CRC32CTable[2][(uiHigh >> 8) & 0xFF]
+				^ g_CRC32CTable[1][(uiHigh >> 16) & 0xFF] ^ g_CRC32CTable[0][uiHigh >> 24];
+			p += 8;
+			nSize -= 8;
+		}
+		while (nSize > 0)
+		{
+			uiCRC = (uiCRC >> 8) ^ g_CRC32CTable[0][(uiCRC ^ *p) & 0xFF];
+			++p;
+			--nSize;
+		}
+		return uiCRC;
+	}
+#if defined(SoHash_X86)
+	//-----------------------------------------------------------------------------
+	static SoHash_TargetSSE42 souint32 SoHash_CRC32C_SSE42(souint32 uiCRC, const unsigned char* p, soint64 nSize)
+	{
+		while (nSize > 0 && ((size_t)p & 7) != 0)
+		{
+			uiCRC = _mm_crc32_u8(uiCRC, *p);
+			++p;
+			--nSize;
+		}
+	#if defined(_M_X64) || defined(__x86_64__)
+		souint64 uiCRC64 = uiCRC;
+		while (nSize >= 8)
+		{
+			uiCRC64 = _mm_crc32_u64(uiCRC64, *(const souint64*)p);
+			p += 8;
+			nSize -= 8;
+		}
+		uiCRC = (souint32)uiCRC64;
+	#endif
+		while (nSize >= 4)
+		{
+			uiCRC = _mm_crc32_u32(uiCRC, *(const unsigned int*)p);
+			p += 4;
+			nSize -= 4;
+		}
+		while (nSize > 0)
+		{
+			uiCRC = _mm_crc32_u8(uiCRC, *p);
+			++p;
+			--nSize;
+		}
+		return uiCRC;
+	}
+#endif
+	//-----------------------------------------------------------------------------
+	typedef souint32 (*SoHash_FormatNameFunc)(char*, const char*, souint32, souint32&, souint32&, souint32&);
+	typedef souint32 (*SoHash_CRC32CFunc)(souint32, const unsigned char*, soint64);
+	struct stSimdImpl
+	{
+		SoSimdLevel eLevel;
+		SoHash_FormatNameFunc pFormatNameFunc;
+		SoHash_CRC32CFunc pCRC32CFunc;
+	};
+	//ÿָʵʹõʵ֣CPU֧ʱֻSoHash_InitдһΡ
+	static stSimdImpl g_SimdImplList[SoSimd_AVX2 + 1];
+	//ǰʹõʵg_SimdImplListе±һ0ʾδʼֻԭӲд
+	static volatile soint32 g_nSimdImpl = 0;
+	//ʼĽȣ0Ϊδʼ1ΪڽУ2ΪѾɡ
+	static volatile soint32 g_nInitState = 0;
+	//-----------------------------------------------------------------------------
+	//CPUǷ֧SSE4.2crc32ָ
+	static bool SoHash_DetectSSE42()
+	{
+#if defined(SoHash_X86)
+	#if defined(_MSC_VER)
+		int info[4] = {0};
+		__cpuid(info, 1);
+		return (info[2] & (1<<20)) != 0;
+	#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse4.2") != 0;
+	#endif
+#else
+		return false;
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	//CPUֵָܹ֧
+	static SoSimdLevel SoHash_DetectSimdLevel()
+	{
+		SoSimdLevel eLevel = SoSimd_None;
+#if defined(SoHash_X86)
+	#if defined(_MSC_VER)
+		int info[4] = {0};
+		__cpuid(info, 1);
+		if (info[3] & (1<<26))
+		{
+			eLevel = SoSimd_SSE2;
+		}
+		#if defined(SoHash_AVX2)
+		//AVX2Ҫͬʱ㣺CPU֧AVX2ϵͳᱣYMMĴ
+		const bool bOSXSAVE = (info[2] & (1<<27)) != 0;
+		__cpuid(info, 0);
+		if (bOSXSAVE && info[0] >= 7 && (_xgetbv(0) & 6) == 6)
+		{
+			__cpuidex(info, 7, 0);
+			if (info[1] & (1<<5))
+			{
+				eLevel = SoSimd_AVX2;
+			}
+		}
+		#endif
+	#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("sse2"))
+		{
+			eLevel = SoSimd_SSE2;
+		}
+		if (__builtin_cpu_supports("avx2"))
+		{
+			eLevel = SoSimd_AVX2;
+		}
+	#endif
+#endif
+		return eLevel;
+	}
+	//-----------------------------------------------------------------------------
+	//ֻеһִ߳гʼ̵߳ȴɡ֮ѯg_SimdImplList޸ġ
+	static void SoHash_Init()
+	{
+		if (SoAtomic_Load(&g_nInitState) == 2)
+		{
+			return;
+		}
+		if (SoAtomic_CompareExchange(&g_nInitState, 1, 0) != 0)
+		{
+			while (SoAtomic_Load(&g_nInitState) != 2)
+			{
+			}
+			return;
+		}
+		SoHash_InitCRC32CTable();
+		const SoSimdLevel eSupported = SoHash_DetectSimdLevel();
+		const bool bSSE42 = SoHash_DetectSSE42();
+		for (int i=SoSimd_None; i<=SoSimd_AVX2; ++i)
+		{
+			const SoSimdLevel eLevel = (i > eSupported) ? eSupported : (SoSimdLevel)i;
+			stSimdImpl& theImpl = g_SimdImplList[i];
+			theImpl.eLevel = eLevel;
+			theImpl.pFormatNameFunc = SoHash_FormatName_Scalar;
+			theImpl.pCRC32CFunc = SoHash_CRC32C_Scalar;
+#if defined(SoHash_X86)
+			if (eLevel == SoSimd_SSE2)
+			{
+				theImpl.pFormatNameFunc = SoHash_FormatName_SSE2;
+			}
+			if (eLevel != SoSimd_None && bSSE42)
+			{
+				theImpl.pCRC32CFunc = SoHash_CRC32C_SSE42;
+			}
+#endif
+#if defined(SoHash_AVX2)
+			if (eLevel == SoSimd_AVX2)
+			{
+				theImpl.pFormatNameFunc = SoHash_FormatName_AVX2;
+			}
+#endif
+		}
+		(void)bSSE42;
+		//ȷĬϵʵ֣ٱǳʼɡ
+		SoAtomic_Store(&g_nSimdImpl, eSupported + 1);
+		SoAtomic_Store(&g_nInitState, 2);
+	}
+	//-----------------------------------------------------------------------------
+	static const stSimdImpl& SoHash_GetImpl()
+	{
+		soint32 nImpl = SoAtomic_Load(&g_nSimdImpl);
+		if (nImpl == 0)
+		{
+			SoHash_Init();
+			nImpl = SoAtomic_Load(&g_nSimdImpl);
+		}
+		return g_SimdImplList[nImpl - 1];
+	}
+	//-----------------------------------------------------------------------------
+	SoSimdLevel SoHash_GetSimdLevel()
+	{
+		return SoHash_GetImpl().eLevel;
+	}
+	//-----------------------------------------------------------------------------
+	void SoHash_SetSimdLevel(SoSimdLevel eLevel)
+	{
+		if (eLevel < SoSimd_None || eLevel > SoSimd_AVX2)
+		{
+			return;
+		}
+		//ֻлʹõʵ֣޸ĹĲѯ߳̿ͬʱ㡣
+		SoHash_Init();
+		SoAtomic_Store(&g_nSimdImpl, eLevel + 1);
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoHash_FormatName(char* pszOut, const char* pszIn, souint32 uiMaxLength,
+		souint32& uiHashA, souint32& uiHashB, souint32& uiHashC)
+	{
+		uiHashA = 0;
+		uiHashB = 0;
+		uiHashC = 0;
+		if (uiMaxLength == 0)
+		{
+			return 0;
+		}
+		const souint32 uiLength = SoHash_GetImpl().pFormatNameFunc(pszOut, pszIn, uiMaxLength - 1, uiHashA, uiHashB, uiHashC);
+		pszOut[uiLength] = 0;
+		uiHashC = uiHashC & 0x7FFFFFFF;
+		return uiLength;
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoHash_CRC32C(souint32 uiCRC, const void* pData, soint64 nSize)
+	{
+		if (pData == 0 || nSize <= 0)
+		{
+			return uiCRC;
+		}
+		return ~SoHash_GetImpl().pCRC32CFunc(~uiCRC, (const unsigned char*)pData, nSize);
+	}
 }
 //-----------------------------------------------------------------------------
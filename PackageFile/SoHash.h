@@ -20,6 +20,33 @@ namespace GGUI
 	//õhashֲֵȽϾȡ
 	//pszStringǴַ
 	souint32 SoHash_Index(const char* pszString);
+
+	//CPUֵ֧SIMDָ
+	enum SoSimdLevel
+	{
+		SoSimd_None, //ʹSIMDָֽڴ
+		SoSimd_SSE2,
+		SoSimd_AVX2,
+	};
+	//ȡǰʹõָ𡣵һεʱCPUԶѡ
+	SoSimdLevel SoHash_GetSimdLevel();
+	//ǿָָҪܲԡ
+	//CPU֧eLevelʹCPUֵܹ֧߼߳ڼʱҲԵá
+	void SoHash_SetSimdLevel(SoSimdLevel eLevel);
+
+	//ʽļͬʱϣֵֻһַ
+	//ʽ1'\\'޸ĳ'/'2Ѵдĸ޸ĳСдĸ
+	//pszOutuiMaxLengthֽڣַʱضΪ(uiMaxLength-1)ַ
+	//uiHashAuiHashBuiHashCֱڶԸʽִַ֮
+	//SoHash_IndexSoHash_PHPSoHash_BKDRĽ
+	//ֵΪʽַ֮ȣ
+	souint32 SoHash_FormatName(char* pszOut, const char* pszIn, souint32 uiMaxLength,
+		souint32& uiHashA, souint32& uiHashB, souint32& uiHashC);
+
+	//CRC32CCastagnoliʽУֵڼԴڵļǷ𻵡
+	//uiCRCΪ֮ǰݵĽһݴ0Էֶμ㡣
+	//CPU֧SSE4.2ָSoSimd_Noneʱʹcrc32ָ㡣
+	souint32 SoHash_CRC32C(souint32 uiCRC, const void* pData, soint64 nSize);
 }
 //-----------------------------------------------------------------------------
 #endif //_SoHash_h_
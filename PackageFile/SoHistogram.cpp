@@ -0,0 +1,162 @@
+﻿//-----------------------------------------------------------------------------
+// SoHistogram
+// (C) oil
+// 2013-10-27
+//-----------------------------------------------------------------------------
+#include "SoHistogram.h"
+#include <string.h>
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	//-----------------------------------------------------------------------------
+	SoHistogram::SoHistogram()
+	{
+		Clear();
+	}
+	//-----------------------------------------------------------------------------
+	void SoHistogram::Record(soint64 nValue)
+	{
+		if (nValue < 0)
+		{
+			nValue = 0;
+		}
+		++m_Counts[GetIndex(nValue)];
+		++m_nCount;
+		m_nSum += nValue;
+		if (nValue > m_nMax)
+		{
+			m_nMax = nValue;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	void SoHistogram::Clear()
+	{
+		memset(m_Counts, 0, sizeof(m_Counts));
+		m_nCount = 0;
+		m_nSum = 0;
+		m_nMax = 0;
+	}
+	//-----------------------------------------------------------------------------
+	void SoHistogram::Add(const SoHistogram& theOther)
+	{
+		for (int i=0; i<SoHistogram_BucketCount; ++i)
+		{
+			m_Counts[i] += theOther.m_Counts[i];
+		}
+		m_nCount += theOther.m_nCount;
+		m_nSum += theOther.m_nSum;
+		if (theOther.m_nMax > m_nMax)
+		{
+			m_nMax = theOther.m_nMax;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	void SoHistogram::Subtract(const SoHistogram& theOther)
+	{
+		for (int i=0; i<SoHistogram_BucketCount; ++i)
+		{
+			m_Counts[i] -= theOther.m_Counts[i];
+		}
+		m_nCount -= theOther.m_nCount;
+		m_nSum -= theOther.m_nSum;
+		//减去的部分可能包含最大值，用剩余的最高格子重新估计。
+		soint64 nBound = 0;
+		for (int i=SoHistogram_BucketCount-1; i>=0; --i)
+		{
+			if (m_Counts[i] > 0)
+			{
+				nBound = GetUpperBound(i);
+				break;
+			}
+		}
+		if (nBound < m_nMax)
+		{
+			m_nMax = nBound;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoHistogram::GetCount() const
+	{
+		return m_nCount;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoHistogram::GetSum() const
+	{
+		return m_nSum;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoHistogram::GetPercentile(double fPercentile) const
+	{
+		if (m_nCount <= 0)
+		{
+			return 0;
+		}
+		//第nRank个值（从1开始）所在的格子。
+		soint64 nRank = (soint64)(fPercentile / 100.0 * (double)m_nCount + 0.5);
+		if (nRank < 1)
+		{
+			nRank = 1;
+		}
+		if (nRank > m_nCount)
+		{
+			nRank = m_nCount;
+		}
+		soint64 nSeen = 0;
+		for (int i=0; i<SoHistogram_BucketCount; ++i)
+		{
+			nSeen += m_Counts[i];
+			if (nSeen >= nRank)
+			{
+				const soint64 nBound = GetUpperBound(i);
+				return (nBound < m_nMax) ? nBound : m_nMax;
+			}
+		}
+		//其他线程正在记录时，m_nCount可能比各格之和稍大。
+		return m_nMax;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoHistogram::GetMax() const
+	{
+		return m_nMax;
+	}
+	//-----------------------------------------------------------------------------
+	int SoHistogram::GetIndex(soint64 nValue)
+	{
+		if (nValue < SoHistogram_SubBucketCount)
+		{
+			//小于SoHistogram_SubBucketCount的值一个值一格。
+			return (int)nValue;
+		}
+		//nExponent为最高位的位置，二分查找。
+		int nExponent = 0;
+		soint64 nRest = nValue;
+		for (int nShift=32; nShift>0; nShift>>=1)
+		{
+			if ((nRest >> nShift) != 0)
+			{
+				nRest >>= nShift;
+				nExponent += nShift;
+			}
+		}
+		if (nExponent > SoHistogram_MaxExponent)
+		{
+			return SoHistogram_BucketCount - 1;
+		}
+		//最高位之后的SoHistogram_SubBucketBits位决定在这个区间里的哪一格。
+		const int nSub = (int)((nValue >> (nExponent - SoHistogram_SubBucketBits)) & (SoHistogram_SubBucketCount - 1));
+		return (nExponent - SoHistogram_SubBucketBits + 1) * SoHistogram_SubBucketCount + nSub;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoHistogram::GetUpperBound(int nIndex)
+	{
+		if (nIndex < SoHistogram_SubBucketCount)
+		{
+			return nIndex;
+		}
+		const int nShift = nIndex / SoHistogram_SubBucketCount - 1;
+		const soint64 nSub = nIndex % SoHistogram_SubBucketCount;
+		const soint64 nLower = (SoHistogram_SubBucketCount + nSub) << nShift;
+		return nLower + ((soint64)1 << nShift) - 1;
+	}
+}
+//-----------------------------------------------------------------------------
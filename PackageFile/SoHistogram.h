@@ -0,0 +1,54 @@
+﻿//-----------------------------------------------------------------------------
+// SoHistogram
+// (C) oil
+// 2013-10-27
+//
+// 对数分级的直方图（与HdrHistogram的思路相同），用于记录延迟。
+// 每个2的幂区间平均分成SoHistogram_SubBucketCount份，相对误差不超过1/SoHistogram_SubBucketCount。
+// 记录一个值只是计算下标并累加，没有锁也没有原子操作，多线程时每个线程使用自己的对象，统计时再汇总。
+//-----------------------------------------------------------------------------
+#ifndef _SoHistogram_h_
+#define _SoHistogram_h_
+//-----------------------------------------------------------------------------
+#include "SoBaseTypeDefine.h"
+//-----------------------------------------------------------------------------
+//32格，相对误差约3%。每个直方图约8KB。
+#define SoHistogram_SubBucketBits 5
+#define SoHistogram_SubBucketCount (1 << SoHistogram_SubBucketBits)
+//能够区分的最大值为2^SoHistogram_MaxExponent，更大的值记录在最后一格。以纳秒计约为68秒。
+#define SoHistogram_MaxExponent 36
+#define SoHistogram_BucketCount ((SoHistogram_MaxExponent - SoHistogram_SubBucketBits + 2) * SoHistogram_SubBucketCount)
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	class SoHistogram
+	{
+	public:
+		SoHistogram();
+		//记录一个值，负数按0记录。
+		void Record(soint64 nValue);
+		void Clear();
+		//累加或者减去另一个直方图，用于汇总多个线程和计算两次统计之间的差。
+		void Add(const SoHistogram& theOther);
+		void Subtract(const SoHistogram& theOther);
+		soint64 GetCount() const;
+		soint64 GetSum() const;
+		//fPercentile为0到100之间的百分数，返回该百分位所在格子的上界，不超过GetMax。没有记录时返回0。
+		soint64 GetPercentile(double fPercentile) const;
+		//记录过的最大值。Subtract之后无法得知确切的最大值，取剩余的最高格子的上界与原来的最大值中较小的一个。
+		soint64 GetMax() const;
+
+	private:
+		static int GetIndex(soint64 nValue);
+		static soint64 GetUpperBound(int nIndex);
+
+	private:
+		soint64 m_Counts[SoHistogram_BucketCount];
+		soint64 m_nCount;
+		soint64 m_nSum;
+		soint64 m_nMax;
+	};
+}
+//-----------------------------------------------------------------------------
+#endif //_SoHistogram_h_
+//-----------------------------------------------------------------------------
@@ -0,0 +1,336 @@
+﻿//-----------------------------------------------------------------------------
+// SoIOUring
+// (C) oil
+// 2013-10-22
+//-----------------------------------------------------------------------------
+#include "SoIOUring.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(SoIOUring_Enable)
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+#if defined(SoIOUring_Enable)
+	//-----------------------------------------------------------------------------
+	//与内核共享的队列指针，读写时需要内存屏障。
+	inline souint32 SoIOUring_LoadAcquire(const souint32* p)
+	{
+		return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+	}
+	inline void SoIOUring_StoreRelease(souint32* p, souint32 v)
+	{
+		__atomic_store_n(p, v, __ATOMIC_RELEASE);
+	}
+#endif
+	//-----------------------------------------------------------------------------
+	SoIOUring::SoIOUring()
+	:m_nRingFD(-1)
+	,m_uiQueueDepth(0)
+	,m_uiToSubmit(0)
+	,m_pSQRing(0)
+	,m_pCQRing(0)
+	,m_pSQEs(0)
+	,m_uiSQRingSize(0)
+	,m_uiCQRingSize(0)
+	,m_uiSQEsSize(0)
+	,m_pSQHead(0)
+	,m_pSQTail(0)
+	,m_pSQMask(0)
+	,m_pSQArray(0)
+	,m_pCQHead(0)
+	,m_pCQTail(0)
+	,m_pCQMask(0)
+	,m_pCQEs(0)
+	,m_pIOVecList(0)
+	{
+	}
+	//-----------------------------------------------------------------------------
+	SoIOUring::~SoIOUring()
+	{
+		Release();
+	}
+	//-----------------------------------------------------------------------------
+	bool SoIOUring::Init(souint32 uiQueueDepth)
+	{
+#if defined(SoIOUring_Enable)
+		if (m_nRingFD != -1 || uiQueueDepth == 0)
+		{
+			return false;
+		}
+		io_uring_params theParams;
+		memset(&theParams, 0, sizeof(theParams));
+		m_nRingFD = (int)syscall(__NR_io_uring_setup, uiQueueDepth, &theParams);
+		if (m_nRingFD < 0)
+		{
+			//内核不支持，或者被安全策略禁止了。
+			m_nRingFD = -1;
+			return false;
+		}
+#if defined(IORING_FEAT_SUBMIT_STABLE)
+		const bool bSubmitStable = (theParams.features & IORING_FEAT_SUBMIT_STABLE) != 0;
+#else
+		const bool bSubmitStable = false;
+#endif
+		if (!bSubmitStable)
+		{
+			//每个提交队列位置一个iovec，位置回收之后会被下一个请求覆盖。
+			//没有IORING_FEAT_SUBMIT_STABLE的内核可能在提交之后才读取iovec，由调用者改用其他读取方式。
+			close(m_nRingFD);
+			m_nRingFD = -1;
+			return false;
+		}
+		m_uiQueueDepth = theParams.sq_entries;
+		m_uiSQRingSize = theParams.sq_off.array + theParams.sq_entries * sizeof(souint32);
+		m_uiCQRingSize = theParams.cq_off.cqes + theParams.cq_entries * sizeof(io_uring_cqe);
+		const bool bSingleMmap = (theParams.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (bSingleMmap)
+		{
+			if (m_uiCQRingSize > m_uiSQRingSize)
+			{
+				m_uiSQRingSize = m_uiCQRingSize;
+			}
+			m_uiCQRingSize = m_uiSQRingSize;
+		}
+		m_pSQRing = mmap(0, (size_t)m_uiSQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_nRingFD, IORING_OFF_SQ_RING);
+		if (m_pSQRing == MAP_FAILED)
+		{
+			m_pSQRing = 0;
+			Release();
+			return false;
+		}
+		if (bSingleMmap)
+		{
+			m_pCQRing = m_pSQRing;
+		}
+		else
+		{
+			m_pCQRing = mmap(0, (size_t)m_uiCQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_nRingFD, IORING_OFF_CQ_RING);
+			if (m_pCQRing == MAP_FAILED)
+			{
+				m_pCQRing = 0;
+				Release();
+				return false;
+			}
+		}
+		m_uiSQEsSize = theParams.sq_entries * sizeof(io_uring_sqe);
+		m_pSQEs = mmap(0, (size_t)m_uiSQEsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_nRingFD, IORING_OFF_SQES);
+		if (m_pSQEs == MAP_FAILED)
+		{
+			m_pSQEs = 0;
+			Release();
+			return false;
+		}
+		char* pSQ = (char*)m_pSQRing;
+		m_pSQHead = (souint32*)(pSQ + theParams.sq_off.head);
+		m_pSQTail = (souint32*)(pSQ + theParams.sq_off.tail);
+		m_pSQMask = (souint32*)(pSQ + theParams.sq_off.ring_mask);
+		m_pSQArray = (souint32*)(pSQ + theParams.sq_off.array);
+		char* pCQ = (char*)m_pCQRing;
+		m_pCQHead = (souint32*)(pCQ + theParams.cq_off.head);
+		m_pCQTail = (souint32*)(pCQ + theParams.cq_off.tail);
+		m_pCQMask = (souint32*)(pCQ + theParams.cq_off.ring_mask);
+		m_pCQEs = pCQ + theParams.cq_off.cqes;
+		m_pIOVecList = malloc(theParams.sq_entries * sizeof(iovec));
+		if (m_pIOVecList == 0)
+		{
+			Release();
+			return false;
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	void SoIOUring::Release()
+	{
+#if defined(SoIOUring_Enable)
+		if (m_pSQEs)
+		{
+			munmap(m_pSQEs, (size_t)m_uiSQEsSize);
+		}
+		if (m_pCQRing && m_pCQRing != m_pSQRing)
+		{
+			munmap(m_pCQRing, (size_t)m_uiCQRingSize);
+		}
+		if (m_pSQRing)
+		{
+			munmap(m_pSQRing, (size_t)m_uiSQRingSize);
+		}
+		if (m_nRingFD != -1)
+		{
+			close(m_nRingFD);
+		}
+#endif
+		if (m_pIOVecList)
+		{
+			free(m_pIOVecList);
+		}
+		m_nRingFD = -1;
+		m_uiQueueDepth = 0;
+		m_uiToSubmit = 0;
+		m_pSQRing = 0;
+		m_pCQRing = 0;
+		m_pSQEs = 0;
+		m_pIOVecList = 0;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoIOUring::IsValid() const
+	{
+		return (m_nRingFD != -1);
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoIOUring::GetQueueDepth() const
+	{
+		return m_uiQueueDepth;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoIOUring::PrepareRead(int nFD, void* pBuff, souint32 uiSize, soint64 nOffset, void* pUserData)
+	{
+#if defined(SoIOUring_Enable)
+		if (m_nRingFD == -1)
+		{
+			return false;
+		}
+		//只有当前线程会修改提交队列的tail。
+		const souint32 uiTail = *m_pSQTail;
+		if (uiTail - SoIOUring_LoadAcquire(m_pSQHead) >= m_uiQueueDepth)
+		{
+			return false;
+		}
+		const souint32 uiIndex = uiTail & *m_pSQMask;
+		//使用READV而不是READ，兼容更早的内核版本。
+		iovec* pIOVec = (iovec*)m_pIOVecList + uiIndex;
+		pIOVec->iov_base = pBuff;
+		pIOVec->iov_len = uiSize;
+		io_uring_sqe* pSQE = (io_uring_sqe*)m_pSQEs + uiIndex;
+		memset(pSQE, 0, sizeof(*pSQE));
+		pSQE->opcode = IORING_OP_READV;
+		pSQE->fd = nFD;
+		pSQE->addr = (souint64)(size_t)pIOVec;
+		pSQE->len = 1;
+		pSQE->off = (souint64)nOffset;
+		pSQE->user_data = (souint64)(size_t)pUserData;
+		m_pSQArray[uiIndex] = uiIndex;
+		SoIOUring_StoreRelease(m_pSQTail, uiTail + 1);
+		++m_uiToSubmit;
+		return true;
+#else
+		return false;
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	bool SoIOUring::Submit(souint32 uiWaitCount)
+	{
+#if defined(SoIOUring_Enable)
+		if (m_nRingFD == -1)
+		{
+			return false;
+		}
+		while (true)
+		{
+			const unsigned int uiFlags = (uiWaitCount > 0) ? IORING_ENTER_GETEVENTS : 0;
+			const int nResult = (int)syscall(__NR_io_uring_enter, m_nRingFD, m_uiToSubmit, uiWaitCount, uiFlags, (void*)0, 0);
+			if (nResult >= 0)
+			{
+				m_uiToSubmit -= ((souint32)nResult < m_uiToSubmit) ? (souint32)nResult : m_uiToSubmit;
+				if (m_uiToSubmit == 0 || uiWaitCount == 0)
+				{
+					return true;
+				}
+			}
+			else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			{
+				return false;
+			}
+		}
+#else
+		return false;
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	bool SoIOUring::Wait(souint32 uiWaitCount)
+	{
+#if defined(SoIOUring_Enable)
+		if (m_nRingFD == -1)
+		{
+			return false;
+		}
+		while (true)
+		{
+			const int nResult = (int)syscall(__NR_io_uring_enter, m_nRingFD, 0, uiWaitCount, IORING_ENTER_GETEVENTS, (void*)0, 0);
+			if (nResult >= 0)
+			{
+				return true;
+			}
+			if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			{
+				return false;
+			}
+		}
+#else
+		(void)uiWaitCount;
+		return false;
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	bool SoIOUring::CancelUnsubmitted(void*& pUserData)
+	{
+#if defined(SoIOUring_Enable)
+		if (m_nRingFD == -1)
+		{
+			return false;
+		}
+		//没有使用SQPOLL，内核只在io_uring_enter中读取提交队列，这时可以回退tail。
+		//内核取走的请求已经推进了head，head之后的都还没有交给内核。
+		const souint32 uiTail = *m_pSQTail;
+		if (uiTail == SoIOUring_LoadAcquire(m_pSQHead))
+		{
+			m_uiToSubmit = 0;
+			return false;
+		}
+		const souint32 uiIndex = (uiTail - 1) & *m_pSQMask;
+		const io_uring_sqe* pSQE = (const io_uring_sqe*)m_pSQEs + uiIndex;
+		pUserData = (void*)(size_t)pSQE->user_data;
+		SoIOUring_StoreRelease(m_pSQTail, uiTail - 1);
+		if (m_uiToSubmit > 0)
+		{
+			--m_uiToSubmit;
+		}
+		return true;
+#else
+		(void)pUserData;
+		return false;
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	bool SoIOUring::PeekCompletion(void*& pUserData, soint32& nResult)
+	{
+#if defined(SoIOUring_Enable)
+		if (m_nRingFD == -1)
+		{
+			return false;
+		}
+		const souint32 uiHead = *m_pCQHead;
+		if (uiHead == SoIOUring_LoadAcquire(m_pCQTail))
+		{
+			return false;
+		}
+		const io_uring_cqe* pCQE = (const io_uring_cqe*)m_pCQEs + (uiHead & *m_pCQMask);
+		pUserData = (void*)(size_t)pCQE->user_data;
+		nResult = pCQE->res;
+		SoIOUring_StoreRelease(m_pCQHead, uiHead + 1);
+		return true;
+#else
+		return false;
+#endif
+	}
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,82 @@
+﻿//-----------------------------------------------------------------------------
+// SoIOUring
+// (C) oil
+// 2013-10-22
+//
+// Linux io_uring的简单封装，只支持批量读取。
+// 直接使用系统调用，不依赖liburing。
+// 在其他平台上，或者内核不支持io_uring（包括没有IORING_FEAT_SUBMIT_STABLE的早期版本）时，
+// Init返回false，调用者应该使用其他读取方式。
+// 一个SoIOUring对象同一时刻只能被一个线程使用。
+//-----------------------------------------------------------------------------
+#ifndef _SoIOUring_h_
+#define _SoIOUring_h_
+//-----------------------------------------------------------------------------
+#include "SoBaseTypeDefine.h"
+//-----------------------------------------------------------------------------
+#if defined(__linux__) && !defined(SoPackageFile_NoIOUring) && defined(__has_include)
+	#if __has_include(<linux/io_uring.h>)
+		#define SoIOUring_Enable
+	#endif
+#endif
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	class SoIOUring
+	{
+	public:
+		SoIOUring();
+		~SoIOUring();
+		//创建队列，最多同时容纳uiQueueDepth个请求。系统不支持io_uring时返回false。
+		bool Init(souint32 uiQueueDepth);
+		void Release();
+		bool IsValid() const;
+		//队列深度。
+		souint32 GetQueueDepth() const;
+		//准备一个读请求，放入提交队列，调用Submit之后才会真正提交给内核。
+		//提交队列已满时返回false。
+		bool PrepareRead(int nFD, void* pBuff, souint32 uiSize, soint64 nOffset, void* pUserData);
+		//把准备好的请求提交给内核，并等待至少uiWaitCount个请求完成。
+		bool Submit(souint32 uiWaitCount);
+		//不提交新的请求，只等待至少uiWaitCount个已经提交给内核的请求完成。
+		bool Wait(souint32 uiWaitCount);
+		//Submit失败之后撤回一个还没有交给内核的请求，pUserData返回PrepareRead时传入的值。
+		//撤回的请求不会执行，它的缓存可以立即释放。没有可以撤回的请求时返回false。
+		bool CancelUnsubmitted(void*& pUserData);
+		//取出一个已完成的请求。nResult为实际读取的字节数，失败时为负的错误码。
+		//没有已完成的请求时返回false。
+		bool PeekCompletion(void*& pUserData, soint32& nResult);
+
+	private:
+		SoIOUring(const SoIOUring&);
+		SoIOUring& operator = (const SoIOUring&);
+
+	private:
+		int m_nRingFD;
+		souint32 m_uiQueueDepth;
+		//已经准备好但尚未提交给内核的请求个数。
+		souint32 m_uiToSubmit;
+		//内核共享的内存。
+		void* m_pSQRing;
+		void* m_pCQRing;
+		void* m_pSQEs;
+		souint64 m_uiSQRingSize;
+		souint64 m_uiCQRingSize;
+		souint64 m_uiSQEsSize;
+		//提交队列。
+		souint32* m_pSQHead;
+		souint32* m_pSQTail;
+		souint32* m_pSQMask;
+		souint32* m_pSQArray;
+		//完成队列。
+		souint32* m_pCQHead;
+		souint32* m_pCQTail;
+		souint32* m_pCQMask;
+		void* m_pCQEs;
+		//每个提交队列位置对应的iovec。
+		void* m_pIOVecList;
+	};
+}
+//-----------------------------------------------------------------------------
+#endif //_SoIOUring_h_
+//-----------------------------------------------------------------------------
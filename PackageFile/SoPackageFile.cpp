@@ -4,46 +4,86 @@
 // 2013-07-13
 //
 // 1，与文件长度大小相关的变量都使用64位整数，支持无限大的资源包文件。
-// 2，最大限度满足跨平台需求。目前，CRITICAL_SECTION不是跨平台的。
+// 2，最大限度满足跨平台需求。线程同步操作由SoThread提供。
 // 3，用户自己定义版本号规则。
 // 4，SingleFile的文件名最好全部是ASCII字符，最好不出现中文等等。
-// 5，在Mode_Read模式下支持多线程。
+// 5，在Mode_Read模式下支持多线程。查找文件不加锁，每个线程使用各自的临时缓存解压缩。
 // 6，尚未对资源包内的SingleFile做加密。
 // 7，SingleFile的文件名长度不能超过SoPackageFileMAX_PATH。
 // 8，在Mode_Read模式下，为了快速定位要读取的文件，使用了哈希操作。魔兽世界的MPQ文件就是这么干的。
 // 9，加入了zlib压缩功能。
 //-----------------------------------------------------------------------------
+#include <stddef.h>
+#include <new>
 #include "SoPackageFile.h"
 #include "SoHash.h"
+#include "SoTrace.h"
+#include "SoIOUring.h"
+#if defined(_WIN32)
 #define ZLIB_WINAPI
+#endif
 #include "zlib.h"
 //-----------------------------------------------------------------------------
+//z_stream的avail_in和avail_out是32位的，更大的文件使用一次性的compress和uncompress。
+#define SoPackageFile_MaxStreamSize 0x7FFFFFFF
+//-----------------------------------------------------------------------------
 namespace GGUI
 {
 	//-----------------------------------------------------------------------------
 	SoPackageFile::SoPackageFile()
 	:m_theFileMode(Mode_None)
+	,m_eIOBackend(SoFileIO::Backend_Default)
+	,m_pAllocator(SoAllocator_GetDefault())
 	,m_pFile(0)
+	,m_nPackageFileSize(0)
 	,m_pSingleFileInfoList(0)
 	,m_nSingleFileInfoListCapacity(0)
 	,m_nSingleFileInfoListSize(0)
 	,m_pHashList(0)
-	,m_pTempBuff_SrcFile(0)
-	,m_pTempBuff_AfterCompress(0)
-	,m_nTempBuffMaxSize_SrcFile(0)
-	,m_nTempBuffMaxSize_AfterCompress(0)
+	,m_pWriteIndex(0)
+	,m_uiWriteIndexCapacity(0)
+	,m_pTempBuffList(0)
+	,m_nScratchMaxBytes(64*1024*1024)
+	,m_nScratchKeepBytes(4*1024*1024)
+	,m_nScratchIdleTime(10000)
+	,m_nScratchTrimTime(0)
+	,m_nLockWaitTime(0)
+	,m_pThreadPool(0)
+	,m_pAsyncThreadPool(0)
+	,m_pInflateThreadPool(0)
+	,m_uiAsyncThreadCount(0)
+	,m_uiAsyncMaxPending(4096)
+	,m_pAsyncRequestList(0)
+	,m_nAsyncPending(0)
+	,m_nAsyncRequestID(0)
+	,m_nEntryCacheMaxSize(64*1024*1024)
+	,m_eCompressFormat(Compress_Zlib)
+	,m_nBlockSize(1024*1024)
+	,m_nBlockMinFileSize(4*1024*1024)
+	,m_nParallelInflateMinSize(8*1024*1024)
+	,m_uiParallelInflateThreads(0)
+	,m_eReadVerify(ReadVerify_FirstTouch)
+	,m_pVerifiedList(0)
+	,m_bPredictorEnable(false)
+	,m_nPredictorBudget(0)
+	,m_pszPredictorFile(0)
+	,m_pSpeculativeState(0)
+	,m_nSpeculativeBytes(0)
 	{
-		InitializeCriticalSection(&m_Lock);
+		m_uiAsyncMaxRunning[SoThreadPool::Priority_High] = 0;
+		//0xFFFFFFFF表示使用默认值，即异步读取线程个数的一半。
+		m_uiAsyncMaxRunning[SoThreadPool::Priority_Low] = 0xFFFFFFFF;
 	}
 	//-----------------------------------------------------------------------------
 	SoPackageFile::~SoPackageFile()
 	{
 		ReleasePackageFile();
-		DeleteCriticalSection(&m_Lock);
+		ReleaseTempBuff(true);
 	}
 	//-----------------------------------------------------------------------------
 	SoPackageFile::OperationResult SoPackageFile::InitPackageFile(const char* pszPackageFile, FileMode theFileMode)
 	{
+		SoTrace_Scope("InitPackageFile");
 		if (pszPackageFile == 0 //空指针
 			|| pszPackageFile[0] == 0 //空字符串
 			|| theFileMode == Mode_None) //无效的文件操作模式
@@ -55,16 +95,16 @@ namespace GGUI
 			//资源包已经打开，必须先关闭才能打开下一个资源包。
 			return Result_PackageFileAlreadyOpen;
 		}
-		FILE* pFile = 0;
+		SoFileIO* pFile = SoFileIO_Create(m_eIOBackend);
 		//记录是否需要解析资源包，即提取资源包已有的文件结构信息。
 		bool bParsePackageFile = false;
 		if (theFileMode == Mode_Read)
 		{
 			//读模式，资源包文件必须存在。
-			pFile = fopen(pszPackageFile, "rb");
-			if (pFile == 0)
+			if (!pFile->Open(pszPackageFile, SoFileIO::Open_Read))
 			{
 				//打开失败。
+				delete pFile;
 				return Result_OpenFileFail;
 			}
 			else
@@ -76,13 +116,12 @@ namespace GGUI
 		else if (theFileMode == Mode_Write)
 		{
 			//写模式，如果资源包不存在则创建。
-			pFile = fopen(pszPackageFile, "r+b");
-			if (pFile == 0)
+			if (!pFile->Open(pszPackageFile, SoFileIO::Open_ReadWrite))
 			{
 				//资源包不存在，则创建。
-				pFile = fopen(pszPackageFile, "w+b");
-				if (pFile == 0)
+				if (!pFile->Open(pszPackageFile, SoFileIO::Open_Create))
 				{
+					delete pFile;
 					return Result_CreateFileFail;
 				}
 				else
@@ -107,6 +146,10 @@ namespace GGUI
 				ReleasePackageFile();
 				return eResult;
 			}
+			if (m_theFileMode == Mode_Read && m_bPredictorEnable)
+			{
+				InitPredictor(pszPackageFile);
+			}
 		}
 		else
 		{
@@ -121,591 +164,3953 @@ namespace GGUI
 	//-----------------------------------------------------------------------------
 	SoPackageFile::OperationResult SoPackageFile::ReleasePackageFile()
 	{
+		//先结束所有后台任务，它们还会使用m_pFile。
+		CancelAllAsync();
+		ReleaseThreadPool();
+		//文件缓存释放时会通知访问预测，所以先释放文件缓存。
+		m_EntryCache.Release();
+		ReleasePredictor();
 		m_theFileMode = Mode_None;
 		if (m_pFile)
 		{
-			fclose(m_pFile);
+			delete m_pFile;
 			m_pFile = 0;
 		}
 		m_stPackageHead.Clear();
+		m_nPackageFileSize = 0;
 		ReleaseSingleFileInfoList();
 		if (m_pHashList)
 		{
-			free(m_pHashList);
+			m_pAllocator->Free(m_pHashList);
 			m_pHashList = 0;
 		}
-		if (m_pTempBuff_SrcFile)
+		if (m_pVerifiedList)
 		{
-			free(m_pTempBuff_SrcFile);
-			m_pTempBuff_SrcFile = 0;
+			m_pAllocator->Free((void*)m_pVerifiedList);
+			m_pVerifiedList = 0;
 		}
-		if (m_pTempBuff_AfterCompress)
+		if (m_pWriteIndex)
 		{
-			free(m_pTempBuff_AfterCompress);
-			m_pTempBuff_AfterCompress = 0;
+			m_pAllocator->Free(m_pWriteIndex);
+			m_pWriteIndex = 0;
+			m_uiWriteIndexCapacity = 0;
 		}
-		m_nTempBuffMaxSize_SrcFile = 0;
-		m_nTempBuffMaxSize_AfterCompress = 0;
+		ReleaseTempBuff(false);
 		return Result_OK;
 	}
 	//-----------------------------------------------------------------------------
-	SoPackageFile::OperationResult SoPackageFile::Open(const char* pszFileName, stReadSingleFile& theFile)
+	SoPackageFile::OperationResult SoPackageFile::SetIOBackend(SoFileIO::Backend eBackend)
 	{
-		if (pszFileName == 0 || pszFileName[0] == 0)
+		if (m_pFile || m_theFileMode != Mode_None)
 		{
-			//空指针或者空字符串。
-			return Result_InvalidParam;
+			//资源包打开之后不能再修改。
+			return Result_PackageFileAlreadyOpen;
 		}
-		if (m_theFileMode != Mode_Read)
+		m_eIOBackend = eBackend;
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::SetAllocator(SoAllocator* pAllocator)
+	{
+		if (m_pFile || m_theFileMode != Mode_None)
 		{
-			return Result_FileModeMismatch;
+			return Result_PackageFileAlreadyOpen;
 		}
+		m_pAllocator = pAllocator ? pAllocator : SoAllocator_GetDefault();
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoAllocator* SoPackageFile::GetAllocator() const
+	{
+		return m_pAllocator;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::GetPackageHead(stPackageHead& theHead) const
+	{
 		if (m_pFile == 0)
 		{
 			return Result_PackageFileHaveNotOpen;
 		}
-		//格式化文件名。
-		char szFormatFileName[SoPackageFileMAX_PATH];
-		FormatFileFullName(szFormatFileName, pszFileName);
-		EnterCriticalSection(&m_Lock);
-		//从m_pSingleFileInfoList中找到索引位置。
-		soint64 theIndex_SingleFileInfoList = GetIndex_SingleFileInfoList(szFormatFileName);
-		if (theIndex_SingleFileInfoList == -1)
-		{
-			//文件不存在。
-			LeaveCriticalSection(&m_Lock);
-			return Result_SingleFileNotExist;
-		}
-		theFile.nFileID = theIndex_SingleFileInfoList;
-		theFile.nFileSize = m_pSingleFileInfoList[theFile.nFileID].nOriginalFileSize;
-		LeaveCriticalSection(&m_Lock);
+		theHead = m_stPackageHead;
 		return Result_OK;
 	}
 	//-----------------------------------------------------------------------------
-	SoPackageFile::OperationResult SoPackageFile::Close(stReadSingleFile& theFile)
+	soint64 SoPackageFile::GetFileCount() const
 	{
-		theFile.Clear();
-		return Result_OK;
+		return m_pFile ? m_nSingleFileInfoListSize : 0;
 	}
 	//-----------------------------------------------------------------------------
-	SoPackageFile::OperationResult SoPackageFile::Read(void* pBuff, soint64 nElementSize, soint64 nElementCount, soint64& nActuallyReadCount, stReadSingleFile& theFile)
+	SoPackageFile::OperationResult SoPackageFile::GetSingleFileInfo(soint64 nFileID, stSingleFileInfo& theInfo) const
 	{
-		nActuallyReadCount = 0;
-		if (pBuff == 0)
+		if (m_pFile == 0)
 		{
-			return Result_InvalidParam;
+			return Result_PackageFileHaveNotOpen;
 		}
-		if (theFile.nFileID < 0)
+		if (nFileID < 0 || nFileID >= m_nSingleFileInfoListSize)
 		{
 			return Result_InvalidFileID;
 		}
-		if (m_theFileMode != Mode_Read)
+		theInfo = m_pSingleFileInfoList[nFileID];
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::GetHashSlot(soint64 nSlot, stHashInfo& theInfo) const
+	{
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		if (m_theFileMode != Mode_Read || m_pHashList == 0)
 		{
 			return Result_FileModeMismatch;
 		}
-		if (m_pFile == 0)
+		if (nSlot < 0 || nSlot >= m_nSingleFileInfoListSize)
 		{
-			return Result_PackageFileHaveNotOpen;
+			return Result_InvalidParam;
 		}
-		if (theFile.nFileID >= m_nSingleFileInfoListSize)
+		theInfo = m_pHashList[nSlot];
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoPackageFile::GetSingleFileInfoSize(soint64 nVersion)
+	{
+		//版本3之前的记录到uiFlags为止（版本1中是对齐空间）。
+		return (nVersion < 3) ? (soint64)offsetof(stSingleFileInfo, uiEmbededCRC) : (soint64)sizeof(stSingleFileInfo);
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoPackageFile::GetBlockSize(const stSingleFileInfo& theFileInfo)
+	{
+		if ((theFileInfo.uiFlags & (SingleFile_Blocked | SingleFile_Stored)) != SingleFile_Blocked)
 		{
-			return Result_InvalidFileID;
+			return 0;
 		}
-		if (theFile.pFileBuff == 0)
+		const souint32 uiShift = (theFileInfo.uiFlags & SingleFile_BlockShiftMask) >> SingleFile_BlockShift;
+		//损坏的资源包中可能是任意值，超出范围的当作无效。
+		if (uiShift >= 63)
 		{
-			//源文件尚未从资源包内读取出来。
-			EnterCriticalSection(&m_Lock);
-			const stSingleFileInfo& theFileInfo = m_pSingleFileInfoList[theFile.nFileID];
-			TryResizeTempBuff_AfterCompress(theFileInfo.nEmbededFileSize);
-			TryResizeTempBuff_SrcFile(theFileInfo.nOriginalFileSize + 1024000); //因为要解压缩，所以适当多申请一些内存。
-			//
-			soint64 nSeekResult = _fseeki64(m_pFile, theFileInfo.nOffset, SEEK_SET);
-			if (nSeekResult != 0)
-			{
-				LeaveCriticalSection(&m_Lock);
-				return Result_FileOperationError;
-			}
-			soint64 nActuallyReadCount = fread(m_pTempBuff_AfterCompress, 1, (size_t)theFileInfo.nEmbededFileSize, m_pFile);
-			if (nActuallyReadCount != theFileInfo.nEmbededFileSize)
-			{
-				LeaveCriticalSection(&m_Lock);
-				return Result_FileOperationError;
-			}
-			//解压缩。
-			uLongf nSizeAfterUncompress = (uLongf)m_nTempBuffMaxSize_SrcFile;
-			int nResult = uncompress((Bytef*)m_pTempBuff_SrcFile, &nSizeAfterUncompress, (Bytef*)m_pTempBuff_AfterCompress, theFileInfo.nEmbededFileSize);
-			if (nResult != Z_OK)
-			{
-				LeaveCriticalSection(&m_Lock);
-				return Result_UncompressFail;
-			}
-			if ((soint64)nSizeAfterUncompress != theFileInfo.nOriginalFileSize)
-			{
-				LeaveCriticalSection(&m_Lock);
-				return Result_FileSizeNotMatchAfterUncompress;
-			}
-			theFile.pFileBuff = (char*)malloc(theFileInfo.nOriginalFileSize);
-			memcpy(theFile.pFileBuff, m_pTempBuff_SrcFile, theFileInfo.nOriginalFileSize);
-			LeaveCriticalSection(&m_Lock);
+			return 0;
 		}
-		nActuallyReadCount = nElementCount;
-		//把nActuallyReadCount修正一下。
-		if (nElementCount * nElementSize > theFile.nFileSize - theFile.nFilePointer)
+		const soint64 nBlockSize = (soint64)1 << uiShift;
+		return (nBlockSize >= SoPackageFile_MinBlockSize && nBlockSize <= SoPackageFile_MaxBlockSize) ? nBlockSize : 0;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoPackageFile::GetBlockCount(const stSingleFileInfo& theFileInfo)
+	{
+		const soint64 nBlockSize = GetBlockSize(theFileInfo);
+		return (nBlockSize > 0 && theFileInfo.nOriginalFileSize > 0) ? (theFileInfo.nOriginalFileSize + nBlockSize - 1) / nBlockSize : 0;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoPackageFile::GetPackageFileSize() const
+	{
+		return (m_pFile && m_theFileMode == Mode_Read) ? m_nPackageFileSize : 0;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::SetAsyncLimit(souint32 uiThreadCount, souint32 uiMaxPending)
+	{
+		if (m_pFile || m_theFileMode != Mode_None)
 		{
-			nActuallyReadCount = (theFile.nFileSize - theFile.nFilePointer) / nElementSize;
+			return Result_PackageFileAlreadyOpen;
 		}
-		soint64 nActuallyReadSize = nActuallyReadCount * nElementSize;
-		memcpy(pBuff, theFile.pFileBuff+theFile.nFilePointer, nActuallyReadSize);
-		//读取完毕。
-		theFile.nFilePointer += nActuallyReadSize;
+		m_uiAsyncThreadCount = uiThreadCount;
+		m_uiAsyncMaxPending = uiMaxPending;
 		return Result_OK;
 	}
 	//-----------------------------------------------------------------------------
-	SoPackageFile::OperationResult SoPackageFile::Tell(soint64& nFilePos, stReadSingleFile& theFile)
+	SoPackageFile::OperationResult SoPackageFile::SetAsyncPriorityLimit(SoThreadPool::Priority ePriority, souint32 uiMaxRunning)
 	{
-		nFilePos = theFile.nFilePointer;
+		if (ePriority < 0 || ePriority >= SoThreadPool::Priority_Count)
+		{
+			return Result_InvalidParam;
+		}
+		if (m_pFile || m_theFileMode != Mode_None)
+		{
+			return Result_PackageFileAlreadyOpen;
+		}
+		m_uiAsyncMaxRunning[ePriority] = uiMaxRunning;
 		return Result_OK;
 	}
 	//-----------------------------------------------------------------------------
-	SoPackageFile::OperationResult SoPackageFile::Seek(soint64 nOffset, SeekOrigin theOrigin, stReadSingleFile& theFile)
+	SoPackageFile::OperationResult SoPackageFile::SetEntryCacheSize(soint64 nMaxSize)
 	{
-		soint64 destPos = 0;
-		switch (theOrigin)
+		if (nMaxSize < 0)
 		{
-		case Seek_Set:
-			destPos = nOffset;
-			break;
-		case Seek_Cur:
-			destPos = theFile.nFilePointer + nOffset;
-			break;
-		case Seek_End:
-			destPos = theFile.nFileSize + nOffset;
-			break;
-		default:
-			break;
+			return Result_InvalidParam;
 		}
-		if (destPos < 0)
+		if (m_pFile || m_theFileMode != Mode_None)
 		{
-			destPos = 0;
+			return Result_PackageFileAlreadyOpen;
 		}
-		else if (destPos > theFile.nFileSize)
+		m_nEntryCacheMaxSize = nMaxSize;
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::SetCompressFormat(CompressFormat eFormat)
+	{
+		if (eFormat != Compress_Zlib && eFormat != Compress_RawDeflate)
 		{
-			destPos = theFile.nFileSize;
+			return Result_InvalidParam;
 		}
-		theFile.nFilePointer = destPos;
+		if (m_pFile || m_theFileMode != Mode_None)
+		{
+			return Result_PackageFileAlreadyOpen;
+		}
+		m_eCompressFormat = eFormat;
 		return Result_OK;
 	}
 	//-----------------------------------------------------------------------------
-	SoPackageFile::OperationResult SoPackageFile::InsertSingleFile(const char* pszDiskFile)
+	SoPackageFile::OperationResult SoPackageFile::SetReadVerify(ReadVerify eVerify)
 	{
-		if (pszDiskFile == 0 || pszDiskFile[0] == 0)
+		if (eVerify != ReadVerify_Always && eVerify != ReadVerify_FirstTouch && eVerify != ReadVerify_Never)
 		{
-			//无效指针或者是空字符串。
 			return Result_InvalidParam;
 		}
-		soint64 nDiskFileNameLength = strlen(pszDiskFile);
-		if (nDiskFileNameLength >= SoPackageFileMAX_PATH)
+		if (m_pFile || m_theFileMode != Mode_None)
 		{
-			return Result_FileNameLengthTooLong;
+			return Result_PackageFileAlreadyOpen;
 		}
-		if (m_theFileMode != Mode_Write)
+		m_eReadVerify = eVerify;
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::SetBlockCompress(soint64 nBlockSize, soint64 nMinFileSize)
+	{
+		if (nBlockSize != 0 && (nBlockSize < SoPackageFile_MinBlockSize || nBlockSize > SoPackageFile_MaxBlockSize || (nBlockSize & (nBlockSize - 1)) != 0))
 		{
-			return Result_FileModeMismatch;
+			return Result_InvalidParam;
 		}
-		if (m_pFile == 0)
+		if (nMinFileSize < 0)
 		{
-			return Result_PackageFileHaveNotOpen;
+			return Result_InvalidParam;
 		}
-		//
-		stSingleFileInfo newSingleFile;
-		FormatFileFullName(newSingleFile.szFileName, pszDiskFile);
-		newSingleFile.uiHashA = SoHash_Index(newSingleFile.szFileName);
-		newSingleFile.uiHashB = SoHash_PHP(newSingleFile.szFileName);
-		newSingleFile.uiHashC = SoHash_BKDR(newSingleFile.szFileName);
-		//判断该文件是否已经存在了。
-		bool bAlreadyExist = false;
-		for (soint64 i=0; i<m_nSingleFileInfoListSize; ++i)
+		if (m_pFile || m_theFileMode != Mode_None)
 		{
-			if (newSingleFile.uiHashA == m_pSingleFileInfoList[i].uiHashA
-				&& newSingleFile.uiHashB == m_pSingleFileInfoList[i].uiHashB
-				&& newSingleFile.uiHashC == m_pSingleFileInfoList[i].uiHashC)
-			{
-				bAlreadyExist = true;
-				break;
-			}
+			return Result_PackageFileAlreadyOpen;
 		}
-		if (bAlreadyExist)
+		m_nBlockSize = nBlockSize;
+		m_nBlockMinFileSize = nMinFileSize;
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::SetParallelInflate(soint64 nMinFileSize, souint32 uiMaxThreads)
+	{
+		if (nMinFileSize < 0)
 		{
-			return Result_SingleFileAlreadyExist;
+			return Result_InvalidParam;
 		}
-		//打开磁盘文件。
-		FILE* pSingleFile = fopen(newSingleFile.szFileName, "rb");
-		if (pSingleFile == 0)
+		if (m_pFile || m_theFileMode != Mode_None)
 		{
-			return Result_OpenFileFail;
+			return Result_PackageFileAlreadyOpen;
 		}
-		//获取磁盘文件大小。
-		_fseeki64(pSingleFile, 0, SEEK_END);
-		soint64 nDiskFileSize = _ftelli64(pSingleFile);
-		newSingleFile.nOriginalFileSize = nDiskFileSize;
-		newSingleFile.nOffset = m_stPackageHead.nOffsetForFirstSingleFileInfo;
-		//向资源包中写入这个文件。
-		OperationResult writeResult = WriteSingleFile(pSingleFile, newSingleFile);
-		fclose(pSingleFile);
-		pSingleFile = 0;
-		if (writeResult != Result_OK)
+		m_nParallelInflateMinSize = nMinFileSize;
+		m_uiParallelInflateThreads = uiMaxThreads;
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::SetPredictor(bool bEnable, soint64 nBudget)
+	{
+		if (nBudget < 0)
 		{
-			//写入失败。
-			return writeResult;
+			return Result_InvalidParam;
 		}
-		//分配结构体对象，并填充参数。
-		soint64 nFileID = AssignSingleFileInfo();
-		if (nFileID == -1)
+		if (m_pFile || m_theFileMode != Mode_None)
 		{
-			return Result_MemoryIsEmpty;
+			return Result_PackageFileAlreadyOpen;
 		}
-		memcpy(&(m_pSingleFileInfoList[nFileID]), &newSingleFile, sizeof(stSingleFileInfo));
-		//完善文件头信息。
-		++m_stPackageHead.nFileCount;
-		m_stPackageHead.nOffsetForFirstSingleFileInfo += m_pSingleFileInfoList[nFileID].nEmbededFileSize;
+		m_bPredictorEnable = bEnable;
+		m_nPredictorBudget = nBudget;
 		return Result_OK;
 	}
 	//-----------------------------------------------------------------------------
-	SoPackageFile::OperationResult SoPackageFile::FlushPackageFile()
+	SoPackageFile::OperationResult SoPackageFile::SavePredictor()
 	{
-		if (m_theFileMode != Mode_Write)
+		if (m_pSpeculativeState == 0)
 		{
 			return Result_FileModeMismatch;
 		}
-		if (m_pFile == 0)
+		return m_Predictor.Save(m_pszPredictorFile) ? Result_OK : Result_CreateFileFail;
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::GetPredictorStats(stPredictorStats& theStats) const
+	{
+		theStats = m_stPredictorStats;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::SetScratchLimit(soint64 nMaxBytes, soint64 nKeepBytes, souint32 uiIdleMilliseconds)
+	{
+		if (nMaxBytes < 0 || nKeepBytes < 0)
 		{
-			return Result_PackageFileHaveNotOpen;
+			return Result_InvalidParam;
 		}
-		OperationResult theResult = WritePackageHead();
-		if (theResult == Result_OK)
+		if (m_pFile || m_theFileMode != Mode_None)
 		{
-			theResult = WriteAllSingleFileInfo();
-			if (theResult == Result_OK)
-			{
-				fflush(m_pFile);
-			}
+			return Result_PackageFileAlreadyOpen;
 		}
-		return theResult;
+		m_nScratchMaxBytes = nMaxBytes;
+		m_nScratchKeepBytes = nKeepBytes;
+		m_nScratchIdleTime = uiIdleMilliseconds;
+		return Result_OK;
 	}
 	//-----------------------------------------------------------------------------
-	SoPackageFile::OperationResult SoPackageFile::WritePackageHead()
+	void SoPackageFile::TrimScratch()
 	{
-		//判断当前文件状态。
-		if (m_pFile == 0)
+		TrimTempBuff(0);
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::GetScratchStats(stScratchStats& theStats)
+	{
+		SoTimedAutoLock theAutoLock(m_ScratchLock, &m_nLockWaitTime);
+		theStats = m_stScratchStats;
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::GetStats(stStats& theStats)
+	{
+		SoAutoLock theAutoLock(m_TempBuffListLock);
+		SumStats(theStats);
+		soint64* pDest = (soint64*)&theStats;
+		const soint64* pBase = (const soint64*)&m_stStatsBase;
+		for (size_t i=0; i<sizeof(stStats)/sizeof(soint64); ++i)
 		{
-			return Result_PackageFileHaveNotOpen;
+			pDest[i] -= pBase[i];
 		}
-		soint64 nSeekResult = _fseeki64(m_pFile, 0, SEEK_SET);
-		if (nSeekResult != 0)
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::ResetStats()
+	{
+		SoAutoLock theAutoLock(m_TempBuffListLock);
+		SumStats(m_stStatsBase);
+		for (int i=0; i<Latency_Count; ++i)
 		{
-			return Result_FileOperationError;
+			for (int j=0; j<Size_Count; ++j)
+			{
+				SumLatency((LatencyOp)i, (SizeClass)j, m_LatencyBase[i][j]);
+			}
 		}
-		//生成合法的文件头。
-		const char* pszFileFlag = SoPackageFileFlag;
-		for (soint64 i=0; i<SoPackageFileFlagLength; ++i)
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::SumStats(stStats& theStats)
+	{
+		//在m_TempBuffListLock内调用。stStats的成员都是soint64，逐个相加。
+		//线程的stTempBuff在SoPackageFile销毁之前一直存在，所以累加值不会减少。
+		//其他线程同时在用SoAtomic_Add64累加，这里用原子读取，32位程序中也不会读到一半的值。
+		theStats = stStats();
+		soint64* pDest = (soint64*)&theStats;
+		for (stTempBuff* pTempBuff = m_pTempBuffList; pTempBuff; pTempBuff = pTempBuff->pNext)
 		{
-			m_stPackageHead.szFileFlag[i] = pszFileFlag[i];
+			const soint64* pSrc = (const soint64*)&pTempBuff->theStats;
+			for (size_t i=0; i<sizeof(stStats)/sizeof(soint64); ++i)
+			{
+				pDest[i] += SoAtomic_Load64(&pSrc[i]);
+			}
 		}
-		m_stPackageHead.nVersion = SoPackageFileVersion;
-		//写入。
-		const size_t sizePackageHead = sizeof(m_stPackageHead);
-		size_t nActuallyWrite = fwrite(&m_stPackageHead, 1, sizePackageHead, m_pFile);
-		if (nActuallyWrite != sizePackageHead)
+		theStats.nLockWaitTime += SoAtomic_Load64(&m_nLockWaitTime) + m_EntryCache.GetLockWaitTime();
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::GetLatency(LatencyOp eOp, SizeClass eSize, SoHistogram& theHistogram)
+	{
+		theHistogram.Clear();
+		if (eOp < 0 || eOp >= Latency_Count || eSize < 0 || eSize >= Size_Count)
 		{
-			//文件头没有写入完整。
-			return Result_FileOperationError;
+			return;
 		}
-		return Result_OK;
+		SoAutoLock theAutoLock(m_TempBuffListLock);
+		SumLatency(eOp, eSize, theHistogram);
+		theHistogram.Subtract(m_LatencyBase[eOp][eSize]);
 	}
 	//-----------------------------------------------------------------------------
-	SoPackageFile::OperationResult SoPackageFile::WriteSingleFile(FILE* pSingleFile, SoPackageFile::stSingleFileInfo& theFileInfo)
+	SoPackageFile::OperationResult SoPackageFile::DumpLatency(FILE* pFile, bool bJson)
 	{
-		if (pSingleFile == 0)
+		if (pFile == 0)
 		{
 			return Result_InvalidParam;
 		}
-		if (m_pFile == 0)
-		{
-			return Result_PackageFileHaveNotOpen;
-		}
-		//调整文件指针位置，准备写入。
-		soint64 nSeekResult = _fseeki64(pSingleFile, 0, SEEK_SET);
-		if (nSeekResult != 0)
+		static const char* s_OpName[Latency_Count] = {"Open", "FirstRead", "Read", "IO", "Inflate"};
+		static const char* s_SizeName[Size_Count] = {"<16KB", "<256KB", "<4MB", ">=4MB"};
+		if (bJson)
 		{
-			return Result_FileOperationError;
+			fprintf(pFile, "{\"unit\":\"ns\",\"latency\":[");
 		}
-		nSeekResult = _fseeki64(m_pFile, theFileInfo.nOffset, SEEK_SET);
-		if (nSeekResult != 0)
+		else
 		{
-			return Result_FileOperationError;
+			fprintf(pFile, "%-10s %-7s %10s %10s %10s %10s %10s %10s %10s\n", "op", "size", "count", "mean(us)", "p50", "p90", "p99", "p99.9", "max");
 		}
-		//读取源文件。
-		TryResizeTempBuff_SrcFile(theFileInfo.nOriginalFileSize);
-		const size_t sizeOriginalFileSize = (size_t)(theFileInfo.nOriginalFileSize);
-		size_t nActuallyRead = fread(m_pTempBuff_SrcFile, 1, sizeOriginalFileSize, pSingleFile);
-		if (nActuallyRead != sizeOriginalFileSize)
+		bool bFirst = true;
+		for (int i=0; i<Latency_Count; ++i)
 		{
+			for (int j=0; j<Size_Count; ++j)
+			{
+				SoHistogram theHistogram;
+				GetLatency((LatencyOp)i, (SizeClass)j, theHistogram);
+				const soint64 nCount = theHistogram.GetCount();
+				const soint64 nMean = (nCount > 0) ? (theHistogram.GetSum() / nCount) : 0;
+				if (bJson)
+				{
+					//JSON输出所有的格子，方便脚本按固定的结构解析。
+					fprintf(pFile, "%s{\"op\":\"%s\",\"size\":\"%s\",\"count\":%lld,\"mean\":%lld,\"p50\":%lld,\"p90\":%lld,\"p99\":%lld,\"p999\":%lld,\"max\":%lld}",
+						bFirst ? "" : ",", s_OpName[i], s_SizeName[j], (long long)nCount, (long long)nMean,
+						(long long)theHistogram.GetPercentile(50.0), (long long)theHistogram.GetPercentile(90.0),
+						(long long)theHistogram.GetPercentile(99.0), (long long)theHistogram.GetPercentile(99.9),
+						(long long)theHistogram.GetMax());
+					bFirst = false;
+				}
+				else if (nCount > 0)
+				{
+					//文本输出跳过没有记录的格子，时间以微秒为单位。
+					fprintf(pFile, "%-10s %-7s %10lld %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+						s_OpName[i], s_SizeName[j], (long long)nCount, nMean / 1000.0,
+						theHistogram.GetPercentile(50.0) / 1000.0, theHistogram.GetPercentile(90.0) / 1000.0,
+						theHistogram.GetPercentile(99.0) / 1000.0, theHistogram.GetPercentile(99.9) / 1000.0,
+						theHistogram.GetMax() / 1000.0);
+				}
+			}
+		}
+		if (bJson)
+		{
+			fprintf(pFile, "]}\n");
+		}
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::SumLatency(LatencyOp eOp, SizeClass eSize, SoHistogram& theHistogram)
+	{
+		//在m_TempBuffListLock内调用。
+		theHistogram.Clear();
+		for (stTempBuff* pTempBuff = m_pTempBuffList; pTempBuff; pTempBuff = pTempBuff->pNext)
+		{
+			theHistogram.Add(pTempBuff->theLatency[eOp][eSize]);
+		}
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::RecordLatency(LatencyOp eOp, soint64 nFileSize, soint64 nElapsed)
+	{
+		GetTempBuff()->theLatency[eOp][GetSizeClass(nFileSize)].Record(nElapsed);
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::SizeClass SoPackageFile::GetSizeClass(soint64 nFileSize)
+	{
+		if (nFileSize < 16 * 1024)
+		{
+			return Size_Tiny;
+		}
+		else if (nFileSize < 256 * 1024)
+		{
+			return Size_Small;
+		}
+		else if (nFileSize < 4 * 1024 * 1024)
+		{
+			return Size_Medium;
+		}
+		else
+		{
+			return Size_Large;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::Open(const char* pszFileName, stReadSingleFile& theFile)
+	{
+		if (pszFileName == 0 || pszFileName[0] == 0)
+		{
+			//空指针或者空字符串。
+			return Result_InvalidParam;
+		}
+		if (m_theFileMode != Mode_Read)
+		{
+			return Result_FileModeMismatch;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		SoTrace_Scope("Open");
+		const soint64 nStartTime = SoThread_GetNanoseconds();
+		//格式化文件名，同时计算哈希值。
+		char szFormatFileName[SoPackageFileMAX_PATH];
+		souint32 uiHashA = 0;
+		souint32 uiHashB = 0;
+		souint32 uiHashC = 0;
+		FormatFileFullName(szFormatFileName, pszFileName, uiHashA, uiHashB, uiHashC);
+		//从m_pSingleFileInfoList中找到索引位置。
+		//Mode_Read模式下索引信息是只读的，不需要加锁。
+		souint32 uiProbeCount = 0;
+		soint64 theIndex_SingleFileInfoList = GetIndex_SingleFileInfoList(uiHashA, uiHashB, uiHashC, uiProbeCount);
+		stStats& theStats = GetThreadStats();
+		SoAtomic_Add64(&theStats.nOpenCount, 1);
+		SoAtomic_Add64(&theStats.nProbeCount, uiProbeCount);
+		if (theIndex_SingleFileInfoList == -1)
+		{
+			//文件不存在。
+			SoAtomic_Add64(&theStats.nMissCount, 1);
+			RecordLatency(Latency_Open, 0, SoThread_GetNanoseconds() - nStartTime);
+			return Result_SingleFileNotExist;
+		}
+		theFile.nFileID = theIndex_SingleFileInfoList;
+		theFile.nFileSize = m_pSingleFileInfoList[theFile.nFileID].nOriginalFileSize;
+		SoTrace_SetArg(theFile.nFileID, theFile.nFileSize);
+		RecordLatency(Latency_Open, theFile.nFileSize, SoThread_GetNanoseconds() - nStartTime);
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::Close(stReadSingleFile& theFile)
+	{
+		theFile.Clear();
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::Read(void* pBuff, soint64 nElementSize, soint64 nElementCount, soint64& nActuallyReadCount, stReadSingleFile& theFile)
+	{
+		nActuallyReadCount = 0;
+		if (pBuff == 0)
+		{
+			return Result_InvalidParam;
+		}
+		if (theFile.nFileID < 0)
+		{
+			return Result_InvalidFileID;
+		}
+		if (m_theFileMode != Mode_Read)
+		{
+			return Result_FileModeMismatch;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		if (theFile.nFileID >= m_nSingleFileInfoListSize)
+		{
+			return Result_InvalidFileID;
+		}
+		SoTrace_Scope("Read");
+		SoTrace_SetArg(theFile.nFileID, theFile.nFileSize);
+		const soint64 nStartTime = SoThread_GetNanoseconds();
+		const LatencyOp eOp = (theFile.pFileBuff == 0) ? Latency_FirstRead : Latency_Read;
+		if (theFile.pFileBuff == 0)
+		{
+			//源文件尚未从资源包内读取出来。
+			RecordAccess(theFile.nFileID, true);
+			SoThreadPool* pSuspendedPool = BeginForegroundRead();
+			OperationResult eResult = LoadSingleFile(theFile);
+			EndForegroundRead(pSuspendedPool);
+			if (eResult != Result_OK)
+			{
+				return eResult;
+			}
+		}
+		nActuallyReadCount = nElementCount;
+		//把nActuallyReadCount修正一下。
+		if (nElementCount * nElementSize > theFile.nFileSize - theFile.nFilePointer)
+		{
+			nActuallyReadCount = (theFile.nFileSize - theFile.nFilePointer) / nElementSize;
+		}
+		soint64 nActuallyReadSize = nActuallyReadCount * nElementSize;
+		memcpy(pBuff, theFile.pFileBuff+theFile.nFilePointer, nActuallyReadSize);
+		//读取完毕。
+		theFile.nFilePointer += nActuallyReadSize;
+		RecordLatency(eOp, theFile.nFileSize, SoThread_GetNanoseconds() - nStartTime);
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::ReadWholeFile(soint64 nFileID, void* pDest, soint64 nCapacity)
+	{
+		if (pDest == 0 || nCapacity < 0)
+		{
+			return Result_InvalidParam;
+		}
+		if (m_theFileMode != Mode_Read)
+		{
+			return Result_FileModeMismatch;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		if (nFileID < 0 || nFileID >= m_nSingleFileInfoListSize)
+		{
+			return Result_InvalidFileID;
+		}
+		const stSingleFileInfo& theFileInfo = m_pSingleFileInfoList[nFileID];
+		if (nCapacity < theFileInfo.nOriginalFileSize)
+		{
+			return Result_BufferTooSmall;
+		}
+		SoTrace_Scope("ReadWholeFile");
+		SoTrace_SetArg(nFileID, theFileInfo.nOriginalFileSize);
+		RecordAccess(nFileID, true);
+		//已经在文件缓存中，直接复制。
+		const char* pCached = 0;
+		soint64 nCachedSize = 0;
+		void* pHandle = m_EntryCache.Acquire(nFileID, pCached, nCachedSize);
+		if (pHandle)
+		{
+			SoAtomic_Add64(&GetThreadStats().nCacheHitCount, 1);
+			memcpy(pDest, pCached, (size_t)nCachedSize);
+			m_EntryCache.Unacquire(pHandle);
+			return Result_OK;
+		}
+		SoAtomic_Add64(&GetThreadStats().nCacheMissCount, 1);
+		SoThreadPool* pSuspendedPool = BeginForegroundRead();
+		OperationResult eResult = LoadSingleFileTo(theFileInfo, (char*)pDest);
+		EndForegroundRead(pSuspendedPool);
+		return eResult;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::ReadMany(stReadSingleFile* pFileList, soint64 nFileCount, OperationResult* pResultList)
+	{
+		if (pFileList == 0 || nFileCount < 0)
+		{
+			return Result_InvalidParam;
+		}
+		if (m_theFileMode != Mode_Read)
+		{
+			return Result_FileModeMismatch;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		if (nFileCount == 0)
+		{
+			return Result_OK;
+		}
+		stReadManyItem* pItemList = (stReadManyItem*)m_pAllocator->Alloc(nFileCount * (soint64)sizeof(stReadManyItem));
+		if (pItemList == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		SoSemaphore theDone(0);
+		//记录访问顺序，只根据最后一个文件做预测，因为其他文件马上就会被读取。
+		if (m_pSpeculativeState)
+		{
+			soint64 nLastFileID = -1;
+			for (soint64 i=0; i<nFileCount; ++i)
+			{
+				const soint64 nFileID = pFileList[i].nFileID;
+				if (pFileList[i].pFileBuff == 0 && nFileID >= 0 && nFileID < m_nSingleFileInfoListSize)
+				{
+					if (nLastFileID != -1)
+					{
+						RecordAccess(nLastFileID, false);
+					}
+					nLastFileID = nFileID;
+				}
+			}
+			if (nLastFileID != -1)
+			{
+				RecordAccess(nLastFileID, true);
+			}
+		}
+		//收集需要从资源包内读取的文件。
+		soint64 nPendingCount = 0;
+		for (soint64 i=0; i<nFileCount; ++i)
+		{
+			stReadSingleFile& theFile = pFileList[i];
+			OperationResult eResult = Result_OK;
+			if (theFile.nFileID < 0 || theFile.nFileID >= m_nSingleFileInfoListSize)
+			{
+				eResult = Result_InvalidFileID;
+			}
+			else if (theFile.pFileBuff == 0 && !CopyFromEntryCache(theFile))
+			{
+				stReadManyItem& theItem = pItemList[nPendingCount];
+				theItem.pPackage = this;
+				theItem.pFile = &theFile;
+				theItem.pResult = pResultList ? &pResultList[i] : 0;
+				theItem.eResult = Result_OK;
+				theItem.nOffset = m_pSingleFileInfoList[theFile.nFileID].nOffset;
+				theItem.pEmbeded = 0;
+				theItem.pDone = &theDone;
+				theItem.pSlot = 0;
+				theItem.bInFlight = false;
+				++nPendingCount;
+			}
+			if (pResultList)
+			{
+				pResultList[i] = eResult;
+			}
+		}
+		//按照在资源包内的偏移量排序，尽量顺序访问磁盘。
+		qsort(pItemList, (size_t)nPendingCount, sizeof(stReadManyItem), CompareReadManyItem);
+		SoThreadPool* pThreadPool = GetThreadPool();
+		SoThreadPool* pSuspendedPool = BeginForegroundRead();
+		SoIOUring theRing;
+		const souint32 uiRingDepth = nPendingCount < 128 ? (souint32)nPendingCount : 128;
+		if (m_pFile->GetFD() != -1 && theRing.Init(uiRingDepth))
+		{
+			//函数返回时所有文件已经处理完毕。
+			ReadManyWithIOUring(theRing, pItemList, nPendingCount, pThreadPool);
+		}
+		else
+		{
+			//不支持io_uring，在线程池中执行读取和解压缩。
+			for (soint64 i=0; i<nPendingCount; ++i)
+			{
+				if (pThreadPool == 0 || !pThreadPool->AddTask(ReadManyTask_Load, &pItemList[i], SoThreadPool::Priority_High))
+				{
+					ReadManyTask_Load(&pItemList[i]);
+				}
+			}
+			//等待所有文件处理完毕。
+			for (soint64 i=0; i<nPendingCount; ++i)
+			{
+				theDone.Wait();
+			}
+		}
+		EndForegroundRead(pSuspendedPool);
+		OperationResult eFinalResult = Result_OK;
+		for (soint64 i=0; i<nPendingCount; ++i)
+		{
+			if (pItemList[i].pResult)
+			{
+				*(pItemList[i].pResult) = pItemList[i].eResult;
+			}
+			if (pItemList[i].eResult != Result_OK && eFinalResult == Result_OK)
+			{
+				eFinalResult = pItemList[i].eResult;
+			}
+		}
+		m_pAllocator->Free(pItemList);
+		if (eFinalResult == Result_OK && pResultList)
+		{
+			//不需要读取的文件中可能有无效的FileID。
+			for (soint64 i=0; i<nFileCount; ++i)
+			{
+				if (pResultList[i] != Result_OK)
+				{
+					eFinalResult = pResultList[i];
+					break;
+				}
+			}
+		}
+		return eFinalResult;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::Verify(souint32 uiThreadCount, VerifyLevel eLevel, OperationResult* pResultList, stVerifyStats* pStats)
+	{
+		SoTrace_Scope("Verify");
+		if (eLevel != Verify_Embeded && eLevel != Verify_Inflate)
+		{
+			return Result_InvalidParam;
+		}
+		if (m_theFileMode != Mode_Read)
+		{
+			return Result_FileModeMismatch;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		OperationResult* pList = pResultList;
+		if (pList == 0 && m_nSingleFileInfoListSize > 0)
+		{
+			pList = (OperationResult*)m_pAllocator->Alloc(m_nSingleFileInfoListSize * (soint64)sizeof(OperationResult));
+			if (pList == 0)
+			{
+				return Result_MemoryIsEmpty;
+			}
+		}
+		if (uiThreadCount == 0)
+		{
+			uiThreadCount = SoThread_GetCPUCount();
+		}
+		if ((soint64)uiThreadCount > m_nSingleFileInfoListSize)
+		{
+			uiThreadCount = (souint32)m_nSingleFileInfoListSize;
+		}
+		//一次性的线程池，线程个数由调用者决定，与ReadMany的线程池互不影响。
+		//各个线程按FileID的顺序领取文件，FileID的顺序就是写入的顺序，磁盘基本上是顺序访问的。
+		SoSemaphore theDone(0);
+		stVerifyTask theTask;
+		theTask.pPackage = this;
+		theTask.eLevel = eLevel;
+		theTask.pResultList = pList;
+		theTask.nNextFileID = 0;
+		theTask.nCheckedCount = 0;
+		theTask.nCheckedBytes = 0;
+		theTask.nSkippedCount = 0;
+		theTask.pDone = &theDone;
+		if (uiThreadCount > 1)
+		{
+			SoThreadPool theThreadPool;
+			if (theThreadPool.Start(uiThreadCount))
+			{
+				souint32 uiStarted = 0;
+				for (souint32 i=0; i<uiThreadCount; ++i)
+				{
+					if (theThreadPool.AddTask(VerifyTask_Run, &theTask, SoThreadPool::Priority_High))
+					{
+						++uiStarted;
+					}
+				}
+				for (souint32 i=0; i<uiStarted; ++i)
+				{
+					theDone.Wait();
+				}
+			}
+		}
+		//只有一个线程、线程池启动失败时在当前线程执行，也负责剩下的文件。
+		VerifyTask_Run(&theTask);
+		theDone.Wait();
+		OperationResult eFinalResult = Result_OK;
+		soint64 nBadCount = 0;
+		for (soint64 i=0; i<m_nSingleFileInfoListSize; ++i)
+		{
+			if (pList[i] != Result_OK)
+			{
+				if (eFinalResult == Result_OK)
+				{
+					eFinalResult = pList[i];
+				}
+				++nBadCount;
+			}
+		}
+		if (pStats)
+		{
+			pStats->nCheckedCount = theTask.nCheckedCount;
+			pStats->nCheckedBytes = theTask.nCheckedBytes;
+			pStats->nSkippedCount = theTask.nSkippedCount;
+			pStats->nBadCount = nBadCount;
+		}
+		if (pList != pResultList)
+		{
+			m_pAllocator->Free(pList);
+		}
+		return eFinalResult;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::ExtractAll(const char* pszDestDir, souint32 uiThreadCount, OperationResult* pResultList, stExtractStats* pStats)
+	{
+		SoTrace_Scope("ExtractAll");
+		if (pszDestDir == 0 || pszDestDir[0] == 0 || strlen(pszDestDir) >= SoPackageFileMAX_PATH)
+		{
+			return Result_InvalidParam;
+		}
+		if (m_theFileMode != Mode_Read)
+		{
+			return Result_FileModeMismatch;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		if (!SoFileIO_MakeDir(pszDestDir))
+		{
+			return Result_CreateFileFail;
+		}
+		OperationResult* pList = pResultList;
+		if (pList == 0 && m_nSingleFileInfoListSize > 0)
+		{
+			pList = (OperationResult*)m_pAllocator->Alloc(m_nSingleFileInfoListSize * (soint64)sizeof(OperationResult));
+			if (pList == 0)
+			{
+				return Result_MemoryIsEmpty;
+			}
+		}
+		if (uiThreadCount == 0)
+		{
+			uiThreadCount = SoThread_GetCPUCount();
+		}
+		if ((soint64)uiThreadCount > m_nSingleFileInfoListSize)
+		{
+			uiThreadCount = (souint32)m_nSingleFileInfoListSize;
+		}
+		//与Verify一样按FileID的顺序领取文件，整个资源包基本上是从头到尾顺序读取的，期间让操作系统加大预读。
+		m_pFile->Advise(0, 0, SoFileIO::Access_Sequential);
+		SoSemaphore theDone(0);
+		stExtractTask theTask;
+		theTask.pPackage = this;
+		theTask.pszDestDir = pszDestDir;
+		theTask.pResultList = pList;
+		theTask.nNextFileID = 0;
+		theTask.nExtractedCount = 0;
+		theTask.nExtractedBytes = 0;
+		theTask.nKernelCopyCount = 0;
+		theTask.pDone = &theDone;
+		if (uiThreadCount > 1)
+		{
+			SoThreadPool theThreadPool;
+			if (theThreadPool.Start(uiThreadCount))
+			{
+				souint32 uiStarted = 0;
+				for (souint32 i=0; i<uiThreadCount; ++i)
+				{
+					if (theThreadPool.AddTask(ExtractTask_Run, &theTask, SoThreadPool::Priority_High))
+					{
+						++uiStarted;
+					}
+				}
+				for (souint32 i=0; i<uiStarted; ++i)
+				{
+					theDone.Wait();
+				}
+			}
+		}
+		ExtractTask_Run(&theTask);
+		theDone.Wait();
+		m_pFile->Advise(0, 0, SoFileIO::Access_Random);
+		OperationResult eFinalResult = Result_OK;
+		soint64 nFailedCount = 0;
+		for (soint64 i=0; i<m_nSingleFileInfoListSize; ++i)
+		{
+			if (pList[i] != Result_OK)
+			{
+				if (eFinalResult == Result_OK)
+				{
+					eFinalResult = pList[i];
+				}
+				++nFailedCount;
+			}
+		}
+		if (pStats)
+		{
+			pStats->nExtractedCount = theTask.nExtractedCount;
+			pStats->nExtractedBytes = theTask.nExtractedBytes;
+			pStats->nKernelCopyCount = theTask.nKernelCopyCount;
+			pStats->nFailedCount = nFailedCount;
+		}
+		if (pList != pResultList)
+		{
+			m_pAllocator->Free(pList);
+		}
+		return eFinalResult;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::ReadAsync(stReadSingleFile& theFile, AsyncCallback pCallback, void* pUserData, SoExecutor* pExecutor, souint32* pRequestID, SoThreadPool::Priority ePriority)
+	{
+		if (pCallback == 0 || ePriority < 0 || ePriority >= SoThreadPool::Priority_Count)
+		{
+			return Result_InvalidParam;
+		}
+		if (m_theFileMode != Mode_Read)
+		{
+			return Result_FileModeMismatch;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		if (theFile.nFileID < 0 || theFile.nFileID >= m_nSingleFileInfoListSize)
+		{
+			return Result_InvalidFileID;
+		}
+		SoThreadPool* pThreadPool = GetAsyncThreadPool();
+		if (pThreadPool == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		if (pCallback != PrefetchCallback && pCallback != SpeculativeCallback && theFile.pFileBuff == 0)
+		{
+			//资源包内部的预读取不算访问。
+			RecordAccess(theFile.nFileID, true);
+		}
+		stAsyncRequest* pRequest = (stAsyncRequest*)m_pAllocator->Alloc(sizeof(stAsyncRequest));
+		if (pRequest == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		pRequest->uiRequestID = (souint32)SoAtomic_Increment(&m_nAsyncRequestID);
+		pRequest->pPackage = this;
+		pRequest->pAllocator = m_pAllocator;
+		pRequest->pFile = &theFile;
+		pRequest->pCallback = pCallback;
+		pRequest->pUserData = pUserData;
+		pRequest->pExecutor = pExecutor;
+		pRequest->ePriority = ePriority;
+		pRequest->nState = Async_Pending;
+		pRequest->eResult = Result_OK;
+		pRequest->pPrev = 0;
+		{
+			SoTimedAutoLock theAutoLock(m_AsyncLock, &m_nLockWaitTime);
+			if (m_uiAsyncMaxPending > 0 && m_nAsyncPending >= (soint32)m_uiAsyncMaxPending)
+			{
+				m_pAllocator->Free(pRequest);
+				return Result_AsyncQueueFull;
+			}
+			pRequest->pNext = m_pAsyncRequestList;
+			if (m_pAsyncRequestList)
+			{
+				m_pAsyncRequestList->pPrev = pRequest;
+			}
+			m_pAsyncRequestList = pRequest;
+			SoAtomic_Increment(&m_nAsyncPending);
+		}
+		//AddTask之后请求随时可能执行完毕并被释放，先记下编号。
+		const souint32 uiRequestID = pRequest->uiRequestID;
+		if (!pThreadPool->AddTask(AsyncTask_Read, pRequest, ePriority))
+		{
+			//线程池已经结束，请求不会执行，回调也不会调用。
+			UnlinkAsyncRequest(pRequest);
+			m_pAllocator->Free(pRequest);
+			return Result_MemoryIsEmpty;
+		}
+		if (pRequestID)
+		{
+			*pRequestID = uiRequestID;
+		}
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::CancelAsync(souint32 uiRequestID)
+	{
+		SoTimedAutoLock theAutoLock(m_AsyncLock, &m_nLockWaitTime);
+		for (stAsyncRequest* pRequest = m_pAsyncRequestList; pRequest; pRequest = pRequest->pNext)
+		{
+			if (pRequest->uiRequestID == uiRequestID)
+			{
+				if (SoAtomic_CompareExchange(&pRequest->nState, Async_Cancelled, Async_Pending) == Async_Pending)
+				{
+					return Result_OK;
+				}
+				return Result_AsyncRequestNotPending;
+			}
+		}
+		//已经结束的请求不在链表中。
+		return Result_AsyncRequestNotPending;
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoPackageFile::CancelAsyncByPriority(SoThreadPool::Priority ePriority)
+	{
+		souint32 uiCount = 0;
+		SoTimedAutoLock theAutoLock(m_AsyncLock, &m_nLockWaitTime);
+		for (stAsyncRequest* pRequest = m_pAsyncRequestList; pRequest; pRequest = pRequest->pNext)
+		{
+			if (pRequest->ePriority == ePriority
+				&& SoAtomic_CompareExchange(&pRequest->nState, Async_Cancelled, Async_Pending) == Async_Pending)
+			{
+				++uiCount;
+			}
+		}
+		return uiCount;
+	}
+	//-----------------------------------------------------------------------------
+	soint32 SoPackageFile::GetAsyncQueueDepth() const
+	{
+		return m_nAsyncPending;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::AcquireView(soint64 nFileID, stFileView& theView)
+	{
+		if (theView.eType != View_None)
+		{
+			//theView还引用着其他内容，直接覆盖会泄漏。
+			return Result_InvalidParam;
+		}
+		if (m_theFileMode != Mode_Read)
+		{
+			return Result_FileModeMismatch;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		if (nFileID < 0 || nFileID >= m_nSingleFileInfoListSize)
+		{
+			return Result_InvalidFileID;
+		}
+		RecordAccess(nFileID, true);
+		const stSingleFileInfo& theFileInfo = m_pSingleFileInfoList[nFileID];
+		SoTrace_Scope("AcquireView");
+		SoTrace_SetArg(nFileID, theFileInfo.nOriginalFileSize);
+		if ((theFileInfo.uiFlags & SingleFile_Stored)
+			&& theFileInfo.nEmbededFileSize == theFileInfo.nOriginalFileSize
+			&& theFileInfo.nOffset + theFileInfo.nEmbededFileSize <= m_nPackageFileSize)
+		{
+			const char* pMapped = m_pFile->MapReadOnly();
+			if (pMapped)
+			{
+				OperationResult eResult = CheckReadChecksum(theFileInfo, pMapped + theFileInfo.nOffset);
+				if (eResult != Result_OK)
+				{
+					return eResult;
+				}
+				theView.pData = pMapped + theFileInfo.nOffset;
+				theView.nSize = theFileInfo.nOriginalFileSize;
+				theView.nFileID = nFileID;
+				theView.eType = View_Mapped;
+				theView.pHandle = 0;
+				return Result_OK;
+			}
+		}
+		const char* pBuff = 0;
+		soint64 nSize = 0;
+		void* pHandle = m_EntryCache.Acquire(nFileID, pBuff, nSize);
+		if (pHandle == 0)
+		{
+			//没有找到的情况由LoadSingleFile统计。
+			stReadSingleFile theFile;
+			theFile.nFileID = nFileID;
+			SoThreadPool* pSuspendedPool = BeginForegroundRead();
+			OperationResult eResult = LoadSingleFile(theFile);
+			EndForegroundRead(pSuspendedPool);
+			if (eResult != Result_OK)
+			{
+				return eResult;
+			}
+			pBuff = theFile.pFileBuff;
+			nSize = theFileInfo.nOriginalFileSize;
+			pHandle = m_EntryCache.InsertAndAcquire(nFileID, theFile.pFileBuff, nSize);
+			if (pHandle)
+			{
+				theView.eType = View_Cached;
+			}
+			else
+			{
+				//文件缓存放不下，或者其他线程已经放进去了。theFile没有指定分配器，pFileBuff由m_pAllocator申请。
+				pHandle = theFile.pFileBuff;
+				theView.eType = View_Owned;
+			}
+			//内存已经交给了文件缓存或者视图。
+			theFile.pFileBuff = 0;
+		}
+		else
+		{
+			theView.eType = View_Cached;
+		}
+		theView.pData = pBuff;
+		theView.nSize = nSize;
+		theView.nFileID = nFileID;
+		theView.pHandle = pHandle;
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::ReleaseView(stFileView& theView)
+	{
+		if (theView.eType == View_Cached)
+		{
+			m_EntryCache.Unacquire(theView.pHandle);
+		}
+		else if (theView.eType == View_Owned)
+		{
+			m_pAllocator->Free(theView.pHandle);
+		}
+		theView.pData = 0;
+		theView.nSize = 0;
+		theView.nFileID = -1;
+		theView.eType = View_None;
+		theView.pHandle = 0;
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::Prefetch(const char* const* pszFileNameList, soint64 nFileCount, PrefetchDepth eDepth)
+	{
+		if (pszFileNameList == 0 || nFileCount < 0)
+		{
+			return Result_InvalidParam;
+		}
+		soint64* pFileIDList = (soint64*)m_pAllocator->Alloc((nFileCount + 1) * (soint64)sizeof(soint64));
+		if (pFileIDList == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		//找不到的文件跳过，其他文件照常预读取，返回第一个失败的结果。
+		soint64 nFound = 0;
+		OperationResult eFirstError = Result_OK;
+		for (soint64 i=0; i<nFileCount; ++i)
+		{
+			stReadSingleFile theFile;
+			OperationResult eResult = Open(pszFileNameList[i], theFile);
+			if (eResult == Result_OK)
+			{
+				pFileIDList[nFound++] = theFile.nFileID;
+			}
+			else if (eFirstError == Result_OK)
+			{
+				eFirstError = eResult;
+			}
+		}
+		OperationResult eResult = PrefetchByID(pFileIDList, nFound, eDepth);
+		m_pAllocator->Free(pFileIDList);
+		return (eResult != Result_OK) ? eResult : eFirstError;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::PrefetchByID(const soint64* pFileIDList, soint64 nFileCount, PrefetchDepth eDepth)
+	{
+		if (pFileIDList == 0 || nFileCount < 0)
+		{
+			return Result_InvalidParam;
+		}
+		if (m_theFileMode != Mode_Read)
+		{
+			return Result_FileModeMismatch;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		for (soint64 i=0; i<nFileCount; ++i)
+		{
+			if (pFileIDList[i] < 0 || pFileIDList[i] >= m_nSingleFileInfoListSize)
+			{
+				return Result_InvalidFileID;
+			}
+		}
+		if (eDepth == Prefetch_Decompress && m_EntryCache.GetMaxSize() == 0)
+		{
+			//没有文件缓存，解压缩的结果没有地方存放。
+			eDepth = Prefetch_ReadAhead;
+		}
+		for (soint64 i=0; i<nFileCount; ++i)
+		{
+			const soint64 nFileID = pFileIDList[i];
+			if (m_EntryCache.Contains(nFileID))
+			{
+				continue;
+			}
+			const stSingleFileInfo& theFileInfo = m_pSingleFileInfoList[nFileID];
+			if (eDepth == Prefetch_ReadAhead)
+			{
+				m_pFile->Advise(theFileInfo.nOffset, theFileInfo.nEmbededFileSize, SoFileIO::Access_WillNeed);
+				continue;
+			}
+			stReadSingleFile* pFile = AllocReadSingleFile(nFileID, theFileInfo.nOriginalFileSize);
+			if (pFile == 0)
+			{
+				return Result_MemoryIsEmpty;
+			}
+			OperationResult eResult = ReadAsync(*pFile, PrefetchCallback, this, 0, 0, SoThreadPool::Priority_Low);
+			if (eResult != Result_OK)
+			{
+				FreeReadSingleFile(pFile);
+				return eResult;
+			}
+		}
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::PrefetchPattern(const char* pszPattern, PrefetchDepth eDepth, soint64* pMatchCount)
+	{
+		if (pMatchCount)
+		{
+			*pMatchCount = 0;
+		}
+		if (pszPattern == 0 || pszPattern[0] == 0)
+		{
+			return Result_InvalidParam;
+		}
+		if (m_theFileMode != Mode_Read)
+		{
+			return Result_FileModeMismatch;
+		}
+		char szPattern[SoPackageFileMAX_PATH];
+		souint32 uiHashA = 0;
+		souint32 uiHashB = 0;
+		souint32 uiHashC = 0;
+		FormatFileFullName(szPattern, pszPattern, uiHashA, uiHashB, uiHashC);
+		soint64* pFileIDList = 0;
+		soint64 nFileCount = 0;
+		soint64 nCapacity = 0;
+		if (!CollectPattern(szPattern, pFileIDList, nFileCount, nCapacity))
+		{
+			m_pAllocator->Free(pFileIDList);
+			return Result_MemoryIsEmpty;
+		}
+		OperationResult eResult = PrefetchByID(pFileIDList, nFileCount, eDepth);
+		m_pAllocator->Free(pFileIDList);
+		if (pMatchCount)
+		{
+			*pMatchCount = nFileCount;
+		}
+		return eResult;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::WarmUp(const char* pszManifestFile, PrefetchDepth eDepth)
+	{
+		if (pszManifestFile == 0 || pszManifestFile[0] == 0)
+		{
+			return Result_InvalidParam;
+		}
+		if (m_theFileMode != Mode_Read)
+		{
+			return Result_FileModeMismatch;
+		}
+		FILE* pManifest = fopen(pszManifestFile, "rb");
+		if (pManifest == 0)
+		{
+			return Result_OpenFileFail;
+		}
+		soint64* pFileIDList = 0;
+		soint64 nFileCount = 0;
+		soint64 nCapacity = 0;
+		bool bMemoryOK = true;
+		char szLine[SoPackageFileMAX_PATH + 2];
+		while (bMemoryOK && fgets(szLine, sizeof(szLine), pManifest))
+		{
+			//去掉行尾的换行符和空白。
+			size_t nLength = strlen(szLine);
+			while (nLength > 0 && (szLine[nLength-1] == '\n' || szLine[nLength-1] == '\r' || szLine[nLength-1] == ' ' || szLine[nLength-1] == '\t'))
+			{
+				szLine[--nLength] = 0;
+			}
+			const char* pszName = szLine;
+			while (*pszName == ' ' || *pszName == '\t')
+			{
+				++pszName;
+			}
+			if (pszName[0] == 0 || pszName[0] == '#')
+			{
+				continue;
+			}
+			if (strchr(pszName, '*') || strchr(pszName, '?'))
+			{
+				char szPattern[SoPackageFileMAX_PATH];
+				souint32 uiHashA = 0;
+				souint32 uiHashB = 0;
+				souint32 uiHashC = 0;
+				FormatFileFullName(szPattern, pszName, uiHashA, uiHashB, uiHashC);
+				bMemoryOK = CollectPattern(szPattern, pFileIDList, nFileCount, nCapacity);
+			}
+			else
+			{
+				stReadSingleFile theFile;
+				if (Open(pszName, theFile) == Result_OK)
+				{
+					bMemoryOK = AppendFileID(pFileIDList, nFileCount, nCapacity, theFile.nFileID);
+				}
+			}
+		}
+		fclose(pManifest);
+		OperationResult eResult = bMemoryOK ? PrefetchByID(pFileIDList, nFileCount, eDepth) : Result_MemoryIsEmpty;
+		m_pAllocator->Free(pFileIDList);
+		return eResult;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::Tell(soint64& nFilePos, stReadSingleFile& theFile)
+	{
+		nFilePos = theFile.nFilePointer;
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::Seek(soint64 nOffset, SeekOrigin theOrigin, stReadSingleFile& theFile)
+	{
+		soint64 destPos = 0;
+		switch (theOrigin)
+		{
+		case Seek_Set:
+			destPos = nOffset;
+			break;
+		case Seek_Cur:
+			destPos = theFile.nFilePointer + nOffset;
+			break;
+		case Seek_End:
+			destPos = theFile.nFileSize + nOffset;
+			break;
+		default:
+			break;
+		}
+		if (destPos < 0)
+		{
+			destPos = 0;
+		}
+		else if (destPos > theFile.nFileSize)
+		{
+			destPos = theFile.nFileSize;
+		}
+		theFile.nFilePointer = destPos;
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::InsertSingleFile(const char* pszDiskFile)
+	{
+		SoTrace_Scope("InsertSingleFile");
+		if (pszDiskFile == 0 || pszDiskFile[0] == 0)
+		{
+			//无效指针或者是空字符串。
+			return Result_InvalidParam;
+		}
+		if (m_theFileMode != Mode_Write)
+		{
+			return Result_FileModeMismatch;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		//
+		stSingleFileInfo newSingleFile;
+		OperationResult eResult = PrepareSingleFileInfo(pszDiskFile, newSingleFile);
+		if (eResult != Result_OK)
+		{
+			return eResult;
+		}
+		//打开磁盘文件。
+		SoFileIO* pSingleFile = SoFileIO_Create(m_eIOBackend);
+		if (!pSingleFile->Open(newSingleFile.szFileName, SoFileIO::Open_Read))
+		{
+			delete pSingleFile;
+			return Result_OpenFileFail;
+		}
+		eResult = AppendSingleFile(pSingleFile, newSingleFile);
+		delete pSingleFile;
+		SoTrace_SetArg(-1, newSingleFile.nOriginalFileSize);
+		return eResult;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::InsertSingleFileFromMemory(const char* pszFileName, const void* pData, soint64 nSize)
+	{
+		SoTrace_Scope("InsertSingleFile");
+		if (pszFileName == 0 || pszFileName[0] == 0 || nSize < 0 || (pData == 0 && nSize > 0))
+		{
+			return Result_InvalidParam;
+		}
+		if (m_theFileMode != Mode_Write)
+		{
+			return Result_FileModeMismatch;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		stSingleFileInfo newSingleFile;
+		OperationResult eResult = PrepareSingleFileInfo(pszFileName, newSingleFile);
+		if (eResult != Result_OK)
+		{
+			return eResult;
+		}
+		SoFileIO_Memory theSource(pData, nSize);
+		theSource.Open(newSingleFile.szFileName, SoFileIO::Open_Read);
+		SoTrace_SetArg(-1, nSize);
+		return AppendSingleFile(&theSource, newSingleFile);
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::PrepareSingleFileInfo(const char* pszFileName, stSingleFileInfo& theFileInfo)
+	{
+		const souint32 uiFileNameLength = FormatFileFullName(theFileInfo.szFileName, pszFileName, theFileInfo.uiHashA, theFileInfo.uiHashB, theFileInfo.uiHashC);
+		if (pszFileName[uiFileNameLength] != 0)
+		{
+			//格式化时发生了截断，说明文件名太长了。
+			return Result_FileNameLengthTooLong;
+		}
+		//先保证m_pWriteIndex放得下，写入文件内容之后就不会再失败。
+		//打开已有的资源包之后第一次写入时，这里才把已有的文件加入m_pWriteIndex。
+		if (!ReserveWriteIndex(m_nSingleFileInfoListSize + 1))
+		{
+			return Result_MemoryIsEmpty;
+		}
+		//判断该文件是否已经存在了。
+		if (FindWrittenFile(theFileInfo.uiHashA, theFileInfo.uiHashB, theFileInfo.uiHashC) != -1)
+		{
+			return Result_SingleFileAlreadyExist;
+		}
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::AppendSingleFile(SoFileIO* pSingleFile, stSingleFileInfo& theFileInfo)
+	{
+		//获取源文件大小。
+		const soint64 nSourceSize = pSingleFile->GetSize();
+		if (nSourceSize < 0)
+		{
+			return Result_FileOperationError;
+		}
+		theFileInfo.nOriginalFileSize = nSourceSize;
+		theFileInfo.nOffset = m_stPackageHead.nOffsetForFirstSingleFileInfo;
+		//向资源包中写入这个文件。
+		OperationResult writeResult = WriteSingleFile(pSingleFile, theFileInfo);
+		if (writeResult != Result_OK)
+		{
+			//写入失败。
+			return writeResult;
+		}
+		//分配结构体对象，并填充参数。
+		soint64 nFileID = AssignSingleFileInfo();
+		if (nFileID == -1)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		memcpy(&(m_pSingleFileInfoList[nFileID]), &theFileInfo, sizeof(stSingleFileInfo));
+		AddWrittenFile(nFileID);
+		//完善文件头信息。
+		++m_stPackageHead.nFileCount;
+		m_stPackageHead.nOffsetForFirstSingleFileInfo += m_pSingleFileInfoList[nFileID].nEmbededFileSize;
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::FlushPackageFile()
+	{
+		SoTrace_Scope("FlushPackageFile");
+		if (m_theFileMode != Mode_Write)
+		{
+			return Result_FileModeMismatch;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		OperationResult theResult = WritePackageHead();
+		if (theResult == Result_OK)
+		{
+			theResult = WriteAllSingleFileInfo();
+			if (theResult == Result_OK)
+			{
+				m_pFile->Flush();
+			}
+		}
+		return theResult;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::WritePackageHead()
+	{
+		//判断当前文件状态。
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		//生成合法的文件头。
+		const char* pszFileFlag = SoPackageFileFlag;
+		for (soint64 i=0; i<SoPackageFileFlagLength; ++i)
+		{
+			m_stPackageHead.szFileFlag[i] = pszFileFlag[i];
+		}
+		m_stPackageHead.nVersion = SoPackageFileVersion;
+		//写入。
+		const soint64 sizePackageHead = sizeof(m_stPackageHead);
+		soint64 nActuallyWrite = WritePackageData(&m_stPackageHead, sizePackageHead, 0);
+		if (nActuallyWrite != sizePackageHead)
+		{
+			//文件头没有写入完整。
+			return Result_FileOperationError;
+		}
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoPackageFile::WritePackageData(const void* pBuff, soint64 nSize, soint64 nOffset)
+	{
+		stStats& theStats = GetThreadStats();
+		SoAtomic_Add64(&theStats.nDiskWriteCount, 1);
+		const soint64 nActuallyWrite = m_pFile->WriteAt(pBuff, nSize, nOffset);
+		if (nActuallyWrite > 0)
+		{
+			SoAtomic_Add64(&theStats.nDiskWriteBytes, nActuallyWrite);
+		}
+		return nActuallyWrite;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::WriteSingleFile(SoFileIO* pSingleFile, SoPackageFile::stSingleFileInfo& theFileInfo)
+	{
+		SoTrace_Scope("WriteSingleFile");
+		SoTrace_SetArg(-1, theFileInfo.nOriginalFileSize);
+		if (pSingleFile == 0)
+		{
+			return Result_InvalidParam;
+		}
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		stTempBuff* pTempBuff = BeginUseTempBuff();
+		if (pTempBuff == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		//压缩结果不小于源文件时原样存储，所以存放压缩结果的缓存与源文件一样大就够了。
+		OperationResult eResult = Result_OK;
+		soint64 nGroupCount = 0;
+		if (m_nBlockSize > 0 && theFileInfo.nOriginalFileSize >= m_nBlockMinFileSize && theFileInfo.nOriginalFileSize > m_nBlockSize)
+		{
+			nGroupCount = ReserveBlockGroup(pTempBuff, theFileInfo.nOriginalFileSize);
+		}
+		if (nGroupCount > 0)
+		{
+			eResult = WriteSingleFile_Blocked(pSingleFile, theFileInfo, pTempBuff, nGroupCount);
+		}
+		else if (theFileInfo.nOriginalFileSize <= SoPackageFile_MaxStreamSize
+			&& ResizeTempBuff(pTempBuff->pTempBuff_SrcFile, pTempBuff->nTempBuffMaxSize_SrcFile, theFileInfo.nOriginalFileSize, false)
+			&& ResizeTempBuff(pTempBuff->pTempBuff_AfterCompress, pTempBuff->nTempBuffMaxSize_AfterCompress, theFileInfo.nOriginalFileSize, false))
+		{
+			eResult = WriteSingleFile_Buffered(pSingleFile, theFileInfo, pTempBuff);
+		}
+		else
+		{
+			SoAtomic_Add64(&m_stScratchStats.nStreamCount, 1);
+			eResult = WriteSingleFile_Streamed(pSingleFile, theFileInfo, pTempBuff);
+		}
+		EndUseTempBuff(pTempBuff);
+		return eResult;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::WriteSingleFile_Buffered(SoFileIO* pSingleFile, SoPackageFile::stSingleFileInfo& theFileInfo, stTempBuff* pTempBuff)
+	{
+		//读取源文件。源文件只会被顺序读取一遍，读完之后不需要保留在系统缓存中。
+		pSingleFile->Advise(0, 0, SoFileIO::Access_Sequential);
+		soint64 nActuallyRead = pSingleFile->ReadAt(pTempBuff->pTempBuff_SrcFile, theFileInfo.nOriginalFileSize, 0);
+		pSingleFile->Advise(0, 0, SoFileIO::Access_DontNeed);
+		if (nActuallyRead != theFileInfo.nOriginalFileSize)
+		{
+			return Result_FileOperationError;
+		}
+		//<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+		//对源文件进行压缩。
+		//某些情况下，压缩后的文件要比压缩前还要大，例如文件本来就很小（只有几个字节），
+		//或者文件本身就是zlib压缩过的，再经过压缩就变的大一点（PNG格式就是已经经过zlib压缩过的）。
+		//这时输出缓存写满，deflate返回Z_OK或者Z_BUF_ERROR，文件原样存储。
+		z_stream* pStream = GetDeflateStream(pTempBuff);
+		if (pStream == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		pStream->next_in = (Bytef*)pTempBuff->pTempBuff_SrcFile;
+		pStream->avail_in = (uInt)theFileInfo.nOriginalFileSize;
+		pStream->next_out = (Bytef*)pTempBuff->pTempBuff_AfterCompress;
+		pStream->avail_out = (uInt)theFileInfo.nOriginalFileSize;
+		const int nResult = deflate(pStream, Z_FINISH);
+		if (nResult != Z_STREAM_END && nResult != Z_OK && nResult != Z_BUF_ERROR)
+		{
+			return Result_CompressFail;
+		}
+		//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+		soint64 sizeFileSizeAfterCompress = (soint64)pStream->total_out;
+		const char* pEmbeded = pTempBuff->pTempBuff_AfterCompress;
+		theFileInfo.uiFlags = SingleFile_Checksum;
+		theFileInfo.uiOriginalCRC = SoHash_CRC32C(0, pTempBuff->pTempBuff_SrcFile, theFileInfo.nOriginalFileSize);
+		if (nResult != Z_STREAM_END || sizeFileSizeAfterCompress >= theFileInfo.nOriginalFileSize)
+		{
+			//压缩没有收益，原样存储。读取时不需要解压缩，还可以直接使用内存映射。
+			sizeFileSizeAfterCompress = theFileInfo.nOriginalFileSize;
+			pEmbeded = pTempBuff->pTempBuff_SrcFile;
+			theFileInfo.uiFlags |= SingleFile_Stored;
+			theFileInfo.uiEmbededCRC = theFileInfo.uiOriginalCRC;
+		}
+		else
+		{
+			theFileInfo.uiEmbededCRC = SoHash_CRC32C(0, pEmbeded, sizeFileSizeAfterCompress);
+			if (m_eCompressFormat == Compress_RawDeflate)
+			{
+				theFileInfo.uiFlags |= SingleFile_RawDeflate;
+			}
+		}
+		//写入到资源包。
+		soint64 nActuallyWrite = WritePackageData(pEmbeded, sizeFileSizeAfterCompress, theFileInfo.nOffset);
+		if (nActuallyWrite != sizeFileSizeAfterCompress)
+		{
+			return Result_FileOperationError;
+		}
+		//完善参数。
+		theFileInfo.nEmbededFileSize = sizeFileSizeAfterCompress;
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::WriteSingleFile_Streamed(SoFileIO* pSingleFile, SoPackageFile::stSingleFileInfo& theFileInfo, stTempBuff* pTempBuff)
+	{
+		//源文件和压缩结果各使用一块缓存，已有的缓存比一块大时直接使用。
+		if (!ResizeTempBuff(pTempBuff->pTempBuff_SrcFile, pTempBuff->nTempBuffMaxSize_SrcFile, SoPackageFile_StreamChunkSize, true)
+			|| !ResizeTempBuff(pTempBuff->pTempBuff_AfterCompress, pTempBuff->nTempBuffMaxSize_AfterCompress, SoPackageFile_StreamChunkSize, true))
+		{
+			return Result_MemoryIsEmpty;
+		}
+		z_stream* pStream = GetDeflateStream(pTempBuff);
+		if (pStream == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		const soint64 nInChunk = (pTempBuff->nTempBuffMaxSize_SrcFile > SoPackageFile_MaxStreamSize) ? SoPackageFile_MaxStreamSize : pTempBuff->nTempBuffMaxSize_SrcFile;
+		const soint64 nOutChunk = (pTempBuff->nTempBuffMaxSize_AfterCompress > SoPackageFile_MaxStreamSize) ? SoPackageFile_MaxStreamSize : pTempBuff->nTempBuffMaxSize_AfterCompress;
+		soint64 nReadPos = 0;
+		soint64 nWritePos = 0;
+		bool bStored = false;
+		souint32 uiOriginalCRC = 0;
+		souint32 uiEmbededCRC = 0;
+		pSingleFile->Advise(0, 0, SoFileIO::Access_Sequential);
+		pStream->next_out = (Bytef*)pTempBuff->pTempBuff_AfterCompress;
+		pStream->avail_out = (uInt)nOutChunk;
+		while (true)
+		{
+			if (pStream->avail_in == 0 && nReadPos < theFileInfo.nOriginalFileSize)
+			{
+				const soint64 nRest = theFileInfo.nOriginalFileSize - nReadPos;
+				const soint64 nRead = (nRest < nInChunk) ? nRest : nInChunk;
+				if (pSingleFile->ReadAt(pTempBuff->pTempBuff_SrcFile, nRead, nReadPos) != nRead)
+				{
+					return Result_FileOperationError;
+				}
+				uiOriginalCRC = SoHash_CRC32C(uiOriginalCRC, pTempBuff->pTempBuff_SrcFile, nRead);
+				nReadPos += nRead;
+				pStream->next_in = (Bytef*)pTempBuff->pTempBuff_SrcFile;
+				pStream->avail_in = (uInt)nRead;
+			}
+			const int nFlush = (nReadPos < theFileInfo.nOriginalFileSize) ? Z_NO_FLUSH : Z_FINISH;
+			const int nResult = deflate(pStream, nFlush);
+			if (nResult != Z_OK && nResult != Z_STREAM_END && nResult != Z_BUF_ERROR)
+			{
+				return Result_CompressFail;
+			}
+			if (pStream->avail_out == 0 || nResult == Z_STREAM_END)
+			{
+				const soint64 nProduced = nOutChunk - (soint64)pStream->avail_out;
+				if (nWritePos + nProduced >= theFileInfo.nOriginalFileSize)
+				{
+					//压缩没有收益，改为原样存储。已经写入的压缩数据会被覆盖。
+					bStored = true;
+					break;
+				}
+				if (WritePackageData(pTempBuff->pTempBuff_AfterCompress, nProduced, theFileInfo.nOffset + nWritePos) != nProduced)
+				{
+					return Result_FileOperationError;
+				}
+				uiEmbededCRC = SoHash_CRC32C(uiEmbededCRC, pTempBuff->pTempBuff_AfterCompress, nProduced);
+				nWritePos += nProduced;
+				pStream->next_out = (Bytef*)pTempBuff->pTempBuff_AfterCompress;
+				pStream->avail_out = (uInt)nOutChunk;
+			}
+			if (nResult == Z_STREAM_END)
+			{
+				break;
+			}
+		}
+		if (bStored)
+		{
+			return WriteSingleFile_Stored(pSingleFile, theFileInfo, pTempBuff);
+		}
+		theFileInfo.uiFlags = SingleFile_Checksum;
+		if (m_eCompressFormat == Compress_RawDeflate)
+		{
+			theFileInfo.uiFlags |= SingleFile_RawDeflate;
+		}
+		theFileInfo.nEmbededFileSize = nWritePos;
+		theFileInfo.uiOriginalCRC = uiOriginalCRC;
+		theFileInfo.uiEmbededCRC = uiEmbededCRC;
+		pSingleFile->Advise(0, 0, SoFileIO::Access_DontNeed);
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::WriteSingleFile_Stored(SoFileIO* pSingleFile, SoPackageFile::stSingleFileInfo& theFileInfo, stTempBuff* pTempBuff)
+	{
+		//压缩过程中途放弃时源文件可能还没有读完，重新计算校验值。
+		const soint64 nChunk = (pTempBuff->nTempBuffMaxSize_SrcFile > SoPackageFile_MaxStreamSize) ? SoPackageFile_MaxStreamSize : pTempBuff->nTempBuffMaxSize_SrcFile;
+		souint32 uiOriginalCRC = 0;
+		for (soint64 nReadPos = 0; nReadPos < theFileInfo.nOriginalFileSize; )
+		{
+			const soint64 nRest = theFileInfo.nOriginalFileSize - nReadPos;
+			const soint64 nRead = (nRest < nChunk) ? nRest : nChunk;
+			if (pSingleFile->ReadAt(pTempBuff->pTempBuff_SrcFile, nRead, nReadPos) != nRead
+				|| WritePackageData(pTempBuff->pTempBuff_SrcFile, nRead, theFileInfo.nOffset + nReadPos) != nRead)
+			{
+				return Result_FileOperationError;
+			}
+			uiOriginalCRC = SoHash_CRC32C(uiOriginalCRC, pTempBuff->pTempBuff_SrcFile, nRead);
+			nReadPos += nRead;
+		}
+		theFileInfo.uiFlags = SingleFile_Checksum | SingleFile_Stored;
+		theFileInfo.nEmbededFileSize = theFileInfo.nOriginalFileSize;
+		theFileInfo.uiOriginalCRC = uiOriginalCRC;
+		theFileInfo.uiEmbededCRC = uiOriginalCRC;
+		pSingleFile->Advise(0, 0, SoFileIO::Access_DontNeed);
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoPackageFile::ReserveBlockGroup(stTempBuff* pTempBuff, soint64 nOriginalFileSize)
+	{
+		const soint64 nBlockSize = m_nBlockSize;
+		const soint64 nBlockCount = (nOriginalFileSize + nBlockSize - 1) / nBlockSize;
+		SoThreadPool* pThreadPool = GetThreadPool();
+		const souint32 uiWorkerCount = pThreadPool ? pThreadPool->GetThreadCount() : 0;
+		soint64 nGroupCount = (soint64)(uiWorkerCount + 1) * SoPackageFile_BlockGroupPerThread;
+		if (nGroupCount > nBlockCount)
+		{
+			nGroupCount = nBlockCount;
+		}
+		//超过临时缓存的上限时减少一组的块数，一块也放不下时由调用者改为流式压缩。
+		for (; nGroupCount > 0; nGroupCount >>= 1)
+		{
+			if (ResizeTempBuff(pTempBuff->pTempBuff_SrcFile, pTempBuff->nTempBuffMaxSize_SrcFile, nGroupCount * nBlockSize, false)
+				&& ResizeTempBuff(pTempBuff->pTempBuff_AfterCompress, pTempBuff->nTempBuffMaxSize_AfterCompress, nGroupCount * SoPackageFile_BlockDestStride(nBlockSize), false))
+			{
+				break;
+			}
+		}
+		return nGroupCount;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::WriteSingleFile_Blocked(SoFileIO* pSingleFile, SoPackageFile::stSingleFileInfo& theFileInfo, stTempBuff* pTempBuff, soint64 nGroupCount)
+	{
+		SoTrace_Scope("WriteSingleFile_Blocked");
+		const soint64 nBlockSize = m_nBlockSize;
+		const soint64 nBlockCount = (theFileInfo.nOriginalFileSize + nBlockSize - 1) / nBlockSize;
+		const soint64 nIndexSize = nBlockCount * (soint64)sizeof(souint32);
+		const soint64 nDestStride = SoPackageFile_BlockDestStride(nBlockSize);
+		//调用者的线程也参与压缩。线程池不可用时全部在调用者的线程中压缩，结果相同。
+		SoThreadPool* pThreadPool = GetThreadPool();
+		const souint32 uiWorkerCount = pThreadPool ? pThreadPool->GetThreadCount() : 0;
+		souint32* pIndex = (souint32*)m_pAllocator->Alloc(nIndexSize);
+		if (pIndex == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		SoSemaphore theDone(0);
+		stBlockTask theTask;
+		theTask.pPackage = this;
+		theTask.nBlockSize = nBlockSize;
+		theTask.pDest = pTempBuff->pTempBuff_AfterCompress;
+		theTask.nDestStride = nDestStride;
+		theTask.pDone = &theDone;
+		OperationResult eResult = Result_OK;
+		bool bStored = false;
+		soint64 nWritePos = 0;
+		souint32 uiOriginalCRC = 0;
+		souint32 uiEmbededCRC = 0;
+		pSingleFile->Advise(0, 0, SoFileIO::Access_Sequential);
+		for (soint64 nFirstBlock = 0; nFirstBlock < nBlockCount && eResult == Result_OK && !bStored; nFirstBlock += nGroupCount)
+		{
+			const soint64 nReadPos = nFirstBlock * nBlockSize;
+			const soint64 nRest = theFileInfo.nOriginalFileSize - nReadPos;
+			const soint64 nRead = (nRest < nGroupCount * nBlockSize) ? nRest : nGroupCount * nBlockSize;
+			if (pSingleFile->ReadAt(pTempBuff->pTempBuff_SrcFile, nRead, nReadPos) != nRead)
+			{
+				eResult = Result_FileOperationError;
+				break;
+			}
+			theTask.pSrc = pTempBuff->pTempBuff_SrcFile;
+			theTask.nSrcSize = nRead;
+			theTask.nBlockCount = (nRead + nBlockSize - 1) / nBlockSize;
+			theTask.pSizeList = pIndex + nFirstBlock;
+			theTask.nNextBlock = 0;
+			souint32 uiStarted = 0;
+			for (soint64 i=1; i<theTask.nBlockCount && uiStarted<uiWorkerCount; ++i)
+			{
+				if (pThreadPool->AddTask(BlockTask_Run, &theTask, SoThreadPool::Priority_High))
+				{
+					++uiStarted;
+				}
+			}
+			//工作线程压缩的同时计算原始内容的校验值。
+			uiOriginalCRC = SoHash_CRC32C(uiOriginalCRC, pTempBuff->pTempBuff_SrcFile, nRead);
+			CompressBlocks(theTask, pTempBuff);
+			for (souint32 i=0; i<uiStarted; ++i)
+			{
+				theDone.Wait();
+			}
+			for (soint64 i=0; i<theTask.nBlockCount; ++i)
+			{
+				const soint64 nSize = (soint64)theTask.pSizeList[i];
+				if (nSize == 0)
+				{
+					eResult = Result_CompressFail;
+					break;
+				}
+				if (nWritePos + nSize + nIndexSize >= theFileInfo.nOriginalFileSize)
+				{
+					//压缩没有收益，改为原样存储。已经写入的压缩数据会被覆盖。
+					bStored = true;
+					break;
+				}
+				const char* pBlock = theTask.pDest + i * nDestStride;
+				if (WritePackageData(pBlock, nSize, theFileInfo.nOffset + nWritePos) != nSize)
+				{
+					eResult = Result_FileOperationError;
+					break;
+				}
+				uiEmbededCRC = SoHash_CRC32C(uiEmbededCRC, pBlock, nSize);
+				nWritePos += nSize;
+			}
+		}
+		if (eResult == Result_OK && !bStored)
+		{
+			//最后写入块索引。
+			if (WritePackageData(pIndex, nIndexSize, theFileInfo.nOffset + nWritePos) != nIndexSize)
+			{
+				eResult = Result_FileOperationError;
+			}
+			uiEmbededCRC = SoHash_CRC32C(uiEmbededCRC, pIndex, nIndexSize);
+			nWritePos += nIndexSize;
+		}
+		m_pAllocator->Free(pIndex);
+		if (eResult != Result_OK)
+		{
+			return eResult;
+		}
+		if (bStored)
+		{
+			return WriteSingleFile_Stored(pSingleFile, theFileInfo, pTempBuff);
+		}
+		souint32 uiShift = 0;
+		while (((soint64)1 << uiShift) < nBlockSize)
+		{
+			++uiShift;
+		}
+		theFileInfo.uiFlags = SingleFile_Checksum | SingleFile_Blocked | (uiShift << SingleFile_BlockShift);
+		if (m_eCompressFormat == Compress_RawDeflate)
+		{
+			theFileInfo.uiFlags |= SingleFile_RawDeflate;
+		}
+		theFileInfo.nEmbededFileSize = nWritePos;
+		theFileInfo.uiOriginalCRC = uiOriginalCRC;
+		theFileInfo.uiEmbededCRC = uiEmbededCRC;
+		pSingleFile->Advise(0, 0, SoFileIO::Access_DontNeed);
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::BlockTask_Run(void* pParam)
+	{
+		stBlockTask* pTask = (stBlockTask*)pParam;
+		pTask->pPackage->CompressBlocks(*pTask, 0);
+		pTask->pDone->Post();
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::CompressBlocks(stBlockTask& theTask, stTempBuff* pTempBuff)
+	{
+		SoTrace_Scope("CompressBlocks");
+		//工作线程只使用自己的zlib压缩对象，不需要临时缓存的内存。
+		stTempBuff* pOwnTempBuff = pTempBuff ? 0 : BeginUseTempBuff();
+		stTempBuff* pUseTempBuff = pTempBuff ? pTempBuff : pOwnTempBuff;
+		while (true)
+		{
+			const soint64 nBlock = SoAtomic_Add64(&theTask.nNextBlock, 1) - 1;
+			if (nBlock >= theTask.nBlockCount)
+			{
+				break;
+			}
+			const soint64 nOffset = nBlock * theTask.nBlockSize;
+			const soint64 nRest = theTask.nSrcSize - nOffset;
+			const soint64 nSize = (nRest < theTask.nBlockSize) ? nRest : theTask.nBlockSize;
+			theTask.pSizeList[nBlock] = 0;
+			z_stream* pStream = pUseTempBuff ? GetDeflateStream(pUseTempBuff) : 0;
+			if (pStream == 0)
+			{
+				continue;
+			}
+			pStream->next_in = (Bytef*)theTask.pSrc + nOffset;
+			pStream->avail_in = (uInt)nSize;
+			pStream->next_out = (Bytef*)theTask.pDest + nBlock * theTask.nDestStride;
+			pStream->avail_out = (uInt)theTask.nDestStride;
+			if (deflate(pStream, Z_FINISH) == Z_STREAM_END)
+			{
+				theTask.pSizeList[nBlock] = (souint32)pStream->total_out;
+			}
+		}
+		if (pOwnTempBuff)
+		{
+			EndUseTempBuff(pOwnTempBuff);
+		}
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::WriteAllSingleFileInfo()
+	{
+		//判断当前文件状态。
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		//写入。
+		const soint64 sizeAllSingleFileInfo = m_nSingleFileInfoListSize * (soint64)sizeof(stSingleFileInfo);
+		soint64 nActuallyWrite = WritePackageData(m_pSingleFileInfoList, sizeAllSingleFileInfo, m_stPackageHead.nOffsetForFirstSingleFileInfo);
+		if (nActuallyWrite != sizeAllSingleFileInfo)
+		{
+			//SingleFile信息列表没有写入完整。
+			return Result_FileOperationError;
+		}
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::ParsePackageFile()
+	{
+		SoTrace_Scope("ParsePackageFile");
+		if (m_pFile == 0)
+		{
+			return Result_PackageFileHaveNotOpen;
+		}
+		//读取文件头。
+		const soint64 sizePackageHead = sizeof(m_stPackageHead);
+		soint64 nActuallyReadSize = m_pFile->ReadAt(&m_stPackageHead, sizePackageHead, 0);
+		if (nActuallyReadSize != sizePackageHead)
+		{
+			//文件头没有读取完整。
+			return Result_FileOperationError;
+		}
+		//判断文件头。
+		if (!CheckValid_PackageHead(m_stPackageHead))
+		{
+			return Result_IsNotPackageFile;
+		}
+		//获取SingleFile信息列表。
+		ReleaseSingleFileInfoList();
+		ReCreateSingleFileInfoList(m_stPackageHead.nFileCount);
+		if (m_pSingleFileInfoList == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		//旧版本的记录比stSingleFileInfo小，先原样读入，再逐个展开。
+		const soint64 nRecordSize = GetSingleFileInfoSize(m_stPackageHead.nVersion);
+		const soint64 sizeSingleFileInfoList = m_stPackageHead.nFileCount * nRecordSize;
+		m_pFile->Advise(m_stPackageHead.nOffsetForFirstSingleFileInfo, sizeSingleFileInfoList, SoFileIO::Access_WillNeed);
+		soint64 nActuallyReadInfoListSize = m_pFile->ReadAt(m_pSingleFileInfoList, sizeSingleFileInfoList, m_stPackageHead.nOffsetForFirstSingleFileInfo);
+		if (nActuallyReadInfoListSize != sizeSingleFileInfoList)
+		{
+			//SingleFile信息列表没有读取完整。
+			return Result_FileOperationError;
+		}
+		//SingleFile信息列表读取成功。
+		m_nSingleFileInfoListSize = m_stPackageHead.nFileCount;
+		if (nRecordSize < (soint64)sizeof(stSingleFileInfo))
+		{
+			//从后向前展开，第i条记录展开之后的位置不会覆盖前面还没有展开的记录。
+			for (soint64 i=m_nSingleFileInfoListSize-1; i>=0; --i)
+			{
+				stSingleFileInfo& theInfo = m_pSingleFileInfoList[i];
+				memmove(&theInfo, (char*)m_pSingleFileInfoList + i * nRecordSize, (size_t)nRecordSize);
+				memset((char*)&theInfo + nRecordSize, 0, (size_t)(sizeof(stSingleFileInfo) - nRecordSize));
+			}
+		}
+		if (m_stPackageHead.nVersion < 2)
+		{
+			//版本1中uiFlags的位置是结构体的对齐空间，不保证为0。
+			for (soint64 i=0; i<m_nSingleFileInfoListSize; ++i)
+			{
+				m_pSingleFileInfoList[i].uiFlags = 0;
+			}
+		}
+		//如果是Mode_Read模式，则生成m_pHashList，帮助快速定位目标文件。
+		if (m_theFileMode == Mode_Read)
+		{
+			//之后按需读取各个SingleFile，访问顺序是随机的，不需要系统做顺序预读。
+			m_pFile->Advise(0, 0, SoFileIO::Access_Random);
+			m_nPackageFileSize = m_pFile->GetSize();
+			if (m_nEntryCacheMaxSize > 0 && m_nSingleFileInfoListSize > 0)
+			{
+				m_EntryCache.Init(m_nSingleFileInfoListSize, m_nEntryCacheMaxSize, m_pAllocator);
+			}
+			if (m_eReadVerify == ReadVerify_FirstTouch && m_nSingleFileInfoListSize > 0)
+			{
+				m_pVerifiedList = (volatile char*)m_pAllocator->Alloc(m_nSingleFileInfoListSize);
+				if (m_pVerifiedList == 0)
+				{
+					return Result_MemoryIsEmpty;
+				}
+				memset((void*)m_pVerifiedList, 0, (size_t)m_nSingleFileInfoListSize);
+			}
+			return BuildHashList();
+		}
+		else
+		{
+			return Result_OK;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::BuildHashList()
+	{
+		SoTrace_Scope("BuildHashList");
+		OperationResult theResult = Result_OK;
+		if (m_pHashList)
+		{
+			m_pAllocator->Free(m_pHashList);
+		}
+		const souint32 uiCount = (souint32)m_nSingleFileInfoListSize;
+		const size_t theSize = (size_t)(uiCount * sizeof(stHashInfo));
+		m_pHashList = (stHashInfo*)m_pAllocator->Alloc(theSize);
+		if (m_pHashList == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		memset(m_pHashList, 0, theSize);
+		//
+		for (souint32 i=0; i<uiCount; ++i)
+		{
+			souint32 uiIndex = m_pSingleFileInfoList[i].uiHashA % uiCount;
+			//根据哈希值的计算，uiIndex是应该放置的位置，但是这个位置上可能已经有值了，
+			//则顺延找到一个空的位置。
+			bool bFindEmpty = false;
+			for (souint32 j=0; j<uiCount; ++j)
+			{
+				souint32 uiCheckIndex = uiIndex + j;
+				if (uiCheckIndex >= uiCount)
+				{
+					uiCheckIndex = uiCheckIndex - uiCount;
+				}
+				if (m_pHashList[uiCheckIndex].uiHashA == 0
+					&& m_pHashList[uiCheckIndex].uiHashB == 0
+					&& m_pHashList[uiCheckIndex].uiHashC == 0)
+				{
+					//uiCheckIndex位置的元素为空。
+					uiIndex = uiCheckIndex;
+					bFindEmpty = true;
+					break;
+				}
+			}
+			if (bFindEmpty)
+			{
+				m_pHashList[uiIndex].uiIndex_SingleFileInfoList = i;
+				m_pHashList[uiIndex].uiHashA = m_pSingleFileInfoList[i].uiHashA;
+				m_pHashList[uiIndex].uiHashB = m_pSingleFileInfoList[i].uiHashB;
+				m_pHashList[uiIndex].uiHashC = m_pSingleFileInfoList[i].uiHashC;
+			}
+			else
+			{
+				theResult = Result_BuildHashListFail;
+				break;
+			}
+		}
+		return theResult;
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::ReCreateSingleFileInfoList(soint64 nCapacity)
+	{
+		stSingleFileInfo* pSingleFileInfoList_Temp = m_pSingleFileInfoList;
+		//
+		size_t sizeCapacity = (size_t)nCapacity;
+		m_pSingleFileInfoList = (stSingleFileInfo*)m_pAllocator->Alloc(sizeCapacity * sizeof(stSingleFileInfo));
+		if (m_pSingleFileInfoList)
+		{
+			//清零
+			memset(m_pSingleFileInfoList, 0, sizeCapacity * sizeof(stSingleFileInfo));
+			//拷贝已有的值
+			if (m_nSingleFileInfoListSize > 0)
+			{
+				size_t sizeCount_SingleFileInfo = (size_t)m_nSingleFileInfoListSize;
+				memcpy(m_pSingleFileInfoList, pSingleFileInfoList_Temp, sizeCount_SingleFileInfo*sizeof(stSingleFileInfo));
+			}
+			m_nSingleFileInfoListCapacity = nCapacity;
+		}
+		else
+		{
+			//申请内存失败。
+			m_pSingleFileInfoList = 0;
+			m_nSingleFileInfoListCapacity = 0;
+			m_nSingleFileInfoListSize = 0;
+		}
+		//
+		if (pSingleFileInfoList_Temp)
+		{
+			m_pAllocator->Free(pSingleFileInfoList_Temp);
+			pSingleFileInfoList_Temp = 0;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::ReleaseSingleFileInfoList()
+	{
+		m_nSingleFileInfoListCapacity = 0;
+		m_nSingleFileInfoListSize = 0;
+		if (m_pSingleFileInfoList)
+		{
+			m_pAllocator->Free(m_pSingleFileInfoList);
+			m_pSingleFileInfoList = 0;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::LoadSingleFile(stReadSingleFile& theFile)
+	{
+		SoTrace_Scope("LoadSingleFile");
+		SoTrace_SetArg(theFile.nFileID, m_pSingleFileInfoList[theFile.nFileID].nOriginalFileSize);
+		if (CopyFromEntryCache(theFile))
+		{
+			//已经预读取过了。
+			return Result_OK;
+		}
+		const stSingleFileInfo& theFileInfo = m_pSingleFileInfoList[theFile.nFileID];
+		char* pFileBuff = AllocFileBuff(theFile, theFileInfo.nOriginalFileSize);
+		if (pFileBuff == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		OperationResult eResult = LoadSingleFileTo(theFileInfo, pFileBuff);
+		if (eResult != Result_OK)
+		{
+			theFile.Clear();
+			return eResult;
+		}
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	char* SoPackageFile::AllocFileBuff(stReadSingleFile& theFile, soint64 nSize)
+	{
+		//多申请一个字节，避免文件大小为0时返回空指针。
+		SoAllocator* pAllocator = theFile.pAllocator ? theFile.pAllocator : m_pAllocator;
+		theFile.pFileBuff = (char*)pAllocator->Alloc(nSize + 1);
+		theFile.pBuffAllocator = theFile.pFileBuff ? pAllocator : 0;
+		return theFile.pFileBuff;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoPackageFile::CopyFromEntryCache(stReadSingleFile& theFile)
+	{
+		const char* pCached = 0;
+		soint64 nCachedSize = 0;
+		void* pHandle = m_EntryCache.Acquire(theFile.nFileID, pCached, nCachedSize);
+		if (pHandle == 0)
+		{
+			SoAtomic_Add64(&GetThreadStats().nCacheMissCount, 1);
+			return false;
+		}
+		SoAtomic_Add64(&GetThreadStats().nCacheHitCount, 1);
+		char* pFileBuff = AllocFileBuff(theFile, nCachedSize);
+		if (pFileBuff)
+		{
+			memcpy(pFileBuff, pCached, (size_t)nCachedSize);
+		}
+		m_EntryCache.Unacquire(pHandle);
+		return (pFileBuff != 0);
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::LoadSingleFileTo(const stSingleFileInfo& theFileInfo, char* pDest)
+	{
+		if (theFileInfo.uiFlags & SingleFile_Stored)
+		{
+			//没有压缩，直接读入pDest。
+			if (theFileInfo.nEmbededFileSize != theFileInfo.nOriginalFileSize)
+			{
+				return Result_FileSizeNotMatchAfterUncompress;
+			}
+			stStats& theStats = GetThreadStats();
+			SoAtomic_Add64(&theStats.nDiskReadCount, 1);
+			SoAtomic_Add64(&theStats.nDiskReadBytes, theFileInfo.nOriginalFileSize);
+			const soint64 nStartTime = SoThread_GetNanoseconds();
+			if (m_pFile->ReadAt(pDest, theFileInfo.nOriginalFileSize, theFileInfo.nOffset) != theFileInfo.nOriginalFileSize)
+			{
+				return Result_FileOperationError;
+			}
+			const soint64 nEndTime = SoThread_GetNanoseconds();
+			RecordLatency(Latency_IO, theFileInfo.nOriginalFileSize, nEndTime - nStartTime);
+			SoTrace_Event("IO", nStartTime, nEndTime, -1, theFileInfo.nOriginalFileSize);
+			return CheckReadChecksum(theFileInfo, pDest);
+		}
+		//使用当前线程的临时缓存，读取资源包使用指定偏移量的读操作，多个线程互不影响。
+		stTempBuff* pTempBuff = BeginUseTempBuff();
+		if (pTempBuff == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		OperationResult eResult = Result_OK;
+		if (ResizeTempBuff(pTempBuff->pTempBuff_AfterCompress, pTempBuff->nTempBuffMaxSize_AfterCompress, theFileInfo.nEmbededFileSize, false))
+		{
+			SoAtomic_Add64(&pTempBuff->theStats.nDiskReadCount, 1);
+			SoAtomic_Add64(&pTempBuff->theStats.nDiskReadBytes, theFileInfo.nEmbededFileSize);
+			const soint64 nStartTime = SoThread_GetNanoseconds();
+			soint64 nActuallyReadCount = m_pFile->ReadAt(pTempBuff->pTempBuff_AfterCompress, theFileInfo.nEmbededFileSize, theFileInfo.nOffset);
+			if (nActuallyReadCount != theFileInfo.nEmbededFileSize)
+			{
+				eResult = Result_FileOperationError;
+			}
+			else
+			{
+				const soint64 nEndTime = SoThread_GetNanoseconds();
+				RecordLatency(Latency_IO, theFileInfo.nOriginalFileSize, nEndTime - nStartTime);
+				SoTrace_Event("IO", nStartTime, nEndTime, -1, theFileInfo.nOriginalFileSize);
+				eResult = UncompressTo(theFileInfo, pTempBuff->pTempBuff_AfterCompress, pDest);
+			}
+		}
+		else
+		{
+			SoAtomic_Add64(&m_stScratchStats.nStreamCount, 1);
+			eResult = LoadSingleFileTo_Streamed(theFileInfo, pDest, pTempBuff);
+		}
+		EndUseTempBuff(pTempBuff);
+		if (eResult == Result_OK)
+		{
+			eResult = CheckReadChecksum(theFileInfo, pDest);
+		}
+		return eResult;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::LoadSingleFileTo_Streamed(const stSingleFileInfo& theFileInfo, char* pDest, stTempBuff* pTempBuff)
+	{
+		if (!ResizeTempBuff(pTempBuff->pTempBuff_AfterCompress, pTempBuff->nTempBuffMaxSize_AfterCompress, SoPackageFile_StreamChunkSize, true))
+		{
+			return Result_MemoryIsEmpty;
+		}
+		z_stream* pStream = GetInflateStream(pTempBuff, (theFileInfo.uiFlags & SingleFile_RawDeflate) != 0);
+		if (pStream == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		const soint64 nInChunk = (pTempBuff->nTempBuffMaxSize_AfterCompress > SoPackageFile_MaxStreamSize) ? SoPackageFile_MaxStreamSize : pTempBuff->nTempBuffMaxSize_AfterCompress;
+		stStats& theStats = pTempBuff->theStats;
+		soint64 nReadPos = 0;
+		soint64 nWritePos = 0;
+		//整个文件的解压缩时间，不包含中间的磁盘读取。
+		soint64 nInflateTime = 0;
+		//输出写满pDest之后再给zlib一个字节，用来发现解压缩后的数据比文件原始大小还要大。
+		Bytef theDummy = 0;
+		int nResult = Z_OK;
+		while (nResult != Z_STREAM_END)
+		{
+			if (pStream->avail_in == 0 && nReadPos < theFileInfo.nEmbededFileSize)
+			{
+				const soint64 nRest = theFileInfo.nEmbededFileSize - nReadPos;
+				const soint64 nRead = (nRest < nInChunk) ? nRest : nInChunk;
+				SoAtomic_Add64(&theStats.nDiskReadCount, 1);
+				SoAtomic_Add64(&theStats.nDiskReadBytes, nRead);
+				const soint64 nStartTime = SoThread_GetNanoseconds();
+				if (m_pFile->ReadAt(pTempBuff->pTempBuff_AfterCompress, nRead, theFileInfo.nOffset + nReadPos) != nRead)
+				{
+					return Result_FileOperationError;
+				}
+				const soint64 nEndTime = SoThread_GetNanoseconds();
+				RecordLatency(Latency_IO, theFileInfo.nOriginalFileSize, nEndTime - nStartTime);
+				SoTrace_Event("IO", nStartTime, nEndTime, -1, nRead);
+				nReadPos += nRead;
+				pStream->next_in = (Bytef*)pTempBuff->pTempBuff_AfterCompress;
+				pStream->avail_in = (uInt)nRead;
+			}
+			if (pStream->avail_out == 0)
+			{
+				const soint64 nRest = theFileInfo.nOriginalFileSize - nWritePos;
+				if (nRest > 0)
+				{
+					pStream->next_out = (Bytef*)pDest + nWritePos;
+					pStream->avail_out = (uInt)((nRest < SoPackageFile_MaxStreamSize) ? nRest : SoPackageFile_MaxStreamSize);
+				}
+				else
+				{
+					pStream->next_out = &theDummy;
+					pStream->avail_out = 1;
+				}
+			}
+			const uInt uiAvailOut = pStream->avail_out;
+			const bool bToDest = (pStream->next_out != &theDummy);
+			const soint64 nStartTime = SoThread_GetNanoseconds();
+			nResult = inflate(pStream, Z_NO_FLUSH);
+			const soint64 nEndTime = SoThread_GetNanoseconds();
+			SoAtomic_Add64(&theStats.nInflateTime, nEndTime - nStartTime);
+			nInflateTime += nEndTime - nStartTime;
+			SoTrace_Event("Inflate", nStartTime, nEndTime, -1, (soint64)(uiAvailOut - pStream->avail_out));
+			if (bToDest)
+			{
+				nWritePos += (soint64)(uiAvailOut - pStream->avail_out);
+				SoAtomic_Add64(&theStats.nInflateBytes, (soint64)(uiAvailOut - pStream->avail_out));
+			}
+			else if (pStream->avail_out == 0)
+			{
+				return Result_FileSizeNotMatchAfterUncompress;
+			}
+			if (nResult == Z_BUF_ERROR && pStream->avail_in == 0 && nReadPos >= theFileInfo.nEmbededFileSize)
+			{
+				//压缩数据已经用完，但还没有结束。
+				return Result_UncompressFail;
+			}
+			if (nResult != Z_OK && nResult != Z_STREAM_END && nResult != Z_BUF_ERROR)
+			{
+				return Result_UncompressFail;
+			}
+			if (!ContinueNextBlock(pStream, theFileInfo, nWritePos, nResult))
+			{
+				return Result_UncompressFail;
+			}
+		}
+		if (nWritePos != theFileInfo.nOriginalFileSize)
+		{
+			return Result_FileSizeNotMatchAfterUncompress;
+		}
+		RecordLatency(Latency_Inflate, theFileInfo.nOriginalFileSize, nInflateTime);
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::UncompressSingleFile(const stSingleFileInfo& theFileInfo, const char* pEmbeded, stReadSingleFile& theFile)
+	{
+		//直接解压缩到pFileBuff中。
+		char* pFileBuff = AllocFileBuff(theFile, theFileInfo.nOriginalFileSize);
+		if (pFileBuff == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		OperationResult eResult = UncompressTo(theFileInfo, pEmbeded, pFileBuff);
+		if (eResult == Result_OK)
+		{
+			eResult = CheckReadChecksum(theFileInfo, pFileBuff);
+		}
+		if (eResult != Result_OK)
+		{
+			theFile.Clear();
+			return eResult;
+		}
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::UncompressTo(const stSingleFileInfo& theFileInfo, const char* pEmbeded, char* pDest)
+	{
+		if (theFileInfo.uiFlags & SingleFile_Stored)
+		{
+			if (theFileInfo.nEmbededFileSize != theFileInfo.nOriginalFileSize)
+			{
+				return Result_FileSizeNotMatchAfterUncompress;
+			}
+			memcpy(pDest, pEmbeded, (size_t)theFileInfo.nOriginalFileSize);
+			return Result_OK;
+		}
+		const bool bRawDeflate = (theFileInfo.uiFlags & SingleFile_RawDeflate) != 0;
+		const bool bBlocked = (theFileInfo.uiFlags & SingleFile_Blocked) != 0;
+		soint64 nSizeAfterUncompress = 0;
+		int nResult = Z_OK;
+		OperationResult eBlockResult = Result_OK;
+		z_stream* pStream = 0;
+		const soint64 nStartTime = SoThread_GetNanoseconds();
+		stTempBuff* pTempBuff = GetTempBuff();
+		if (pTempBuff)
+		{
+			pStream = GetInflateStream(pTempBuff, bRawDeflate);
+		}
+		if (pStream && bBlocked)
+		{
+			eBlockResult = UncompressBlocks(theFileInfo, pEmbeded, pDest, pStream, nSizeAfterUncompress);
+		}
+		else if (pStream)
+		{
+			nResult = InflateBuffer(pStream, pEmbeded, theFileInfo.nEmbededFileSize, pDest, theFileInfo.nOriginalFileSize, nSizeAfterUncompress);
+		}
+		else if (!bRawDeflate && !bBlocked)
+		{
+			uLongf nSize = (uLongf)theFileInfo.nOriginalFileSize;
+			nResult = uncompress((Bytef*)pDest, &nSize, (const Bytef*)pEmbeded, (uLong)theFileInfo.nEmbededFileSize);
+			nSizeAfterUncompress = (soint64)nSize;
+		}
+		else
+		{
+			//uncompress只支持单个zlib格式的压缩流。
+			return Result_MemoryIsEmpty;
+		}
+		const soint64 nEndTime = SoThread_GetNanoseconds();
+		const soint64 nInflateTime = nEndTime - nStartTime;
+		SoTrace_Event("Inflate", nStartTime, nEndTime, -1, (soint64)nSizeAfterUncompress);
+		stStats& theStats = GetThreadStats();
+		SoAtomic_Add64(&theStats.nInflateTime, nInflateTime);
+		SoAtomic_Add64(&theStats.nInflateBytes, nSizeAfterUncompress);
+		if (eBlockResult != Result_OK)
+		{
+			return eBlockResult;
+		}
+		if (nResult != Z_OK)
+		{
+			//解压缩后的数据比stSingleFileInfo描述的源文件大小还要大。
+			return (nResult == Z_BUF_ERROR) ? Result_FileSizeNotMatchAfterUncompress : Result_UncompressFail;
+		}
+		if (nSizeAfterUncompress != theFileInfo.nOriginalFileSize)
+		{
+			return Result_FileSizeNotMatchAfterUncompress;
+		}
+		RecordLatency(Latency_Inflate, theFileInfo.nOriginalFileSize, nInflateTime);
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::UncompressBlocks(const stSingleFileInfo& theFileInfo, const char* pEmbeded, char* pDest, z_stream* pStream, soint64& nProduced)
+	{
+		nProduced = 0;
+		const soint64 nBlockSize = GetBlockSize(theFileInfo);
+		const soint64 nBlockCount = GetBlockCount(theFileInfo);
+		const soint64 nIndexSize = nBlockCount * (soint64)sizeof(souint32);
+		if (nBlockSize == 0 || nIndexSize > theFileInfo.nEmbededFileSize)
+		{
+			return Result_UncompressFail;
+		}
+		//块索引在压缩数据的末尾。资源包内的数据不一定按4字节对齐，逐个复制出来，累加成每块的起始位置。
+		const soint64 nStreamSize = theFileInfo.nEmbededFileSize - nIndexSize;
+		const char* pIndex = pEmbeded + nStreamSize;
+		soint64* pOffsetList = (soint64*)m_pAllocator->Alloc((nBlockCount + 1) * (soint64)sizeof(soint64));
+		if (pOffsetList == 0)
+		{
+			return Result_MemoryIsEmpty;
+		}
+		pOffsetList[0] = 0;
+		for (soint64 i=0; i<nBlockCount; ++i)
+		{
+			souint32 uiSize = 0;
+			memcpy(&uiSize, pIndex + i * (soint64)sizeof(souint32), sizeof(uiSize));
+			pOffsetList[i + 1] = pOffsetList[i] + (soint64)uiSize;
+		}
+		if (pOffsetList[nBlockCount] > nStreamSize)
+		{
+			m_pAllocator->Free(pOffsetList);
+			return Result_UncompressFail;
+		}
+		SoSemaphore theDone(0);
+		stInflateTask theTask;
+		theTask.pPackage = this;
+		theTask.pEmbeded = pEmbeded;
+		theTask.pOffsetList = pOffsetList;
+		theTask.pDest = pDest;
+		theTask.nOriginalFileSize = theFileInfo.nOriginalFileSize;
+		theTask.nBlockSize = nBlockSize;
+		theTask.nBlockCount = nBlockCount;
+		theTask.bRawDeflate = (theFileInfo.uiFlags & SingleFile_RawDeflate) != 0;
+		theTask.nNextBlock = 0;
+		theTask.nProduced = 0;
+		theTask.nPoolBlocks = 0;
+		theTask.nResult = Result_OK;
+		theTask.pDone = &theDone;
+		//调用者的线程算一个，其余的块交给线程池。线程池中的任务可能还没开始，调用者就已经解压缩完所有的块，
+		//这些任务开始之后领取不到块，直接结束。
+		souint32 uiStarted = 0;
+		if (nBlockCount > 1 && theFileInfo.nOriginalFileSize >= m_nParallelInflateMinSize && m_uiParallelInflateThreads != 1)
+		{
+			SoThreadPool* pThreadPool = GetInflateThreadPool();
+			souint32 uiHelperCount = pThreadPool ? pThreadPool->GetThreadCount() : 0;
+			if (m_uiParallelInflateThreads > 1 && uiHelperCount > m_uiParallelInflateThreads - 1)
+			{
+				uiHelperCount = m_uiParallelInflateThreads - 1;
+			}
+			if ((soint64)uiHelperCount > nBlockCount - 1)
+			{
+				uiHelperCount = (souint32)(nBlockCount - 1);
+			}
+			for (souint32 i=0; i<uiHelperCount; ++i)
+			{
+				if (pThreadPool->AddTask(InflateTask_Run, &theTask, SoThreadPool::Priority_High))
+				{
+					++uiStarted;
+				}
+			}
+		}
+		InflateBlocks(theTask, pStream, false);
+		for (souint32 i=0; i<uiStarted; ++i)
+		{
+			theDone.Wait();
+		}
+		m_pAllocator->Free(pOffsetList);
+		if (uiStarted > 0)
+		{
+			stStats& theStats = GetThreadStats();
+			SoAtomic_Add64(&theStats.nParallelInflateCount, 1);
+			SoAtomic_Add64(&theStats.nParallelInflateBlocks, theTask.nPoolBlocks);
+		}
+		nProduced = theTask.nProduced;
+		return (OperationResult)theTask.nResult;
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::InflateTask_Run(void* pParam)
+	{
+		stInflateTask* pTask = (stInflateTask*)pParam;
+		SoPackageFile* pPackage = pTask->pPackage;
+		//线程池的线程使用自己的zlib对象。取不到时不领取块，由其他线程完成。
+		stTempBuff* pTempBuff = pPackage->BeginUseTempBuff();
+		if (pTempBuff)
+		{
+			z_stream* pStream = pPackage->GetInflateStream(pTempBuff, pTask->bRawDeflate);
+			if (pStream)
+			{
+				pPackage->InflateBlocks(*pTask, pStream, true);
+			}
+			pPackage->EndUseTempBuff(pTempBuff);
+		}
+		pTask->pDone->Post();
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::InflateBlocks(stInflateTask& theTask, z_stream* pStream, bool bPoolThread)
+	{
+		SoTrace_Scope("InflateBlocks");
+		bool bFirst = true;
+		while (theTask.nResult == Result_OK)
+		{
+			const soint64 nBlock = SoAtomic_Add64(&theTask.nNextBlock, 1) - 1;
+			if (nBlock >= theTask.nBlockCount)
+			{
+				break;
+			}
+			const soint64 nOutPos = nBlock * theTask.nBlockSize;
+			const soint64 nOutRest = theTask.nOriginalFileSize - nOutPos;
+			const soint64 nOutSize = (nOutRest < theTask.nBlockSize) ? nOutRest : theTask.nBlockSize;
+			OperationResult eResult = Result_OK;
+			soint64 nBlockProduced = 0;
+			//GetInflateStream返回的对象已经Reset，之后的每一块都要重新开始。
+			if (!bFirst && inflateReset(pStream) != Z_OK)
+			{
+				eResult = Result_UncompressFail;
+			}
+			else
+			{
+				const soint64 nInPos = theTask.pOffsetList[nBlock];
+				const int nResult = InflateBuffer(pStream, theTask.pEmbeded + nInPos, theTask.pOffsetList[nBlock + 1] - nInPos, theTask.pDest + nOutPos, nOutSize, nBlockProduced);
+				if (nResult != Z_OK)
+				{
+					eResult = (nResult == Z_BUF_ERROR) ? Result_FileSizeNotMatchAfterUncompress : Result_UncompressFail;
+				}
+				else if (nBlockProduced != nOutSize)
+				{
+					eResult = Result_FileSizeNotMatchAfterUncompress;
+				}
+			}
+			bFirst = false;
+			SoAtomic_Add64(&theTask.nProduced, nBlockProduced);
+			if (bPoolThread)
+			{
+				SoAtomic_Add64(&theTask.nPoolBlocks, 1);
+			}
+			if (eResult != Result_OK)
+			{
+				SoAtomic_CompareExchange(&theTask.nResult, (soint32)eResult, (soint32)Result_OK);
+			}
+		}
+	}
+	//-----------------------------------------------------------------------------
+	bool SoPackageFile::ContinueNextBlock(z_stream* pStream, const stSingleFileInfo& theFileInfo, soint64 nOutSize, int& nResult)
+	{
+		if (nResult != Z_STREAM_END || (theFileInfo.uiFlags & SingleFile_Blocked) == 0 || nOutSize >= theFileInfo.nOriginalFileSize)
+		{
+			return true;
+		}
+		//一块结束时输出一定正好在块的边界上。
+		const soint64 nBlockSize = GetBlockSize(theFileInfo);
+		if (nBlockSize == 0 || nOutSize % nBlockSize != 0 || inflateReset(pStream) != Z_OK)
+		{
+			return false;
+		}
+		nResult = Z_OK;
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	int SoPackageFile::InflateBuffer(z_stream* pStream, const char* pIn, soint64 nInSize, char* pOut, soint64 nOutSize, soint64& nProduced)
+	{
+		//pOut写满之后再给zlib一个字节，用来发现解压缩后的数据比nOutSize还要大。
+		//nOutSize为0时zlib仍然要求输出缓存不为空，与uncompress的做法相同。
+		Bytef theDummy = 0;
+		bool bToDummy = false;
+		soint64 nInPos = 0;
+		soint64 nOutPos = 0;
+		nProduced = 0;
+		pStream->avail_in = 0;
+		pStream->avail_out = 0;
+		while (true)
+		{
+			if (pStream->avail_in == 0 && nInPos < nInSize)
+			{
+				const soint64 nRest = nInSize - nInPos;
+				const soint64 nSize = (nRest < SoPackageFile_MaxStreamSize) ? nRest : SoPackageFile_MaxStreamSize;
+				pStream->next_in = (Bytef*)pIn + nInPos;
+				pStream->avail_in = (uInt)nSize;
+				nInPos += nSize;
+			}
+			if (pStream->avail_out == 0)
+			{
+				const soint64 nRest = nOutSize - nOutPos;
+				if (nRest > 0)
+				{
+					const soint64 nSize = (nRest < SoPackageFile_MaxStreamSize) ? nRest : SoPackageFile_MaxStreamSize;
+					pStream->next_out = (Bytef*)pOut + nOutPos;
+					pStream->avail_out = (uInt)nSize;
+					nOutPos += nSize;
+				}
+				else
+				{
+					pStream->next_out = &theDummy;
+					pStream->avail_out = 1;
+					bToDummy = true;
+				}
+			}
+			const int nResult = inflate(pStream, (nInPos >= nInSize) ? Z_FINISH : Z_NO_FLUSH);
+			nProduced = bToDummy ? nOutSize : nOutPos - (soint64)pStream->avail_out;
+			if (bToDummy && pStream->avail_out == 0)
+			{
+				return Z_BUF_ERROR;
+			}
+			if (nResult == Z_STREAM_END)
+			{
+				return Z_OK;
+			}
+			if (nResult == Z_MEM_ERROR)
+			{
+				return Z_MEM_ERROR;
+			}
+			if (nResult != Z_OK && nResult != Z_BUF_ERROR)
+			{
+				return Z_DATA_ERROR;
+			}
+			if (nResult == Z_BUF_ERROR && pStream->avail_out > 0)
+			{
+				//输出缓存还有空间，但压缩数据已经用完，还没有结束。
+				return Z_DATA_ERROR;
+			}
+		}
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::CheckReadChecksum(const stSingleFileInfo& theFileInfo, const char* pData)
+	{
+		if (m_eReadVerify == ReadVerify_Never || (theFileInfo.uiFlags & SingleFile_Checksum) == 0)
+		{
+			return Result_OK;
+		}
+		if ((theFileInfo.uiFlags & (SingleFile_Stored | SingleFile_RawDeflate)) == 0)
+		{
+			//zlib格式，解压缩时已经检查过adler32。
+			return Result_OK;
+		}
+		const soint64 nFileID = &theFileInfo - m_pSingleFileInfoList;
+		if (m_pVerifiedList && m_pVerifiedList[nFileID])
+		{
+			return Result_OK;
+		}
+		SoAtomic_Add64(&GetThreadStats().nChecksumBytes, theFileInfo.nOriginalFileSize);
+		if (SoHash_CRC32C(0, pData, theFileInfo.nOriginalFileSize) != theFileInfo.uiOriginalCRC)
+		{
+			return Result_ChecksumMismatch;
+		}
+		if (m_pVerifiedList)
+		{
+			m_pVerifiedList[nFileID] = 1;
+		}
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::ReadManyWithIOUring(SoIOUring& theRing, stReadManyItem* pItemList, soint64 nItemCount, SoThreadPool* pThreadPool)
+	{
+		const int nFD = m_pFile->GetFD();
+		const souint32 uiDepth = theRing.GetQueueDepth();
+		stStats& theStats = GetThreadStats();
+		//限制已经读取但还没有解压缩的文件个数，控制内存占用。
+		SoSemaphore theSlot((soint32)uiDepth * 2);
+		soint64 nNext = 0;
+		soint64 nInFlight = 0;
+		bool bRingError = false;
+		while (nNext < nItemCount || nInFlight > 0)
+		{
+			//尽可能多地填充提交队列。
+			while (!bRingError && nNext < nItemCount && nInFlight < (soint64)uiDepth)
+			{
+				if (!theSlot.TryWait())
+				{
+					if (nInFlight > 0)
+					{
+						break;
+					}
+					//所有名额都被等待解压缩的文件占用了，等待线程池释放。
+					theSlot.Wait();
+				}
+				stReadManyItem& theItem = pItemList[nNext];
+				++nNext;
+				theItem.pSlot = &theSlot;
+				const stSingleFileInfo& theFileInfo = m_pSingleFileInfoList[theItem.pFile->nFileID];
+				if (theFileInfo.nEmbededFileSize > 0x40000000)
+				{
+					//超过1GB的文件直接同步读取。
+					theSlot.Post();
+					theItem.pSlot = 0;
+					ReadManyTask_Load(&theItem);
+					continue;
+				}
+				theItem.pEmbeded = (char*)m_pAllocator->Alloc(theFileInfo.nEmbededFileSize + 1);
+				if (theItem.pEmbeded == 0)
+				{
+					theItem.eResult = Result_MemoryIsEmpty;
+					ReadManyTask_Finish(&theItem);
+					continue;
+				}
+				if (!theRing.PrepareRead(nFD, theItem.pEmbeded, (souint32)theFileInfo.nEmbededFileSize, theFileInfo.nOffset, &theItem))
+				{
+					//提交队列已满，不应该发生。缓存没有交给内核，可以释放，改为同步读取。
+					m_pAllocator->Free(theItem.pEmbeded);
+					theItem.pEmbeded = 0;
+					ReadManyTask_Load(&theItem);
+					continue;
+				}
+				theItem.bInFlight = true;
+				++nInFlight;
+			}
+			if (nInFlight == 0)
+			{
+				if (bRingError)
+				{
+					//剩余的文件同步读取。
+					while (nNext < nItemCount)
+					{
+						ReadManyTask_Load(&pItemList[nNext]);
+						++nNext;
+					}
+				}
+				continue;
+			}
+			//提交失败之后不再提交新的请求，只等待已经交给内核的请求完成。
+			if (!(bRingError ? theRing.Wait(1) : theRing.Submit(1)))
+			{
+				void* pUserData = 0;
+				if (!bRingError)
+				{
+					//不应该发生。撤回还没有交给内核的请求，改为同步读取。
+					//已经交给内核的请求还在写入缓存，继续等待它们完成，之后照常处理。
+					bRingError = true;
+					while (theRing.CancelUnsubmitted(pUserData))
+					{
+						stReadManyItem& theItem = *(stReadManyItem*)pUserData;
+						--nInFlight;
+						theItem.bInFlight = false;
+						m_pAllocator->Free(theItem.pEmbeded);
+						theItem.pEmbeded = 0;
+						ReadManyTask_Load(&theItem);
+					}
+					continue;
+				}
+				//连等待也失败了，内核可能还在写入这些缓存，不能释放也不能再使用，只能放弃，改为同步读取。
+				for (soint64 i=0; i<nNext; ++i)
+				{
+					stReadManyItem& theItem = pItemList[i];
+					if (theItem.bInFlight)
+					{
+						theItem.bInFlight = false;
+						theItem.pEmbeded = 0;
+						ReadManyTask_Load(&theItem);
+					}
+				}
+				nInFlight = 0;
+				continue;
+			}
+			//处理已经完成的读请求，交给线程池解压缩。
+			void* pUserData = 0;
+			soint32 nResult = 0;
+			while (theRing.PeekCompletion(pUserData, nResult))
+			{
+				--nInFlight;
+				stReadManyItem& theItem = *(stReadManyItem*)pUserData;
+				theItem.bInFlight = false;
+				const stSingleFileInfo& theFileInfo = m_pSingleFileInfoList[theItem.pFile->nFileID];
+				if (nResult >= 0)
+				{
+					SoAtomic_Add64(&theStats.nDiskReadCount, 1);
+					SoAtomic_Add64(&theStats.nDiskReadBytes, nResult);
+				}
+				if (nResult >= 0 && nResult < theFileInfo.nEmbededFileSize)
+				{
+					//没有一次读完，剩余部分同步读取。
+					const soint64 nRest = theFileInfo.nEmbededFileSize - nResult;
+					SoAtomic_Add64(&theStats.nDiskReadCount, 1);
+					SoAtomic_Add64(&theStats.nDiskReadBytes, nRest);
+					if (m_pFile->ReadAt(theItem.pEmbeded + nResult, nRest, theFileInfo.nOffset + nResult) == nRest)
+					{
+						nResult = (soint32)theFileInfo.nEmbededFileSize;
+					}
+					else
+					{
+						nResult = -1;
+					}
+				}
+				if (nResult < 0)
+				{
+					theItem.eResult = Result_FileOperationError;
+					ReadManyTask_Finish(&theItem);
+				}
+				else if (pThreadPool == 0 || !pThreadPool->AddTask(ReadManyTask_Uncompress, &theItem, SoThreadPool::Priority_High))
+				{
+					ReadManyTask_Uncompress(&theItem);
+				}
+			}
+		}
+		//等待所有文件处理完毕。线程池中的解压缩任务还会使用theSlot，必须在这里等待。
+		for (soint64 i=0; i<nItemCount; ++i)
+		{
+			pItemList[i].pDone->Wait();
+		}
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::ReadManyTask_Load(void* pParam)
+	{
+		stReadManyItem* pItem = (stReadManyItem*)pParam;
+		pItem->eResult = pItem->pPackage->LoadSingleFile(*(pItem->pFile));
+		ReadManyTask_Finish(pItem);
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::ReadManyTask_Uncompress(void* pParam)
+	{
+		stReadManyItem* pItem = (stReadManyItem*)pParam;
+		const stSingleFileInfo& theFileInfo = pItem->pPackage->m_pSingleFileInfoList[pItem->pFile->nFileID];
+		pItem->eResult = pItem->pPackage->UncompressSingleFile(theFileInfo, pItem->pEmbeded, *(pItem->pFile));
+		ReadManyTask_Finish(pItem);
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::ReadManyTask_Finish(stReadManyItem* pItem)
+	{
+		if (pItem->pEmbeded)
+		{
+			pItem->pPackage->m_pAllocator->Free(pItem->pEmbeded);
+			pItem->pEmbeded = 0;
+		}
+		if (pItem->pSlot)
+		{
+			pItem->pSlot->Post();
+			pItem->pSlot = 0;
+		}
+		pItem->pDone->Post();
+	}
+	//-----------------------------------------------------------------------------
+	int SoPackageFile::CompareReadManyItem(const void* pLeft, const void* pRight)
+	{
+		const soint64 nLeft = ((const stReadManyItem*)pLeft)->nOffset;
+		const soint64 nRight = ((const stReadManyItem*)pRight)->nOffset;
+		return (nLeft < nRight) ? -1 : ((nLeft > nRight) ? 1 : 0);
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::VerifyTask_Run(void* pParam)
+	{
+		stVerifyTask* pTask = (stVerifyTask*)pParam;
+		SoPackageFile* pThis = pTask->pPackage;
+		//整个过程一直持有当前线程的临时缓存，每个文件只需要两块SoPackageFile_VerifyChunkSize大小的缓存。
+		stTempBuff* pTempBuff = pThis->BeginUseTempBuff();
+		while (true)
+		{
+			const soint64 nFileID = SoAtomic_Add64(&pTask->nNextFileID, 1) - 1;
+			if (nFileID >= pThis->m_nSingleFileInfoListSize)
+			{
+				break;
+			}
+			bool bChecked = false;
+			soint64 nReadBytes = 0;
+			OperationResult eResult = Result_MemoryIsEmpty;
+			if (pTempBuff)
+			{
+				eResult = pThis->VerifySingleFile(pThis->m_pSingleFileInfoList[nFileID], pTask->eLevel, pTempBuff, bChecked, nReadBytes);
+			}
+			pTask->pResultList[nFileID] = eResult;
+			SoAtomic_Add64(bChecked ? &pTask->nCheckedCount : &pTask->nSkippedCount, 1);
+			SoAtomic_Add64(&pTask->nCheckedBytes, nReadBytes);
+		}
+		if (pTempBuff)
+		{
+			//Verify的线程随后就结束了，缓存不再保留。
+			pThis->FreeTempBuff(pTempBuff);
+			pThis->EndUseTempBuff(pTempBuff);
+		}
+		pTask->pDone->Post();
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::VerifySingleFile(const stSingleFileInfo& theFileInfo, VerifyLevel eLevel, stTempBuff* pTempBuff, bool& bChecked, soint64& nReadBytes)
+	{
+		SoTrace_Scope("VerifySingleFile");
+		bChecked = false;
+		nReadBytes = 0;
+		const bool bHasChecksum = (theFileInfo.uiFlags & SingleFile_Checksum) != 0;
+		const bool bInflate = (eLevel == Verify_Inflate && (theFileInfo.uiFlags & SingleFile_Stored) == 0);
+		if (!bHasChecksum && !bInflate)
+		{
+			//没有校验值，也不需要解压缩，无法检查。
+			return Result_OK;
+		}
+		if (theFileInfo.nOffset < 0 || theFileInfo.nEmbededFileSize < 0 || theFileInfo.nOffset + theFileInfo.nEmbededFileSize > m_nPackageFileSize)
+		{
+			bChecked = true;
 			return Result_FileOperationError;
 		}
-		if (feof(pSingleFile) != 0)
+		if (!ResizeTempBuff(pTempBuff->pTempBuff_AfterCompress, pTempBuff->nTempBuffMaxSize_AfterCompress, SoPackageFile_VerifyChunkSize, true))
+		{
+			return Result_MemoryIsEmpty;
+		}
+		z_stream* pStream = 0;
+		if (bInflate)
+		{
+			if (!ResizeTempBuff(pTempBuff->pTempBuff_SrcFile, pTempBuff->nTempBuffMaxSize_SrcFile, SoPackageFile_VerifyChunkSize, true))
+			{
+				return Result_MemoryIsEmpty;
+			}
+			pStream = GetInflateStream(pTempBuff, (theFileInfo.uiFlags & SingleFile_RawDeflate) != 0);
+			if (pStream == 0)
+			{
+				return Result_MemoryIsEmpty;
+			}
+		}
+		bChecked = true;
+		stStats& theStats = pTempBuff->theStats;
+		souint32 uiEmbededCRC = 0;
+		souint32 uiOriginalCRC = 0;
+		soint64 nOutSize = 0;
+		int nResult = Z_OK;
+		for (soint64 nReadPos = 0; nReadPos < theFileInfo.nEmbededFileSize; )
+		{
+			const soint64 nRest = theFileInfo.nEmbededFileSize - nReadPos;
+			const soint64 nRead = (nRest < SoPackageFile_VerifyChunkSize) ? nRest : SoPackageFile_VerifyChunkSize;
+			SoAtomic_Add64(&theStats.nDiskReadCount, 1);
+			SoAtomic_Add64(&theStats.nDiskReadBytes, nRead);
+			if (m_pFile->ReadAt(pTempBuff->pTempBuff_AfterCompress, nRead, theFileInfo.nOffset + nReadPos) != nRead)
+			{
+				return Result_FileOperationError;
+			}
+			nReadPos += nRead;
+			nReadBytes += nRead;
+			uiEmbededCRC = SoHash_CRC32C(uiEmbededCRC, pTempBuff->pTempBuff_AfterCompress, nRead);
+			if (pStream == 0 || nResult == Z_STREAM_END)
+			{
+				//压缩数据结束之后剩余的字节与读取时一样被忽略，只参与uiEmbededCRC的计算。
+				continue;
+			}
+			//解压缩的结果只用来计算校验值，每次都写到同一块缓存中。
+			pStream->next_in = (Bytef*)pTempBuff->pTempBuff_AfterCompress;
+			pStream->avail_in = (uInt)nRead;
+			do
+			{
+				pStream->next_out = (Bytef*)pTempBuff->pTempBuff_SrcFile;
+				pStream->avail_out = (uInt)SoPackageFile_VerifyChunkSize;
+				nResult = inflate(pStream, Z_NO_FLUSH);
+				if (nResult != Z_OK && nResult != Z_STREAM_END && nResult != Z_BUF_ERROR)
+				{
+					return Result_UncompressFail;
+				}
+				const soint64 nProduced = SoPackageFile_VerifyChunkSize - (soint64)pStream->avail_out;
+				SoAtomic_Add64(&theStats.nInflateBytes, nProduced);
+				nOutSize += nProduced;
+				if (nOutSize > theFileInfo.nOriginalFileSize)
+				{
+					return Result_FileSizeNotMatchAfterUncompress;
+				}
+				uiOriginalCRC = SoHash_CRC32C(uiOriginalCRC, pTempBuff->pTempBuff_SrcFile, nProduced);
+				if (!ContinueNextBlock(pStream, theFileInfo, nOutSize, nResult))
+				{
+					return Result_UncompressFail;
+				}
+			} while (nResult != Z_STREAM_END && (pStream->avail_in > 0 || pStream->avail_out == 0));
+		}
+		if (pStream)
+		{
+			if (nResult != Z_STREAM_END)
+			{
+				//压缩数据不完整。
+				return Result_UncompressFail;
+			}
+			if (nOutSize != theFileInfo.nOriginalFileSize)
+			{
+				return Result_FileSizeNotMatchAfterUncompress;
+			}
+		}
+		if (bHasChecksum)
+		{
+			if (uiEmbededCRC != theFileInfo.uiEmbededCRC || (pStream && uiOriginalCRC != theFileInfo.uiOriginalCRC))
+			{
+				return Result_ChecksumMismatch;
+			}
+		}
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::ExtractTask_Run(void* pParam)
+	{
+		stExtractTask* pTask = (stExtractTask*)pParam;
+		SoPackageFile* pThis = pTask->pPackage;
+		//与Verify一样，整个过程一直持有当前线程的临时缓存。
+		stTempBuff* pTempBuff = pThis->BeginUseTempBuff();
+		//每个线程重复使用一个SoFileIO对象写出文件。
+		SoFileIO* pOutFile = SoFileIO_Create(pThis->m_eIOBackend);
+		char szPath[SoPackageFileMAX_PATH * 2];
+		const size_t nDirLength = strlen(pTask->pszDestDir);
+		memcpy(szPath, pTask->pszDestDir, nDirLength);
+		szPath[nDirLength] = '/';
+		while (true)
+		{
+			const soint64 nFileID = SoAtomic_Add64(&pTask->nNextFileID, 1) - 1;
+			if (nFileID >= pThis->m_nSingleFileInfoListSize)
+			{
+				break;
+			}
+			const stSingleFileInfo& theFileInfo = pThis->m_pSingleFileInfoList[nFileID];
+			OperationResult eResult = Result_OK;
+			bool bKernelCopy = false;
+			const char* pszExtractPath = GetExtractPath(theFileInfo.szFileName);
+			if (pTempBuff == 0 || pOutFile == 0)
+			{
+				eResult = Result_MemoryIsEmpty;
+			}
+			else if (pszExtractPath == 0)
+			{
+				eResult = Result_UnsafeFileName;
+			}
+			else
+			{
+				strcpy(szPath + nDirLength + 1, pszExtractPath);
+				//多数目录已经存在，打开失败时才创建目录。
+				bool bOpen = pOutFile->Open(szPath, SoFileIO::Open_Create);
+				if (!bOpen && SoFileIO_MakeParentDir(szPath))
+				{
+					bOpen = pOutFile->Open(szPath, SoFileIO::Open_Create);
+				}
+				if (bOpen)
+				{
+					eResult = pThis->ExtractSingleFile(theFileInfo, pOutFile, pTempBuff, bKernelCopy);
+					if (!pOutFile->Flush() && eResult == Result_OK)
+					{
+						eResult = Result_FileOperationError;
+					}
+					pOutFile->Close();
+					if (eResult != Result_OK)
+					{
+						remove(szPath);
+					}
+				}
+				else
+				{
+					eResult = Result_CreateFileFail;
+				}
+			}
+			pTask->pResultList[nFileID] = eResult;
+			if (eResult == Result_OK)
+			{
+				SoAtomic_Add64(&pTask->nExtractedCount, 1);
+				SoAtomic_Add64(&pTask->nExtractedBytes, theFileInfo.nOriginalFileSize);
+				if (bKernelCopy)
+				{
+					SoAtomic_Add64(&pTask->nKernelCopyCount, 1);
+				}
+			}
+		}
+		if (pOutFile)
+		{
+			delete pOutFile;
+		}
+		if (pTempBuff)
+		{
+			pThis->FreeTempBuff(pTempBuff);
+			pThis->EndUseTempBuff(pTempBuff);
+		}
+		pTask->pDone->Post();
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoPackageFile::ExtractSingleFile(const stSingleFileInfo& theFileInfo, SoFileIO* pOutFile, stTempBuff* pTempBuff, bool& bKernelCopy)
+	{
+		SoTrace_Scope("ExtractSingleFile");
+		bKernelCopy = false;
+		if (theFileInfo.nOffset < 0 || theFileInfo.nEmbededFileSize < 0 || theFileInfo.nOffset + theFileInfo.nEmbededFileSize > m_nPackageFileSize)
 		{
-			//越界了，这不应该发生。
-			//这时，文件指针应该在文件末尾，再读一个字节才会越界。
 			return Result_FileOperationError;
 		}
-		//<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
-		//对源文件进行压缩。
-		//某些情况下，压缩后的文件要比压缩前还要大，例如文件本来就很小（只有几个字节），
-		//或者文件本身就是zlib压缩过的，再经过压缩就变的大一点（PNG格式就是已经经过zlib压缩过的）。
-		TryResizeTempBuff_AfterCompress(theFileInfo.nOriginalFileSize + 1024000);
-		uLongf nSizeAfterCompress = (uLongf)m_nTempBuffMaxSize_AfterCompress;
-		int nResult = compress((Bytef*)m_pTempBuff_AfterCompress, &nSizeAfterCompress, (Bytef*)m_pTempBuff_SrcFile, sizeOriginalFileSize);
-		if (nResult != Z_OK)
+		const bool bStored = (theFileInfo.uiFlags & SingleFile_Stored) != 0;
+		if (bStored && theFileInfo.nEmbededFileSize != theFileInfo.nOriginalFileSize)
 		{
-			return Result_CompressFail;
+			return Result_FileSizeNotMatchAfterUncompress;
 		}
-		//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
-		//写入到资源包。
-		const size_t sizeFileSizeAfterCompress = (size_t)nSizeAfterCompress;
-		size_t nActuallyWrite = fwrite(m_pTempBuff_AfterCompress, 1, sizeFileSizeAfterCompress, m_pFile);
-		if (nActuallyWrite != sizeFileSizeAfterCompress)
+		stStats& theStats = pTempBuff->theStats;
+		soint64 nCopied = 0;
+		if (bStored && theFileInfo.nEmbededFileSize > 0)
+		{
+			//原样存储的文件先尝试在内核中复制，复制不完的部分（或者不支持时的全部）再经过缓存读写。
+			nCopied = pOutFile->CopyFrom(m_pFile, theFileInfo.nOffset, theFileInfo.nEmbededFileSize, 0);
+			if (nCopied > 0)
+			{
+				SoAtomic_Add64(&theStats.nDiskReadCount, 1);
+				SoAtomic_Add64(&theStats.nDiskReadBytes, nCopied);
+			}
+			else
+			{
+				nCopied = 0;
+			}
+			if (nCopied == theFileInfo.nEmbededFileSize)
+			{
+				bKernelCopy = true;
+				return Result_OK;
+			}
+		}
+		//只有完整经过缓存的内容才能计算校验值。
+		//zlib格式由inflate检查adler32，与CheckReadChecksum一致。
+		const bool bCheck = ((theFileInfo.uiFlags & SingleFile_Checksum) != 0 && (theFileInfo.uiFlags & (SingleFile_Stored | SingleFile_RawDeflate)) != 0
+			&& nCopied == 0 && m_eReadVerify != ReadVerify_Never);
+		if (!ResizeTempBuff(pTempBuff->pTempBuff_AfterCompress, pTempBuff->nTempBuffMaxSize_AfterCompress, SoPackageFile_ExtractChunkSize, true))
+		{
+			return Result_MemoryIsEmpty;
+		}
+		z_stream* pStream = 0;
+		if (!bStored)
+		{
+			if (!ResizeTempBuff(pTempBuff->pTempBuff_SrcFile, pTempBuff->nTempBuffMaxSize_SrcFile, SoPackageFile_ExtractChunkSize, true))
+			{
+				return Result_MemoryIsEmpty;
+			}
+			pStream = GetInflateStream(pTempBuff, (theFileInfo.uiFlags & SingleFile_RawDeflate) != 0);
+			if (pStream == 0)
+			{
+				return Result_MemoryIsEmpty;
+			}
+		}
+		souint32 uiOriginalCRC = 0;
+		soint64 nOutSize = nCopied;
+		int nResult = Z_OK;
+		for (soint64 nReadPos = nCopied; nReadPos < theFileInfo.nEmbededFileSize; )
+		{
+			const soint64 nRest = theFileInfo.nEmbededFileSize - nReadPos;
+			const soint64 nRead = (nRest < SoPackageFile_ExtractChunkSize) ? nRest : SoPackageFile_ExtractChunkSize;
+			SoAtomic_Add64(&theStats.nDiskReadCount, 1);
+			SoAtomic_Add64(&theStats.nDiskReadBytes, nRead);
+			if (m_pFile->ReadAt(pTempBuff->pTempBuff_AfterCompress, nRead, theFileInfo.nOffset + nReadPos) != nRead)
+			{
+				return Result_FileOperationError;
+			}
+			nReadPos += nRead;
+			if (pStream == 0)
+			{
+				if (bCheck)
+				{
+					uiOriginalCRC = SoHash_CRC32C(uiOriginalCRC, pTempBuff->pTempBuff_AfterCompress, nRead);
+				}
+				if (pOutFile->WriteAt(pTempBuff->pTempBuff_AfterCompress, nRead, nOutSize) != nRead)
+				{
+					return Result_FileOperationError;
+				}
+				nOutSize += nRead;
+				continue;
+			}
+			if (nResult == Z_STREAM_END)
+			{
+				//压缩数据结束之后剩余的字节与读取时一样被忽略。
+				continue;
+			}
+			pStream->next_in = (Bytef*)pTempBuff->pTempBuff_AfterCompress;
+			pStream->avail_in = (uInt)nRead;
+			do
+			{
+				pStream->next_out = (Bytef*)pTempBuff->pTempBuff_SrcFile;
+				pStream->avail_out = (uInt)SoPackageFile_ExtractChunkSize;
+				nResult = inflate(pStream, Z_NO_FLUSH);
+				if (nResult != Z_OK && nResult != Z_STREAM_END && nResult != Z_BUF_ERROR)
+				{
+					return Result_UncompressFail;
+				}
+				const soint64 nProduced = SoPackageFile_ExtractChunkSize - (soint64)pStream->avail_out;
+				SoAtomic_Add64(&theStats.nInflateBytes, nProduced);
+				if (nOutSize + nProduced > theFileInfo.nOriginalFileSize)
+				{
+					return Result_FileSizeNotMatchAfterUncompress;
+				}
+				if (bCheck)
+				{
+					uiOriginalCRC = SoHash_CRC32C(uiOriginalCRC, pTempBuff->pTempBuff_SrcFile, nProduced);
+				}
+				if (nProduced > 0 && pOutFile->WriteAt(pTempBuff->pTempBuff_SrcFile, nProduced, nOutSize) != nProduced)
+				{
+					return Result_FileOperationError;
+				}
+				nOutSize += nProduced;
+				if (!ContinueNextBlock(pStream, theFileInfo, nOutSize, nResult))
+				{
+					return Result_UncompressFail;
+				}
+			} while (nResult != Z_STREAM_END && (pStream->avail_in > 0 || pStream->avail_out == 0));
+		}
+		if (pStream && nResult != Z_STREAM_END)
+		{
+			//压缩数据不完整。
+			return Result_UncompressFail;
+		}
+		if (nOutSize != theFileInfo.nOriginalFileSize)
+		{
+			return Result_FileSizeNotMatchAfterUncompress;
+		}
+		if (bCheck)
+		{
+			SoAtomic_Add64(&theStats.nChecksumBytes, theFileInfo.nOriginalFileSize);
+			if (uiOriginalCRC != theFileInfo.uiOriginalCRC)
+			{
+				return Result_ChecksumMismatch;
+			}
+		}
+		return Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	const char* SoPackageFile::GetExtractPath(const char* pszFileName)
+	{
+		if (memchr(pszFileName, 0, SoPackageFileMAX_PATH) == 0)
+		{
+			//损坏的资源包中文件名可能没有结束符。
+			return 0;
+		}
+		//InsertSingleFile记录的是磁盘路径，例如"d:/game.ini"和"/tmp/a.txt"，与tar一样去掉盘符和开头的分隔符。
+		if (((pszFileName[0] >= 'a' && pszFileName[0] <= 'z') || (pszFileName[0] >= 'A' && pszFileName[0] <= 'Z')) && pszFileName[1] == ':')
+		{
+			pszFileName += 2;
+		}
+		while (*pszFileName == '/' || *pszFileName == '\\')
+		{
+			++pszFileName;
+		}
+		if (pszFileName[0] == 0 || strchr(pszFileName, ':'))
+		{
+			//其他位置的":"在Windows上是盘符或者NTFS的数据流。
+			return 0;
+		}
+		const char* pszPart = pszFileName;
+		while (true)
+		{
+			const char* pszEnd = pszPart;
+			while (*pszEnd != 0 && *pszEnd != '/' && *pszEnd != '\\')
+			{
+				++pszEnd;
+			}
+			if (pszEnd - pszPart == 2 && pszPart[0] == '.' && pszPart[1] == '.')
+			{
+				return 0;
+			}
+			if (*pszEnd == 0)
+			{
+				return pszFileName;
+			}
+			pszPart = pszEnd + 1;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::AsyncTask_Read(void* pParam)
+	{
+		stAsyncRequest* pRequest = (stAsyncRequest*)pParam;
+		SoPackageFile* pPackage = pRequest->pPackage;
+		if (SoAtomic_CompareExchange(&pRequest->nState, Async_Running, Async_Pending) == Async_Pending)
+		{
+			if (pRequest->pFile->pFileBuff == 0)
+			{
+				pRequest->eResult = pPackage->LoadSingleFile(*(pRequest->pFile));
+			}
+		}
+		else
+		{
+			pRequest->eResult = Result_Cancelled;
+		}
+		//从链表中移除，之后CancelAsync就找不到这个请求了。
+		pPackage->UnlinkAsyncRequest(pRequest);
+		//回调执行之后请求可能已经被调用者释放，此后不能再使用pRequest和pPackage。
+		if (pRequest->pExecutor == 0 || !pRequest->pExecutor->Post(AsyncTask_Callback, pRequest))
+		{
+			AsyncTask_Callback(pRequest);
+		}
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::AsyncTask_Callback(void* pParam)
+	{
+		stAsyncRequest* pRequest = (stAsyncRequest*)pParam;
+		//执行器可能在资源包释放之后才执行回调，这里不能使用pPackage。
+		SoAllocator* pAllocator = pRequest->pAllocator;
+		pRequest->pCallback(pRequest->eResult, *(pRequest->pFile), pRequest->pUserData);
+		pAllocator->Free(pRequest);
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::UnlinkAsyncRequest(stAsyncRequest* pRequest)
+	{
+		SoTimedAutoLock theAutoLock(m_AsyncLock, &m_nLockWaitTime);
+		if (pRequest->pPrev)
+		{
+			pRequest->pPrev->pNext = pRequest->pNext;
+		}
+		else
+		{
+			m_pAsyncRequestList = pRequest->pNext;
+		}
+		if (pRequest->pNext)
+		{
+			pRequest->pNext->pPrev = pRequest->pPrev;
+		}
+		SoAtomic_Decrement(&m_nAsyncPending);
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::CancelAllAsync()
+	{
+		for (int i=0; i<SoThreadPool::Priority_Count; ++i)
+		{
+			CancelAsyncByPriority((SoThreadPool::Priority)i);
+		}
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::PrefetchCallback(OperationResult eResult, stReadSingleFile& theFile, void* pUserData)
+	{
+		SoPackageFile* pThis = (SoPackageFile*)pUserData;
+		if (eResult == Result_OK && theFile.pFileBuff)
+		{
+			if (pThis->m_EntryCache.Insert(theFile.nFileID, theFile.pFileBuff, theFile.nFileSize))
+			{
+				//文件缓存接管了这块内存。
+				theFile.pFileBuff = 0;
+			}
+		}
+		pThis->FreeReadSingleFile(&theFile);
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::InitPredictor(const char* pszPackageFile)
+	{
+		if (m_nSingleFileInfoListSize <= 0 || m_EntryCache.GetMaxSize() == 0)
+		{
+			//预测的结果要放在文件缓存中。
+			return;
+		}
+		//用文件头、文件个数和整个SingleFile信息列表的CRC32C识别资源包，内容相同的文件换了位置或者重新打包都会被发现。
+		soint64 theIdentity[SoAccessPredictor_IdentityCount];
+		theIdentity[0] = m_stPackageHead.nVersion;
+		theIdentity[1] = m_stPackageHead.nOffsetForFirstSingleFileInfo;
+		theIdentity[2] = SoHash_CRC32C(0, m_pSingleFileInfoList, m_nSingleFileInfoListSize * (soint64)sizeof(stSingleFileInfo));
+		if (!m_Predictor.Init(m_nSingleFileInfoListSize, theIdentity))
+		{
+			return;
+		}
+		//各个线程记录的上一次访问属于之前打开的资源包。
+		{
+			SoAutoLock theAutoLock(m_TempBuffListLock);
+			for (stTempBuff* pTempBuff = m_pTempBuffList; pTempBuff; pTempBuff = pTempBuff->pNext)
+			{
+				pTempBuff->nLastAccessFileID = -1;
+			}
+		}
+		m_pSpeculativeState = (volatile soint32*)calloc((size_t)m_nSingleFileInfoListSize, sizeof(soint32));
+		const size_t nLength = strlen(pszPackageFile);
+		m_pszPredictorFile = (char*)malloc(nLength + 8);
+		if (m_pSpeculativeState == 0 || m_pszPredictorFile == 0)
+		{
+			ReleasePredictor();
+			return;
+		}
+		memcpy(m_pszPredictorFile, pszPackageFile, nLength);
+		memcpy(m_pszPredictorFile + nLength, ".sopred", 8);
+		m_Predictor.Load(m_pszPredictorFile);
+		m_nSpeculativeBytes = 0;
+		m_stPredictorStats = stPredictorStats();
+		m_EntryCache.SetEvictCallback(OnEntryEvicted, this);
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::ReleasePredictor()
+	{
+		if (m_pSpeculativeState && m_Predictor.IsDirty())
+		{
+			m_Predictor.Save(m_pszPredictorFile);
+		}
+		m_EntryCache.SetEvictCallback(0, 0);
+		m_Predictor.Release();
+		if (m_pSpeculativeState)
+		{
+			free((void*)m_pSpeculativeState);
+			m_pSpeculativeState = 0;
+		}
+		if (m_pszPredictorFile)
+		{
+			free(m_pszPredictorFile);
+			m_pszPredictorFile = 0;
+		}
+		//m_stPredictorStats保留到下次InitPackageFile，便于查看。
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::RecordAccess(soint64 nFileID, bool bSpeculate)
+	{
+		if (m_pSpeculativeState == 0 || nFileID < 0)
+		{
+			return;
+		}
+		//统计预测的效果。
+		const soint64 nSize = m_pSingleFileInfoList[nFileID].nOriginalFileSize;
+		if (ReleaseSpeculative(nFileID, Speculative_Cached, Speculative_None))
+		{
+			SoAtomic_Add64(&m_stPredictorStats.nHit, 1);
+			SoAtomic_Add64(&m_stPredictorStats.nHitBytes, nSize);
+		}
+		else if (ReleaseSpeculative(nFileID, Speculative_Loading, Speculative_None))
+		{
+			SoAtomic_Add64(&m_stPredictorStats.nLateHit, 1);
+		}
+		//每个线程记录自己的访问顺序，多个线程同时读取时不会把不相关的文件当成前后相继。
+		stTempBuff* pTempBuff = GetTempBuff();
+		m_Predictor.Record(pTempBuff->nLastAccessFileID, nFileID);
+		pTempBuff->nLastAccessFileID = nFileID;
+		if (!bSpeculate)
+		{
+			return;
+		}
+		//沿着最可能的后继向前预测几步，预读取需要时间，只预测下一个文件往往来不及。
+		soint64 theFileIDList[SoAccessPredictor_MaxSuccessor];
+		soint64 nCurrent = nFileID;
+		for (int nDepth=0; nDepth<SoPackageFile_PredictDepth; ++nDepth)
+		{
+			//至少出现过2次，并且占全部后继的1/4以上。
+			const souint32 uiCount = m_Predictor.Predict(nCurrent, theFileIDList, 2, 2, 4);
+			for (souint32 i=0; i<uiCount; ++i)
+			{
+				IssueSpeculative(theFileIDList[i]);
+			}
+			if (uiCount == 0)
+			{
+				break;
+			}
+			nCurrent = theFileIDList[0];
+		}
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::IssueSpeculative(soint64 nFileID)
+	{
+		const soint64 nSize = m_pSingleFileInfoList[nFileID].nOriginalFileSize;
+		if (m_nSpeculativeBytes + nSize > m_nPredictorBudget || m_EntryCache.Contains(nFileID))
+		{
+			return;
+		}
+		if (SoAtomic_CompareExchange(&m_pSpeculativeState[nFileID], Speculative_Loading, Speculative_None) != Speculative_None)
+		{
+			//已经预读取过了。
+			return;
+		}
+		SoAtomic_Add64(&m_nSpeculativeBytes, nSize);
+		SoAtomic_Add64(&m_stPredictorStats.nIssued, 1);
+		SoAtomic_Add64(&m_stPredictorStats.nIssuedBytes, nSize);
+		stReadSingleFile* pFile = AllocReadSingleFile(nFileID, nSize);
+		if (pFile == 0 || ReadAsync(*pFile, SpeculativeCallback, this, 0, 0, SoThreadPool::Priority_Low) != Result_OK)
+		{
+			//队列已满，放弃。
+			ReleaseSpeculative(nFileID, Speculative_Loading, Speculative_None);
+			SoAtomic_Add64(&m_stPredictorStats.nIssued, -1);
+			SoAtomic_Add64(&m_stPredictorStats.nIssuedBytes, -nSize);
+			FreeReadSingleFile(pFile);
+		}
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::SpeculativeCallback(OperationResult eResult, stReadSingleFile& theFile, void* pUserData)
+	{
+		SoPackageFile* pThis = (SoPackageFile*)pUserData;
+		const soint64 nFileID = theFile.nFileID;
+		bool bWasted = true;
+		if (eResult == Result_OK && theFile.pFileBuff)
+		{
+			//先修改状态再放入文件缓存，因为放入之后随时可能被淘汰。
+			//状态修改失败说明已经被读取过了，照样放入文件缓存。
+			SoAtomic_CompareExchange(&pThis->m_pSpeculativeState[nFileID], Speculative_Cached, Speculative_Loading);
+			if (pThis->m_EntryCache.Insert(nFileID, theFile.pFileBuff, theFile.nFileSize))
+			{
+				theFile.pFileBuff = 0;
+				bWasted = false;
+			}
+			else if (pThis->m_EntryCache.Contains(nFileID))
+			{
+				//其他的预读取已经放进去了。
+				bWasted = false;
+			}
+		}
+		if (bWasted)
+		{
+			if (pThis->ReleaseSpeculative(nFileID, Speculative_Loading, Speculative_None)
+				|| pThis->ReleaseSpeculative(nFileID, Speculative_Cached, Speculative_None))
+			{
+				SoAtomic_Add64(&pThis->m_stPredictorStats.nWasted, 1);
+				SoAtomic_Add64(&pThis->m_stPredictorStats.nWastedBytes, pThis->m_pSingleFileInfoList[nFileID].nOriginalFileSize);
+			}
+		}
+		pThis->FreeReadSingleFile(&theFile);
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::OnEntryEvicted(soint64 nFileID, soint64 /*nSize*/, void* pUserData)
+	{
+		SoPackageFile* pThis = (SoPackageFile*)pUserData;
+		if (pThis->ReleaseSpeculative(nFileID, Speculative_Cached, Speculative_None))
+		{
+			SoAtomic_Add64(&pThis->m_stPredictorStats.nWasted, 1);
+			SoAtomic_Add64(&pThis->m_stPredictorStats.nWastedBytes, pThis->m_pSingleFileInfoList[nFileID].nOriginalFileSize);
+		}
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::stReadSingleFile* SoPackageFile::AllocReadSingleFile(soint64 nFileID, soint64 nFileSize)
+	{
+		void* pAddress = m_pAllocator->Alloc(sizeof(stReadSingleFile));
+		if (pAddress == 0)
 		{
-			return Result_FileOperationError;
+			return 0;
 		}
-		//完善参数。
-		theFileInfo.nEmbededFileSize = sizeFileSizeAfterCompress;
-		return Result_OK;
+		stReadSingleFile* pFile = new (pAddress) stReadSingleFile;
+		pFile->nFileID = nFileID;
+		pFile->nFileSize = nFileSize;
+		return pFile;
 	}
 	//-----------------------------------------------------------------------------
-	SoPackageFile::OperationResult SoPackageFile::WriteAllSingleFileInfo()
+	void SoPackageFile::FreeReadSingleFile(stReadSingleFile* pFile)
 	{
-		//判断当前文件状态。
-		if (m_pFile == 0)
+		if (pFile)
 		{
-			return Result_PackageFileHaveNotOpen;
+			pFile->Clear();
+			pFile->~stReadSingleFile();
+			m_pAllocator->Free(pFile);
 		}
-		soint64 nSeekResult = _fseeki64(m_pFile, m_stPackageHead.nOffsetForFirstSingleFileInfo, SEEK_SET);
-		if (nSeekResult != 0)
+	}
+	//-----------------------------------------------------------------------------
+	bool SoPackageFile::ReleaseSpeculative(soint64 nFileID, SpeculativeState eFrom, SpeculativeState eTo)
+	{
+		if (SoAtomic_CompareExchange(&m_pSpeculativeState[nFileID], eTo, eFrom) != eFrom)
 		{
-			return Result_FileOperationError;
+			return false;
 		}
-		//写入。
-		const size_t sizeAllSingleFileInfo = ((size_t)m_nSingleFileInfoListSize) * sizeof(stSingleFileInfo);
-		size_t nActuallyWrite = fwrite(m_pSingleFileInfoList, 1, sizeAllSingleFileInfo, m_pFile);
-		if (nActuallyWrite != sizeAllSingleFileInfo)
+		SoAtomic_Add64(&m_nSpeculativeBytes, -m_pSingleFileInfoList[nFileID].nOriginalFileSize);
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoPackageFile::CollectPattern(const char* pszPattern, soint64*& pFileIDList, soint64& nFileCount, soint64& nCapacity)
+	{
+		for (soint64 i=0; i<m_nSingleFileInfoListSize; ++i)
 		{
-			//SingleFile信息列表没有写入完整。
-			return Result_FileOperationError;
+			if (MatchPattern(pszPattern, m_pSingleFileInfoList[i].szFileName))
+			{
+				if (!AppendFileID(pFileIDList, nFileCount, nCapacity, i))
+				{
+					return false;
+				}
+			}
 		}
-		return Result_OK;
+		return true;
 	}
 	//-----------------------------------------------------------------------------
-	SoPackageFile::OperationResult SoPackageFile::ParsePackageFile()
+	bool SoPackageFile::AppendFileID(soint64*& pFileIDList, soint64& nFileCount, soint64& nCapacity, soint64 nFileID)
 	{
-		if (m_pFile == 0)
+		if (nFileCount >= nCapacity)
 		{
-			return Result_PackageFileHaveNotOpen;
+			const soint64 nNewCapacity = (nCapacity < 64) ? 64 : nCapacity * 2;
+			soint64* pNewList = (soint64*)m_pAllocator->Alloc(nNewCapacity * (soint64)sizeof(soint64));
+			if (pNewList == 0)
+			{
+				return false;
+			}
+			if (pFileIDList)
+			{
+				memcpy(pNewList, pFileIDList, (size_t)nFileCount * sizeof(soint64));
+				m_pAllocator->Free(pFileIDList);
+			}
+			pFileIDList = pNewList;
+			nCapacity = nNewCapacity;
 		}
-		soint64 nSeekResult = _fseeki64(m_pFile, 0, SEEK_SET);
-		if (nSeekResult != 0)
+		pFileIDList[nFileCount++] = nFileID;
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoPackageFile::MatchPattern(const char* pszPattern, const char* pszName)
+	{
+		//遇到'*'时记录位置，后面匹配失败时回到这里，让'*'多匹配一个字符。
+		const char* pszStar = 0;
+		const char* pszStarName = 0;
+		while (*pszName)
 		{
-			return Result_FileOperationError;
+			if (*pszPattern == '?' || *pszPattern == *pszName)
+			{
+				++pszPattern;
+				++pszName;
+			}
+			else if (*pszPattern == '*')
+			{
+				pszStar = pszPattern++;
+				pszStarName = pszName;
+			}
+			else if (pszStar)
+			{
+				pszPattern = pszStar + 1;
+				pszName = ++pszStarName;
+			}
+			else
+			{
+				return false;
+			}
 		}
-		//读取文件头。
-		const size_t sizePackageHead = sizeof(m_stPackageHead);
-		size_t nActuallyReadSize = fread(&m_stPackageHead, 1, sizePackageHead, m_pFile);
-		if (nActuallyReadSize != sizePackageHead)
+		while (*pszPattern == '*')
 		{
-			//文件头没有读取完整。
-			return Result_FileOperationError;
+			++pszPattern;
 		}
-		//判断文件头。
-		if (!CheckValid_PackageHead(m_stPackageHead))
+		return (*pszPattern == 0);
+	}
+	//-----------------------------------------------------------------------------
+	SoThreadPool* SoPackageFile::BeginForegroundRead()
+	{
+		//m_pAsyncThreadPool只在ReleasePackageFile中置为0，读取期间不会改变，所以不需要加锁。
+		SoThreadPool* pThreadPool = m_pAsyncThreadPool;
+		if (pThreadPool)
 		{
-			return Result_IsNotPackageFile;
+			pThreadPool->SuspendLowPriority();
 		}
-		//获取SingleFile信息列表。
-		nSeekResult = _fseeki64(m_pFile, m_stPackageHead.nOffsetForFirstSingleFileInfo, SEEK_SET);
-		if (nSeekResult != 0)
+		return pThreadPool;
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::EndForegroundRead(SoThreadPool* pThreadPool)
+	{
+		if (pThreadPool)
 		{
-			return Result_FileOperationError;
+			pThreadPool->ResumeLowPriority();
 		}
-		ReleaseSingleFileInfoList();
-		ReCreateSingleFileInfoList(m_stPackageHead.nFileCount);
-		if (m_pSingleFileInfoList == 0)
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::ReleaseThreadPool()
+	{
+		//不持有m_ThreadPoolLock，因为线程池中的任务可能正在等待这个锁。
+		if (m_pAsyncThreadPool)
 		{
-			return Result_MemoryIsEmpty;
+			delete m_pAsyncThreadPool;
+			m_pAsyncThreadPool = 0;
 		}
-		const size_t sizeSingleFileInfoList = ((size_t)(m_stPackageHead.nFileCount)) * sizeof(stSingleFileInfo);
-		size_t nActuallyReadInfoListSize = fread(m_pSingleFileInfoList, 1, sizeSingleFileInfoList, m_pFile);
-		if (nActuallyReadInfoListSize != sizeSingleFileInfoList)
+		if (m_pThreadPool)
 		{
-			//SingleFile信息列表没有读取完整。
-			return Result_FileOperationError;
+			delete m_pThreadPool;
+			m_pThreadPool = 0;
 		}
-		//SingleFile信息列表读取成功。
-		m_nSingleFileInfoListSize = m_stPackageHead.nFileCount;
-		//如果是Mode_Read模式，则生成m_pHashList，帮助快速定位目标文件。
-		if (m_theFileMode == Mode_Read)
+		//其他线程池中的任务可能正在等待解压缩，最后结束。
+		if (m_pInflateThreadPool)
 		{
-			return BuildHashList();
+			delete m_pInflateThreadPool;
+			m_pInflateThreadPool = 0;
 		}
-		else
+	}
+	//-----------------------------------------------------------------------------
+	SoThreadPool* SoPackageFile::GetThreadPool()
+	{
+		SoAutoLock theAutoLock(m_ThreadPoolLock);
+		if (m_pThreadPool == 0)
 		{
-			return Result_OK;
+			m_pThreadPool = new SoThreadPool;
+			if (!m_pThreadPool->Start(SoThread_GetCPUCount()))
+			{
+				delete m_pThreadPool;
+				m_pThreadPool = 0;
+			}
 		}
+		return m_pThreadPool;
 	}
 	//-----------------------------------------------------------------------------
-	SoPackageFile::OperationResult SoPackageFile::BuildHashList()
+	SoThreadPool* SoPackageFile::GetInflateThreadPool()
 	{
-		OperationResult theResult = Result_OK;
-		if (m_pHashList)
+		SoAutoLock theAutoLock(m_ThreadPoolLock);
+		if (m_pInflateThreadPool == 0)
 		{
-			free(m_pHashList);
+			m_pInflateThreadPool = new SoThreadPool;
+			if (!m_pInflateThreadPool->Start(SoThread_GetCPUCount()))
+			{
+				delete m_pInflateThreadPool;
+				m_pInflateThreadPool = 0;
+			}
 		}
-		const souint32 uiCount = (souint32)m_nSingleFileInfoListSize;
-		const size_t theSize = (size_t)(uiCount * sizeof(stHashInfo));
-		m_pHashList = (stHashInfo*)malloc(theSize);
-		memset(m_pHashList, 0, theSize);
-		//
-		for (souint32 i=0; i<uiCount; ++i)
+		return m_pInflateThreadPool;
+	}
+	//-----------------------------------------------------------------------------
+	SoThreadPool* SoPackageFile::GetAsyncThreadPool()
+	{
+		SoAutoLock theAutoLock(m_ThreadPoolLock);
+		if (m_pAsyncThreadPool == 0)
 		{
-			souint32 uiIndex = m_pSingleFileInfoList[i].uiHashA % uiCount;
-			//根据哈希值的计算，uiIndex是应该放置的位置，但是这个位置上可能已经有值了，
-			//则顺延找到一个空的位置。
-			bool bFindEmpty = false;
-			for (souint32 j=0; j<uiCount; ++j)
+			//设置完毕之后才赋值给m_pAsyncThreadPool，因为BeginForegroundRead不加锁。
+			SoThreadPool* pThreadPool = new SoThreadPool;
+			const souint32 uiThreadCount = (m_uiAsyncThreadCount > 0) ? m_uiAsyncThreadCount : SoThread_GetCPUCount();
+			for (int i=0; i<SoThreadPool::Priority_Count; ++i)
 			{
-				souint32 uiCheckIndex = uiIndex + j;
-				if (uiCheckIndex >= uiCount)
-				{
-					uiCheckIndex = uiCheckIndex - uiCount;
-				}
-				if (m_pHashList[uiCheckIndex].uiHashA == 0
-					&& m_pHashList[uiCheckIndex].uiHashB == 0
-					&& m_pHashList[uiCheckIndex].uiHashC == 0)
+				souint32 uiMaxRunning = m_uiAsyncMaxRunning[i];
+				if (uiMaxRunning == 0xFFFFFFFF)
 				{
-					//uiCheckIndex位置的元素为空。
-					uiIndex = uiCheckIndex;
-					bFindEmpty = true;
-					break;
+					uiMaxRunning = (uiThreadCount + 1) / 2;
 				}
+				pThreadPool->SetPriorityLimit((SoThreadPool::Priority)i, uiMaxRunning);
 			}
-			if (bFindEmpty)
+			if (pThreadPool->Start(uiThreadCount))
 			{
-				m_pHashList[uiIndex].uiIndex_SingleFileInfoList = i;
-				m_pHashList[uiIndex].uiHashA = m_pSingleFileInfoList[i].uiHashA;
-				m_pHashList[uiIndex].uiHashB = m_pSingleFileInfoList[i].uiHashB;
-				m_pHashList[uiIndex].uiHashC = m_pSingleFileInfoList[i].uiHashC;
+				m_pAsyncThreadPool = pThreadPool;
 			}
 			else
 			{
-				theResult = Result_BuildHashListFail;
-				break;
+				delete pThreadPool;
 			}
 		}
-		return theResult;
+		return m_pAsyncThreadPool;
 	}
 	//-----------------------------------------------------------------------------
-	void SoPackageFile::ReCreateSingleFileInfoList(soint64 nCapacity)
+	SoPackageFile::stTempBuff* SoPackageFile::GetTempBuff()
 	{
-		stSingleFileInfo* pSingleFileInfoList_Temp = m_pSingleFileInfoList;
-		//
-		size_t sizeCapacity = (size_t)nCapacity;
-		m_pSingleFileInfoList = (stSingleFileInfo*)malloc(sizeCapacity * sizeof(stSingleFileInfo));
-		if (m_pSingleFileInfoList)
-		{
-			//清零
-			memset(m_pSingleFileInfoList, 0, sizeCapacity * sizeof(stSingleFileInfo));
-			//拷贝已有的值
-			if (m_nSingleFileInfoListSize > 0)
-			{
-				size_t sizeCount_SingleFileInfo = (size_t)m_nSingleFileInfoListSize;
-				memcpy(m_pSingleFileInfoList, pSingleFileInfoList_Temp, sizeCount_SingleFileInfo*sizeof(stSingleFileInfo));
-			}
-			m_nSingleFileInfoListCapacity = nCapacity;
-		}
-		else
+		stTempBuff* pTempBuff = (stTempBuff*)m_TempBuffTLS.GetValue();
+		if (pTempBuff == 0)
 		{
-			//申请内存失败。
-			m_pSingleFileInfoList = 0;
-			m_nSingleFileInfoListCapacity = 0;
-			m_nSingleFileInfoListSize = 0;
+			//当前线程第一次使用临时缓存。
+			pTempBuff = new stTempBuff;
+			m_TempBuffTLS.SetValue(pTempBuff);
+			SoAutoLock theAutoLock(m_TempBuffListLock);
+			pTempBuff->pNext = m_pTempBuffList;
+			m_pTempBuffList = pTempBuff;
 		}
-		//
-		if (pSingleFileInfoList_Temp)
+		return pTempBuff;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::stStats& SoPackageFile::GetThreadStats()
+	{
+		return GetTempBuff()->theStats;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::stTempBuff* SoPackageFile::BeginUseTempBuff()
+	{
+		stTempBuff* pTempBuff = GetTempBuff();
+		if (pTempBuff)
 		{
-			free(pSingleFileInfoList_Temp);
-			pSingleFileInfoList_Temp = 0;
+			pTempBuff->theLock.Lock();
 		}
+		return pTempBuff;
 	}
 	//-----------------------------------------------------------------------------
-	void SoPackageFile::ReleaseSingleFileInfoList()
+	void SoPackageFile::EndUseTempBuff(stTempBuff* pTempBuff)
 	{
-		m_nSingleFileInfoListCapacity = 0;
-		m_nSingleFileInfoListSize = 0;
-		if (m_pSingleFileInfoList)
+		const soint64 nNow = SoThread_GetMilliseconds();
+		pTempBuff->nLastUseTime = nNow;
+		if (pTempBuff->nTempBuffMaxSize_SrcFile + pTempBuff->nTempBuffMaxSize_AfterCompress > m_nScratchKeepBytes)
 		{
-			free(m_pSingleFileInfoList);
-			m_pSingleFileInfoList = 0;
+			//为一次性的大文件申请的缓存，不长期占用。
+			FreeTempBuff(pTempBuff);
+		}
+		pTempBuff->theLock.Unlock();
+		//没有定时器，由正在读写的线程每隔一段时间检查一次所有线程的闲置缓存。
+		//多个线程同时到期时，只有把m_nScratchTrimTime从nTrimTime改成功的线程去整理。
+		const soint64 nTrimTime = SoAtomic_Load64(&m_nScratchTrimTime);
+		if (nNow >= nTrimTime
+			&& SoAtomic_CompareExchange64(&m_nScratchTrimTime, nNow + m_nScratchIdleTime, nTrimTime) == nTrimTime)
+		{
+			TrimTempBuff(m_nScratchIdleTime);
 		}
 	}
 	//-----------------------------------------------------------------------------
-	void SoPackageFile::TryResizeTempBuff_SrcFile(soint64 nDestSize)
+	void SoPackageFile::TrimTempBuff(soint64 nIdleMilliseconds)
 	{
-		soint64 nRealDestSize = 0;
-		if (m_pTempBuff_SrcFile)
+		const soint64 nNow = SoThread_GetMilliseconds();
+		SoAutoLock theAutoLock(m_TempBuffListLock);
+		for (stTempBuff* pTempBuff = m_pTempBuffList; pTempBuff; pTempBuff = pTempBuff->pNext)
 		{
-			if (m_nTempBuffMaxSize_SrcFile < nDestSize)
+			if (!pTempBuff->theLock.TryLock())
+			{
+				//正在使用。
+				continue;
+			}
+			if (nNow - pTempBuff->nLastUseTime >= nIdleMilliseconds)
 			{
-				nRealDestSize = nDestSize * 2;
+				FreeTempBuff(pTempBuff);
 			}
+			pTempBuff->theLock.Unlock();
 		}
-		else
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::FreeTempBuff(stTempBuff* pTempBuff)
+	{
+		const soint64 nBytes = pTempBuff->nTempBuffMaxSize_SrcFile + pTempBuff->nTempBuffMaxSize_AfterCompress;
+		if (nBytes == 0)
+		{
+			return;
+		}
+		if (pTempBuff->pTempBuff_SrcFile)
+		{
+			m_pAllocator->Free(pTempBuff->pTempBuff_SrcFile);
+			pTempBuff->pTempBuff_SrcFile = 0;
+		}
+		if (pTempBuff->pTempBuff_AfterCompress)
 		{
-			nRealDestSize = nDestSize;
+			m_pAllocator->Free(pTempBuff->pTempBuff_AfterCompress);
+			pTempBuff->pTempBuff_AfterCompress = 0;
 		}
-		if (nRealDestSize > 0)
+		pTempBuff->nTempBuffMaxSize_SrcFile = 0;
+		pTempBuff->nTempBuffMaxSize_AfterCompress = 0;
+		SoTimedAutoLock theAutoLock(m_ScratchLock, &m_nLockWaitTime);
+		m_stScratchStats.nCurrentBytes -= nBytes;
+		++m_stScratchStats.nShrinkCount;
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::ReleaseTempBuff(bool bDeleteAll)
+	{
+		SoAutoLock theAutoLock(m_TempBuffListLock);
+		stTempBuff* pTempBuff = m_pTempBuffList;
+		while (pTempBuff)
 		{
-			if (m_pTempBuff_SrcFile)
+			stTempBuff* pNext = pTempBuff->pNext;
+			FreeTempBuff(pTempBuff);
+			if (pTempBuff->pInflateStream)
+			{
+				inflateEnd(pTempBuff->pInflateStream);
+				m_pAllocator->Free(pTempBuff->pInflateStream);
+				pTempBuff->pInflateStream = 0;
+			}
+			if (pTempBuff->pDeflateStream)
+			{
+				deflateEnd(pTempBuff->pDeflateStream);
+				m_pAllocator->Free(pTempBuff->pDeflateStream);
+				pTempBuff->pDeflateStream = 0;
+			}
+			if (pTempBuff->pRawInflateStream)
+			{
+				inflateEnd(pTempBuff->pRawInflateStream);
+				m_pAllocator->Free(pTempBuff->pRawInflateStream);
+				pTempBuff->pRawInflateStream = 0;
+			}
+			if (bDeleteAll)
 			{
-				free(m_pTempBuff_SrcFile);
-				m_pTempBuff_SrcFile = 0;
+				delete pTempBuff;
 			}
-			m_pTempBuff_SrcFile = (char*)malloc(nRealDestSize);
-			m_nTempBuffMaxSize_SrcFile = nRealDestSize;
+			pTempBuff = pNext;
+		}
+		if (bDeleteAll)
+		{
+			m_pTempBuffList = 0;
 		}
 	}
 	//-----------------------------------------------------------------------------
-	void SoPackageFile::TryResizeTempBuff_AfterCompress(soint64 nDestSize)
+	z_stream* SoPackageFile::GetInflateStream(stTempBuff* pTempBuff, bool bRawDeflate)
 	{
-		soint64 nRealDestSize = 0;
-		if (m_pTempBuff_AfterCompress)
+		z_stream*& pCached = bRawDeflate ? pTempBuff->pRawInflateStream : pTempBuff->pInflateStream;
+		if (pCached)
 		{
-			if (m_nTempBuffMaxSize_AfterCompress < nDestSize)
+			if (inflateReset(pCached) != Z_OK)
 			{
-				nRealDestSize = nDestSize * 2;
+				return 0;
 			}
+			//inflateReset不清除输入输出，上次解压缩可能剩下没有用到的输入，例如分块压缩文件末尾的块索引。
+			pCached->next_in = 0;
+			pCached->avail_in = 0;
+			pCached->next_out = 0;
+			pCached->avail_out = 0;
+			return pCached;
 		}
-		else
+		z_stream* pStream = (z_stream*)m_pAllocator->Alloc(sizeof(z_stream));
+		if (pStream == 0)
+		{
+			return 0;
+		}
+		memset(pStream, 0, sizeof(z_stream));
+		pStream->zalloc = (alloc_func)ZAlloc;
+		pStream->zfree = (free_func)ZFree;
+		pStream->opaque = this;
+		//窗口位数为负数表示raw deflate。
+		const int nResult = bRawDeflate ? inflateInit2(pStream, -MAX_WBITS) : inflateInit(pStream);
+		if (nResult != Z_OK)
+		{
+			m_pAllocator->Free(pStream);
+			return 0;
+		}
+		pCached = pStream;
+		return pStream;
+	}
+	//-----------------------------------------------------------------------------
+	z_stream* SoPackageFile::GetDeflateStream(stTempBuff* pTempBuff)
+	{
+		if (pTempBuff->pDeflateStream)
+		{
+			return (deflateReset(pTempBuff->pDeflateStream) == Z_OK) ? pTempBuff->pDeflateStream : 0;
+		}
+		z_stream* pStream = (z_stream*)m_pAllocator->Alloc(sizeof(z_stream));
+		if (pStream == 0)
+		{
+			return 0;
+		}
+		memset(pStream, 0, sizeof(z_stream));
+		pStream->zalloc = (alloc_func)ZAlloc;
+		pStream->zfree = (free_func)ZFree;
+		pStream->opaque = this;
+		//与compress使用相同的压缩级别。raw deflate只是去掉了zlib头和adler32，压缩参数与deflateInit的默认值相同。
+		const int nResult = (m_eCompressFormat == Compress_RawDeflate)
+			? deflateInit2(pStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY)
+			: deflateInit(pStream, Z_DEFAULT_COMPRESSION);
+		if (nResult != Z_OK)
+		{
+			m_pAllocator->Free(pStream);
+			return 0;
+		}
+		pTempBuff->pDeflateStream = pStream;
+		return pStream;
+	}
+	//-----------------------------------------------------------------------------
+	void* SoPackageFile::ZAlloc(void* pOpaque, unsigned int uiItems, unsigned int uiSize)
+	{
+		return ((SoPackageFile*)pOpaque)->m_pAllocator->Alloc((soint64)uiItems * uiSize);
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::ZFree(void* pOpaque, void* pAddress)
+	{
+		((SoPackageFile*)pOpaque)->m_pAllocator->Free(pAddress);
+	}
+	//-----------------------------------------------------------------------------
+	bool SoPackageFile::ResizeTempBuff(char*& pBuff, soint64& nCapacity, soint64 nDestSize, bool bForce)
+	{
+		if (pBuff && nCapacity >= nDestSize)
 		{
-			nRealDestSize = nDestSize;
+			return true;
 		}
-		if (nRealDestSize > 0)
+		//按64KB对齐，文件大小逐渐增长时不必每次都重新申请；大小为0时也申请一块。
+		soint64 nNewCapacity = (nDestSize + 0xFFFF) & ~(soint64)0xFFFF;
+		if (nNewCapacity == 0)
 		{
-			if (m_pTempBuff_AfterCompress)
+			nNewCapacity = 0x10000;
+		}
+		{
+			SoTimedAutoLock theAutoLock(m_ScratchLock, &m_nLockWaitTime);
+			const soint64 nNewBytes = m_stScratchStats.nCurrentBytes - nCapacity + nNewCapacity;
+			if (!bForce && nNewBytes > m_nScratchMaxBytes)
+			{
+				return false;
+			}
+			m_stScratchStats.nCurrentBytes = nNewBytes;
+			if (m_stScratchStats.nPeakBytes < nNewBytes)
 			{
-				free(m_pTempBuff_AfterCompress);
-				m_pTempBuff_AfterCompress = 0;
+				m_stScratchStats.nPeakBytes = nNewBytes;
 			}
-			m_pTempBuff_AfterCompress = (char*)malloc(nRealDestSize);
-			m_nTempBuffMaxSize_AfterCompress = nRealDestSize;
 		}
+		SoAtomic_Add64(&GetThreadStats().nScratchResizeCount, 1);
+		//原有内容不需要保留，先释放再申请，避免同时占用两份内存。
+		if (pBuff)
+		{
+			m_pAllocator->Free(pBuff);
+		}
+		pBuff = (char*)m_pAllocator->Alloc(nNewCapacity);
+		if (pBuff == 0)
+		{
+			SoTimedAutoLock theAutoLock(m_ScratchLock, &m_nLockWaitTime);
+			m_stScratchStats.nCurrentBytes -= nNewCapacity;
+			nCapacity = 0;
+			return false;
+		}
+		nCapacity = nNewCapacity;
+		return true;
 	}
 	//-----------------------------------------------------------------------------
 	soint64 SoPackageFile::AssignSingleFileInfo()
@@ -725,17 +4130,88 @@ namespace GGUI
 		return nResult;
 	}
 	//-----------------------------------------------------------------------------
-	soint64 SoPackageFile::GetIndex_SingleFileInfoList(const char* pszFileName)
+	soint64 SoPackageFile::FindWrittenFile(souint32 uiHashA, souint32 uiHashB, souint32 uiHashC)
+	{
+		if (m_pWriteIndex == 0)
+		{
+			return -1;
+		}
+		const souint32 uiMask = m_uiWriteIndexCapacity - 1;
+		for (souint32 i = uiHashA & uiMask; m_pWriteIndex[i] != 0; i = (i + 1) & uiMask)
+		{
+			const soint64 nFileID = (soint64)m_pWriteIndex[i] - 1;
+			const stSingleFileInfo& theFileInfo = m_pSingleFileInfoList[nFileID];
+			if (theFileInfo.uiHashA == uiHashA && theFileInfo.uiHashB == uiHashB && theFileInfo.uiHashC == uiHashC)
+			{
+				return nFileID;
+			}
+		}
+		return -1;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoPackageFile::ReserveWriteIndex(soint64 nFileCount)
+	{
+		//装载率不超过一半。
+		if (nFileCount * 2 <= (soint64)m_uiWriteIndexCapacity)
+		{
+			return true;
+		}
+		souint32 uiCapacity = (m_uiWriteIndexCapacity > 0) ? m_uiWriteIndexCapacity : 64;
+		while ((soint64)uiCapacity < nFileCount * 2)
+		{
+			if (uiCapacity >= 0x80000000)
+			{
+				return false;
+			}
+			uiCapacity *= 2;
+		}
+		souint32* pWriteIndex = (souint32*)m_pAllocator->Alloc(uiCapacity * (soint64)sizeof(souint32));
+		if (pWriteIndex == 0)
+		{
+			return false;
+		}
+		memset(pWriteIndex, 0, uiCapacity * sizeof(souint32));
+		if (m_pWriteIndex)
+		{
+			m_pAllocator->Free(m_pWriteIndex);
+		}
+		m_pWriteIndex = pWriteIndex;
+		m_uiWriteIndexCapacity = uiCapacity;
+		//重新加入已有的文件，包括打开已有的资源包时读入的文件。
+		for (soint64 i=0; i<m_nSingleFileInfoListSize; ++i)
+		{
+			AddWrittenFile(i);
+		}
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	void SoPackageFile::AddWrittenFile(soint64 nFileID)
+	{
+		//在ReserveWriteIndex之后调用，一定有空位。
+		const souint32 uiMask = m_uiWriteIndexCapacity - 1;
+		souint32 i = m_pSingleFileInfoList[nFileID].uiHashA & uiMask;
+		while (m_pWriteIndex[i] != 0)
+		{
+			i = (i + 1) & uiMask;
+		}
+		m_pWriteIndex[i] = (souint32)(nFileID + 1);
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoPackageFile::GetIndex_SingleFileInfoList(souint32 uiHashA, souint32 uiHashB, souint32 uiHashC, souint32& uiProbeCount)
 	{
 		soint64 theIndex = -1;
-		const souint32 uiHashA = SoHash_Index(pszFileName);
-		const souint32 uiHashB = SoHash_PHP(pszFileName);
-		const souint32 uiHashC = SoHash_BKDR(pszFileName);
+		uiProbeCount = 0;
 		const souint32 uiCount = (souint32)m_nSingleFileInfoListSize;
+		if (uiCount == 0)
+		{
+			//资源包内没有文件。
+			return theIndex;
+		}
 		souint32 uiIndex = uiHashA % uiCount;
 		//
 		for (souint32 j=0; j<uiCount; ++j)
 		{
+			++uiProbeCount;
 			souint32 uiCheckIndex = uiIndex + j;
 			if (uiCheckIndex >= uiCount)
 			{
@@ -752,34 +4228,10 @@ namespace GGUI
 		return theIndex;
 	}
 	//-----------------------------------------------------------------------------
-	void SoPackageFile::FormatFileFullName(char* pszOut, const char* pszIn) const
+	souint32 SoPackageFile::FormatFileFullName(char* pszOut, const char* pszIn, souint32& uiHashA, souint32& uiHashB, souint32& uiHashC) const
 	{
-		soint64 nCount = 0;
-		while (pszIn[nCount] != 0)
-		{
-			char theC = pszIn[nCount];
-			if (theC >= 'A' && theC <= 'Z')
-			{
-				//大写字母转换为小写字母
-				theC += 32;
-			}
-			else if (theC == '\\')
-			{
-				theC = '/';
-			}
-			pszOut[nCount] = theC;
-			//
-			++nCount;
-			if (nCount >= SoPackageFileMAX_PATH)
-			{
-				pszOut[SoPackageFileMAX_PATH-1] = 0;
-				break;
-			}
-		}
-		if (nCount < SoPackageFileMAX_PATH)
-		{
-			pszOut[nCount] = 0;
-		}
+		//格式化与计算哈希值合并在一起，只遍历一遍文件名，并且会根据CPU选择SIMD指令。
+		return SoHash_FormatName(pszOut, pszIn, SoPackageFileMAX_PATH, uiHashA, uiHashB, uiHashC);
 	}
 	//-----------------------------------------------------------------------------
 	bool SoPackageFile::CheckValid_PackageHead(const SoPackageFile::stPackageHead& theHead)
@@ -801,7 +4253,7 @@ namespace GGUI
 		//判断版本号
 		if (br)
 		{
-			if (theHead.nVersion != SoPackageFileVersion)
+			if (theHead.nVersion < 1 || theHead.nVersion > SoPackageFileVersion)
 			{
 				br = false;
 			}
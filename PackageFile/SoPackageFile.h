@@ -7,16 +7,46 @@
 #define _SoPackageFile_h_
 //-----------------------------------------------------------------------------
 #include <stdio.h>
-#include <Windows.h>
+#include <stdlib.h>
+#include <string.h>
 #include "SoBaseTypeDefine.h"
+#include "SoThread.h"
+#include "SoFileIO.h"
+#include "SoThreadPool.h"
+#include "SoAllocator.h"
+#include "SoHistogram.h"
+#include "SoEntryCache.h"
+#include "SoAccessPredictor.h"
 //-----------------------------------------------------------------------------
 #define SoPackageFileFlag "SOPACKAG"
 #define SoPackageFileFlagLength 8
-#define SoPackageFileVersion 1
+//版本2在stSingleFileInfo中加入了uiFlags，占用的是版本1中结构体末尾的对齐空间，记录大小不变。
+//版本3在stSingleFileInfo末尾加入了两个校验值，记录变大了8个字节。
+//版本4加入了分块压缩的文件（SingleFile_Blocked），记录大小不变。
+#define SoPackageFileVersion 4
 #define SoPackageFileMAX_PATH 256
+//访问预测时沿着最可能的后继向前预测的步数。
+#define SoPackageFile_PredictDepth 2
+//临时缓存放不下的文件分块流式读写时，每块的大小。
+#define SoPackageFile_StreamChunkSize (256*1024)
+//Verify分块读取文件时，每块的大小。
+#define SoPackageFile_VerifyChunkSize (1024*1024)
+//ExtractAll分块读取和写出文件时，每块的大小。块越大，写出时的系统调用越少。
+#define SoPackageFile_ExtractChunkSize (4*1024*1024)
+//分块压缩时块大小的范围，必须是2的幂。
+#define SoPackageFile_MinBlockSize (64*1024)
+#define SoPackageFile_MaxBlockSize (64*1024*1024)
+//分块压缩时一次读入并交给线程池压缩的块数，是线程个数的倍数，多出来的块让先完成的线程继续压缩。
+#define SoPackageFile_BlockGroupPerThread 2
+//一块压缩结果的缓存大小，是deflateBound在任何压缩参数下的上限，压缩结果一定放得下，deflate一次就能完成。
+#define SoPackageFile_BlockDestStride(nBlockSize) ((nBlockSize) + ((nBlockSize) >> 3) + ((nBlockSize) >> 6) + 64)
+//-----------------------------------------------------------------------------
+//zlib的z_stream，避免在头文件中包含zlib.h。
+struct z_stream_s;
 //-----------------------------------------------------------------------------
 namespace GGUI
 {
+	class SoIOUring;
 	class SoPackageFile
 	{
 	public:
@@ -41,7 +71,7 @@ namespace GGUI
 			Result_IsNotPackageFile, //不是SoPackageFile文件
 			Result_OpenFileFail, //打开磁盘文件失败
 			Result_CreateFileFail, //创建磁盘文件失败
-			Result_FileOperationError, //C标准库中的文件操作函数返回了失败。
+			Result_FileOperationError, //磁盘文件的读写操作返回了失败。
 			Result_MemoryIsEmpty, //申请内存失败，内存不足。
 			Result_FileModeMismatch, //文件模式不匹配，例如Mode_Read模式下，你却想执行Write操作。
 			Result_SingleFileAlreadyExist, //文件已经存在。可能是文件名重复了。
@@ -52,6 +82,87 @@ namespace GGUI
 			Result_CompressFail, //对源文件执行压缩操作时失败了。
 			Result_UncompressFail, //执行解压缩失败了。
 			Result_FileSizeNotMatchAfterUncompress, //解压缩后文件大小与stSingleFileInfo描述的源文件大小不一致。
+			Result_Cancelled, //异步读取请求被取消了。
+			Result_AsyncQueueFull, //等待执行的异步读取请求太多了。
+			Result_AsyncRequestNotPending, //异步读取请求已经开始执行或者已经结束，不能取消。
+			Result_BufferTooSmall, //外界提供的缓存放不下文件内容。
+			Result_ChecksumMismatch, //文件内容与stSingleFileInfo中记录的校验值不一致，资源包已经损坏。
+			Result_UnsafeFileName, //文件名包含".."这一级目录，不能解压到目标目录之外。
+		};
+		//stSingleFileInfo::uiFlags的取值。
+		enum SingleFileFlag
+		{
+			//压缩没有收益，原样存储，nEmbededFileSize与nOriginalFileSize相同。
+			SingleFile_Stored = 0x1,
+			//uiEmbededCRC和uiOriginalCRC有效。版本3之前写入的文件没有校验值。
+			SingleFile_Checksum = 0x2,
+			//压缩数据是没有zlib头和adler32的raw deflate，由uiOriginalCRC保证内容正确。
+			SingleFile_RawDeflate = 0x4,
+			//文件按块独立压缩，每块是一个完整的压缩流（格式由SingleFile_RawDeflate决定），各块首尾相接，
+			//最后是块索引：每块压缩之后的字节数，souint32。块大小为2的(uiFlags >> SingleFile_BlockShift)次幂，
+			//最后一块可能不满。版本4加入。
+			SingleFile_Blocked = 0x8,
+			SingleFile_BlockShift = 8,
+			SingleFile_BlockShiftMask = 0xFF00,
+		};
+		//写入时压缩数据的格式。
+		enum CompressFormat
+		{
+			//zlib格式，解压缩时zlib总是计算adler32。
+			Compress_Zlib,
+			//raw deflate，不计算adler32，读取时是否检查由ReadVerify决定。
+			Compress_RawDeflate,
+		};
+		//读取时检查uiOriginalCRC的方式。只检查带有SingleFile_Checksum的原样存储和raw deflate文件，
+		//zlib格式的压缩文件在解压缩时已经由adler32检查过，不再重复计算。
+		enum ReadVerify
+		{
+			//每次从资源包读取都检查，包括内存映射的只读视图。
+			ReadVerify_Always,
+			//打开资源包之后，每个文件只在第一次读取时检查。
+			ReadVerify_FirstTouch,
+			//不检查，用于已经在部署时检查过资源包的环境。
+			ReadVerify_Never,
+		};
+		//Verify的检查程度。
+		enum VerifyLevel
+		{
+			//只读取资源包内的数据，检查uiEmbededCRC，不解压缩。没有校验值的文件被跳过。
+			Verify_Embeded,
+			//同时解压缩，检查uiOriginalCRC和解压缩之后的大小；没有校验值的压缩文件由zlib检查adler32。
+			Verify_Inflate,
+		};
+		//Verify的统计。
+		struct stVerifyStats
+		{
+			//检查过的文件个数，以及读取的字节数。
+			soint64 nCheckedCount;
+			soint64 nCheckedBytes;
+			//没有校验值、无法检查的文件个数。
+			soint64 nSkippedCount;
+			//损坏的文件个数。
+			soint64 nBadCount;
+
+			stVerifyStats()
+			{
+				memset(this, 0, sizeof(*this));
+			}
+		};
+		//ExtractAll的统计。
+		struct stExtractStats
+		{
+			//成功解压的文件个数，以及写出的字节数（文件原始大小之和）。
+			soint64 nExtractedCount;
+			soint64 nExtractedBytes;
+			//其中在内核中直接复制的原样存储的文件个数。
+			soint64 nKernelCopyCount;
+			//失败的文件个数。
+			soint64 nFailedCount;
+
+			stExtractStats()
+			{
+				memset(this, 0, sizeof(*this));
+			}
 		};
 		//资源包文件头。
 		struct stPackageHead
@@ -91,6 +202,12 @@ namespace GGUI
 			souint32 uiHashA;
 			souint32 uiHashB;
 			souint32 uiHashC;
+			//SingleFileFlag的组合。版本1的资源包中为0。
+			souint32 uiFlags;
+			//资源包内的数据（压缩之后）和文件原始内容的SoHash_CRC32C。版本3加入。
+			//原样存储的文件两者相同。
+			souint32 uiEmbededCRC;
+			souint32 uiOriginalCRC;
 
 			stSingleFileInfo()
 			{
@@ -124,8 +241,13 @@ namespace GGUI
 			//如果资源包内对SingleFile做了压缩操作，则pFileBuff存储解压之后的原始文件，
 			//才能向外界提供对SingleFile的读操作。
 			char* pFileBuff;
+			//申请pFileBuff使用的分配器，为0表示使用资源包的分配器。由外界指定，Clear时保持不变。
+			//例如指定一个SoAllocator_Arena，一帧内读取的所有文件可以一次性释放。
+			SoAllocator* pAllocator;
+			//实际申请pFileBuff的分配器，由资源包设置。
+			SoAllocator* pBuffAllocator;
 
-			stReadSingleFile():nFileID(-1),nFileSize(0),nFilePointer(0),pFileBuff(0)
+			stReadSingleFile():nFileID(-1),nFileSize(0),nFilePointer(0),pFileBuff(0),pAllocator(0),pBuffAllocator(0)
 			{
 			}
 			void Clear()
@@ -135,17 +257,231 @@ namespace GGUI
 				nFilePointer = 0;
 				if (pFileBuff)
 				{
-					free(pFileBuff);
+					if (pBuffAllocator)
+					{
+						pBuffAllocator->Free(pFileBuff);
+					}
+					else
+					{
+						free(pFileBuff);
+					}
 					pFileBuff = 0;
 				}
+				pBuffAllocator = 0;
+			}
+		};
+
+		enum ViewType
+		{
+			View_None,
+			//没有压缩的文件，直接指向资源包的内存映射。
+			View_Mapped,
+			//引用文件缓存中解压缩之后的内容。
+			View_Cached,
+			//文件缓存放不下，视图独占一块解压缩之后的内存。
+			View_Owned,
+		};
+		//文件内容的只读视图。
+		struct stFileView
+		{
+			//文件内容。文件大小为0时也不是空指针。
+			const char* pData;
+			soint64 nSize;
+			soint64 nFileID;
+			//以下成员由ReleaseView使用，外界不要修改。
+			ViewType eType;
+			void* pHandle;
+
+			stFileView():pData(0),nSize(0),nFileID(-1),eType(View_None),pHandle(0)
+			{
+			}
+		};
+		//预读取的程度。
+		enum PrefetchDepth
+		{
+			//只提示操作系统把压缩数据读入系统缓存。
+			Prefetch_ReadAhead,
+			//在后台读取并解压缩，放入文件缓存。之后Read该文件时直接从文件缓存中复制。
+			Prefetch_Decompress,
+		};
+		//访问预测的效果统计。字节数都是文件的原始大小。
+		struct stPredictorStats
+		{
+			//根据预测发出的预读取。
+			soint64 nIssued;
+			soint64 nIssuedBytes;
+			//读取时预读取的文件已经在文件缓存中。
+			soint64 nHit;
+			soint64 nHitBytes;
+			//读取时预读取还没有完成。
+			soint64 nLateHit;
+			//预读取的文件在被读取之前就被淘汰了，或者预读取失败、被取消。
+			soint64 nWasted;
+			soint64 nWastedBytes;
+
+			stPredictorStats()
+			{
+				memset(this, 0, sizeof(*this));
+			}
+		};
+		//临时缓存（读取压缩数据、写入时读取源文件和存放压缩结果的缓存）的统计。
+		struct stScratchStats
+		{
+			//所有线程的临时缓存当前占用的字节数，以及历史最大值。
+			soint64 nCurrentBytes;
+			soint64 nPeakBytes;
+			//临时缓存放不下、分块流式读写的文件个数。
+			soint64 nStreamCount;
+			//临时缓存被释放的次数，包括使用后立即释放、闲置超时释放和TrimScratch。
+			soint64 nShrinkCount;
+
+			stScratchStats()
+			{
+				memset(this, 0, sizeof(*this));
+			}
+		};
+		//延迟直方图记录的操作。
+		enum LatencyOp
+		{
+			//Open查找文件。
+			Latency_Open,
+			//第一次Read，需要读取并解压缩文件。
+			Latency_FirstRead,
+			//之后的Read，只是内存复制。
+			Latency_Read,
+			//一次读取资源包的操作。
+			Latency_IO,
+			//解压缩一个文件。
+			Latency_Inflate,
+			Latency_Count,
+		};
+		//延迟直方图按文件的原始大小分组。
+		enum SizeClass
+		{
+			//小于16KB。
+			Size_Tiny,
+			//小于256KB。
+			Size_Small,
+			//小于4MB。
+			Size_Medium,
+			//不小于4MB。
+			Size_Large,
+			Size_Count,
+		};
+		//内置的性能计数器，一直开启。每个线程只累加自己的计数器，GetStats时汇总。
+		//所有成员都是soint64，时间的单位为纳秒。
+		struct stStats
+		{
+			//Open的次数，以及其中文件不存在的次数。
+			soint64 nOpenCount;
+			soint64 nMissCount;
+			//Open在哈希表中探测的位置个数之和，除以nOpenCount即平均探测长度。
+			soint64 nProbeCount;
+			//读取资源包的次数和字节数，不包括内存映射和文件缓存。
+			soint64 nDiskReadCount;
+			soint64 nDiskReadBytes;
+			//写入资源包的次数和字节数。
+			soint64 nDiskWriteCount;
+			soint64 nDiskWriteBytes;
+			//解压缩得到的字节数，以及花费的时间。
+			soint64 nInflateBytes;
+			soint64 nInflateTime;
+			//等待锁的时间（文件缓存的锁、临时缓存和异步读取的锁），只统计锁被其他线程占用的情况。
+			soint64 nLockWaitTime;
+			//临时缓存重新申请的次数。
+			soint64 nScratchResizeCount;
+			//读取时在文件缓存中找到和没有找到的次数。
+			soint64 nCacheHitCount;
+			soint64 nCacheMissCount;
+			//读取时按ReadVerify计算校验值的字节数。
+			soint64 nChecksumBytes;
+			//并行解压缩的分块压缩文件个数，以及其中由线程池的线程解压缩的块数。
+			soint64 nParallelInflateCount;
+			soint64 nParallelInflateBlocks;
+
+			stStats()
+			{
+				memset(this, 0, sizeof(*this));
 			}
 		};
+		//异步读取完成时的回调。eResult为Result_OK时，theFile.pFileBuff中已经是文件内容，
+		//可以直接调用Read；请求被取消时eResult为Result_Cancelled。
+		typedef void (*AsyncCallback)(OperationResult eResult, stReadSingleFile& theFile, void* pUserData);
 
 	public:
 		SoPackageFile();
 		~SoPackageFile();
 		OperationResult InitPackageFile(const char* pszPackageFile, FileMode theFileMode);
 		OperationResult ReleasePackageFile();
+		//指定读写磁盘文件的方式。必须在InitPackageFile之前调用，默认为SoFileIO::Backend_Default。
+		OperationResult SetIOBackend(SoFileIO::Backend eBackend);
+		//指定内存分配器，资源包内部的内存（文件缓冲、临时缓存、SingleFile信息列表、哈希表、
+		//文件缓存、zlib的内部状态、异步请求）都由它申请。必须在InitPackageFile之前调用，为0表示默认的分配器。
+		//pAllocator必须在SoPackageFile对象销毁之后才能销毁。
+		OperationResult SetAllocator(SoAllocator* pAllocator);
+		SoAllocator* GetAllocator() const;
+		//异步读取的并发限制。必须在InitPackageFile之前调用。
+		//uiThreadCount为执行异步读取的线程个数，为0表示与CPU个数相同；
+		//uiMaxPending为同时存在的异步读取请求个数上限，为0表示不限制。
+		OperationResult SetAsyncLimit(souint32 uiThreadCount, souint32 uiMaxPending);
+		//限制某个优先级的异步读取同时执行的个数，为0表示不限制。必须在InitPackageFile之前调用。
+		//默认Priority_High不限制，Priority_Low最多占用一半的异步读取线程。
+		OperationResult SetAsyncPriorityLimit(SoThreadPool::Priority ePriority, souint32 uiMaxRunning);
+		//文件缓存的字节数上限，为0表示不使用文件缓存。必须在InitPackageFile之前调用，默认为64MB。
+		OperationResult SetEntryCacheSize(soint64 nMaxSize);
+		//Mode_Write模式下新写入文件的压缩格式。必须在InitPackageFile之前调用，默认为Compress_Zlib。
+		OperationResult SetCompressFormat(CompressFormat eFormat);
+		//Mode_Read模式下读取时的检查方式。必须在InitPackageFile之前调用，默认为ReadVerify_FirstTouch。
+		OperationResult SetReadVerify(ReadVerify eVerify);
+		//Mode_Write模式下原始大小不小于nMinFileSize的文件按nBlockSize分块，在线程池中并行压缩（SingleFile_Blocked）。
+		//nBlockSize为0表示不分块，否则必须是2的幂，在SoPackageFile_MinBlockSize和SoPackageFile_MaxBlockSize之间。
+		//必须在InitPackageFile之前调用，默认为1MB和4MB。块越小并行度越高，但每块独立压缩，压缩率稍差。
+		OperationResult SetBlockCompress(soint64 nBlockSize, soint64 nMinFileSize);
+		//Mode_Read模式下一次解压缩整个文件时（ReadWholeFile、Read、ReadMany等），原始大小不小于nMinFileSize的
+		//分块压缩文件在线程池中并行解压缩各块，调用者的线程也参与。uiMaxThreads为一个文件最多使用的线程个数
+		//（包括调用者的线程），为0表示与CPU个数相同，为1表示不并行。必须在InitPackageFile之前调用，默认为8MB和0。
+		OperationResult SetParallelInflate(soint64 nMinFileSize, souint32 uiMaxThreads);
+		//启用访问预测，必须在InitPackageFile之前调用，默认不启用。需要文件缓存。
+		//Read、ReadMany、ReadAsync读取文件时记录访问顺序，并在后台预读取最可能被访问的后继文件。
+		//nBudget为已经预读取但还没有被读取的文件的原始大小之和的上限。
+		//统计表保存在"资源包文件名.sopred"中，打开资源包时加载，ReleasePackageFile时保存。
+		OperationResult SetPredictor(bool bEnable, soint64 nBudget);
+		//立即保存访问预测的统计表。
+		OperationResult SavePredictor();
+		void GetPredictorStats(stPredictorStats& theStats) const;
+		//临时缓存的策略，必须在InitPackageFile之前调用。默认为64MB、4MB、10000毫秒。
+		//nMaxBytes为所有线程的临时缓存之和的上限，放不下的文件分块流式读写，每块SoPackageFile_StreamChunkSize字节；
+		//一个线程的临时缓存超过nKeepBytes时，使用完毕立即释放，否则闲置uiIdleMilliseconds之后释放。
+		OperationResult SetScratchLimit(soint64 nMaxBytes, soint64 nKeepBytes, souint32 uiIdleMilliseconds);
+		//立即释放所有线程中没有正在使用的临时缓存。
+		void TrimScratch();
+		void GetScratchStats(stScratchStats& theStats);
+		//从创建对象或者上次ResetStats以来的计数。其他线程可能正在累加，结果不是严格的快照。
+		void GetStats(stStats& theStats);
+		//同时清空延迟直方图。
+		void ResetStats();
+		//从创建对象或者上次ResetStats以来的延迟直方图，单位为纳秒。与stStats一样每个线程记录自己的直方图。
+		void GetLatency(LatencyOp eOp, SizeClass eSize, SoHistogram& theHistogram);
+		//输出所有延迟直方图的次数、平均值和百分位。bJson为false时输出文本表格，单位为微秒；
+		//为true时输出JSON，单位为纳秒。
+		OperationResult DumpLatency(FILE* pFile, bool bJson);
+
+		//<<<<<<<<<<<<<<<< 资源包的结构 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+		//供检查资源包的工具使用，返回的都是副本。
+		OperationResult GetPackageHead(stPackageHead& theHead) const;
+		//资源包内文件的个数，资源包没有打开时为0。
+		soint64 GetFileCount() const;
+		OperationResult GetSingleFileInfo(soint64 nFileID, stSingleFileInfo& theInfo) const;
+		//Mode_Read模式下BuildHashList建立的哈希表的第nSlot个位置，位置的个数与GetFileCount相同。
+		OperationResult GetHashSlot(soint64 nSlot, stHashInfo& theInfo) const;
+		//Mode_Read模式下资源包文件的字节数。
+		soint64 GetPackageFileSize() const;
+		//版本为nVersion的资源包中，一条stSingleFileInfo记录的字节数。
+		static soint64 GetSingleFileInfoSize(soint64 nVersion);
+		//分块压缩的文件的块大小和块个数，其他文件返回0。
+		static soint64 GetBlockSize(const stSingleFileInfo& theFileInfo);
+		static soint64 GetBlockCount(const stSingleFileInfo& theFileInfo);
+		//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 
 		//<<<<<<<<<<<<<<<< 从资源包内读取一个文件 <<<<<<<<<<<<<<<<<<<<<<<<<
 		OperationResult Open(const char* pszFileName, stReadSingleFile& theFile);
@@ -153,18 +489,243 @@ namespace GGUI
 		OperationResult Read(void* pBuff, soint64 nElementSize, soint64 nElementCount, soint64& nActuallyReadCount, stReadSingleFile& theFile);
 		OperationResult Tell(soint64& nFilePos, stReadSingleFile& theFile);
 		OperationResult Seek(soint64 nOffset, SeekOrigin theOrigin, stReadSingleFile& theFile);
+		//把整个文件读入pDest，nCapacity不能小于文件原始大小。nFileID可以由Open得到。
+		//压缩数据读入当前线程的临时缓存，直接解压缩到pDest中，不使用stReadSingleFile::pFileBuff。
+		//多个线程可以同时调用。
+		OperationResult ReadWholeFile(soint64 nFileID, void* pDest, soint64 nCapacity);
+		//批量读取多个文件的内容，这些文件必须已经Open成功。已经读取过的文件会被跳过。
+		//Linux下使用io_uring一次提交所有读请求，其他情况在线程池中读取；解压缩都在线程池中执行。
+		//pResultList可以为0，不为0时必须能容纳nFileCount个元素，记录每个文件的结果。
+		//所有文件都成功时返回Result_OK，否则返回第一个失败的结果。
+		OperationResult ReadMany(stReadSingleFile* pFileList, soint64 nFileCount, OperationResult* pResultList);
+		//检查资源包内所有文件的校验值，uiThreadCount个线程并行读取和检查，为0表示与CPU个数相同。
+		//每个线程按SoPackageFile_VerifyChunkSize分块读取，不使用文件缓存，内存占用与文件大小无关。
+		//pResultList可以为0，不为0时必须能容纳GetFileCount()个元素，记录每个文件的结果；pStats可以为0。
+		//所有文件都正确时返回Result_OK，否则返回FileID最小的损坏文件的结果。
+		OperationResult Verify(souint32 uiThreadCount, VerifyLevel eLevel, OperationResult* pResultList, stVerifyStats* pStats);
+		//把资源包内所有文件解压到pszDestDir目录下，按需创建子目录，已经存在的文件被覆盖。
+		//uiThreadCount个线程并行读取、解压缩和写出，为0表示与CPU个数相同；每个线程按SoPackageFile_ExtractChunkSize分块处理，
+		//不使用文件缓存。原样存储的文件尽量在内核中直接复制（SoFileIO::CopyFrom）。
+		//经过用户态的数据按ReadVerify检查uiOriginalCRC，内核中复制的文件不检查，需要时先调用Verify。
+		//与tar相同，绝对路径的文件名（InsertSingleFile记录的就是磁盘路径）去掉开头的"/"、"\\"和盘符之后放在pszDestDir下。
+		//pResultList和pStats的用法与Verify相同；失败的文件不保留不完整的输出。
+		OperationResult ExtractAll(const char* pszDestDir, souint32 uiThreadCount, OperationResult* pResultList, stExtractStats* pStats);
+		//异步读取一个文件的内容，theFile必须已经Open成功，并且在回调执行之前保持有效。
+		//读取和解压缩在内部的线程池中执行，完成后把pCallback交给pExecutor执行；
+		//pExecutor为0时直接在线程池的线程中执行pCallback，此时不能在回调中调用ReleasePackageFile。
+		//pRequestID可以为0，不为0时返回请求ID，用于CancelAsync。
+		//ePriority为Priority_High的请求总是先于Priority_Low的请求执行；
+		//另外，Read和ReadMany需要从磁盘读取时，暂停开始新的Priority_Low请求。
+		//返回Result_OK之外的结果时请求没有提交，pCallback不会执行。
+		OperationResult ReadAsync(stReadSingleFile& theFile, AsyncCallback pCallback, void* pUserData, SoExecutor* pExecutor, souint32* pRequestID, SoThreadPool::Priority ePriority);
+		//取消一个还没有开始执行的异步读取请求，回调仍然会执行，eResult为Result_Cancelled。
+		OperationResult CancelAsync(souint32 uiRequestID);
+		//取消某个优先级所有还没有开始执行的异步读取请求，返回取消的请求个数。
+		souint32 CancelAsyncByPriority(SoThreadPool::Priority ePriority);
+		//尚未完成的异步读取请求个数，包括正在执行的请求。
+		soint32 GetAsyncQueueDepth() const;
+		//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+
+		//<<<<<<<<<<<<<<<< 只读视图 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+		//获取文件内容的只读视图，不复制文件内容。nFileID可以由Open得到。多个线程可以同时调用。
+		//没有压缩的文件直接指向资源包的内存映射（SoFileIO不支持内存映射时按压缩的文件处理）；
+		//压缩的文件解压缩后放入文件缓存，视图引用文件缓存中的内容，被引用的内容不会被释放。
+		//视图必须在ReleasePackageFile之前用ReleaseView释放。
+		OperationResult AcquireView(soint64 nFileID, stFileView& theView);
+		OperationResult ReleaseView(stFileView& theView);
+		//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+
+		//<<<<<<<<<<<<<<<< 预读取 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+		//告诉资源包哪些文件很快就会被读取。函数立即返回。
+		//Prefetch_Decompress以Priority_Low异步执行，可以用CancelAsyncByPriority取消；
+		//没有文件缓存时与Prefetch_ReadAhead相同。已经在文件缓存中的文件会被跳过。
+		OperationResult Prefetch(const char* const* pszFileNameList, soint64 nFileCount, PrefetchDepth eDepth);
+		OperationResult PrefetchByID(const soint64* pFileIDList, soint64 nFileCount, PrefetchDepth eDepth);
+		//预读取文件名与pszPattern匹配的所有文件。不区分大小写，'\\'与'/'相同；
+		//'*'匹配任意个字符（包括'/'），'?'匹配一个字符。pMatchCount可以为0。
+		OperationResult PrefetchPattern(const char* pszPattern, PrefetchDepth eDepth, soint64* pMatchCount);
+		//按照清单文件预读取，一般在启动时调用。
+		//清单是文本文件，每行一个文件名或者通配符，空行和'#'开头的行被忽略，不存在的文件被忽略。
+		OperationResult WarmUp(const char* pszManifestFile, PrefetchDepth eDepth);
 		//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 
 		//<<<<<<<<<<<<<<<< 把一个磁盘文件写入资源包 <<<<<<<<<<<<<<<<<<<<<<<
 		OperationResult InsertSingleFile(const char* pszDiskFile);
+		//把内存中的nSize个字节作为文件pszFileName写入资源包，不需要先生成磁盘文件。
+		OperationResult InsertSingleFileFromMemory(const char* pszFileName, const void* pData, soint64 nSize);
 		OperationResult FlushPackageFile();
 		//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 
+	private:
+		//临时缓存。为了防止频繁的申请和释放内存，这里维护临时缓存。
+		//Mode_Read模式下每个线程拥有自己的临时缓存，多个线程解压缩时互不干扰。
+		struct stTempBuff
+		{
+			char* pTempBuff_SrcFile;
+			char* pTempBuff_AfterCompress;
+			soint64 nTempBuffMaxSize_SrcFile;
+			soint64 nTempBuffMaxSize_AfterCompress;
+			//当前线程重复使用的zlib解压缩和压缩对象，第一次使用时创建，之后每次使用前Reset。
+			//zlib的压缩对象有几百KB的内部状态，每个文件都创建一次的话，小文件的开销主要在这里。
+			z_stream_s* pInflateStream;
+			z_stream_s* pDeflateStream;
+			//解压缩raw deflate的对象。一个资源包内两种格式可能同时存在，所以与pInflateStream分开。
+			z_stream_s* pRawInflateStream;
+			//上次使用完毕的时间，SoThread_GetMilliseconds。
+			soint64 nLastUseTime;
+			//当前线程上一次访问的FileID，-1表示没有。访问预测按线程记录访问顺序。
+			soint64 nLastAccessFileID;
+			//当前线程的性能计数器和延迟直方图，只有所属线程修改。
+			stStats theStats;
+			SoHistogram theLatency[Latency_Count][Size_Count];
+			//使用缓存期间由所属线程持有，其他线程释放闲置的缓存时使用TryLock，不会释放正在使用的缓存。
+			SoLock theLock;
+			//所有线程的临时缓存串成一个链表，便于统一释放。
+			stTempBuff* pNext;
+
+			stTempBuff()
+			:pTempBuff_SrcFile(0),pTempBuff_AfterCompress(0),nTempBuffMaxSize_SrcFile(0),nTempBuffMaxSize_AfterCompress(0)
+			,pInflateStream(0),pDeflateStream(0),pRawInflateStream(0),nLastUseTime(0),nLastAccessFileID(-1),pNext(0)
+			{
+			}
+		};
+		//ReadMany中一个待读取的文件。
+		struct stReadManyItem
+		{
+			SoPackageFile* pPackage;
+			stReadSingleFile* pFile;
+			OperationResult* pResult;
+			OperationResult eResult;
+			//文件在资源包内的偏移量，用于排序。
+			soint64 nOffset;
+			//io_uring读取到的压缩数据。
+			char* pEmbeded;
+			//处理完毕后Post。
+			SoSemaphore* pDone;
+			//io_uring方式下限制同时存在的pEmbeded个数，处理完毕后Post。
+			SoSemaphore* pSlot;
+			//已经提交给io_uring，尚未完成。
+			bool bInFlight;
+		};
+		//Verify的所有线程共享的状态。
+		struct stVerifyTask
+		{
+			SoPackageFile* pPackage;
+			VerifyLevel eLevel;
+			OperationResult* pResultList;
+			//下一个要检查的FileID，各个线程用原子操作领取。
+			volatile soint64 nNextFileID;
+			volatile soint64 nCheckedCount;
+			volatile soint64 nCheckedBytes;
+			volatile soint64 nSkippedCount;
+			//每个线程结束时Post。
+			SoSemaphore* pDone;
+		};
+		//分块压缩一组块时所有线程共享的状态。
+		struct stBlockTask
+		{
+			SoPackageFile* pPackage;
+			//这一组块的原始数据，各块首尾相接，只有最后一块可能不满。
+			const char* pSrc;
+			soint64 nSrcSize;
+			soint64 nBlockSize;
+			soint64 nBlockCount;
+			//第i块的压缩结果在pDest + i * nDestStride。
+			char* pDest;
+			soint64 nDestStride;
+			//第i块压缩之后的字节数，为0表示压缩失败。
+			souint32* pSizeList;
+			//下一个要压缩的块，各个线程用原子操作领取。
+			volatile soint64 nNextBlock;
+			//每个线程结束时Post。
+			SoSemaphore* pDone;
+		};
+		//并行解压缩一个分块压缩文件时所有线程共享的状态。
+		struct stInflateTask
+		{
+			SoPackageFile* pPackage;
+			const char* pEmbeded;
+			//第i块的压缩数据从pEmbeded + pOffsetList[i]到pEmbeded + pOffsetList[i+1]。
+			const soint64* pOffsetList;
+			char* pDest;
+			soint64 nOriginalFileSize;
+			soint64 nBlockSize;
+			soint64 nBlockCount;
+			bool bRawDeflate;
+			//下一个要解压缩的块，各个线程用原子操作领取。
+			volatile soint64 nNextBlock;
+			//解压缩得到的字节数，以及线程池的线程解压缩的块数。
+			volatile soint64 nProduced;
+			volatile soint64 nPoolBlocks;
+			//第一个失败的块的结果，有块失败之后其他线程不再领取新的块。
+			volatile soint32 nResult;
+			//每个线程结束时Post。
+			SoSemaphore* pDone;
+		};
+		//ExtractAll的所有线程共享的状态。
+		struct stExtractTask
+		{
+			SoPackageFile* pPackage;
+			const char* pszDestDir;
+			OperationResult* pResultList;
+			//下一个要解压的FileID，各个线程用原子操作领取。
+			volatile soint64 nNextFileID;
+			volatile soint64 nExtractedCount;
+			volatile soint64 nExtractedBytes;
+			volatile soint64 nKernelCopyCount;
+			//每个线程结束时Post。
+			SoSemaphore* pDone;
+		};
+		enum AsyncState
+		{
+			Async_Pending,
+			Async_Running,
+			Async_Cancelled,
+		};
+		//一个异步读取请求。
+		struct stAsyncRequest
+		{
+			souint32 uiRequestID;
+			SoPackageFile* pPackage;
+			//申请这个请求的分配器。回调可能在资源包释放之后才执行，不能再经过pPackage。
+			SoAllocator* pAllocator;
+			stReadSingleFile* pFile;
+			AsyncCallback pCallback;
+			void* pUserData;
+			SoExecutor* pExecutor;
+			SoThreadPool::Priority ePriority;
+			//AsyncState，使用原子操作修改。
+			volatile soint32 nState;
+			OperationResult eResult;
+			//尚未完成的请求串成一个双向链表，用于CancelAsync查找。
+			stAsyncRequest* pPrev;
+			stAsyncRequest* pNext;
+		};
+
 	private:
 		//写入资源包文件头。
 		OperationResult WritePackageHead();
+		//所有写入资源包的操作都经过这里，以便统计写入的次数和字节数。返回实际写入的字节数。
+		soint64 WritePackageData(const void* pBuff, soint64 nSize, soint64 nOffset);
+		//格式化文件名并计算哈希值，检查是否与已经写入的文件重名。
+		OperationResult PrepareSingleFileInfo(const char* pszFileName, stSingleFileInfo& theFileInfo);
+		//从pSingleFile读取内容写入资源包，并记录theFileInfo。
+		OperationResult AppendSingleFile(SoFileIO* pSingleFile, stSingleFileInfo& theFileInfo);
 		//把一个原始的SingleFile写入到资源包中。
-		OperationResult WriteSingleFile(FILE* pSingleFile, stSingleFileInfo& theFileInfo);
+		OperationResult WriteSingleFile(SoFileIO* pSingleFile, stSingleFileInfo& theFileInfo);
+		//源文件整个读入临时缓存，压缩之后写入资源包。
+		OperationResult WriteSingleFile_Buffered(SoFileIO* pSingleFile, stSingleFileInfo& theFileInfo, stTempBuff* pTempBuff);
+		//临时缓存放不下源文件时，分块读取源文件、压缩并写入资源包。
+		OperationResult WriteSingleFile_Streamed(SoFileIO* pSingleFile, stSingleFileInfo& theFileInfo, stTempBuff* pTempBuff);
+		//大文件按m_nBlockSize分块，一组一组地读入临时缓存，在线程池中并行压缩，按顺序写入资源包。
+		OperationResult WriteSingleFile_Blocked(SoFileIO* pSingleFile, stSingleFileInfo& theFileInfo, stTempBuff* pTempBuff, soint64 nGroupCount);
+		//在临时缓存的上限之内为分块压缩准备缓存，返回一组的块数，连一块都放不下时返回0。
+		soint64 ReserveBlockGroup(stTempBuff* pTempBuff, soint64 nOriginalFileSize);
+		//压缩没有收益时把源文件原样复制到资源包，覆盖已经写入的压缩数据。
+		OperationResult WriteSingleFile_Stored(SoFileIO* pSingleFile, stSingleFileInfo& theFileInfo, stTempBuff* pTempBuff);
+		static void BlockTask_Run(void* pParam);
+		//领取并压缩theTask中的块，直到没有剩下的块。pTempBuff为0时使用当前线程的临时缓存。
+		void CompressBlocks(stBlockTask& theTask, stTempBuff* pTempBuff);
 		//把stSingleFileInfo信息集合写入到资源包中。
 		OperationResult WriteAllSingleFileInfo();
 		//解析资源包，即提取资源包已有的文件结构信息。
@@ -174,15 +735,137 @@ namespace GGUI
 
 		void ReCreateSingleFileInfoList(soint64 nCapacity);
 		void ReleaseSingleFileInfoList();
-		void TryResizeTempBuff_SrcFile(soint64 nDestSize);
-		void TryResizeTempBuff_AfterCompress(soint64 nDestSize);
+		//获取当前线程的临时缓存，第一次调用时创建。
+		stTempBuff* GetTempBuff();
+		//获取当前线程的临时缓存并加锁，使用完毕后调用EndUseTempBuff。
+		stTempBuff* BeginUseTempBuff();
+		//解锁，按照临时缓存的策略释放过大的缓存，并顺便释放其他线程闲置的缓存。
+		void EndUseTempBuff(stTempBuff* pTempBuff);
+		//释放所有线程的临时缓存占用的内存。
+		//bDeleteAll为false时只释放缓存内存，stTempBuff对象仍然保留，因为线程局部存储里还记录着它们。
+		void ReleaseTempBuff(bool bDeleteAll);
+		//释放闲置超过nIdleMilliseconds的临时缓存，跳过正在使用的。
+		void TrimTempBuff(soint64 nIdleMilliseconds);
+		//当前线程的性能计数器。
+		stStats& GetThreadStats();
+		//汇总所有线程的性能计数器，没有减去m_stStatsBase。
+		void SumStats(stStats& theStats);
+		//汇总所有线程的一个延迟直方图，没有减去m_LatencyBase。
+		void SumLatency(LatencyOp eOp, SizeClass eSize, SoHistogram& theHistogram);
+		//把nElapsed纳秒记录到当前线程的直方图，nFileSize为文件的原始大小。
+		void RecordLatency(LatencyOp eOp, soint64 nFileSize, soint64 nElapsed);
+		static SizeClass GetSizeClass(soint64 nFileSize);
+		//释放一个线程的pTempBuff_SrcFile和pTempBuff_AfterCompress。
+		void FreeTempBuff(stTempBuff* pTempBuff);
+		//保证pBuff至少能容纳nDestSize个字节，原有内容不保留。
+		//bForce为false时，如果扩大之后超过临时缓存的上限则不扩大，返回false。
+		bool ResizeTempBuff(char*& pBuff, soint64& nCapacity, soint64 nDestSize, bool bForce);
+		//获取当前线程的zlib对象，已经Reset，可以直接使用。失败返回0。
+		//bRawDeflate对应SingleFile_RawDeflate；压缩对象的格式由m_eCompressFormat决定。
+		z_stream_s* GetInflateStream(stTempBuff* pTempBuff, bool bRawDeflate);
+		z_stream_s* GetDeflateStream(stTempBuff* pTempBuff);
+		//用pStream把内存中的压缩数据一次性解压缩到pOut中，超过z_stream的32位限制时分段提供输入和输出。
+		//返回值与uncompress一致：Z_OK，输出缓存不够为Z_BUF_ERROR，数据不完整为Z_DATA_ERROR。nProduced返回输出的字节数。
+		static int InflateBuffer(z_stream_s* pStream, const char* pIn, soint64 nInSize, char* pOut, soint64 nOutSize, soint64& nProduced);
+		//分块压缩的文件由多个压缩流首尾相接，流式解压缩时inflate返回Z_STREAM_END之后，如果还有后续的块，
+		//重置pStream并把nResult改为Z_OK。nOutSize为到目前为止解压缩得到的字节数，不在块的边界上时返回false。
+		static bool ContinueNextBlock(z_stream_s* pStream, const stSingleFileInfo& theFileInfo, soint64 nOutSize, int& nResult);
+		//把内存中分块压缩的数据pEmbeded解压缩到pDest中，逐块检查块索引和每块的大小。
+		//文件足够大时按m_uiParallelInflateThreads在m_pInflateThreadPool中并行解压缩。
+		OperationResult UncompressBlocks(const stSingleFileInfo& theFileInfo, const char* pEmbeded, char* pDest, z_stream_s* pStream, soint64& nProduced);
+		static void InflateTask_Run(void* pParam);
+		//领取并解压缩theTask中的块，直到没有剩下的块或者有块失败。bPoolThread表示是否在线程池的线程中。
+		void InflateBlocks(stInflateTask& theTask, z_stream_s* pStream, bool bPoolThread);
+		//读取到文件的原始内容之后，按照m_eReadVerify检查uiOriginalCRC。theFileInfo必须是m_pSingleFileInfoList中的元素。
+		OperationResult CheckReadChecksum(const stSingleFileInfo& theFileInfo, const char* pData);
+		//zlib内部的内存申请，opaque为SoPackageFile对象。
+		static void* ZAlloc(void* pOpaque, unsigned int uiItems, unsigned int uiSize);
+		static void ZFree(void* pOpaque, void* pAddress);
+		//读取并解压缩一个文件，结果存放在theFile.pFileBuff中。
+		OperationResult LoadSingleFile(stReadSingleFile& theFile);
+		//为theFile.pFileBuff申请内存，使用theFile指定的分配器。
+		char* AllocFileBuff(stReadSingleFile& theFile, soint64 nSize);
+		//如果文件在文件缓存中，则复制到新申请的theFile.pFileBuff中。
+		bool CopyFromEntryCache(stReadSingleFile& theFile);
+		//读取并解压缩一个文件，结果存放在pDest中，pDest至少能容纳文件原始大小。
+		OperationResult LoadSingleFileTo(const stSingleFileInfo& theFileInfo, char* pDest);
+		//临时缓存放不下压缩数据时，分块读取并解压缩。
+		OperationResult LoadSingleFileTo_Streamed(const stSingleFileInfo& theFileInfo, char* pDest, stTempBuff* pTempBuff);
+		//把压缩数据pEmbeded解压缩到新申请的theFile.pFileBuff中，没有压缩的文件直接复制。
+		OperationResult UncompressSingleFile(const stSingleFileInfo& theFileInfo, const char* pEmbeded, stReadSingleFile& theFile);
+		OperationResult UncompressTo(const stSingleFileInfo& theFileInfo, const char* pEmbeded, char* pDest);
+		void ReadManyWithIOUring(SoIOUring& theRing, stReadManyItem* pItemList, soint64 nItemCount, SoThreadPool* pThreadPool);
+		static void ReadManyTask_Load(void* pParam);
+		static void ReadManyTask_Uncompress(void* pParam);
+		static void ReadManyTask_Finish(stReadManyItem* pItem);
+		static int CompareReadManyItem(const void* pLeft, const void* pRight);
+		static void VerifyTask_Run(void* pParam);
+		//检查一个文件。bChecked返回是否真正做了检查，没有校验值的文件可能被跳过；nReadBytes返回读取的字节数。
+		OperationResult VerifySingleFile(const stSingleFileInfo& theFileInfo, VerifyLevel eLevel, stTempBuff* pTempBuff, bool& bChecked, soint64& nReadBytes);
+		static void ExtractTask_Run(void* pParam);
+		//把一个文件写入已经打开的pOutFile。bKernelCopy返回是否在内核中复制了文件内容。
+		OperationResult ExtractSingleFile(const stSingleFileInfo& theFileInfo, SoFileIO* pOutFile, stTempBuff* pTempBuff, bool& bKernelCopy);
+		//返回文件名中拼接在目标目录之后的部分：去掉开头的"/"、"\\"和盘符。
+		//剩下的部分为空、包含".."这一级目录或者":"时返回0。
+		static const char* GetExtractPath(const char* pszFileName);
+		static void AsyncTask_Read(void* pParam);
+		static void AsyncTask_Callback(void* pParam);
+		//把请求从m_pAsyncRequestList中移除，并减少m_nAsyncPending。
+		void UnlinkAsyncRequest(stAsyncRequest* pRequest);
+		//取消所有尚未开始执行的异步读取请求。
+		void CancelAllAsync();
+		//结束所有线程池。已经提交的任务会先执行完毕。
+		void ReleaseThreadPool();
+		//预读取完成后把文件放入文件缓存。
+		static void PrefetchCallback(OperationResult eResult, stReadSingleFile& theFile, void* pUserData);
+		//<<<<<<<<<<<<<<<< 访问预测 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+		//m_pSpeculativeState中每个文件的状态。
+		enum SpeculativeState
+		{
+			Speculative_None,
+			//预测预读取已经发出，尚未完成。
+			Speculative_Loading,
+			//预测预读取的文件已经在文件缓存中，尚未被读取。
+			Speculative_Cached,
+		};
+		void InitPredictor(const char* pszPackageFile);
+		void ReleasePredictor();
+		//记录一次前台读取。bSpeculate为true时根据预测发出预读取。
+		void RecordAccess(soint64 nFileID, bool bSpeculate);
+		void IssueSpeculative(soint64 nFileID);
+		static void SpeculativeCallback(OperationResult eResult, stReadSingleFile& theFile, void* pUserData);
+		static void OnEntryEvicted(soint64 nFileID, soint64 nSize, void* pUserData);
+		//预读取使用的stReadSingleFile由m_pAllocator申请，回调中释放。
+		stReadSingleFile* AllocReadSingleFile(soint64 nFileID, soint64 nFileSize);
+		void FreeReadSingleFile(stReadSingleFile* pFile);
+		//如果文件的状态为eFrom，则修改为eTo，并且从预测预读取的占用中扣除。返回是否修改成功。
+		bool ReleaseSpeculative(soint64 nFileID, SpeculativeState eFrom, SpeculativeState eTo);
+		//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+		//收集文件名与pszPattern（已经格式化）匹配的所有文件。
+		bool CollectPattern(const char* pszPattern, soint64*& pFileIDList, soint64& nFileCount, soint64& nCapacity);
+		bool AppendFileID(soint64*& pFileIDList, soint64& nFileCount, soint64& nCapacity, soint64 nFileID);
+		static bool MatchPattern(const char* pszPattern, const char* pszName);
+		//前台读取开始时暂停后台的低优先级任务，返回被暂停的线程池，结束时传给EndForegroundRead。
+		SoThreadPool* BeginForegroundRead();
+		void EndForegroundRead(SoThreadPool* pThreadPool);
+		//获取线程池，第一次调用时创建。
+		SoThreadPool* GetThreadPool();
+		SoThreadPool* GetAsyncThreadPool();
+		SoThreadPool* GetInflateThreadPool();
 		soint64 AssignSingleFileInfo();
-		soint64 GetIndex_SingleFileInfoList(const char* pszFileName);
+		//Mode_Write模式下查找已经写入的文件，不存在返回-1。
+		soint64 FindWrittenFile(souint32 uiHashA, souint32 uiHashB, souint32 uiHashC);
+		//保证m_pWriteIndex可以容纳nFileCount个文件，扩大时重新加入已有的文件。
+		bool ReserveWriteIndex(soint64 nFileCount);
+		void AddWrittenFile(soint64 nFileID);
+		//uiProbeCount返回探测的位置个数。
+		soint64 GetIndex_SingleFileInfoList(souint32 uiHashA, souint32 uiHashB, souint32 uiHashC, souint32& uiProbeCount);
 
 		//把文件名格式化成如下格式：
 		//1，把'\\'修改成'/'；
 		//2，把大写字母修改成小写字母；
-		void FormatFileFullName(char* pszOut, const char* pszIn) const;
+		//同时计算文件名的三个哈希值。返回值为格式化之后的文件名长度。
+		souint32 FormatFileFullName(char* pszOut, const char* pszIn, souint32& uiHashA, souint32& uiHashB, souint32& uiHashC) const;
 		//判断文件头是否合法。合法返回true，不合法返回false。
 		bool CheckValid_PackageHead(const stPackageHead& theHead);
 		////判断SingleFile信息是否合法。合法返回true，不合法返回false。
@@ -190,9 +873,13 @@ namespace GGUI
 
 	private:
 		FileMode m_theFileMode;
-		FILE* m_pFile;
+		SoFileIO::Backend m_eIOBackend;
+		SoAllocator* m_pAllocator;
+		SoFileIO* m_pFile;
 		//文件头。
 		stPackageHead m_stPackageHead;
+		//Mode_Read模式下资源包文件的大小，用于检查内存映射的范围。
+		soint64 m_nPackageFileSize;
 		//SingleFile信息列表。
 		stSingleFileInfo* m_pSingleFileInfoList;
 		//m_pSingleFileInfoList中可以容纳多少个stSingleFileInfo对象。
@@ -200,14 +887,74 @@ namespace GGUI
 		//m_pSingleFileInfoList中有效stSingleFileInfo对象的个数。
 		soint64 m_nSingleFileInfoListSize;
 		//在Mode_Read模式下，帮助快速定位目标文件。
+		//ParsePackageFile执行完毕之后m_pHashList和m_pSingleFileInfoList不再改变，
+		//所以Open查找文件时不需要加锁。
 		stHashInfo* m_pHashList;
-		//为了防止频繁的申请和释放内存，这里维护临时缓存。
-		char* m_pTempBuff_SrcFile;
-		char* m_pTempBuff_AfterCompress;
-		soint64 m_nTempBuffMaxSize_SrcFile;
-		soint64 m_nTempBuffMaxSize_AfterCompress;
-		//多线程锁。
-		CRITICAL_SECTION m_Lock;
+		//Mode_Write模式下检查文件重名的哈希表，线性探测，元素为文件ID加一，0表示空位。
+		//容量为2的幂，装载率不超过一半。
+		souint32* m_pWriteIndex;
+		souint32 m_uiWriteIndexCapacity;
+		//每个线程的临时缓存。
+		SoThreadLocal m_TempBuffTLS;
+		//所有线程的临时缓存链表。
+		stTempBuff* m_pTempBuffList;
+		//保护m_pTempBuffList，在线程第一次创建临时缓存和释放闲置的缓存时使用。
+		SoLock m_TempBuffListLock;
+		//临时缓存的策略和统计，m_ScratchLock保护m_stScratchStats的nCurrentBytes和nPeakBytes。
+		soint64 m_nScratchMaxBytes;
+		soint64 m_nScratchKeepBytes;
+		soint64 m_nScratchIdleTime;
+		//下一次检查闲置缓存的时间。
+		volatile soint64 m_nScratchTrimTime;
+		stScratchStats m_stScratchStats;
+		SoLock m_ScratchLock;
+		//ResetStats时的计数和延迟直方图，GetStats和GetLatency返回与它们的差。
+		stStats m_stStatsBase;
+		SoHistogram m_LatencyBase[Latency_Count][Size_Count];
+		//等待资源包自己的锁的时间，只在锁被占用时累加，不需要分线程。
+		volatile soint64 m_nLockWaitTime;
+		//ReadMany使用的线程池。
+		SoThreadPool* m_pThreadPool;
+		//ReadAsync使用的线程池。与ReadMany分开，避免在异步回调中调用ReadMany时互相等待。
+		SoThreadPool* m_pAsyncThreadPool;
+		//分块并行解压缩使用的线程池。其中的任务只解压缩，不会等待其他任务，
+		//所以ReadMany和ReadAsync的线程也可以把块交给它并等待结果。
+		SoThreadPool* m_pInflateThreadPool;
+		SoLock m_ThreadPoolLock;
+		souint32 m_uiAsyncThreadCount;
+		souint32 m_uiAsyncMaxPending;
+		//每个优先级同时执行的异步读取个数上限。
+		souint32 m_uiAsyncMaxRunning[SoThreadPool::Priority_Count];
+		//尚未完成的异步读取请求。
+		stAsyncRequest* m_pAsyncRequestList;
+		volatile soint32 m_nAsyncPending;
+		volatile soint32 m_nAsyncRequestID;
+		SoLock m_AsyncLock;
+		//解压缩之后的文件缓存，Mode_Read模式下使用。
+		SoEntryCache m_EntryCache;
+		soint64 m_nEntryCacheMaxSize;
+		CompressFormat m_eCompressFormat;
+		//分块压缩的块大小（为0表示不分块）和文件大小的下限。
+		soint64 m_nBlockSize;
+		soint64 m_nBlockMinFileSize;
+		//并行解压缩的文件大小下限和每个文件的线程个数上限。
+		soint64 m_nParallelInflateMinSize;
+		souint32 m_uiParallelInflateThreads;
+		ReadVerify m_eReadVerify;
+		//ReadVerify_FirstTouch时每个文件是否已经检查过，检查通过之后置为1。
+		//多个线程可能同时检查同一个文件，结果相同，不需要加锁。
+		volatile char* m_pVerifiedList;
+		//访问预测。
+		SoAccessPredictor m_Predictor;
+		bool m_bPredictorEnable;
+		soint64 m_nPredictorBudget;
+		//统计表的文件名。
+		char* m_pszPredictorFile;
+		//每个文件的SpeculativeState，为0表示没有启用访问预测。
+		volatile soint32* m_pSpeculativeState;
+		//已经预读取但还没有被读取的文件的原始大小之和。
+		volatile soint64 m_nSpeculativeBytes;
+		stPredictorStats m_stPredictorStats;
 	};
 }
 //-----------------------------------------------------------------------------
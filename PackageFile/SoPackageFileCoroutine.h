@@ -0,0 +1,88 @@
+﻿//-----------------------------------------------------------------------------
+// SoPackageFileCoroutine
+// (C) oil
+// 2013-10-23
+//
+// SoPackageFile::ReadAsync的C++20协程封装。编译器不支持协程时这个文件为空。
+// 用法：
+//     SoPackageFile::stReadSingleFile theFile;
+//     thePackage.Open("ui/main.png", theFile);
+//     SoPackageFile::OperationResult eResult = co_await SoCoReadAsync(thePackage, theFile, pExecutor, SoThreadPool::Priority_High);
+// 协程在pExecutor中恢复执行；pExecutor为0时在SoPackageFile内部的线程池中恢复执行。
+//-----------------------------------------------------------------------------
+#ifndef _SoPackageFileCoroutine_h_
+#define _SoPackageFileCoroutine_h_
+//-----------------------------------------------------------------------------
+#include "SoPackageFile.h"
+//-----------------------------------------------------------------------------
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+	#if __has_include(<coroutine>)
+		#define SoPackageFile_EnableCoroutine
+	#endif
+#endif
+//-----------------------------------------------------------------------------
+#if defined(SoPackageFile_EnableCoroutine)
+#include <coroutine>
+namespace GGUI
+{
+	class SoReadAwaiter
+	{
+	public:
+		SoReadAwaiter(SoPackageFile& thePackage, SoPackageFile::stReadSingleFile& theFile, SoExecutor* pExecutor, SoThreadPool::Priority ePriority)
+		:m_pPackage(&thePackage)
+		,m_pFile(&theFile)
+		,m_pExecutor(pExecutor)
+		,m_ePriority(ePriority)
+		,m_eResult(SoPackageFile::Result_OK)
+		{
+		}
+		bool await_ready() const
+		{
+			//文件内容已经读取过了，不需要挂起。
+			return (m_pFile->pFileBuff != 0);
+		}
+		bool await_suspend(std::coroutine_handle<> hHandle)
+		{
+			m_hHandle = hHandle;
+			//提交成功之后回调随时可能在其他线程中恢复协程，所以不能再访问成员变量。
+			SoPackageFile::OperationResult eResult = m_pPackage->ReadAsync(*m_pFile, OnComplete, this, m_pExecutor, 0, m_ePriority);
+			if (eResult != SoPackageFile::Result_OK)
+			{
+				//提交失败，不挂起，await_resume返回失败原因。
+				m_eResult = eResult;
+				return false;
+			}
+			return true;
+		}
+		SoPackageFile::OperationResult await_resume() const
+		{
+			return m_eResult;
+		}
+
+	private:
+		static void OnComplete(SoPackageFile::OperationResult eResult, SoPackageFile::stReadSingleFile& /*theFile*/, void* pUserData)
+		{
+			SoReadAwaiter* pThis = (SoReadAwaiter*)pUserData;
+			pThis->m_eResult = eResult;
+			pThis->m_hHandle.resume();
+		}
+
+	private:
+		SoPackageFile* m_pPackage;
+		SoPackageFile::stReadSingleFile* m_pFile;
+		SoExecutor* m_pExecutor;
+		SoThreadPool::Priority m_ePriority;
+		SoPackageFile::OperationResult m_eResult;
+		std::coroutine_handle<> m_hHandle;
+	};
+	//-----------------------------------------------------------------------------
+	//co_await的结果为SoPackageFile::OperationResult。theFile必须已经Open成功。
+	inline SoReadAwaiter SoCoReadAsync(SoPackageFile& thePackage, SoPackageFile::stReadSingleFile& theFile, SoExecutor* pExecutor = 0, SoThreadPool::Priority ePriority = SoThreadPool::Priority_High)
+	{
+		return SoReadAwaiter(thePackage, theFile, pExecutor, ePriority);
+	}
+}
+#endif //SoPackageFile_EnableCoroutine
+//-----------------------------------------------------------------------------
+#endif //_SoPackageFileCoroutine_h_
+//-----------------------------------------------------------------------------
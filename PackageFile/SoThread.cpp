@@ -0,0 +1,395 @@
+﻿//-----------------------------------------------------------------------------
+// SoThread
+// (C) oil
+// 2013-10-20
+//-----------------------------------------------------------------------------
+#include "SoThread.h"
+#include "SoTrace.h"
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <time.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	//-----------------------------------------------------------------------------
+	SoLock::SoLock()
+	{
+#if defined(_WIN32)
+		InitializeCriticalSection(&m_Lock);
+#else
+		//与CRITICAL_SECTION保持一致，同一个线程可以重复加锁。
+		pthread_mutexattr_t theAttr;
+		pthread_mutexattr_init(&theAttr);
+		pthread_mutexattr_settype(&theAttr, PTHREAD_MUTEX_RECURSIVE);
+		pthread_mutex_init(&m_Lock, &theAttr);
+		pthread_mutexattr_destroy(&theAttr);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	SoLock::~SoLock()
+	{
+#if defined(_WIN32)
+		DeleteCriticalSection(&m_Lock);
+#else
+		pthread_mutex_destroy(&m_Lock);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	void SoLock::Lock()
+	{
+#if defined(_WIN32)
+		EnterCriticalSection(&m_Lock);
+#else
+		pthread_mutex_lock(&m_Lock);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	void SoLock::Unlock()
+	{
+#if defined(_WIN32)
+		LeaveCriticalSection(&m_Lock);
+#else
+		pthread_mutex_unlock(&m_Lock);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	bool SoLock::TryLock()
+	{
+#if defined(_WIN32)
+		return (TryEnterCriticalSection(&m_Lock) != FALSE);
+#else
+		return (pthread_mutex_trylock(&m_Lock) == 0);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	SoTimedAutoLock::SoTimedAutoLock(SoLock& theLock, volatile soint64* pWaitTime)
+	:m_Lock(theLock)
+	{
+		if (!m_Lock.TryLock())
+		{
+			const soint64 nStart = SoThread_GetNanoseconds();
+			m_Lock.Lock();
+			const soint64 nEnd = SoThread_GetNanoseconds();
+			SoAtomic_Add64(pWaitTime, nEnd - nStart);
+			SoTrace_Event("LockWait", nStart, nEnd, -1, -1);
+		}
+	}
+	//-----------------------------------------------------------------------------
+	SoThreadLocal::SoThreadLocal()
+	{
+#if defined(_WIN32)
+		m_dwIndex = TlsAlloc();
+#else
+		pthread_key_create(&m_Key, 0);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	SoThreadLocal::~SoThreadLocal()
+	{
+#if defined(_WIN32)
+		TlsFree(m_dwIndex);
+#else
+		pthread_key_delete(m_Key);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	void* SoThreadLocal::GetValue() const
+	{
+#if defined(_WIN32)
+		return TlsGetValue(m_dwIndex);
+#else
+		return pthread_getspecific(m_Key);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	void SoThreadLocal::SetValue(void* pValue)
+	{
+#if defined(_WIN32)
+		TlsSetValue(m_dwIndex, pValue);
+#else
+		pthread_setspecific(m_Key, pValue);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	SoSemaphore::SoSemaphore(soint32 nInitCount)
+	{
+#if defined(_WIN32)
+		m_hSemaphore = CreateSemaphore(0, nInitCount, 0x7FFFFFFF, 0);
+#else
+		//没有使用sem_t，因为有的平台不支持匿名信号量。
+		pthread_mutex_init(&m_Mutex, 0);
+		pthread_cond_init(&m_Cond, 0);
+		m_nCount = nInitCount;
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	SoSemaphore::~SoSemaphore()
+	{
+#if defined(_WIN32)
+		CloseHandle(m_hSemaphore);
+#else
+		pthread_cond_destroy(&m_Cond);
+		pthread_mutex_destroy(&m_Mutex);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	void SoSemaphore::Post()
+	{
+#if defined(_WIN32)
+		ReleaseSemaphore(m_hSemaphore, 1, 0);
+#else
+		pthread_mutex_lock(&m_Mutex);
+		++m_nCount;
+		pthread_cond_signal(&m_Cond);
+		pthread_mutex_unlock(&m_Mutex);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	void SoSemaphore::Wait()
+	{
+#if defined(_WIN32)
+		WaitForSingleObject(m_hSemaphore, INFINITE);
+#else
+		pthread_mutex_lock(&m_Mutex);
+		while (m_nCount <= 0)
+		{
+			pthread_cond_wait(&m_Cond, &m_Mutex);
+		}
+		--m_nCount;
+		pthread_mutex_unlock(&m_Mutex);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	bool SoSemaphore::TryWait()
+	{
+#if defined(_WIN32)
+		return (WaitForSingleObject(m_hSemaphore, 0) == WAIT_OBJECT_0);
+#else
+		bool br = false;
+		pthread_mutex_lock(&m_Mutex);
+		if (m_nCount > 0)
+		{
+			--m_nCount;
+			br = true;
+		}
+		pthread_mutex_unlock(&m_Mutex);
+		return br;
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	soint32 SoAtomic_Increment(volatile soint32* pValue)
+	{
+#if defined(_WIN32)
+		return (soint32)InterlockedIncrement((volatile LONG*)pValue);
+#else
+		return __sync_add_and_fetch(pValue, 1);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	soint32 SoAtomic_Decrement(volatile soint32* pValue)
+	{
+#if defined(_WIN32)
+		return (soint32)InterlockedDecrement((volatile LONG*)pValue);
+#else
+		return __sync_sub_and_fetch(pValue, 1);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoAtomic_Add64(volatile soint64* pValue, soint64 nDelta)
+	{
+#if defined(_WIN32)
+		return InterlockedExchangeAdd64((volatile LONGLONG*)pValue, nDelta) + nDelta;
+#else
+		return __sync_add_and_fetch(pValue, nDelta);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	soint32 SoAtomic_CompareExchange(volatile soint32* pValue, soint32 nExchange, soint32 nComparand)
+	{
+#if defined(_WIN32)
+		return (soint32)InterlockedCompareExchange((volatile LONG*)pValue, nExchange, nComparand);
+#else
+		return __sync_val_compare_and_swap(pValue, nComparand, nExchange);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoAtomic_CompareExchange64(volatile soint64* pValue, soint64 nExchange, soint64 nComparand)
+	{
+#if defined(_WIN32)
+		return (soint64)InterlockedCompareExchange64((volatile LONGLONG*)pValue, nExchange, nComparand);
+#else
+		return __sync_val_compare_and_swap(pValue, nComparand, nExchange);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	soint32 SoAtomic_Load(const volatile soint32* pValue)
+	{
+#if defined(_WIN32)
+		//VC对volatile变量的读取带有acquire语义。
+		return *pValue;
+#else
+		return __atomic_load_n(pValue, __ATOMIC_ACQUIRE);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	void SoAtomic_Store(volatile soint32* pValue, soint32 nValue)
+	{
+#if defined(_WIN32)
+		InterlockedExchange((volatile LONG*)pValue, nValue);
+#else
+		__atomic_store_n(pValue, nValue, __ATOMIC_RELEASE);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoAtomic_Load64(const volatile soint64* pValue)
+	{
+#if defined(_WIN64)
+		return *pValue;
+#elif defined(_WIN32)
+		//32位程序没有原子的64位读取，用比较交换代替，写入的值与原值相同。
+		return InterlockedCompareExchange64((volatile LONGLONG*)pValue, 0, 0);
+#else
+		return __atomic_load_n(pValue, __ATOMIC_ACQUIRE);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	void SoAtomic_Store64(volatile soint64* pValue, soint64 nValue)
+	{
+#if defined(_WIN32)
+		InterlockedExchange64((volatile LONGLONG*)pValue, nValue);
+#else
+		__atomic_store_n(pValue, nValue, __ATOMIC_RELEASE);
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoThread_GetCPUCount()
+	{
+		souint32 uiCount = 1;
+#if defined(_WIN32)
+		SYSTEM_INFO theInfo;
+		GetSystemInfo(&theInfo);
+		uiCount = (souint32)theInfo.dwNumberOfProcessors;
+#else
+		const long nCount = sysconf(_SC_NPROCESSORS_ONLN);
+		if (nCount > 0)
+		{
+			uiCount = (souint32)nCount;
+		}
+#endif
+		return uiCount > 0 ? uiCount : 1;
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoThread_GetCurrentThreadID()
+	{
+#if defined(_WIN32)
+		return (souint32)GetCurrentThreadId();
+#elif defined(__linux__)
+		return (souint32)syscall(SYS_gettid);
+#else
+		return (souint32)(size_t)pthread_self();
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoThread_GetMilliseconds()
+	{
+		return SoThread_GetMicroseconds() / 1000;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoThread_GetMicroseconds()
+	{
+		return SoThread_GetNanoseconds() / 1000;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoThread_GetNanoseconds()
+	{
+#if defined(_WIN32)
+		//GetTickCount每49天回绕一次，并且精度不够，使用高精度计数器。
+		LARGE_INTEGER theFreq;
+		LARGE_INTEGER theCounter;
+		QueryPerformanceFrequency(&theFreq);
+		QueryPerformanceCounter(&theCounter);
+		//先分成整秒和余数，避免乘以1000000000时溢出。
+		const soint64 nSecond = theCounter.QuadPart / theFreq.QuadPart;
+		const soint64 nRemain = theCounter.QuadPart % theFreq.QuadPart;
+		return nSecond * 1000000000 + nRemain * 1000000000 / theFreq.QuadPart;
+#else
+		struct timespec theTime;
+		clock_gettime(CLOCK_MONOTONIC, &theTime);
+		return (soint64)theTime.tv_sec * 1000000000 + theTime.tv_nsec;
+#endif
+	}
+	//-----------------------------------------------------------------------------
+	SoThread::SoThread()
+	:m_pFunc(0)
+	,m_pParam(0)
+	,m_bRunning(false)
+#if defined(_WIN32)
+	,m_hThread(0)
+#endif
+	{
+	}
+	//-----------------------------------------------------------------------------
+	SoThread::~SoThread()
+	{
+		Join();
+	}
+	//-----------------------------------------------------------------------------
+	bool SoThread::Start(SoThreadFunc pFunc, void* pParam)
+	{
+		if (pFunc == 0 || m_bRunning)
+		{
+			return false;
+		}
+		m_pFunc = pFunc;
+		m_pParam = pParam;
+#if defined(_WIN32)
+		m_hThread = CreateThread(0, 0, ThreadProc, this, 0, 0);
+		m_bRunning = (m_hThread != 0);
+#else
+		m_bRunning = (pthread_create(&m_Thread, 0, ThreadProc, this) == 0);
+#endif
+		return m_bRunning;
+	}
+	//-----------------------------------------------------------------------------
+	void SoThread::Join()
+	{
+		if (!m_bRunning)
+		{
+			return;
+		}
+#if defined(_WIN32)
+		WaitForSingleObject(m_hThread, INFINITE);
+		CloseHandle(m_hThread);
+		m_hThread = 0;
+#else
+		pthread_join(m_Thread, 0);
+#endif
+		m_bRunning = false;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoThread::IsRunning() const
+	{
+		return m_bRunning;
+	}
+	//-----------------------------------------------------------------------------
+#if defined(_WIN32)
+	DWORD WINAPI SoThread::ThreadProc(LPVOID pThis)
+	{
+		SoThread* pThread = (SoThread*)pThis;
+		pThread->m_pFunc(pThread->m_pParam);
+		return 0;
+	}
+#else
+	void* SoThread::ThreadProc(void* pThis)
+	{
+		SoThread* pThread = (SoThread*)pThis;
+		pThread->m_pFunc(pThread->m_pParam);
+		return 0;
+	}
+#endif
+}
+//-----------------------------------------------------------------------------
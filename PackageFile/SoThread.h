@@ -0,0 +1,191 @@
+﻿//-----------------------------------------------------------------------------
+// SoThread
+// (C) oil
+// 2013-10-20
+//
+// 跨平台的线程和同步操作。Windows下使用Win32 API，其他平台使用pthread。
+//-----------------------------------------------------------------------------
+#ifndef _SoThread_h_
+#define _SoThread_h_
+//-----------------------------------------------------------------------------
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "SoBaseTypeDefine.h"
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	//互斥锁。同一个线程可以重复加锁。
+	class SoLock
+	{
+	public:
+		SoLock();
+		~SoLock();
+		void Lock();
+		void Unlock();
+		//锁空闲时加锁并返回true，否则立即返回false。
+		bool TryLock();
+
+	private:
+		//不允许拷贝。
+		SoLock(const SoLock&);
+		SoLock& operator = (const SoLock&);
+
+	private:
+#if defined(_WIN32)
+		CRITICAL_SECTION m_Lock;
+#else
+		pthread_mutex_t m_Lock;
+#endif
+	};
+	//-----------------------------------------------------------------------------
+	//构造时加锁，析构时解锁。
+	class SoAutoLock
+	{
+	public:
+		SoAutoLock(SoLock& theLock):m_Lock(theLock)
+		{
+			m_Lock.Lock();
+		}
+		~SoAutoLock()
+		{
+			m_Lock.Unlock();
+		}
+
+	private:
+		SoAutoLock(const SoAutoLock&);
+		SoAutoLock& operator = (const SoAutoLock&);
+
+	private:
+		SoLock& m_Lock;
+	};
+	//-----------------------------------------------------------------------------
+	//构造时加锁，析构时解锁。锁被其他线程占用时，把等待的纳秒数累加到*pWaitTime。
+	//没有竞争时只多一次TryLock，不读取时间。
+	class SoTimedAutoLock
+	{
+	public:
+		SoTimedAutoLock(SoLock& theLock, volatile soint64* pWaitTime);
+		~SoTimedAutoLock()
+		{
+			m_Lock.Unlock();
+		}
+
+	private:
+		SoTimedAutoLock(const SoTimedAutoLock&);
+		SoTimedAutoLock& operator = (const SoTimedAutoLock&);
+
+	private:
+		SoLock& m_Lock;
+	};
+	//-----------------------------------------------------------------------------
+	//线程局部存储。多个线程通过同一个SoThreadLocal对象保存各自的指针，互不干扰。
+	//线程退出时不会释放指针指向的对象，由使用者负责管理。
+	class SoThreadLocal
+	{
+	public:
+		SoThreadLocal();
+		~SoThreadLocal();
+		void* GetValue() const;
+		void SetValue(void* pValue);
+
+	private:
+		SoThreadLocal(const SoThreadLocal&);
+		SoThreadLocal& operator = (const SoThreadLocal&);
+
+	private:
+#if defined(_WIN32)
+		DWORD m_dwIndex;
+#else
+		pthread_key_t m_Key;
+#endif
+	};
+	//-----------------------------------------------------------------------------
+	//信号量。
+	class SoSemaphore
+	{
+	public:
+		SoSemaphore(soint32 nInitCount);
+		~SoSemaphore();
+		//计数加一，唤醒一个等待的线程。
+		void Post();
+		//等待计数大于0，然后计数减一。
+		void Wait();
+		//计数大于0时减一并返回true，否则立即返回false。
+		bool TryWait();
+
+	private:
+		SoSemaphore(const SoSemaphore&);
+		SoSemaphore& operator = (const SoSemaphore&);
+
+	private:
+#if defined(_WIN32)
+		HANDLE m_hSemaphore;
+#else
+		pthread_mutex_t m_Mutex;
+		pthread_cond_t m_Cond;
+		soint32 m_nCount;
+#endif
+	};
+	//-----------------------------------------------------------------------------
+	//原子操作。返回值为操作之后的新值。
+	soint32 SoAtomic_Increment(volatile soint32* pValue);
+	soint32 SoAtomic_Decrement(volatile soint32* pValue);
+	soint64 SoAtomic_Add64(volatile soint64* pValue, soint64 nDelta);
+	//如果*pValue等于nComparand，则把*pValue修改为nExchange。返回修改之前的值。
+	soint32 SoAtomic_CompareExchange(volatile soint32* pValue, soint32 nExchange, soint32 nComparand);
+	soint64 SoAtomic_CompareExchange64(volatile soint64* pValue, soint64 nExchange, soint64 nComparand);
+	//原子地读取和写入。读取之后的操作不会提前到读取之前，写入之前的操作不会推迟到写入之后。
+	//32位程序中普通的64位读写会分成两次，必须使用SoAtomic_Load64和SoAtomic_Store64。
+	soint32 SoAtomic_Load(const volatile soint32* pValue);
+	void SoAtomic_Store(volatile soint32* pValue, soint32 nValue);
+	soint64 SoAtomic_Load64(const volatile soint64* pValue);
+	void SoAtomic_Store64(volatile soint64* pValue, soint64 nValue);
+	//-----------------------------------------------------------------------------
+	//获取CPU的逻辑核心个数。
+	souint32 SoThread_GetCPUCount();
+	//当前线程的ID，与调试器和性能分析工具中显示的线程ID一致。
+	souint32 SoThread_GetCurrentThreadID();
+	//单调递增的毫秒数、微秒数和纳秒数，只用于计算时间间隔。
+	soint64 SoThread_GetMilliseconds();
+	soint64 SoThread_GetMicroseconds();
+	soint64 SoThread_GetNanoseconds();
+	//-----------------------------------------------------------------------------
+	//线程。
+	typedef void (*SoThreadFunc)(void* pParam);
+	class SoThread
+	{
+	public:
+		SoThread();
+		~SoThread();
+		//启动线程，在新线程中执行pFunc(pParam)。
+		bool Start(SoThreadFunc pFunc, void* pParam);
+		//等待线程结束。
+		void Join();
+		bool IsRunning() const;
+
+	private:
+		SoThread(const SoThread&);
+		SoThread& operator = (const SoThread&);
+#if defined(_WIN32)
+		static DWORD WINAPI ThreadProc(LPVOID pThis);
+#else
+		static void* ThreadProc(void* pThis);
+#endif
+
+	private:
+		SoThreadFunc m_pFunc;
+		void* m_pParam;
+		bool m_bRunning;
+#if defined(_WIN32)
+		HANDLE m_hThread;
+#else
+		pthread_t m_Thread;
+#endif
+	};
+}
+//-----------------------------------------------------------------------------
+#endif //_SoThread_h_
+//-----------------------------------------------------------------------------
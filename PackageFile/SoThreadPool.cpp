@@ -0,0 +1,321 @@
+﻿//-----------------------------------------------------------------------------
+// SoThreadPool
+// (C) oil
+// 2013-10-22
+//-----------------------------------------------------------------------------
+#include "SoThreadPool.h"
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	//-----------------------------------------------------------------------------
+	SoThreadPool::SoThreadPool()
+	:m_pThreadList(0)
+	,m_uiThreadCount(0)
+	,m_nLowSuspendCount(0)
+	,m_TaskSemaphore(0)
+	,m_WaitSemaphore(0)
+	,m_nWaitingWorker(0)
+	{
+		for (int i=0; i<Priority_Count; ++i)
+		{
+			m_pTaskHead[i] = 0;
+			m_pTaskTail[i] = 0;
+			m_nQueueDepth[i] = 0;
+			m_uiRunning[i] = 0;
+			m_uiMaxRunning[i] = 0;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	SoThreadPool::~SoThreadPool()
+	{
+		Stop();
+	}
+	//-----------------------------------------------------------------------------
+	bool SoThreadPool::Start(souint32 uiThreadCount)
+	{
+		if (m_pThreadList || uiThreadCount == 0)
+		{
+			return false;
+		}
+		m_pThreadList = new SoThread[uiThreadCount];
+		for (souint32 i=0; i<uiThreadCount; ++i)
+		{
+			if (!m_pThreadList[i].Start(WorkerProc, this))
+			{
+				break;
+			}
+			++m_uiThreadCount;
+		}
+		if (m_uiThreadCount == 0)
+		{
+			delete [] m_pThreadList;
+			m_pThreadList = 0;
+			return false;
+		}
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	void SoThreadPool::Stop()
+	{
+		if (m_pThreadList == 0)
+		{
+			return;
+		}
+		//每个工作线程一个退出任务，放在低优先级队列的末尾，所以之前提交的任务都会执行完毕。
+		//退出任务不受优先级限制和暂停的影响。
+		for (souint32 i=0; i<m_uiThreadCount; ++i)
+		{
+			AddTask(0, 0, Priority_Low);
+		}
+		for (souint32 i=0; i<m_uiThreadCount; ++i)
+		{
+			m_pThreadList[i].Join();
+		}
+		delete [] m_pThreadList;
+		m_pThreadList = 0;
+		m_uiThreadCount = 0;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoThreadPool::AddTask(TaskFunc pFunc, void* pParam, Priority ePriority)
+	{
+		if (m_pThreadList == 0 || ePriority < 0 || ePriority >= Priority_Count)
+		{
+			return false;
+		}
+		stTask* pTask = new stTask;
+		pTask->pFunc = pFunc;
+		pTask->pParam = pParam;
+		pTask->pNext = 0;
+		m_Lock.Lock();
+		if (m_pTaskTail[ePriority])
+		{
+			m_pTaskTail[ePriority]->pNext = pTask;
+		}
+		else
+		{
+			m_pTaskHead[ePriority] = pTask;
+		}
+		m_pTaskTail[ePriority] = pTask;
+		SoAtomic_Increment(&m_nQueueDepth[ePriority]);
+		//等待中的工作线程可能可以执行这个任务。
+		WakeWaitingWorker(false);
+		m_Lock.Unlock();
+		m_TaskSemaphore.Post();
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoThreadPool::Post(TaskFunc pFunc, void* pParam)
+	{
+		if (pFunc == 0)
+		{
+			//空任务是退出任务，不允许从外部提交。
+			return false;
+		}
+		return AddTask(pFunc, pParam, Priority_High);
+	}
+	//-----------------------------------------------------------------------------
+	void SoThreadPool::SetPriorityLimit(Priority ePriority, souint32 uiMaxRunning)
+	{
+		if (ePriority < 0 || ePriority >= Priority_Count)
+		{
+			return;
+		}
+		SoAutoLock theAutoLock(m_Lock);
+		m_uiMaxRunning[ePriority] = uiMaxRunning;
+		WakeWaitingWorker(true);
+	}
+	//-----------------------------------------------------------------------------
+	void SoThreadPool::SuspendLowPriority()
+	{
+		//前台读取时频繁调用，不加锁。
+		SoAtomic_Increment(&m_nLowSuspendCount);
+	}
+	//-----------------------------------------------------------------------------
+	void SoThreadPool::ResumeLowPriority()
+	{
+		if (SoAtomic_Decrement(&m_nLowSuspendCount) == 0)
+		{
+			//工作线程在m_Lock内检查m_nLowSuspendCount并登记等待，所以这里加锁之后一定能看到它。
+			SoAutoLock theAutoLock(m_Lock);
+			WakeWaitingWorker(true);
+		}
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoThreadPool::GetThreadCount() const
+	{
+		return m_uiThreadCount;
+	}
+	//-----------------------------------------------------------------------------
+	soint32 SoThreadPool::GetQueueDepth() const
+	{
+		soint32 nDepth = 0;
+		for (int i=0; i<Priority_Count; ++i)
+		{
+			nDepth += m_nQueueDepth[i];
+		}
+		return nDepth;
+	}
+	//-----------------------------------------------------------------------------
+	soint32 SoThreadPool::GetQueueDepth(Priority ePriority) const
+	{
+		if (ePriority < 0 || ePriority >= Priority_Count)
+		{
+			return 0;
+		}
+		return m_nQueueDepth[ePriority];
+	}
+	//-----------------------------------------------------------------------------
+	void SoThreadPool::WorkerProc(void* pParam)
+	{
+		((SoThreadPool*)pParam)->WorkerLoop();
+	}
+	//-----------------------------------------------------------------------------
+	void SoThreadPool::WorkerLoop()
+	{
+		while (true)
+		{
+			//拿到信号量说明队列中至少有一个任务属于当前线程。
+			m_TaskSemaphore.Wait();
+			m_Lock.Lock();
+			stTask* pTask = 0;
+			int nPriority = 0;
+			while (true)
+			{
+				for (nPriority=0; nPriority<Priority_Count; ++nPriority)
+				{
+					stTask* pHead = m_pTaskHead[nPriority];
+					if (pHead && (pHead->pFunc == 0 || CanRun((Priority)nPriority)))
+					{
+						pTask = pHead;
+						break;
+					}
+				}
+				if (pTask)
+				{
+					break;
+				}
+				//队列中的任务暂时都不能执行，等待条件改变。
+				++m_nWaitingWorker;
+				m_Lock.Unlock();
+				m_WaitSemaphore.Wait();
+				m_Lock.Lock();
+			}
+			m_pTaskHead[nPriority] = pTask->pNext;
+			if (m_pTaskHead[nPriority] == 0)
+			{
+				m_pTaskTail[nPriority] = 0;
+			}
+			SoAtomic_Decrement(&m_nQueueDepth[nPriority]);
+			TaskFunc pFunc = pTask->pFunc;
+			void* pParam = pTask->pParam;
+			delete pTask;
+			if (pFunc == 0)
+			{
+				//退出任务。
+				m_Lock.Unlock();
+				break;
+			}
+			++m_uiRunning[nPriority];
+			m_Lock.Unlock();
+			//
+			pFunc(pParam);
+			//
+			m_Lock.Lock();
+			--m_uiRunning[nPriority];
+			WakeWaitingWorker(false);
+			m_Lock.Unlock();
+		}
+	}
+	//-----------------------------------------------------------------------------
+	bool SoThreadPool::CanRun(Priority ePriority) const
+	{
+		if (ePriority == Priority_Low && m_nLowSuspendCount > 0)
+		{
+			return false;
+		}
+		return (m_uiMaxRunning[ePriority] == 0 || m_uiRunning[ePriority] < m_uiMaxRunning[ePriority]);
+	}
+	//-----------------------------------------------------------------------------
+	void SoThreadPool::WakeWaitingWorker(bool bWakeAll)
+	{
+		while (m_nWaitingWorker > 0)
+		{
+			--m_nWaitingWorker;
+			m_WaitSemaphore.Post();
+			if (!bWakeAll)
+			{
+				break;
+			}
+		}
+	}
+	//-----------------------------------------------------------------------------
+	SoManualExecutor::SoManualExecutor()
+	:m_pTaskHead(0)
+	,m_pTaskTail(0)
+	,m_nQueueDepth(0)
+	{
+	}
+	//-----------------------------------------------------------------------------
+	SoManualExecutor::~SoManualExecutor()
+	{
+		//还没有执行的任务直接丢弃。
+		stTask* pTask = m_pTaskHead;
+		while (pTask)
+		{
+			stTask* pNext = pTask->pNext;
+			delete pTask;
+			pTask = pNext;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	bool SoManualExecutor::Post(TaskFunc pFunc, void* pParam)
+	{
+		if (pFunc == 0)
+		{
+			return false;
+		}
+		stTask* pTask = new stTask;
+		pTask->pFunc = pFunc;
+		pTask->pParam = pParam;
+		pTask->pNext = 0;
+		SoAutoLock theAutoLock(m_Lock);
+		if (m_pTaskTail)
+		{
+			m_pTaskTail->pNext = pTask;
+		}
+		else
+		{
+			m_pTaskHead = pTask;
+		}
+		m_pTaskTail = pTask;
+		SoAtomic_Increment(&m_nQueueDepth);
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoManualExecutor::RunPending()
+	{
+		//一次取出整个队列，执行任务时不持有锁。
+		m_Lock.Lock();
+		stTask* pTask = m_pTaskHead;
+		m_pTaskHead = 0;
+		m_pTaskTail = 0;
+		m_nQueueDepth = 0;
+		m_Lock.Unlock();
+		souint32 uiCount = 0;
+		while (pTask)
+		{
+			stTask* pNext = pTask->pNext;
+			pTask->pFunc(pTask->pParam);
+			delete pTask;
+			pTask = pNext;
+			++uiCount;
+		}
+		return uiCount;
+	}
+	//-----------------------------------------------------------------------------
+	soint32 SoManualExecutor::GetQueueDepth() const
+	{
+		return m_nQueueDepth;
+	}
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,138 @@
+﻿//-----------------------------------------------------------------------------
+// SoThreadPool
+// (C) oil
+// 2013-10-22
+//
+// 固定线程个数的线程池。
+// 任务分为高低两个优先级，工作线程总是先执行高优先级的任务，同一优先级内按照提交的顺序执行。
+// 每个优先级可以限制同时执行的任务个数；低优先级任务还可以暂停，暂停期间不会开始新的低优先级任务。
+// SoExecutor是执行任务的接口，SoThreadPool和SoManualExecutor都实现了这个接口，
+// 异步操作完成时可以把回调交给调用者指定的SoExecutor执行。
+//-----------------------------------------------------------------------------
+#ifndef _SoThreadPool_h_
+#define _SoThreadPool_h_
+//-----------------------------------------------------------------------------
+#include "SoThread.h"
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	class SoExecutor
+	{
+	public:
+		typedef void (*TaskFunc)(void* pParam);
+
+	public:
+		virtual ~SoExecutor() {}
+		//提交一个任务，稍后执行pFunc(pParam)。提交失败返回false。
+		virtual bool Post(TaskFunc pFunc, void* pParam) = 0;
+	};
+	//-----------------------------------------------------------------------------
+	class SoThreadPool : public SoExecutor
+	{
+	public:
+		enum Priority
+		{
+			//前台任务，例如调用者正在等待的读取。
+			Priority_High,
+			//后台任务，例如预读取。
+			Priority_Low,
+			Priority_Count,
+		};
+
+	public:
+		SoThreadPool();
+		~SoThreadPool();
+		//启动uiThreadCount个工作线程。
+		bool Start(souint32 uiThreadCount);
+		//等待已经提交的任务全部执行完毕，然后结束所有工作线程。
+		void Stop();
+		//提交一个任务，在某个工作线程中执行pFunc(pParam)。
+		bool AddTask(TaskFunc pFunc, void* pParam, Priority ePriority);
+		//以Priority_High提交任务。
+		virtual bool Post(TaskFunc pFunc, void* pParam);
+		//限制某个优先级同时执行的任务个数，为0表示不限制。
+		void SetPriorityLimit(Priority ePriority, souint32 uiMaxRunning);
+		//暂停和恢复低优先级任务，必须成对调用，可以嵌套。已经开始执行的任务不受影响。
+		void SuspendLowPriority();
+		void ResumeLowPriority();
+		souint32 GetThreadCount() const;
+		//排队等待执行的任务个数。
+		soint32 GetQueueDepth() const;
+		soint32 GetQueueDepth(Priority ePriority) const;
+
+	private:
+		SoThreadPool(const SoThreadPool&);
+		SoThreadPool& operator = (const SoThreadPool&);
+		static void WorkerProc(void* pParam);
+		void WorkerLoop();
+		//在m_Lock内调用。是否可以开始一个ePriority优先级的任务。
+		bool CanRun(Priority ePriority) const;
+		//在m_Lock内调用。唤醒等待的工作线程，让它们重新选择任务。
+		void WakeWaitingWorker(bool bWakeAll);
+
+	private:
+		struct stTask
+		{
+			//pFunc为0表示让工作线程退出。
+			TaskFunc pFunc;
+			void* pParam;
+			stTask* pNext;
+		};
+
+	private:
+		SoThread* m_pThreadList;
+		souint32 m_uiThreadCount;
+		//每个优先级一个任务队列。
+		stTask* m_pTaskHead[Priority_Count];
+		stTask* m_pTaskTail[Priority_Count];
+		volatile soint32 m_nQueueDepth[Priority_Count];
+		//每个优先级正在执行的任务个数和上限。
+		souint32 m_uiRunning[Priority_Count];
+		souint32 m_uiMaxRunning[Priority_Count];
+		//大于0时不开始新的低优先级任务。
+		volatile soint32 m_nLowSuspendCount;
+		SoLock m_Lock;
+		//计数等于队列中的任务个数。
+		SoSemaphore m_TaskSemaphore;
+		//队列中有任务但是因为优先级限制不能执行时，工作线程在这里等待。
+		SoSemaphore m_WaitSemaphore;
+		//在m_WaitSemaphore上等待的工作线程个数。
+		soint32 m_nWaitingWorker;
+	};
+	//-----------------------------------------------------------------------------
+	//任务保存在队列中，由调用者在自己的线程中调用RunPending执行。
+	//例如游戏主循环每帧调用一次RunPending，异步读取的回调就都在主线程中执行。
+	class SoManualExecutor : public SoExecutor
+	{
+	public:
+		SoManualExecutor();
+		virtual ~SoManualExecutor();
+		virtual bool Post(TaskFunc pFunc, void* pParam);
+		//执行队列中所有的任务，返回执行的任务个数。
+		//执行过程中新提交的任务留到下一次RunPending。
+		souint32 RunPending();
+		//队列中等待执行的任务个数。
+		soint32 GetQueueDepth() const;
+
+	private:
+		SoManualExecutor(const SoManualExecutor&);
+		SoManualExecutor& operator = (const SoManualExecutor&);
+
+	private:
+		struct stTask
+		{
+			TaskFunc pFunc;
+			void* pParam;
+			stTask* pNext;
+		};
+
+	private:
+		stTask* m_pTaskHead;
+		stTask* m_pTaskTail;
+		volatile soint32 m_nQueueDepth;
+		SoLock m_Lock;
+	};
+}
+//-----------------------------------------------------------------------------
+#endif //_SoThreadPool_h_
+//-----------------------------------------------------------------------------
@@ -0,0 +1,210 @@
+﻿//-----------------------------------------------------------------------------
+// SoTrace
+// (C) oil
+// 2013-10-28
+//-----------------------------------------------------------------------------
+#include "SoTrace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	//-----------------------------------------------------------------------------
+	struct stTraceEvent
+	{
+		//为0表示位置已经取得，但事件还没有写完。
+		const char* volatile pszName;
+		soint64 nStartTime;
+		soint64 nEndTime;
+		soint64 nFileID;
+		soint64 nSize;
+		souint32 uiThreadID;
+	};
+	//-----------------------------------------------------------------------------
+	class SoTraceBuffer
+	{
+	public:
+		SoTraceBuffer()
+		:m_pEventList(0)
+		,m_nAllocatedCount(0)
+		,m_nCapacity(0)
+		,m_nEventCount(0)
+		,m_nDroppedCount(0)
+		,m_nBaseTime(0)
+		,m_nEnabled(0)
+		,m_nWriterCount(0)
+		{
+		}
+		~SoTraceBuffer()
+		{
+			Disable();
+			if (m_pEventList)
+			{
+				free(m_pEventList);
+				m_pEventList = 0;
+			}
+		}
+		//停止记录，并等待正在写入的事件全部写完。返回之后可以修改或者释放m_pEventList。
+		void Disable()
+		{
+			//带有完整的内存屏障，与SoTrace_Record中先登记再检查的顺序配合。
+			SoAtomic_CompareExchange(&m_nEnabled, 0, 1);
+			while (SoAtomic_Load(&m_nWriterCount) != 0)
+			{
+			}
+		}
+
+	public:
+		stTraceEvent* m_pEventList;
+		//m_pEventList的元素个数，和本次记录的事件个数上限。
+		soint64 m_nAllocatedCount;
+		soint64 m_nCapacity;
+		volatile soint64 m_nEventCount;
+		volatile soint64 m_nDroppedCount;
+		soint64 m_nBaseTime;
+		//是否正在记录。只用原子操作读写。
+		volatile soint32 m_nEnabled;
+		//正在SoTrace_Record中写入事件的线程个数。
+		volatile soint32 m_nWriterCount;
+		//保护SoTrace_Start、SoTrace_Stop和SoTrace_Save之间的互斥。记录事件时不使用它。
+		SoLock m_Lock;
+	};
+	//放在文件作用域，避免函数内静态对象在多线程下的初始化问题。
+	static SoTraceBuffer s_theTraceBuffer;
+	//-----------------------------------------------------------------------------
+	bool SoTrace_Start(souint32 uiMaxEventCount)
+	{
+		if (uiMaxEventCount == 0)
+		{
+			return false;
+		}
+		SoAutoLock theAutoLock(s_theTraceBuffer.m_Lock);
+		//等待其他线程写完之后才能清空或者释放旧的数组。
+		s_theTraceBuffer.Disable();
+		if ((soint64)uiMaxEventCount > s_theTraceBuffer.m_nAllocatedCount)
+		{
+			stTraceEvent* pEventList = (stTraceEvent*)malloc(sizeof(stTraceEvent) * uiMaxEventCount);
+			if (pEventList == 0)
+			{
+				return false;
+			}
+			if (s_theTraceBuffer.m_pEventList)
+			{
+				free(s_theTraceBuffer.m_pEventList);
+			}
+			s_theTraceBuffer.m_pEventList = pEventList;
+			s_theTraceBuffer.m_nAllocatedCount = uiMaxEventCount;
+		}
+		memset(s_theTraceBuffer.m_pEventList, 0, sizeof(stTraceEvent) * uiMaxEventCount);
+		s_theTraceBuffer.m_nCapacity = uiMaxEventCount;
+		s_theTraceBuffer.m_nEventCount = 0;
+		s_theTraceBuffer.m_nDroppedCount = 0;
+		s_theTraceBuffer.m_nBaseTime = SoThread_GetNanoseconds();
+		//以上的修改先于开始记录对其他线程可见。
+		SoAtomic_Store(&s_theTraceBuffer.m_nEnabled, 1);
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	void SoTrace_Stop()
+	{
+		SoAutoLock theAutoLock(s_theTraceBuffer.m_Lock);
+		s_theTraceBuffer.Disable();
+	}
+	//-----------------------------------------------------------------------------
+	bool SoTrace_IsEnabled()
+	{
+		return (SoAtomic_Load(&s_theTraceBuffer.m_nEnabled) != 0);
+	}
+	//-----------------------------------------------------------------------------
+	bool SoTrace_Save(const char* pszFileName)
+	{
+		if (pszFileName == 0 || pszFileName[0] == 0)
+		{
+			return false;
+		}
+		FILE* pFile = fopen(pszFileName, "wb");
+		if (pFile == 0)
+		{
+			return false;
+		}
+		SoAutoLock theAutoLock(s_theTraceBuffer.m_Lock);
+		const soint64 nCount = SoTrace_GetEventCount();
+		//Chrome trace的时间以微秒为单位，可以带小数。
+		fprintf(pFile, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":%lld},\"traceEvents\":[", (long long)s_theTraceBuffer.m_nDroppedCount);
+		bool bFirst = true;
+		for (soint64 i=0; i<nCount; ++i)
+		{
+			const stTraceEvent& theEvent = s_theTraceBuffer.m_pEventList[i];
+			if (theEvent.pszName == 0)
+			{
+				continue;
+			}
+			fprintf(pFile, "%s\n{\"name\":\"%s\",\"cat\":\"SoPackageFile\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+				bFirst ? "" : ",", theEvent.pszName, theEvent.uiThreadID,
+				(theEvent.nStartTime - s_theTraceBuffer.m_nBaseTime) / 1000.0, (theEvent.nEndTime - theEvent.nStartTime) / 1000.0);
+			if (theEvent.nFileID >= 0 || theEvent.nSize >= 0)
+			{
+				fprintf(pFile, ",\"args\":{");
+				if (theEvent.nFileID >= 0)
+				{
+					fprintf(pFile, "\"file\":%lld%s", (long long)theEvent.nFileID, (theEvent.nSize >= 0) ? "," : "");
+				}
+				if (theEvent.nSize >= 0)
+				{
+					fprintf(pFile, "\"size\":%lld", (long long)theEvent.nSize);
+				}
+				fprintf(pFile, "}");
+			}
+			fprintf(pFile, "}");
+			bFirst = false;
+		}
+		fprintf(pFile, "\n]}\n");
+		const bool bOK = (ferror(pFile) == 0);
+		fclose(pFile);
+		return bOK;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoTrace_GetEventCount()
+	{
+		const soint64 nCount = SoAtomic_Load64(&s_theTraceBuffer.m_nEventCount);
+		return (nCount < s_theTraceBuffer.m_nCapacity) ? nCount : s_theTraceBuffer.m_nCapacity;
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoTrace_GetDroppedCount()
+	{
+		return SoAtomic_Load64(&s_theTraceBuffer.m_nDroppedCount);
+	}
+	//-----------------------------------------------------------------------------
+	void SoTrace_Record(const char* pszName, soint64 nStartTime, soint64 nEndTime, soint64 nFileID, soint64 nSize)
+	{
+		if (!SoTrace_IsEnabled())
+		{
+			return;
+		}
+		//先登记再检查是否还在记录，SoTraceBuffer::Disable等到登记的写入全部结束才返回，
+		//所以检查通过之后数组不会被清空或者释放。
+		SoAtomic_Increment(&s_theTraceBuffer.m_nWriterCount);
+		if (SoTrace_IsEnabled())
+		{
+			const soint64 nIndex = SoAtomic_Add64(&s_theTraceBuffer.m_nEventCount, 1) - 1;
+			if (nIndex < s_theTraceBuffer.m_nCapacity)
+			{
+				stTraceEvent& theEvent = s_theTraceBuffer.m_pEventList[nIndex];
+				theEvent.nStartTime = nStartTime;
+				theEvent.nEndTime = nEndTime;
+				theEvent.nFileID = nFileID;
+				theEvent.nSize = nSize;
+				theEvent.uiThreadID = SoThread_GetCurrentThreadID();
+				//最后写名字，SoTrace_Save跳过还没有写完的事件。
+				theEvent.pszName = pszName;
+			}
+			else
+			{
+				SoAtomic_Add64(&s_theTraceBuffer.m_nDroppedCount, 1);
+			}
+		}
+		SoAtomic_Decrement(&s_theTraceBuffer.m_nWriterCount);
+	}
+}
+//-----------------------------------------------------------------------------
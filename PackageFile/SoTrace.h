@@ -0,0 +1,83 @@
+﻿//-----------------------------------------------------------------------------
+// SoTrace
+// (C) oil
+// 2013-10-28
+//
+// 记录资源包操作的时间线，保存为Chrome trace格式的JSON文件，可以在chrome://tracing或者Perfetto中查看。
+// 1，只有编译时定义了SoTrace_Enable，SoTrace_Scope等宏才会展开，否则什么代码也不生成。
+// 2，SoTrace_Start之后才开始记录。事件放在预先申请的数组中，用原子操作取得位置，记录时不加锁。
+// 3，数组满了之后新的事件被丢弃，SoTrace_GetDroppedCount返回丢弃的个数。
+// 4，SoTrace_Start和SoTrace_Stop等待正在记录的事件写完才返回，之后才会清空或者释放数组。
+// 5，Visual Studio的Trace配置定义了SoTrace_Enable；其他编译环境在命令行上定义，例如-DSoTrace_Enable。
+//-----------------------------------------------------------------------------
+#ifndef _SoTrace_h_
+#define _SoTrace_h_
+//-----------------------------------------------------------------------------
+#include "SoBaseTypeDefine.h"
+#include "SoThread.h"
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	//开始记录，最多记录uiMaxEventCount个事件。会清空之前记录的事件。
+	bool SoTrace_Start(souint32 uiMaxEventCount);
+	//停止记录，返回时其他线程已经不再写入。已经记录的事件保留到下一次SoTrace_Start。
+	void SoTrace_Stop();
+	bool SoTrace_IsEnabled();
+	//把记录的事件写入文件。应该在SoTrace_Stop之后调用。
+	bool SoTrace_Save(const char* pszFileName);
+	soint64 SoTrace_GetEventCount();
+	soint64 SoTrace_GetDroppedCount();
+	//记录一个事件。pszName必须是常量字符串，保存时才读取它。
+	//nFileID和nSize为-1时不输出。
+	void SoTrace_Record(const char* pszName, soint64 nStartTime, soint64 nEndTime, soint64 nFileID, soint64 nSize);
+	//-----------------------------------------------------------------------------
+	//构造时记下开始时间，析构时记录事件。
+	class SoTraceScope
+	{
+	public:
+		SoTraceScope(const char* pszName)
+		:m_pszName(pszName)
+		,m_nStartTime(SoTrace_IsEnabled() ? SoThread_GetNanoseconds() : -1)
+		,m_nFileID(-1)
+		,m_nSize(-1)
+		{
+		}
+		~SoTraceScope()
+		{
+			if (m_nStartTime >= 0)
+			{
+				SoTrace_Record(m_pszName, m_nStartTime, SoThread_GetNanoseconds(), m_nFileID, m_nSize);
+			}
+		}
+		void SetArg(soint64 nFileID, soint64 nSize)
+		{
+			m_nFileID = nFileID;
+			m_nSize = nSize;
+		}
+
+	private:
+		SoTraceScope(const SoTraceScope&);
+		SoTraceScope& operator = (const SoTraceScope&);
+
+	private:
+		const char* m_pszName;
+		soint64 m_nStartTime;
+		soint64 m_nFileID;
+		soint64 m_nSize;
+	};
+}
+//-----------------------------------------------------------------------------
+#if defined(SoTrace_Enable)
+//在当前作用域内记录一个事件，每个作用域只能有一个。
+#define SoTrace_Scope(pszName) GGUI::SoTraceScope theTraceScope(pszName)
+#define SoTrace_SetArg(nFileID, nSize) theTraceScope.SetArg(nFileID, nSize)
+//记录已经测量好的时间段。
+#define SoTrace_Event(pszName, nStartTime, nEndTime, nFileID, nSize) GGUI::SoTrace_Record(pszName, nStartTime, nEndTime, nFileID, nSize)
+#else
+#define SoTrace_Scope(pszName)
+#define SoTrace_SetArg(nFileID, nSize)
+#define SoTrace_Event(pszName, nStartTime, nEndTime, nFileID, nSize)
+#endif
+//-----------------------------------------------------------------------------
+#endif //_SoTrace_h_
+//-----------------------------------------------------------------------------
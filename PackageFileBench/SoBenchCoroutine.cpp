@@ -0,0 +1,98 @@
+﻿//-----------------------------------------------------------------------------
+// SoBenchCoroutine
+// (C) oil
+// 2013-10-30
+//
+// SoPackageFileCoroutine的测试场景。需要用C++20编译，编译器不支持协程时只输出提示。
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include "SoPackageFileBench.h"
+#include "SoPackageFileCoroutine.h"
+using namespace GGUI;
+//-----------------------------------------------------------------------------
+#if defined(SoPackageFile_EnableCoroutine)
+//最简单的协程类型：立即开始执行，结束时不挂起，协程帧自动释放。
+struct SoBenchTask
+{
+	struct promise_type
+	{
+		SoBenchTask get_return_object()
+		{
+			return SoBenchTask();
+		}
+		std::suspend_never initial_suspend()
+		{
+			return std::suspend_never();
+		}
+		std::suspend_never final_suspend() noexcept
+		{
+			return std::suspend_never();
+		}
+		void return_void()
+		{
+		}
+		void unhandled_exception()
+		{
+		}
+	};
+};
+struct stCoroutineState
+{
+	souint32 uiDone;
+	souint32 uiFailCount;
+};
+//读取一个文件。协程在theExecutor中恢复，也就是调用RunPending的线程，所以theState不需要加锁。
+SoBenchTask SoBench_CoReadOne(SoPackageFile& thePackage, const char* pszName, SoManualExecutor& theExecutor, stCoroutineState& theState)
+{
+	SoPackageFile::stReadSingleFile theFile;
+	SoPackageFile::OperationResult eResult = thePackage.Open(pszName, theFile);
+	if (eResult == SoPackageFile::Result_OK)
+	{
+		eResult = co_await SoCoReadAsync(thePackage, theFile, &theExecutor);
+	}
+	if (eResult != SoPackageFile::Result_OK || theFile.pFileBuff == 0)
+	{
+		++theState.uiFailCount;
+	}
+	thePackage.Close(theFile);
+	++theState.uiDone;
+}
+#endif
+//-----------------------------------------------------------------------------
+#define SoBench_CoroutineFileCount 2000
+#define SoBench_CoroutineFileSize 4096
+void SoBench_Coroutine()
+{
+#if defined(SoPackageFile_EnableCoroutine)
+	const char* pszPackage = SoBench_TempDir "coroutine.sof";
+	const souint32 uiFileCount = SoBench_CreatePackage(pszPackage, SoBench_CoroutineFileCount, SoBench_CoroutineFileSize, 0);
+	SoPackageFile thePackage;
+	if (uiFileCount == 0 || thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read) != SoPackageFile::Result_OK)
+	{
+		printf("Coroutine: create package fail\n");
+		return;
+	}
+	char szName[SoPackageFileMAX_PATH];
+	SoManualExecutor theExecutor;
+	stCoroutineState theState = {0, 0};
+	const double fStart = SoBench_Now();
+	for (souint32 i=0; i<uiFileCount; ++i)
+	{
+		SoBench_MakeEntryName(szName, i);
+		SoBench_CoReadOne(thePackage, szName, theExecutor, theState);
+	}
+	//所有的协程都在这个线程中恢复执行。
+	while (theState.uiDone < uiFileCount)
+	{
+		theExecutor.RunPending();
+	}
+	const double fTime = SoBench_Now() - fStart;
+	thePackage.ReleasePackageFile();
+	remove(pszPackage);
+	printf("Coroutine: %u entries co_await ReadAsync, %.1f entries/s, %u fail\n", uiFileCount, uiFileCount / fTime, theState.uiFailCount);
+	SoBench_Report("entries/s", uiFileCount / fTime, "Coroutine/read");
+#else
+	printf("Coroutine: compiler does not support C++20 coroutines, skipped\n");
+#endif
+}
+//-----------------------------------------------------------------------------
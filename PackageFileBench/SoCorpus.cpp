@@ -0,0 +1,469 @@
+﻿//-----------------------------------------------------------------------------
+// SoCorpus
+// (C) oil
+// 2013-10-29
+//-----------------------------------------------------------------------------
+#include "SoCorpus.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	//-----------------------------------------------------------------------------
+	//目录层数的上限，保证文件名不超过SoPackageFileMAX_PATH。
+	#define SoCorpus_MaxDepth 12
+	//-----------------------------------------------------------------------------
+	//把一个整数打散成看起来随机的整数。
+	static souint32 SoCorpus_Mix(souint32 x)
+	{
+		x ^= x >> 16;
+		x *= 0x85EBCA6B;
+		x ^= x >> 13;
+		x *= 0xC2B2AE35;
+		x ^= x >> 16;
+		return x;
+	}
+	//-----------------------------------------------------------------------------
+	//xorshift随机数发生器，不依赖C运行库，在不同平台下生成相同的序列。
+	struct stCorpusRandom
+	{
+		souint32 uiState;
+		stCorpusRandom(souint32 uiSeed):uiState(uiSeed ? uiSeed : 0x9E3779B9)
+		{
+		}
+		souint32 Next()
+		{
+			uiState ^= uiState << 13;
+			uiState ^= uiState >> 17;
+			uiState ^= uiState << 5;
+			return uiState;
+		}
+		//返回[nMin, nMax]范围内的整数。
+		soint64 Range(soint64 nMin, soint64 nMax)
+		{
+			const souint64 uiRandom = ((souint64)Next() << 32) | Next();
+			return nMin + (soint64)(uiRandom % (souint64)(nMax - nMin + 1));
+		}
+	};
+	//-----------------------------------------------------------------------------
+	static const char* s_szDirWords[] = {
+		"Data", "Textures", "Character", "Hero", "Monster", "UI", "Sound", "Music",
+		"Effect", "Particle", "Models", "Animation", "Scene", "Terrain", "Config",
+		"Script", "Shader", "Font", "Icon", "Skill", "Item", "Npc", "Map", "common",
+		"low", "high", "Boss_Dragon", "Weapon", "Armor", "env", "Lightmap", "Patch",
+	};
+	static const char* s_szExtList[][4] = {
+		{".lua", ".ini", ".xml", ".txt"},
+		{".mdl", ".ani", ".bin", ".skn"},
+		{".png", ".ogg", ".dds", ".wav"},
+	};
+	//文本内容使用的单词，模拟脚本和配置文件。
+	static const char* s_szTextWords[] = {
+		"local", "function", "end", "return", "if", "then", "else", "for", "in", "do",
+		"self", "nil", "true", "false", "=", "==", "(", ")", "{", "}", ",", "0", "1",
+		"100", "name", "id", "level", "hp", "mp", "attack", "defense", "speed", "skill",
+		"item", "count", "x", "y", "z", "<node", "/>", "value=\"", "\"", "type", "table",
+	};
+	//-----------------------------------------------------------------------------
+	SoCorpus::SoCorpus()
+	:m_uiClassCount(0)
+	,m_uiTotalWeight(0)
+	,m_uiSeed(1)
+	,m_uiMinDepth(1)
+	,m_uiMaxDepth(6)
+	,m_pBuff(0)
+	,m_nBuffSize(0)
+	{
+		SetSpec(SoCorpus_DefaultSpec);
+	}
+	//-----------------------------------------------------------------------------
+	SoCorpus::~SoCorpus()
+	{
+		if (m_pBuff)
+		{
+			free(m_pBuff);
+			m_pBuff = 0;
+		}
+	}
+	//-----------------------------------------------------------------------------
+	bool SoCorpus::SetSpec(const char* pszSpec)
+	{
+		if (pszSpec == 0)
+		{
+			return false;
+		}
+		stEntryClass theClassList[SoCorpus_MaxClassCount];
+		souint32 uiClassCount = 0;
+		souint32 uiTotalWeight = 0;
+		const char* p = pszSpec;
+		while (*p)
+		{
+			if (uiClassCount >= SoCorpus_MaxClassCount)
+			{
+				return false;
+			}
+			stEntryClass& theClass = theClassList[uiClassCount];
+			if (strncmp(p, "text:", 5) == 0)
+			{
+				theClass.eKind = Content_Text;
+				p += 5;
+			}
+			else if (strncmp(p, "binary:", 7) == 0)
+			{
+				theClass.eKind = Content_Binary;
+				p += 7;
+			}
+			else if (strncmp(p, "media:", 6) == 0)
+			{
+				theClass.eKind = Content_Media;
+				p += 6;
+			}
+			else
+			{
+				return false;
+			}
+			char* pEnd = 0;
+			const unsigned long ulWeight = strtoul(p, &pEnd, 10);
+			if (pEnd == p || *pEnd != ':' || ulWeight == 0 || ulWeight > 1000000)
+			{
+				return false;
+			}
+			theClass.uiWeight = (souint32)ulWeight;
+			p = pEnd + 1;
+			if (!ParseSize(p, theClass.nMinSize))
+			{
+				return false;
+			}
+			if (*p == '-')
+			{
+				++p;
+				if (!ParseSize(p, theClass.nMaxSize))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				theClass.nMaxSize = theClass.nMinSize;
+			}
+			if (theClass.nMinSize > theClass.nMaxSize)
+			{
+				return false;
+			}
+			if (*p == ',')
+			{
+				++p;
+			}
+			else if (*p != 0)
+			{
+				return false;
+			}
+			uiTotalWeight += theClass.uiWeight;
+			++uiClassCount;
+		}
+		if (uiClassCount == 0)
+		{
+			return false;
+		}
+		memcpy(m_ClassList, theClassList, sizeof(stEntryClass) * uiClassCount);
+		m_uiClassCount = uiClassCount;
+		m_uiTotalWeight = uiTotalWeight;
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	void SoCorpus::SetSeed(souint32 uiSeed)
+	{
+		m_uiSeed = uiSeed;
+	}
+	//-----------------------------------------------------------------------------
+	void SoCorpus::SetPathDepth(souint32 uiMinDepth, souint32 uiMaxDepth)
+	{
+		if (uiMaxDepth > SoCorpus_MaxDepth)
+		{
+			uiMaxDepth = SoCorpus_MaxDepth;
+		}
+		if (uiMinDepth > uiMaxDepth)
+		{
+			uiMinDepth = uiMaxDepth;
+		}
+		m_uiMinDepth = uiMinDepth;
+		m_uiMaxDepth = uiMaxDepth;
+	}
+	//-----------------------------------------------------------------------------
+	void SoCorpus::GetEntry(soint64 nIndex, char* pszName, soint64& nSize, ContentKind& eKind) const
+	{
+		stCorpusRandom theRandom(GetEntrySeed(nIndex, 0));
+		//按权重选择类别。
+		const souint32 uiPick = theRandom.Next() % m_uiTotalWeight;
+		souint32 uiClass = 0;
+		souint32 uiWeightSum = m_ClassList[0].uiWeight;
+		while (uiPick >= uiWeightSum && uiClass + 1 < m_uiClassCount)
+		{
+			++uiClass;
+			uiWeightSum += m_ClassList[uiClass].uiWeight;
+		}
+		const stEntryClass& theClass = m_ClassList[uiClass];
+		eKind = theClass.eKind;
+		//对数均匀分布：先随机选一个2的幂次区间，再在区间内均匀选择。只用整数运算，结果不受浮点实现影响。
+		int nMinBit = 0;
+		int nMaxBit = 0;
+		while (nMinBit < 62 && ((soint64)2 << nMinBit) <= theClass.nMinSize)
+		{
+			++nMinBit;
+		}
+		while (nMaxBit < 62 && ((soint64)2 << nMaxBit) <= theClass.nMaxSize)
+		{
+			++nMaxBit;
+		}
+		const int nBit = (int)theRandom.Range(nMinBit, nMaxBit);
+		soint64 nLow = (soint64)1 << nBit;
+		soint64 nHigh = ((soint64)2 << nBit) - 1;
+		if (nLow < theClass.nMinSize || nBit == nMinBit)
+		{
+			nLow = theClass.nMinSize;
+		}
+		if (nHigh > theClass.nMaxSize)
+		{
+			nHigh = theClass.nMaxSize;
+		}
+		nSize = theRandom.Range(nLow, nHigh);
+		//目录部分。
+		const souint32 uiWordCount = sizeof(s_szDirWords) / sizeof(s_szDirWords[0]);
+		const souint32 uiDepth = (souint32)theRandom.Range(m_uiMinDepth, m_uiMaxDepth);
+		char* p = pszName;
+		for (souint32 i=0; i<uiDepth; ++i)
+		{
+			const char* pszWord = s_szDirWords[theRandom.Next() % uiWordCount];
+			const size_t nLength = strlen(pszWord);
+			memcpy(p, pszWord, nLength);
+			p += nLength;
+			*p++ = '/';
+		}
+		//文件名带上序号，保证不同的文件不会重名。
+		const char* pszWord = s_szDirWords[theRandom.Next() % uiWordCount];
+		const char* pszExt = s_szExtList[eKind][theRandom.Next() % 4];
+		sprintf(p, "%s_%08llx%s", pszWord, (unsigned long long)nIndex, pszExt);
+	}
+	//-----------------------------------------------------------------------------
+	void SoCorpus::FillContent(soint64 nIndex, char* pBuff, soint64 nSize, ContentKind eKind) const
+	{
+		stCorpusRandom theRandom(GetEntrySeed(nIndex, 1));
+		if (eKind == Content_Text)
+		{
+			const souint32 uiWordCount = sizeof(s_szTextWords) / sizeof(s_szTextWords[0]);
+			soint64 nPos = 0;
+			while (nPos < nSize)
+			{
+				const souint32 uiRandom = theRandom.Next();
+				const char* pszWord = s_szTextWords[uiRandom % uiWordCount];
+				for (const char* c=pszWord; *c && nPos<nSize; ++c)
+				{
+					pBuff[nPos++] = *c;
+				}
+				if (nPos < nSize)
+				{
+					pBuff[nPos++] = ((uiRandom >> 16) % 8 == 0) ? '\n' : ' ';
+				}
+			}
+		}
+		else if (eKind == Content_Binary)
+		{
+			//16字节一条记录：序号，小范围的随机数，以及从本文件的8种模式中选择的8个字节。
+			souint32 uiPatternList[16];
+			for (int i=0; i<16; ++i)
+			{
+				uiPatternList[i] = theRandom.Next();
+			}
+			souint32 uiRecord[4];
+			soint64 nPos = 0;
+			for (souint32 k=0; nPos<nSize; ++k)
+			{
+				const souint32 uiRandom = theRandom.Next();
+				const souint32 uiPattern = (uiRandom >> 16) % 8;
+				uiRecord[0] = k;
+				uiRecord[1] = uiRandom & 0x3FF;
+				uiRecord[2] = uiPatternList[uiPattern * 2];
+				uiRecord[3] = uiPatternList[uiPattern * 2 + 1];
+				const soint64 nCopy = (nSize - nPos < (soint64)sizeof(uiRecord)) ? (nSize - nPos) : (soint64)sizeof(uiRecord);
+				memcpy(pBuff + nPos, uiRecord, (size_t)nCopy);
+				nPos += nCopy;
+			}
+		}
+		else
+		{
+			soint64 nPos = 0;
+			for (; nPos+4<=nSize; nPos+=4)
+			{
+				const souint32 uiRandom = theRandom.Next();
+				memcpy(pBuff + nPos, &uiRandom, 4);
+			}
+			for (; nPos<nSize; ++nPos)
+			{
+				pBuff[nPos] = (char)theRandom.Next();
+			}
+		}
+	}
+	//-----------------------------------------------------------------------------
+	soint64 SoCorpus::GetMaxSize() const
+	{
+		soint64 nMaxSize = 0;
+		for (souint32 i=0; i<m_uiClassCount; ++i)
+		{
+			if (m_ClassList[i].nMaxSize > nMaxSize)
+			{
+				nMaxSize = m_ClassList[i].nMaxSize;
+			}
+		}
+		return nMaxSize;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoCorpus::WriteDirectory(const char* pszRootDir, soint64 nEntryCount, soint64* pTotalBytes)
+	{
+		if (pTotalBytes)
+		{
+			*pTotalBytes = 0;
+		}
+		if (pszRootDir == 0 || pszRootDir[0] == 0 || strlen(pszRootDir) + 2 >= SoPackageFileMAX_PATH || !PrepareBuff(GetMaxSize()))
+		{
+			return false;
+		}
+		char szPath[SoPackageFileMAX_PATH * 2];
+		const size_t nRootLength = strlen(pszRootDir);
+		memcpy(szPath, pszRootDir, nRootLength);
+		szPath[nRootLength] = '/';
+		SoFileIO_MakeDir(pszRootDir);
+		soint64 nSize = 0;
+		ContentKind eKind = Content_Text;
+		for (soint64 i=0; i<nEntryCount; ++i)
+		{
+			GetEntry(i, szPath + nRootLength + 1, nSize, eKind);
+			FillContent(i, m_pBuff, nSize, eKind);
+			//多数目录已经存在，打开失败时才创建目录。
+			FILE* pFile = fopen(szPath, "wb");
+			if (pFile == 0)
+			{
+				SoFileIO_MakeParentDir(szPath);
+				pFile = fopen(szPath, "wb");
+				if (pFile == 0)
+				{
+					return false;
+				}
+			}
+			const bool bOK = (fwrite(m_pBuff, 1, (size_t)nSize, pFile) == (size_t)nSize);
+			fclose(pFile);
+			if (!bOK)
+			{
+				return false;
+			}
+			if (pTotalBytes)
+			{
+				*pTotalBytes += nSize;
+			}
+		}
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	SoPackageFile::OperationResult SoCorpus::WritePackage(SoPackageFile& thePackage, const char* pszPrefix, soint64 nEntryCount, soint64* pTotalBytes)
+	{
+		if (pTotalBytes)
+		{
+			*pTotalBytes = 0;
+		}
+		const size_t nPrefixLength = pszPrefix ? strlen(pszPrefix) : 0;
+		if (nPrefixLength >= SoPackageFileMAX_PATH)
+		{
+			return SoPackageFile::Result_InvalidParam;
+		}
+		if (!PrepareBuff(GetMaxSize()))
+		{
+			return SoPackageFile::Result_MemoryIsEmpty;
+		}
+		char szName[SoPackageFileMAX_PATH * 2];
+		if (nPrefixLength > 0)
+		{
+			memcpy(szName, pszPrefix, nPrefixLength);
+		}
+		soint64 nSize = 0;
+		ContentKind eKind = Content_Text;
+		for (soint64 i=0; i<nEntryCount; ++i)
+		{
+			GetEntry(i, szName + nPrefixLength, nSize, eKind);
+			FillContent(i, m_pBuff, nSize, eKind);
+			const SoPackageFile::OperationResult eResult = thePackage.InsertSingleFileFromMemory(szName, m_pBuff, nSize);
+			if (eResult != SoPackageFile::Result_OK)
+			{
+				return eResult;
+			}
+			if (pTotalBytes)
+			{
+				*pTotalBytes += nSize;
+			}
+		}
+		return SoPackageFile::Result_OK;
+	}
+	//-----------------------------------------------------------------------------
+	souint32 SoCorpus::GetEntrySeed(soint64 nIndex, souint32 uiStream) const
+	{
+		souint32 uiSeed = SoCorpus_Mix(m_uiSeed ^ (uiStream * 0x9E3779B9));
+		uiSeed = SoCorpus_Mix(uiSeed ^ (souint32)nIndex);
+		uiSeed = SoCorpus_Mix(uiSeed ^ (souint32)((souint64)nIndex >> 32));
+		return uiSeed;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoCorpus::ParseSize(const char*& pszText, soint64& nSize)
+	{
+		char* pEnd = 0;
+		const double fValue = strtod(pszText, &pEnd);
+		if (pEnd == pszText || fValue < 0.0)
+		{
+			return false;
+		}
+		double fScale = 1.0;
+		if (*pEnd == 'K' || *pEnd == 'k')
+		{
+			fScale = 1024.0;
+			++pEnd;
+		}
+		else if (*pEnd == 'M' || *pEnd == 'm')
+		{
+			fScale = 1024.0 * 1024.0;
+			++pEnd;
+		}
+		else if (*pEnd == 'G' || *pEnd == 'g')
+		{
+			fScale = 1024.0 * 1024.0 * 1024.0;
+			++pEnd;
+		}
+		//单个文件不超过4G。
+		const double fSize = fValue * fScale;
+		if (fSize > 4.0 * 1024.0 * 1024.0 * 1024.0)
+		{
+			return false;
+		}
+		nSize = (soint64)fSize;
+		pszText = pEnd;
+		return true;
+	}
+	//-----------------------------------------------------------------------------
+	bool SoCorpus::PrepareBuff(soint64 nSize)
+	{
+		if (nSize <= m_nBuffSize && m_pBuff)
+		{
+			return true;
+		}
+		char* pBuff = (char*)malloc((size_t)(nSize > 0 ? nSize : 1));
+		if (pBuff == 0)
+		{
+			return false;
+		}
+		if (m_pBuff)
+		{
+			free(m_pBuff);
+		}
+		m_pBuff = pBuff;
+		m_nBuffSize = nSize;
+		return true;
+	}
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,84 @@
+﻿//-----------------------------------------------------------------------------
+// SoCorpus
+// (C) oil
+// 2013-10-29
+//
+// 生成测试用的资源文件集合（语料）。相同的种子和分布描述总是生成相同的文件名和文件内容。
+// 1，文件分为几类，每类有权重、大小范围和内容类型。大小在范围内按对数均匀分布。
+// 2，内容类型：text为文本，压缩率高；binary为结构化的二进制数据，可以压缩一部分；
+//    media为随机数据，模拟已经压缩过的图片和声音，无法压缩。
+// 3，第i个文件只由种子和i决定，可以只生成其中一部分，或者多个线程分段生成。
+// 4，可以生成磁盘上的目录树，也可以不经过磁盘直接写入资源包。
+//-----------------------------------------------------------------------------
+#ifndef _SoCorpus_h_
+#define _SoCorpus_h_
+//-----------------------------------------------------------------------------
+#include "SoBaseTypeDefine.h"
+#include "SoPackageFile.h"
+//-----------------------------------------------------------------------------
+#define SoCorpus_MaxClassCount 8
+//默认的分布：大量的小文本文件，一部分中等大小的二进制文件，少量大的媒体文件。
+#define SoCorpus_DefaultSpec "text:60:64-16K,binary:30:16K-1M,media:10:1M-8M"
+//-----------------------------------------------------------------------------
+namespace GGUI
+{
+	class SoCorpus
+	{
+	public:
+		enum ContentKind
+		{
+			Content_Text,
+			Content_Binary,
+			Content_Media,
+		};
+		struct stEntryClass
+		{
+			ContentKind eKind;
+			souint32 uiWeight;
+			soint64 nMinSize;
+			soint64 nMaxSize;
+		};
+
+	public:
+		SoCorpus();
+		~SoCorpus();
+		//解析分布描述，格式为逗号分隔的"类型:权重:最小大小-最大大小"，大小可以带K、M后缀。
+		//例如"text:60:64-16K,media:10:1M-8M"。格式错误时返回false，原有的分布不变。
+		bool SetSpec(const char* pszSpec);
+		void SetSeed(souint32 uiSeed);
+		//目录的层数范围。
+		void SetPathDepth(souint32 uiMinDepth, souint32 uiMaxDepth);
+		//第nIndex个文件的文件名（以'/'分隔的相对路径）、大小和内容类型。
+		void GetEntry(soint64 nIndex, char* pszName, soint64& nSize, ContentKind& eKind) const;
+		//生成第nIndex个文件的内容，pBuff至少有nSize个字节。
+		void FillContent(soint64 nIndex, char* pBuff, soint64 nSize, ContentKind eKind) const;
+		//所有文件中最大的可能大小，用于准备缓存。
+		soint64 GetMaxSize() const;
+		//在pszRootDir下生成nEntryCount个文件，pTotalBytes返回文件的总字节数，可以为0。
+		bool WriteDirectory(const char* pszRootDir, soint64 nEntryCount, soint64* pTotalBytes);
+		//把nEntryCount个文件写入以Mode_Write打开的资源包，文件名加上pszPrefix前缀（可以为0）。
+		SoPackageFile::OperationResult WritePackage(SoPackageFile& thePackage, const char* pszPrefix, soint64 nEntryCount, soint64* pTotalBytes);
+
+	private:
+		SoCorpus(const SoCorpus&);
+		SoCorpus& operator = (const SoCorpus&);
+		//每个文件使用自己的随机数序列。
+		souint32 GetEntrySeed(soint64 nIndex, souint32 uiStream) const;
+		static bool ParseSize(const char*& pszText, soint64& nSize);
+		bool PrepareBuff(soint64 nSize);
+
+	private:
+		stEntryClass m_ClassList[SoCorpus_MaxClassCount];
+		souint32 m_uiClassCount;
+		souint32 m_uiTotalWeight;
+		souint32 m_uiSeed;
+		souint32 m_uiMinDepth;
+		souint32 m_uiMaxDepth;
+		//WriteDirectory和WritePackage使用的内容缓存。
+		char* m_pBuff;
+		soint64 m_nBuffSize;
+	};
+}
+//-----------------------------------------------------------------------------
+#endif //_SoCorpus_h_
+//-----------------------------------------------------------------------------
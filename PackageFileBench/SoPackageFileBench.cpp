@@ -0,0 +1,1884 @@
+﻿//-----------------------------------------------------------------------------
+// SoPackageFileBench
+// (C) oil
+// 2013-10-20
+//
+// SoPackageFile的性能测试程序。
+// 所有的测试数据都由固定的随机数种子生成，多次运行的结果可以互相比较。
+// 用法：PackageFileBench [--filter 测试名] [--repeat 次数] [--json 结果文件]
+// --filter只运行名字包含指定字符串的测试；--json把所有的指标写成JSON文件，用于跟踪不同版本之间的性能变化。
+// --baseline与基准文件比较，有指标变差超过容差时返回2。性能回归测试使用：
+//   PackageFileBench --filter Regression --baseline PerfBaseline.json
+// --write-baseline把这次的结果写成新的基准文件，保留原有的容差。
+// 测试过程中的正确性检查（例如解压的文件与包内内容不同）失败时返回3。
+// --trace把运行过程中资源包各个操作的时间线保存为Chrome trace文件，需要定义SoTrace_Enable编译（Trace配置）。
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "SoPackageFile.h"
+#include "SoHash.h"
+#include "SoThread.h"
+#include "SoCorpus.h"
+#include "SoAllocator.h"
+#include "SoTrace.h"
+#include "SoPackageFileBench.h"
+#if defined(_WIN32)
+#include <Windows.h>
+#include <direct.h>
+#include <psapi.h>
+#define SoBench_MakeDir(pszDir) _mkdir(pszDir)
+#else
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#define SoBench_MakeDir(pszDir) mkdir(pszDir, 0755)
+#endif
+using namespace GGUI;
+//-----------------------------------------------------------------------------
+//返回以秒为单位的时间。
+double SoBench_Now()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER theFreq;
+	LARGE_INTEGER theCounter;
+	QueryPerformanceFrequency(&theFreq);
+	QueryPerformanceCounter(&theCounter);
+	return (double)theCounter.QuadPart / (double)theFreq.QuadPart;
+#else
+	timespec theTime;
+	clock_gettime(CLOCK_MONOTONIC, &theTime);
+	return (double)theTime.tv_sec + (double)theTime.tv_nsec * 1e-9;
+#endif
+}
+//-----------------------------------------------------------------------------
+//固定种子的随机数发生器，保证在不同平台、不同C运行库下生成相同的数据。
+struct SoBenchRandom
+{
+	souint32 uiState;
+	SoBenchRandom(souint32 uiSeed):uiState(uiSeed)
+	{
+	}
+	souint32 Next()
+	{
+		uiState = uiState * 1664525 + 1013904223;
+		return uiState >> 8;
+	}
+	//返回[uiMin, uiMax]范围内的整数。
+	souint32 Range(souint32 uiMin, souint32 uiMax)
+	{
+		return uiMin + Next() % (uiMax - uiMin + 1);
+	}
+};
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 测试结果 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//每个指标有一个以'/'分隔的名字，例如"ReadThroughput/large/4t"。
+#define SoBench_MaxResultCount 512
+struct stBenchResult
+{
+	char szName[128];
+	const char* pszUnit;
+	double fValue;
+};
+stBenchResult g_ResultList[SoBench_MaxResultCount];
+souint32 g_uiResultCount = 0;
+//新测试场景的重复次数，结果取中位数。
+souint32 g_uiRepeat = 3;
+//记录一个指标。pszUnit必须是常量字符串。
+void SoBench_Report(const char* pszUnit, double fValue, const char* pszFormat, ...)
+{
+	if (g_uiResultCount >= SoBench_MaxResultCount)
+	{
+		return;
+	}
+	stBenchResult& theResult = g_ResultList[g_uiResultCount++];
+	va_list theArgs;
+	va_start(theArgs, pszFormat);
+	vsprintf(theResult.szName, pszFormat, theArgs);
+	va_end(theArgs);
+	theResult.pszUnit = pszUnit;
+	theResult.fValue = fValue;
+}
+bool SoBench_SaveJson(const char* pszFileName)
+{
+	FILE* pFile = fopen(pszFileName, "wb");
+	if (pFile == 0)
+	{
+		return false;
+	}
+	fprintf(pFile, "{\n\"package_version\": %d,\n\"repeat\": %u,\n\"results\": [", SoPackageFileVersion, g_uiRepeat);
+	for (souint32 i=0; i<g_uiResultCount; ++i)
+	{
+		fprintf(pFile, "%s\n{\"name\": \"%s\", \"value\": %.6g, \"unit\": \"%s\"}", i == 0 ? "" : ",",
+			g_ResultList[i].szName, g_ResultList[i].fValue, g_ResultList[i].pszUnit);
+	}
+	fprintf(pFile, "\n]\n}\n");
+	fclose(pFile);
+	return true;
+}
+int SoBench_CompareDouble(const void* pLeft, const void* pRight)
+{
+	const double fLeft = *(const double*)pLeft;
+	const double fRight = *(const double*)pRight;
+	return (fLeft < fRight) ? -1 : ((fLeft > fRight) ? 1 : 0);
+}
+//正确性检查失败的次数，不为0时main返回3。
+souint32 g_uiCheckFailCount = 0;
+//bOK为false时打印失败原因并计数。
+void SoBench_Check(bool bOK, const char* pszFormat, ...)
+{
+	if (bOK)
+	{
+		return;
+	}
+	++g_uiCheckFailCount;
+	va_list theArgs;
+	va_start(theArgs, pszFormat);
+	printf("CHECK FAIL: ");
+	vprintf(pszFormat, theArgs);
+	printf("\n");
+	va_end(theArgs);
+}
+//排序并返回中位数，会修改pValueList。
+double SoBench_Median(double* pValueList, souint32 uiCount)
+{
+	qsort(pValueList, uiCount, sizeof(double), SoBench_CompareDouble);
+	return pValueList[uiCount / 2];
+}
+//进程占用物理内存的历史最大值，单位为字节。
+double SoBench_PeakMemory()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS theCounters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &theCounters, sizeof(theCounters)))
+	{
+		return (double)theCounters.PeakWorkingSetSize;
+	}
+	return 0.0;
+#else
+	rusage theUsage;
+	getrusage(RUSAGE_SELF, &theUsage);
+	//Linux下ru_maxrss以KB为单位。
+	return (double)theUsage.ru_maxrss * 1024.0;
+#endif
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 文件名格式化 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//模拟游戏资源的路径：目录层次不定，大小写混杂，'\\'和'/'混用。
+const char* g_szPathWords[] = {
+	"Data", "Textures", "Character", "Hero", "Monster", "UI", "Sound", "Music",
+	"Effect", "Particle", "Models", "Animation", "Scene", "Terrain", "Config",
+	"Script", "Lua", "Shader", "Font", "Icon", "Skill", "Item", "Npc", "Map",
+	"common", "low", "high", "Boss_Dragon", "Weapon", "Armor", "env", "Lightmap",
+};
+const char* g_szPathExts[] = {
+	".png", ".DDS", ".ini", ".lua", ".ogg", ".wav", ".mdl", ".ani", ".xml", ".TGA",
+};
+//根据目标长度范围生成一个路径。
+void SoBench_MakePath(char* pszOut, souint32 uiMinLength, souint32 uiMaxLength, SoBenchRandom& theRandom)
+{
+	const souint32 uiWordCount = sizeof(g_szPathWords) / sizeof(g_szPathWords[0]);
+	const souint32 uiExtCount = sizeof(g_szPathExts) / sizeof(g_szPathExts[0]);
+	const souint32 uiTarget = theRandom.Range(uiMinLength, uiMaxLength);
+	souint32 uiLength = 0;
+	pszOut[0] = 0;
+	while (uiLength + 12 < uiTarget)
+	{
+		const char* pszWord = g_szPathWords[theRandom.Next() % uiWordCount];
+		const souint32 uiWordLength = (souint32)strlen(pszWord);
+		if (uiLength + uiWordLength + 1 + 12 > uiTarget)
+		{
+			break;
+		}
+		memcpy(pszOut + uiLength, pszWord, uiWordLength);
+		uiLength += uiWordLength;
+		pszOut[uiLength++] = (theRandom.Next() & 1) ? '\\' : '/';
+	}
+	//文件名部分，补齐到目标长度。
+	const char* pszExt = g_szPathExts[theRandom.Next() % uiExtCount];
+	const souint32 uiExtLength = (souint32)strlen(pszExt);
+	while (uiLength + uiExtLength < uiTarget)
+	{
+		const souint32 r = theRandom.Next() % 36;
+		pszOut[uiLength++] = (char)(r < 10 ? '0' + r : (r < 23 ? 'a' + r - 10 : 'A' + r - 23));
+	}
+	memcpy(pszOut + uiLength, pszExt, uiExtLength + 1);
+}
+//-----------------------------------------------------------------------------
+//修改之前的实现：先逐个字节格式化，再分别计算三个哈希值。
+souint32 SoBench_FormatName_Legacy(char* pszOut, const char* pszIn, souint32& uiHashA, souint32& uiHashB, souint32& uiHashC)
+{
+	soint64 nCount = 0;
+	while (pszIn[nCount] != 0)
+	{
+		char theC = pszIn[nCount];
+		if (theC >= 'A' && theC <= 'Z')
+		{
+			theC += 32;
+		}
+		else if (theC == '\\')
+		{
+			theC = '/';
+		}
+		pszOut[nCount] = theC;
+		++nCount;
+		if (nCount >= SoPackageFileMAX_PATH)
+		{
+			pszOut[SoPackageFileMAX_PATH-1] = 0;
+			break;
+		}
+	}
+	if (nCount < SoPackageFileMAX_PATH)
+	{
+		pszOut[nCount] = 0;
+	}
+	uiHashA = SoHash_Index(pszOut);
+	uiHashB = SoHash_PHP(pszOut);
+	uiHashC = SoHash_BKDR(pszOut);
+	return (souint32)strlen(pszOut);
+}
+//-----------------------------------------------------------------------------
+struct stPathDistribution
+{
+	const char* pszName;
+	souint32 uiMinLength;
+	souint32 uiMaxLength;
+};
+void SoBench_FormatName()
+{
+	//短路径，如"ui/btn_ok.png"；常见的资源路径；目录层次很深的路径。
+	const stPathDistribution theDistList[] = {
+		{"short(8-31)", 8, 31},
+		{"typical(32-96)", 32, 96},
+		{"deep(97-250)", 97, 250},
+	};
+	const souint32 uiDistCount = sizeof(theDistList) / sizeof(theDistList[0]);
+	const souint32 uiPathCount = 4096;
+	const souint32 uiRepeat = 200;
+	char* pPathBuff = (char*)malloc(uiPathCount * SoPackageFileMAX_PATH);
+	char szOut[SoPackageFileMAX_PATH];
+	const SoSimdLevel eDefaultLevel = SoHash_GetSimdLevel();
+	const char* szLevelName[] = {"scalar", "sse2", "avx2"};
+
+	printf("FormatName: %u paths x %u repeats, detected simd level: %s\n", uiPathCount, uiRepeat, szLevelName[eDefaultLevel]);
+	printf("%-16s %-10s %12s %12s\n", "distribution", "impl", "ns/name", "MB/s");
+	for (souint32 d=0; d<uiDistCount + 1; ++d)
+	{
+		//最后一轮为混合分布：短路径30%，常见路径60%，深路径10%。
+		const bool bMixed = (d == uiDistCount);
+		SoBenchRandom theRandom(20131020 + d);
+		soint64 nTotalBytes = 0;
+		for (souint32 i=0; i<uiPathCount; ++i)
+		{
+			const stPathDistribution* pDist = &theDistList[d < uiDistCount ? d : 0];
+			if (bMixed)
+			{
+				const souint32 r = theRandom.Next() % 10;
+				pDist = &theDistList[r < 3 ? 0 : (r < 9 ? 1 : 2)];
+			}
+			char* pszPath = pPathBuff + i * SoPackageFileMAX_PATH;
+			SoBench_MakePath(pszPath, pDist->uiMinLength, pDist->uiMaxLength, theRandom);
+			nTotalBytes += strlen(pszPath);
+		}
+		//以legacy实现为基准，其余依次是各个指令集级别。
+		for (soint32 nImpl=-1; nImpl<=(soint32)eDefaultLevel; ++nImpl)
+		{
+			if (nImpl >= 0)
+			{
+				SoHash_SetSimdLevel((SoSimdLevel)nImpl);
+			}
+			souint32 uiCheck = 0;
+			const double fStart = SoBench_Now();
+			for (souint32 r=0; r<uiRepeat; ++r)
+			{
+				for (souint32 i=0; i<uiPathCount; ++i)
+				{
+					const char* pszPath = pPathBuff + i * SoPackageFileMAX_PATH;
+					souint32 uiHashA, uiHashB, uiHashC;
+					if (nImpl < 0)
+					{
+						uiCheck += SoBench_FormatName_Legacy(szOut, pszPath, uiHashA, uiHashB, uiHashC);
+					}
+					else
+					{
+						uiCheck += SoHash_FormatName(szOut, pszPath, SoPackageFileMAX_PATH, uiHashA, uiHashB, uiHashC);
+					}
+					uiCheck ^= uiHashA ^ uiHashB ^ uiHashC;
+				}
+			}
+			const double fSeconds = SoBench_Now() - fStart;
+			const double fNames = (double)uiPathCount * uiRepeat;
+			printf("%-16s %-10s %12.2f %12.1f  (check %08x)\n", bMixed ? "mixed" : theDistList[d].pszName,
+				nImpl < 0 ? "legacy" : szLevelName[nImpl], fSeconds * 1e9 / fNames,
+				(double)nTotalBytes * uiRepeat / fSeconds / (1024.0 * 1024.0), uiCheck);
+			SoBench_Report("ns", fSeconds * 1e9 / fNames, "FormatName/%s/%s", bMixed ? "mixed" : theDistList[d].pszName,
+				nImpl < 0 ? "legacy" : szLevelName[nImpl]);
+		}
+		SoHash_SetSimdLevel(eDefaultLevel);
+	}
+	free(pPathBuff);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 测试用的资源包 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//第i个测试文件的文件名。
+void SoBench_MakeEntryNameIn(char* pszOut, const char* pszDir, souint32 i)
+{
+	sprintf(pszOut, "%sgroup%02u_entry_%06u.bin", pszDir, i % 64, i);
+}
+void SoBench_MakeEntryName(char* pszOut, souint32 i)
+{
+	SoBench_MakeEntryNameIn(pszOut, SoBench_TempDir, i);
+}
+//生成一个包含uiFileCount个文件的资源包，每个文件uiFileSize个字节。
+//uiLargeFileSize不为0时，编号为SoBench_LargeFileStep整数倍的文件大小为uiLargeFileSize。
+//临时的磁盘文件生成在pszEntryDir目录中，多个线程同时生成资源包时各自使用不同的目录。
+//返回生成的文件总个数，失败返回0。
+#define SoBench_LargeFileStep 32
+souint32 SoBench_CreatePackageIn(const char* pszPackage, const char* pszEntryDir, souint32 uiFileCount, souint32 uiFileSize, souint32 uiLargeFileSize)
+{
+	char szName[SoPackageFileMAX_PATH];
+	const souint32 uiMaxFileSize = (uiLargeFileSize > uiFileSize) ? uiLargeFileSize : uiFileSize;
+	char* pContent = (char*)malloc(uiMaxFileSize + 1);
+	SoBenchRandom theRandom(uiFileCount);
+	SoPackageFile thePackage;
+	SoBench_MakeDir(SoBench_TempDir);
+	SoBench_MakeDir(pszEntryDir);
+	remove(pszPackage);
+	if (thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Write) != SoPackageFile::Result_OK)
+	{
+		free(pContent);
+		return 0;
+	}
+	souint32 uiInserted = 0;
+	for (souint32 i=0; i<uiFileCount; ++i)
+	{
+		const souint32 uiSize = (uiLargeFileSize > 0 && i % SoBench_LargeFileStep == 0) ? uiLargeFileSize : uiFileSize;
+		//内容可以压缩，但不是全部相同的字节。
+		for (souint32 k=0; k<uiSize; ++k)
+		{
+			pContent[k] = (char)('a' + theRandom.Next() % 8);
+		}
+		sprintf(szName, "%sentry.tmp", pszEntryDir);
+		FILE* pFile = fopen(szName, "wb");
+		if (pFile == 0)
+		{
+			break;
+		}
+		fwrite(pContent, 1, uiSize, pFile);
+		fclose(pFile);
+		//InsertSingleFile使用磁盘文件名作为包内文件名，所以先改名。
+		char szEntry[SoPackageFileMAX_PATH];
+		SoBench_MakeEntryNameIn(szEntry, pszEntryDir, i);
+		if (rename(szName, szEntry) != 0)
+		{
+			break;
+		}
+		if (thePackage.InsertSingleFile(szEntry) == SoPackageFile::Result_OK)
+		{
+			++uiInserted;
+		}
+		remove(szEntry);
+	}
+	thePackage.FlushPackageFile();
+	thePackage.ReleasePackageFile();
+	free(pContent);
+	return uiInserted;
+}
+souint32 SoBench_CreatePackage(const char* pszPackage, souint32 uiFileCount, souint32 uiFileSize, souint32 uiLargeFileSize)
+{
+	return SoBench_CreatePackageIn(pszPackage, SoBench_TempDir, uiFileCount, uiFileSize, uiLargeFileSize);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 共用的测量 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//OpenPackage、LookupLatency、ReadThroughput和Regression使用相同的测量函数。
+//每个函数重复g_uiRepeat次，返回中位数。pAllocator不为0时统计它的申请次数，*pAllocCount返回最后一次测量的次数；
+//pStats不为0时返回最后一次测量的资源包统计。
+soint64 SoBench_AllocCount(SoAllocator* pAllocator)
+{
+	if (pAllocator == 0)
+	{
+		return 0;
+	}
+	stAllocatorStats theStats;
+	pAllocator->GetStats(&theStats, 1);
+	return theStats.nAllocCount;
+}
+//InitPackageFile的毫秒数：读取文件头和文件信息列表，建立哈希表。
+double SoBench_MeasureOpen(const char* pszPackage, SoAllocator* pAllocator, soint64* pAllocCount)
+{
+	double* pTimeList = (double*)malloc(g_uiRepeat * sizeof(double));
+	for (souint32 r=0; r<g_uiRepeat; ++r)
+	{
+		SoPackageFile thePackage;
+		if (pAllocator)
+		{
+			thePackage.SetAllocator(pAllocator);
+		}
+		const soint64 nAllocStart = SoBench_AllocCount(pAllocator);
+		const double fStart = SoBench_Now();
+		thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+		pTimeList[r] = (SoBench_Now() - fStart) * 1000.0;
+		if (pAllocCount)
+		{
+			*pAllocCount = SoBench_AllocCount(pAllocator) - nAllocStart;
+		}
+		thePackage.ReleasePackageFile();
+	}
+	const double fMedian = SoBench_Median(pTimeList, g_uiRepeat);
+	free(pTimeList);
+	return fMedian;
+}
+//从pNameBuff中的uiNameCount个文件名（间隔SoPackageFileMAX_PATH）中随机选择，Open共uiLookupCount次，返回每次的纳秒数。
+//文件名预先生成，不计入时间；随机数的种子固定，每次测量的查找顺序相同。
+double SoBench_MeasureLookup(SoPackageFile& thePackage, const char* pNameBuff, souint32 uiNameCount, souint32 uiLookupCount,
+	SoAllocator* pAllocator, soint64* pAllocCount, SoPackageFile::stStats* pStats)
+{
+	double* pTimeList = (double*)malloc(g_uiRepeat * sizeof(double));
+	for (souint32 r=0; r<g_uiRepeat; ++r)
+	{
+		SoBenchRandom theRandom(31);
+		thePackage.ResetStats();
+		const soint64 nAllocStart = SoBench_AllocCount(pAllocator);
+		const double fStart = SoBench_Now();
+		for (souint32 k=0; k<uiLookupCount; ++k)
+		{
+			SoPackageFile::stReadSingleFile theFile;
+			thePackage.Open(pNameBuff + (theRandom.Next() % uiNameCount) * SoPackageFileMAX_PATH, theFile);
+		}
+		pTimeList[r] = (SoBench_Now() - fStart) * 1e9 / uiLookupCount;
+		if (pAllocCount)
+		{
+			*pAllocCount = SoBench_AllocCount(pAllocator) - nAllocStart;
+		}
+		if (pStats)
+		{
+			thePackage.GetStats(*pStats);
+		}
+	}
+	const double fMedian = SoBench_Median(pTimeList, g_uiRepeat);
+	free(pTimeList);
+	return fMedian;
+}
+#define SoBench_MaxReadThreads 4
+struct stReadThreadParam
+{
+	SoPackageFile* pPackage;
+	const soint64* pFileIDList;
+	const soint64* pFileSizeList;
+	souint32 uiFileCount;
+	souint32 uiFirst;
+	soint64 nBuffSize;
+	soint64 nReadBytes;
+};
+//从uiFirst开始依次读取所有文件，每个线程的起点不同。
+void SoBench_ReadThread(void* pParam)
+{
+	stReadThreadParam* pThreadParam = (stReadThreadParam*)pParam;
+	char* pBuff = (char*)malloc((size_t)pThreadParam->nBuffSize);
+	for (souint32 i=0; i<pThreadParam->uiFileCount; ++i)
+	{
+		const souint32 uiIndex = (pThreadParam->uiFirst + i) % pThreadParam->uiFileCount;
+		if (pThreadParam->pPackage->ReadWholeFile(pThreadParam->pFileIDList[uiIndex], pBuff, pThreadParam->nBuffSize) == SoPackageFile::Result_OK)
+		{
+			pThreadParam->nReadBytes += pThreadParam->pFileSizeList[uiIndex];
+		}
+	}
+	free(pBuff);
+}
+//uiThreadCount个线程各自用ReadWholeFile读取一遍列表中的所有文件，返回总的MB/s。
+//只有一个线程时在当前线程中读取，当前线程的临时缓存可以在多次测量之间重复使用。
+double SoBench_MeasureRead(SoPackageFile& thePackage, const soint64* pFileIDList, const soint64* pFileSizeList, souint32 uiFileCount,
+	soint64 nBuffSize, souint32 uiThreadCount, SoAllocator* pAllocator, soint64* pAllocCount, SoPackageFile::stStats* pStats)
+{
+	SoThread theThreadList[SoBench_MaxReadThreads];
+	stReadThreadParam theParamList[SoBench_MaxReadThreads];
+	double* pRateList = (double*)malloc(g_uiRepeat * sizeof(double));
+	if (uiThreadCount > SoBench_MaxReadThreads)
+	{
+		uiThreadCount = SoBench_MaxReadThreads;
+	}
+	for (souint32 r=0; r<g_uiRepeat; ++r)
+	{
+		thePackage.ResetStats();
+		const soint64 nAllocStart = SoBench_AllocCount(pAllocator);
+		const double fStart = SoBench_Now();
+		for (souint32 i=0; i<uiThreadCount; ++i)
+		{
+			stReadThreadParam& theParam = theParamList[i];
+			theParam.pPackage = &thePackage;
+			theParam.pFileIDList = pFileIDList;
+			theParam.pFileSizeList = pFileSizeList;
+			theParam.uiFileCount = uiFileCount;
+			theParam.uiFirst = i * uiFileCount / uiThreadCount;
+			theParam.nBuffSize = nBuffSize;
+			theParam.nReadBytes = 0;
+			if (uiThreadCount == 1)
+			{
+				SoBench_ReadThread(&theParam);
+			}
+			else
+			{
+				theThreadList[i].Start(SoBench_ReadThread, &theParam);
+			}
+		}
+		soint64 nTotalBytes = 0;
+		for (souint32 i=0; i<uiThreadCount; ++i)
+		{
+			if (uiThreadCount > 1)
+			{
+				theThreadList[i].Join();
+			}
+			nTotalBytes += theParamList[i].nReadBytes;
+		}
+		pRateList[r] = nTotalBytes / (SoBench_Now() - fStart) / (1024.0 * 1024.0);
+		if (pAllocCount)
+		{
+			*pAllocCount = SoBench_AllocCount(pAllocator) - nAllocStart;
+		}
+		if (pStats)
+		{
+			thePackage.GetStats(*pStats);
+		}
+	}
+	const double fMedian = SoBench_Median(pRateList, g_uiRepeat);
+	free(pRateList);
+	return fMedian;
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 多线程查找文件 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+struct stLookupThreadParam
+{
+	SoPackageFile* pPackage;
+	souint32 uiFileCount;
+	souint32 uiLookupCount;
+	souint32 uiSeed;
+	souint32 uiFound;
+};
+void SoBench_LookupThread(void* pParam)
+{
+	stLookupThreadParam* pThreadParam = (stLookupThreadParam*)pParam;
+	SoBenchRandom theRandom(pThreadParam->uiSeed);
+	char szName[SoPackageFileMAX_PATH];
+	for (souint32 i=0; i<pThreadParam->uiLookupCount; ++i)
+	{
+		SoBench_MakeEntryName(szName, theRandom.Next() % pThreadParam->uiFileCount);
+		SoPackageFile::stReadSingleFile theFile;
+		if (pThreadParam->pPackage->Open(szName, theFile) == SoPackageFile::Result_OK)
+		{
+			++pThreadParam->uiFound;
+		}
+	}
+}
+void SoBench_LookupScaling()
+{
+	const char* pszPackage = SoBench_TempDir "lookup.sof";
+	const souint32 uiFileCount = SoBench_CreatePackage(pszPackage, 10000, 16, 0);
+	if (uiFileCount == 0)
+	{
+		printf("LookupScaling: create package fail\n");
+		return;
+	}
+	SoPackageFile thePackage;
+	thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+	const souint32 uiLookupPerThread = 200000;
+	const souint32 uiThreadCountList[] = {1, 2, 4, 8, 16, 32, 64};
+	const souint32 uiListSize = sizeof(uiThreadCountList) / sizeof(uiThreadCountList[0]);
+	SoThread theThreadList[64];
+	stLookupThreadParam theParamList[64];
+	double fSingleRate = 0.0;
+	printf("LookupScaling: %u entries, %u lookups per thread\n", uiFileCount, uiLookupPerThread);
+	printf("%8s %14s %10s\n", "threads", "lookups/s", "scaling");
+	for (souint32 n=0; n<uiListSize; ++n)
+	{
+		const souint32 uiThreadCount = uiThreadCountList[n];
+		const double fStart = SoBench_Now();
+		for (souint32 i=0; i<uiThreadCount; ++i)
+		{
+			theParamList[i].pPackage = &thePackage;
+			theParamList[i].uiFileCount = uiFileCount;
+			theParamList[i].uiLookupCount = uiLookupPerThread;
+			theParamList[i].uiSeed = 1000 + i;
+			theParamList[i].uiFound = 0;
+			theThreadList[i].Start(SoBench_LookupThread, &theParamList[i]);
+		}
+		for (souint32 i=0; i<uiThreadCount; ++i)
+		{
+			theThreadList[i].Join();
+		}
+		const double fSeconds = SoBench_Now() - fStart;
+		const double fRate = (double)uiLookupPerThread * uiThreadCount / fSeconds;
+		if (n == 0)
+		{
+			fSingleRate = fRate;
+		}
+		printf("%8u %14.0f %10.2f\n", uiThreadCount, fRate, fRate / fSingleRate);
+		SoBench_Report("lookups/s", fRate, "LookupScaling/%ut", uiThreadCount);
+	}
+	thePackage.ReleasePackageFile();
+	remove(pszPackage);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 批量读取 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//模拟服务启动时的预热：打开并读取资源包内的所有文件。
+//逐个调用Read与一次调用ReadMany做比较。
+void SoBench_ReadMany()
+{
+	const char* pszPackage = SoBench_TempDir "readmany.sof";
+	const souint32 uiFileCount = SoBench_CreatePackage(pszPackage, 4000, 16384, 0);
+	if (uiFileCount == 0)
+	{
+		printf("ReadMany: create package fail\n");
+		return;
+	}
+	char szName[SoPackageFileMAX_PATH];
+	char* pBuff = (char*)malloc(16384);
+	SoPackageFile::stReadSingleFile* pFileList = new SoPackageFile::stReadSingleFile[uiFileCount];
+	printf("ReadMany: %u entries\n", uiFileCount);
+	printf("%10s %10s %12s\n", "method", "seconds", "entries/s");
+	for (int nMethod=0; nMethod<2; ++nMethod)
+	{
+		//每次都重新打开资源包，避免上一轮的缓存影响结果。
+		SoPackageFile thePackage;
+		thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+		const double fStart = SoBench_Now();
+		for (souint32 i=0; i<uiFileCount; ++i)
+		{
+			SoBench_MakeEntryName(szName, i);
+			thePackage.Open(szName, pFileList[i]);
+		}
+		if (nMethod == 0)
+		{
+			soint64 nActuallyReadCount = 0;
+			for (souint32 i=0; i<uiFileCount; ++i)
+			{
+				thePackage.Read(pBuff, 1, pFileList[i].nFileSize, nActuallyReadCount, pFileList[i]);
+			}
+		}
+		else
+		{
+			thePackage.ReadMany(pFileList, uiFileCount, 0);
+		}
+		const double fSeconds = SoBench_Now() - fStart;
+		printf("%10s %10.3f %12.0f\n", nMethod == 0 ? "Read" : "ReadMany", fSeconds, uiFileCount / fSeconds);
+		SoBench_Report("entries/s", uiFileCount / fSeconds, "ReadMany/%s", nMethod == 0 ? "Read" : "ReadMany");
+		for (souint32 i=0; i<uiFileCount; ++i)
+		{
+			thePackage.Close(pFileList[i]);
+		}
+		thePackage.ReleasePackageFile();
+	}
+	delete [] pFileList;
+	free(pBuff);
+	remove(pszPackage);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 前台读取的延迟 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+void SoBench_IgnoreCallback(SoPackageFile::OperationResult /*eResult*/, SoPackageFile::stReadSingleFile& /*theFile*/, void* /*pUserData*/)
+{
+}
+//后台以低优先级异步读取大文件的同时，前台逐个读取小文件，统计每次读取的延迟。
+void SoBench_PriorityLatency()
+{
+	const char* pszPackage = SoBench_TempDir "priority.sof";
+	const souint32 uiFileCount = SoBench_CreatePackage(pszPackage, 1024, 4096, 2*1024*1024);
+	if (uiFileCount == 0)
+	{
+		printf("PriorityLatency: create package fail\n");
+		return;
+	}
+	const souint32 uiReadCount = 2000;
+	const souint32 uiLargeCount = (uiFileCount + SoBench_LargeFileStep - 1) / SoBench_LargeFileStep;
+	double* pLatencyList = (double*)malloc(uiReadCount * sizeof(double));
+	char* pBuff = (char*)malloc(4096);
+	SoPackageFile::stReadSingleFile* pLargeList = new SoPackageFile::stReadSingleFile[uiLargeCount];
+	char szName[SoPackageFileMAX_PATH];
+	printf("PriorityLatency: %u small reads, %u large background entries\n", uiReadCount, uiLargeCount);
+	printf("%12s %10s %10s %10s\n", "background", "p50(us)", "p99(us)", "max(us)");
+	for (int nBackground=0; nBackground<2; ++nBackground)
+	{
+		SoPackageFile thePackage;
+		thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+		if (nBackground)
+		{
+			for (souint32 i=0; i<uiLargeCount; ++i)
+			{
+				SoBench_MakeEntryName(szName, i * SoBench_LargeFileStep);
+				thePackage.Open(szName, pLargeList[i]);
+				thePackage.ReadAsync(pLargeList[i], SoBench_IgnoreCallback, 0, 0, 0, SoThreadPool::Priority_Low);
+			}
+		}
+		SoBenchRandom theRandom(31);
+		for (souint32 i=0; i<uiReadCount; ++i)
+		{
+			//跳过大文件。
+			souint32 uiIndex = theRandom.Next() % uiFileCount;
+			if (uiIndex % SoBench_LargeFileStep == 0)
+			{
+				++uiIndex;
+			}
+			SoBench_MakeEntryName(szName, uiIndex % uiFileCount);
+			const double fStart = SoBench_Now();
+			SoPackageFile::stReadSingleFile theFile;
+			soint64 nActuallyReadCount = 0;
+			thePackage.Open(szName, theFile);
+			thePackage.Read(pBuff, 1, theFile.nFileSize, nActuallyReadCount, theFile);
+			thePackage.Close(theFile);
+			pLatencyList[i] = (SoBench_Now() - fStart) * 1000000.0;
+		}
+		qsort(pLatencyList, uiReadCount, sizeof(double), SoBench_CompareDouble);
+		printf("%12s %10.1f %10.1f %10.1f\n", nBackground ? "yes" : "no",
+			pLatencyList[uiReadCount / 2], pLatencyList[uiReadCount * 99 / 100], pLatencyList[uiReadCount - 1]);
+		SoBench_Report("us", pLatencyList[uiReadCount / 2], "PriorityLatency/%s/p50", nBackground ? "background" : "idle");
+		SoBench_Report("us", pLatencyList[uiReadCount * 99 / 100], "PriorityLatency/%s/p99", nBackground ? "background" : "idle");
+		//ReleasePackageFile会取消尚未开始的后台读取。
+		thePackage.ReleasePackageFile();
+		for (souint32 i=0; i<uiLargeCount; ++i)
+		{
+			thePackage.Close(pLargeList[i]);
+		}
+	}
+	delete [] pLargeList;
+	free(pBuff);
+	free(pLatencyList);
+	remove(pszPackage);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 读取整个文件 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//读取整个文件的三种方式：Open+Read（解压缩到pFileBuff再复制）、ReadWholeFile（直接解压缩到调用者的缓存）、
+//AcquireView（不复制）。不使用文件缓存，每种方式都从磁盘读取并解压缩。
+void SoBench_ReadWholeFile()
+{
+	const char* pszPackage = SoBench_TempDir "readwhole.sof";
+	const souint32 uiFileSize = 256*1024;
+	const souint32 uiFileCount = SoBench_CreatePackage(pszPackage, 256, uiFileSize, 0);
+	if (uiFileCount == 0)
+	{
+		printf("ReadWholeFile: create package fail\n");
+		return;
+	}
+	char szName[SoPackageFileMAX_PATH];
+	char* pBuff = (char*)malloc(uiFileSize);
+	const char* pszMethodName[3] = {"Read", "WholeFile", "View"};
+	printf("ReadWholeFile: %u entries, %u bytes each\n", uiFileCount, uiFileSize);
+	printf("%10s %10s %12s\n", "method", "seconds", "MB/s");
+	for (int nMethod=0; nMethod<3; ++nMethod)
+	{
+		SoPackageFile thePackage;
+		thePackage.SetEntryCacheSize(0);
+		thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+		soint64 nTotalSize = 0;
+		const double fStart = SoBench_Now();
+		for (souint32 i=0; i<uiFileCount; ++i)
+		{
+			SoBench_MakeEntryName(szName, i);
+			SoPackageFile::stReadSingleFile theFile;
+			if (thePackage.Open(szName, theFile) != SoPackageFile::Result_OK)
+			{
+				continue;
+			}
+			nTotalSize += theFile.nFileSize;
+			if (nMethod == 0)
+			{
+				soint64 nActuallyReadCount = 0;
+				thePackage.Read(pBuff, 1, theFile.nFileSize, nActuallyReadCount, theFile);
+				thePackage.Close(theFile);
+			}
+			else if (nMethod == 1)
+			{
+				thePackage.ReadWholeFile(theFile.nFileID, pBuff, uiFileSize);
+			}
+			else
+			{
+				SoPackageFile::stFileView theView;
+				if (thePackage.AcquireView(theFile.nFileID, theView) == SoPackageFile::Result_OK)
+				{
+					thePackage.ReleaseView(theView);
+				}
+			}
+		}
+		const double fSeconds = SoBench_Now() - fStart;
+		printf("%10s %10.3f %12.1f\n", pszMethodName[nMethod], fSeconds, nTotalSize / fSeconds / (1024.0 * 1024.0));
+		SoBench_Report("MB/s", nTotalSize / fSeconds / (1024.0 * 1024.0), "ReadWholeFile/%s", pszMethodName[nMethod]);
+		thePackage.ReleasePackageFile();
+	}
+	free(pBuff);
+	remove(pszPackage);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 小文件的压缩和解压缩 <<<<<<<<<<<<<<<<<<<<<<<<
+//文件很小时，压缩和解压缩的开销主要是zlib的初始化。
+//写入时间包括生成临时磁盘文件，读取不使用文件缓存。
+void SoBench_SmallEntry()
+{
+	const char* pszPackage = SoBench_TempDir "small.sof";
+	const souint32 uiFileSize = 512;
+	const double fCreateStart = SoBench_Now();
+	const souint32 uiFileCount = SoBench_CreatePackage(pszPackage, 8000, uiFileSize, 0);
+	const double fCreateSeconds = SoBench_Now() - fCreateStart;
+	if (uiFileCount == 0)
+	{
+		printf("SmallEntry: create package fail\n");
+		return;
+	}
+	const souint32 uiRoundCount = 5;
+	char szName[SoPackageFileMAX_PATH];
+	char szBuff[uiFileSize];
+	SoPackageFile thePackage;
+	thePackage.SetEntryCacheSize(0);
+	thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+	soint64* pFileIDList = (soint64*)malloc(uiFileCount * sizeof(soint64));
+	for (souint32 i=0; i<uiFileCount; ++i)
+	{
+		SoBench_MakeEntryName(szName, i);
+		SoPackageFile::stReadSingleFile theFile;
+		thePackage.Open(szName, theFile);
+		pFileIDList[i] = theFile.nFileID;
+	}
+	const double fReadStart = SoBench_Now();
+	for (souint32 r=0; r<uiRoundCount; ++r)
+	{
+		for (souint32 i=0; i<uiFileCount; ++i)
+		{
+			thePackage.ReadWholeFile(pFileIDList[i], szBuff, uiFileSize);
+		}
+	}
+	const double fReadSeconds = SoBench_Now() - fReadStart;
+	printf("SmallEntry: %u entries, %u bytes each\n", uiFileCount, uiFileSize);
+	printf("%10s %12s\n", "operation", "entries/s");
+	printf("%10s %12.0f\n", "insert", uiFileCount / fCreateSeconds);
+	printf("%10s %12.0f\n", "read", uiFileCount * uiRoundCount / fReadSeconds);
+	SoBench_Report("entries/s", uiFileCount / fCreateSeconds, "SmallEntry/insert");
+	SoBench_Report("entries/s", uiFileCount * uiRoundCount / fReadSeconds, "SmallEntry/read");
+	free(pFileIDList);
+	thePackage.ReleasePackageFile();
+	remove(pszPackage);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 打开资源包 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//不同文件个数的资源包，InitPackageFile的时间。
+void SoBench_OpenPackage()
+{
+	const char* pszPackage = SoBench_TempDir "open.sof";
+	const souint32 uiCountList[] = {1000, 4000, 16000};
+	const souint32 uiListSize = sizeof(uiCountList) / sizeof(uiCountList[0]);
+	printf("OpenPackage: median of %u runs\n", g_uiRepeat);
+	printf("%10s %12s\n", "entries", "ms");
+	for (souint32 n=0; n<uiListSize; ++n)
+	{
+		const souint32 uiFileCount = SoBench_CreatePackage(pszPackage, uiCountList[n], 16, 0);
+		if (uiFileCount == 0)
+		{
+			printf("OpenPackage: create package fail\n");
+			break;
+		}
+		const double fMedian = SoBench_MeasureOpen(pszPackage, 0, 0);
+		printf("%10u %12.3f\n", uiFileCount, fMedian);
+		SoBench_Report("ms", fMedian, "OpenPackage/%u", uiFileCount);
+	}
+	remove(pszPackage);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 查找文件的延迟 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//单线程Open的平均时间，分别查找存在和不存在的文件。
+#define SoBench_LookupLatencyCount 262144
+void SoBench_LookupLatency()
+{
+	const char* pszPackage = SoBench_TempDir "lookuplatency.sof";
+	const souint32 uiFileCount = SoBench_CreatePackage(pszPackage, 10000, 16, 0);
+	if (uiFileCount == 0)
+	{
+		printf("LookupLatency: create package fail\n");
+		return;
+	}
+	char* pNameBuff = (char*)malloc(uiFileCount * SoPackageFileMAX_PATH);
+	SoPackageFile thePackage;
+	thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+	printf("LookupLatency: %u entries, median of %u runs\n", uiFileCount, g_uiRepeat);
+	printf("%10s %12s\n", "lookup", "ns/op");
+	for (int nMiss=0; nMiss<2; ++nMiss)
+	{
+		for (souint32 i=0; i<uiFileCount; ++i)
+		{
+			char* pszName = pNameBuff + i * SoPackageFileMAX_PATH;
+			if (nMiss)
+			{
+				sprintf(pszName, SoBench_TempDir "missing_entry_%06u.bin", i);
+			}
+			else
+			{
+				SoBench_MakeEntryName(pszName, i);
+			}
+		}
+		SoPackageFile::stStats theStats;
+		const double fMedian = SoBench_MeasureLookup(thePackage, pNameBuff, uiFileCount, SoBench_LookupLatencyCount, 0, 0, &theStats);
+		printf("%10s %12.1f  (found %lld)\n", nMiss ? "miss" : "hit", fMedian, (long long)(theStats.nOpenCount - theStats.nMissCount));
+		SoBench_Report("ns", fMedian, "LookupLatency/%s", nMiss ? "miss" : "hit");
+	}
+	thePackage.ReleasePackageFile();
+	free(pNameBuff);
+	remove(pszPackage);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 读取吞吐量 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//小文件和大文件分别在单线程和多线程下的读取速度，不使用文件缓存，每次都从磁盘读取并解压缩。
+//同时记录临时缓存占用的最大字节数。
+void SoBench_ReadThroughput()
+{
+	struct stEntryKind
+	{
+		const char* pszName;
+		souint32 uiFileCount;
+		souint32 uiFileSize;
+	};
+	const stEntryKind theKindList[] = {
+		{"small", 4000, 4096},
+		{"large", 64, 1024*1024},
+	};
+	const souint32 uiKindCount = sizeof(theKindList) / sizeof(theKindList[0]);
+	const souint32 uiThreadCountList[] = {1, 4};
+	const souint32 uiListSize = sizeof(uiThreadCountList) / sizeof(uiThreadCountList[0]);
+	char szName[SoPackageFileMAX_PATH];
+	printf("ReadThroughput: median of %u runs\n", g_uiRepeat);
+	printf("%8s %8s %12s %14s\n", "entries", "threads", "MB/s", "scratch peak");
+	for (souint32 k=0; k<uiKindCount; ++k)
+	{
+		const stEntryKind& theKind = theKindList[k];
+		const char* pszPackage = SoBench_TempDir "throughput.sof";
+		const souint32 uiFileCount = SoBench_CreatePackage(pszPackage, theKind.uiFileCount, theKind.uiFileSize, 0);
+		if (uiFileCount == 0)
+		{
+			printf("ReadThroughput: create package fail\n");
+			break;
+		}
+		soint64* pFileIDList = (soint64*)malloc(uiFileCount * sizeof(soint64));
+		soint64* pFileSizeList = (soint64*)malloc(uiFileCount * sizeof(soint64));
+		SoPackageFile thePackage;
+		thePackage.SetEntryCacheSize(0);
+		thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+		for (souint32 i=0; i<uiFileCount; ++i)
+		{
+			SoBench_MakeEntryName(szName, i);
+			SoPackageFile::stReadSingleFile theFile;
+			thePackage.Open(szName, theFile);
+			pFileIDList[i] = theFile.nFileID;
+			pFileSizeList[i] = theFile.nFileSize;
+		}
+		for (souint32 n=0; n<uiListSize; ++n)
+		{
+			const souint32 uiThreadCount = uiThreadCountList[n];
+			const double fMedian = SoBench_MeasureRead(thePackage, pFileIDList, pFileSizeList, uiFileCount, theKind.uiFileSize, uiThreadCount, 0, 0, 0);
+			SoPackageFile::stScratchStats theScratch;
+			thePackage.GetScratchStats(theScratch);
+			printf("%8s %8u %12.1f %14lld\n", theKind.pszName, uiThreadCount, fMedian, (long long)theScratch.nPeakBytes);
+			SoBench_Report("MB/s", fMedian, "ReadThroughput/%s/%ut", theKind.pszName, uiThreadCount);
+			SoBench_Report("bytes", (double)theScratch.nPeakBytes, "ReadThroughput/%s/%ut/scratch_peak", theKind.pszName, uiThreadCount);
+		}
+		thePackage.ReleasePackageFile();
+		free(pFileSizeList);
+		free(pFileIDList);
+		remove(pszPackage);
+	}
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 打包吞吐量 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+struct stPackThreadParam
+{
+	char szPackage[SoPackageFileMAX_PATH];
+	char szEntryDir[SoPackageFileMAX_PATH];
+	souint32 uiInserted;
+};
+#define SoBench_PackFileCount 200
+#define SoBench_PackFileSize (64*1024)
+void SoBench_PackThread(void* pParam)
+{
+	stPackThreadParam* pThreadParam = (stPackThreadParam*)pParam;
+	pThreadParam->uiInserted = SoBench_CreatePackageIn(pThreadParam->szPackage, pThreadParam->szEntryDir, SoBench_PackFileCount, SoBench_PackFileSize, 0);
+}
+//一个资源包只能由一个线程写入，多个线程各自生成自己的资源包，统计总的速度。
+//时间包括生成临时磁盘文件。
+void SoBench_PackThroughput()
+{
+	const souint32 uiThreadCountList[] = {1, 2, 4};
+	const souint32 uiListSize = sizeof(uiThreadCountList) / sizeof(uiThreadCountList[0]);
+	SoThread theThreadList[4];
+	stPackThreadParam theParamList[4];
+	double* pRateList = (double*)malloc(g_uiRepeat * sizeof(double));
+	printf("PackThroughput: %u entries x %u bytes per thread, median of %u runs\n", SoBench_PackFileCount, SoBench_PackFileSize, g_uiRepeat);
+	printf("%8s %12s\n", "threads", "MB/s");
+	for (souint32 n=0; n<uiListSize; ++n)
+	{
+		const souint32 uiThreadCount = uiThreadCountList[n];
+		for (souint32 r=0; r<g_uiRepeat; ++r)
+		{
+			const double fStart = SoBench_Now();
+			for (souint32 i=0; i<uiThreadCount; ++i)
+			{
+				sprintf(theParamList[i].szPackage, SoBench_TempDir "pack%u.sof", i);
+				sprintf(theParamList[i].szEntryDir, SoBench_TempDir "pack%u/", i);
+				theParamList[i].uiInserted = 0;
+				theThreadList[i].Start(SoBench_PackThread, &theParamList[i]);
+			}
+			double fTotalBytes = 0.0;
+			for (souint32 i=0; i<uiThreadCount; ++i)
+			{
+				theThreadList[i].Join();
+				fTotalBytes += (double)theParamList[i].uiInserted * SoBench_PackFileSize;
+			}
+			pRateList[r] = fTotalBytes / (SoBench_Now() - fStart) / (1024.0 * 1024.0);
+		}
+		const double fMedian = SoBench_Median(pRateList, g_uiRepeat);
+		printf("%8u %12.1f\n", uiThreadCount, fMedian);
+		SoBench_Report("MB/s", fMedian, "PackThroughput/%ut", uiThreadCount);
+		for (souint32 i=0; i<uiThreadCount; ++i)
+		{
+			remove(theParamList[i].szPackage);
+		}
+	}
+	free(pRateList);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 混合资源 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//用SoCorpus生成大小和内容各不相同的文件，直接从内存写入资源包，不经过磁盘。
+//然后打开资源包，按写入的顺序读取所有文件。
+#define SoBench_CorpusSpec "text:70:64-16K,binary:25:1K-256K,media:5:64K-512K"
+#define SoBench_CorpusCount 2000
+void SoBench_CorpusPack()
+{
+	const char* pszPackage = SoBench_TempDir "corpus.sof";
+	SoCorpus theCorpus;
+	theCorpus.SetSpec(SoBench_CorpusSpec);
+	SoBench_MakeDir(SoBench_TempDir);
+	remove(pszPackage);
+	soint64 nTotalBytes = 0;
+	const double fPackStart = SoBench_Now();
+	{
+		SoPackageFile thePackage;
+		SoPackageFile::OperationResult eResult = thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Write);
+		if (eResult == SoPackageFile::Result_OK)
+		{
+			eResult = theCorpus.WritePackage(thePackage, 0, SoBench_CorpusCount, &nTotalBytes);
+		}
+		thePackage.FlushPackageFile();
+		thePackage.ReleasePackageFile();
+		if (eResult != SoPackageFile::Result_OK)
+		{
+			printf("CorpusPack: create package fail, result %d\n", (int)eResult);
+			remove(pszPackage);
+			return;
+		}
+	}
+	const double fPackSeconds = SoBench_Now() - fPackStart;
+	SoPackageFile thePackage;
+	thePackage.SetEntryCacheSize(0);
+	const double fOpenStart = SoBench_Now();
+	thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+	const double fOpenSeconds = SoBench_Now() - fOpenStart;
+	char* pBuff = (char*)malloc((size_t)theCorpus.GetMaxSize() + 1);
+	char szName[SoPackageFileMAX_PATH];
+	soint64 nSize = 0;
+	SoCorpus::ContentKind eKind = SoCorpus::Content_Text;
+	souint32 uiReadCount = 0;
+	const double fReadStart = SoBench_Now();
+	for (souint32 i=0; i<SoBench_CorpusCount; ++i)
+	{
+		theCorpus.GetEntry(i, szName, nSize, eKind);
+		SoPackageFile::stReadSingleFile theFile;
+		if (thePackage.Open(szName, theFile) == SoPackageFile::Result_OK
+			&& thePackage.ReadWholeFile(theFile.nFileID, pBuff, nSize + 1) == SoPackageFile::Result_OK)
+		{
+			++uiReadCount;
+		}
+	}
+	const double fReadSeconds = SoBench_Now() - fReadStart;
+	const double fMegaBytes = (double)nTotalBytes / (1024.0 * 1024.0);
+	printf("CorpusPack: %u entries, %.1f MB, %u read back\n", SoBench_CorpusCount, fMegaBytes, uiReadCount);
+	printf("%10s %12s %12s\n", "operation", "entries/s", "MB/s");
+	printf("%10s %12.0f %12.1f\n", "pack", SoBench_CorpusCount / fPackSeconds, fMegaBytes / fPackSeconds);
+	printf("%10s %12.0f %12.1f\n", "read", SoBench_CorpusCount / fReadSeconds, fMegaBytes / fReadSeconds);
+	printf("%10s %12.3f ms\n", "open", fOpenSeconds * 1000.0);
+	SoBench_Report("entries/s", SoBench_CorpusCount / fPackSeconds, "CorpusPack/pack_entries");
+	SoBench_Report("MB/s", fMegaBytes / fPackSeconds, "CorpusPack/pack");
+	SoBench_Report("MB/s", fMegaBytes / fReadSeconds, "CorpusPack/read");
+	SoBench_Report("ms", fOpenSeconds * 1000.0, "CorpusPack/open");
+	free(pBuff);
+	thePackage.ReleasePackageFile();
+	remove(pszPackage);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 读取时的校验 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//同一组文件分别以zlib格式和raw deflate写入，比较不同ReadVerify下ReadWholeFile的速度。
+//zlib格式的压缩文件只由zlib计算adler32，不计算CRC32C；raw deflate在ReadVerify_Never时没有任何校验。
+//每种组合读取两遍，ReadVerify_FirstTouch只在第一遍计算校验值。
+#define SoBench_ReadVerifyCount 1000
+//按文件名找到语料中的每个文件，ReadWholeFile读到的内容必须与语料生成的内容逐字节相同，并且至少有一个raw deflate的文件。
+void SoBench_ReadVerifyCompare(const char* pszPackage, const SoCorpus& theCorpus, char* pBuff)
+{
+	SoPackageFile thePackage;
+	thePackage.SetEntryCacheSize(0);
+	thePackage.SetReadVerify(SoPackageFile::ReadVerify_Never);
+	thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+	char* pExpect = (char*)malloc((size_t)theCorpus.GetMaxSize() + 1);
+	char szName[SoPackageFileMAX_PATH];
+	souint32 uiRawCount = 0;
+	souint32 uiMismatch = 0;
+	for (soint64 i=0; i<SoBench_ReadVerifyCount; ++i)
+	{
+		soint64 nSize = 0;
+		SoCorpus::ContentKind eKind;
+		theCorpus.GetEntry(i, szName, nSize, eKind);
+		theCorpus.FillContent(i, pExpect, nSize, eKind);
+		SoPackageFile::stReadSingleFile theFile;
+		SoPackageFile::stSingleFileInfo theInfo;
+		if (thePackage.Open(szName, theFile) != SoPackageFile::Result_OK
+			|| thePackage.GetSingleFileInfo(theFile.nFileID, theInfo) != SoPackageFile::Result_OK
+			|| thePackage.ReadWholeFile(theFile.nFileID, pBuff, theCorpus.GetMaxSize() + 1) != SoPackageFile::Result_OK
+			|| theInfo.nOriginalFileSize != nSize || memcmp(pBuff, pExpect, (size_t)nSize) != 0)
+		{
+			++uiMismatch;
+		}
+		else if (theInfo.uiFlags & SoPackageFile::SingleFile_RawDeflate)
+		{
+			++uiRawCount;
+		}
+		thePackage.Close(theFile);
+	}
+	SoBench_Check(uiMismatch == 0 && uiRawCount > 0, "ReadVerify: %u raw entries differ from the corpus, %u raw deflate entries matched", uiMismatch, uiRawCount);
+	free(pExpect);
+	thePackage.ReleasePackageFile();
+}
+//把资源包中第一个非空文件的数据中间的一个字节取反，两种级别的Verify和ReadVerify_Always下的ReadWholeFile都必须失败。
+void SoBench_ReadVerifyCorrupt(const char* pszPackage, char* pBuff, soint64 nCapacity)
+{
+	SoPackageFile::stSingleFileInfo theInfo;
+	soint64 nFileID = -1;
+	{
+		SoPackageFile thePackage;
+		if (thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read) == SoPackageFile::Result_OK)
+		{
+			for (soint64 i=0; i<thePackage.GetFileCount(); ++i)
+			{
+				if (thePackage.GetSingleFileInfo(i, theInfo) == SoPackageFile::Result_OK && theInfo.nEmbededFileSize > 0)
+				{
+					nFileID = i;
+					break;
+				}
+			}
+		}
+	}
+	FILE* pFile = (nFileID >= 0) ? fopen(pszPackage, "r+b") : 0;
+	if (pFile == 0)
+	{
+		SoBench_Check(false, "ReadVerify: no entry to corrupt in %s", pszPackage);
+		return;
+	}
+	const long nPosition = (long)(theInfo.nOffset + theInfo.nEmbededFileSize / 2);
+	fseek(pFile, nPosition, SEEK_SET);
+	const int nByte = fgetc(pFile);
+	fseek(pFile, nPosition, SEEK_SET);
+	fputc(~nByte & 0xFF, pFile);
+	fclose(pFile);
+	SoPackageFile thePackage;
+	thePackage.SetEntryCacheSize(0);
+	thePackage.SetReadVerify(SoPackageFile::ReadVerify_Always);
+	thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+	const SoPackageFile::OperationResult eEmbeded = thePackage.Verify(1, SoPackageFile::Verify_Embeded, 0, 0);
+	const SoPackageFile::OperationResult eInflate = thePackage.Verify(1, SoPackageFile::Verify_Inflate, 0, 0);
+	const SoPackageFile::OperationResult eRead = thePackage.ReadWholeFile(nFileID, pBuff, nCapacity);
+	SoBench_Check(eEmbeded != SoPackageFile::Result_OK && eInflate != SoPackageFile::Result_OK && eRead != SoPackageFile::Result_OK,
+		"ReadVerify: corrupted entry %lld not detected, verify %d/%d, read %d", (long long)nFileID, (int)eEmbeded, (int)eInflate, (int)eRead);
+	thePackage.ReleasePackageFile();
+}
+void SoBench_ReadVerify()
+{
+	const char* pszPackage = SoBench_TempDir "verify.sof";
+	const char* pszFormatName[2] = {"zlib", "raw"};
+	const char* pszVerifyName[3] = {"always", "firsttouch", "never"};
+	SoCorpus theCorpus;
+	theCorpus.SetSpec(SoBench_CorpusSpec);
+	SoBench_MakeDir(SoBench_TempDir);
+	char* pBuff = (char*)malloc((size_t)theCorpus.GetMaxSize() + 1);
+	printf("ReadVerify: %u entries, read twice\n", SoBench_ReadVerifyCount);
+	printf("%10s %12s %12s %16s\n", "format", "verify", "MB/s", "checksum MB");
+	for (int nFormat=0; nFormat<2; ++nFormat)
+	{
+		remove(pszPackage);
+		soint64 nTotalBytes = 0;
+		{
+			SoPackageFile thePackage;
+			thePackage.SetCompressFormat((nFormat == 0) ? SoPackageFile::Compress_Zlib : SoPackageFile::Compress_RawDeflate);
+			SoPackageFile::OperationResult eResult = thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Write);
+			if (eResult == SoPackageFile::Result_OK)
+			{
+				eResult = theCorpus.WritePackage(thePackage, 0, SoBench_ReadVerifyCount, &nTotalBytes);
+			}
+			thePackage.FlushPackageFile();
+			thePackage.ReleasePackageFile();
+			if (eResult != SoPackageFile::Result_OK)
+			{
+				printf("ReadVerify: create package fail, result %d\n", (int)eResult);
+				break;
+			}
+		}
+		for (int nVerify=0; nVerify<3; ++nVerify)
+		{
+			if (nFormat == 0 && nVerify != 0)
+			{
+				//zlib格式的压缩文件不受ReadVerify影响（只有原样存储的文件计算CRC32C），只测ReadVerify_Always作为对照。
+				continue;
+			}
+			SoPackageFile thePackage;
+			thePackage.SetEntryCacheSize(0);
+			thePackage.SetReadVerify((SoPackageFile::ReadVerify)nVerify);
+			thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+			const double fStart = SoBench_Now();
+			for (int nRound=0; nRound<2; ++nRound)
+			{
+				for (soint64 i=0; i<thePackage.GetFileCount(); ++i)
+				{
+					thePackage.ReadWholeFile(i, pBuff, theCorpus.GetMaxSize() + 1);
+				}
+			}
+			const double fSeconds = SoBench_Now() - fStart;
+			SoPackageFile::stStats theStats;
+			thePackage.GetStats(theStats);
+			const double fMegaBytes = 2.0 * (double)nTotalBytes / (1024.0 * 1024.0);
+			printf("%10s %12s %12.1f %16.1f\n", pszFormatName[nFormat], pszVerifyName[nVerify], fMegaBytes / fSeconds,
+				(double)theStats.nChecksumBytes / (1024.0 * 1024.0));
+			SoBench_Report("MB/s", fMegaBytes / fSeconds, "ReadVerify/%s_%s", pszFormatName[nFormat], pszVerifyName[nVerify]);
+			thePackage.ReleasePackageFile();
+		}
+		if (nFormat == 1)
+		{
+			SoBench_ReadVerifyCompare(pszPackage, theCorpus, pBuff);
+			SoBench_ReadVerifyCorrupt(pszPackage, pBuff, theCorpus.GetMaxSize() + 1);
+		}
+	}
+	free(pBuff);
+	remove(pszPackage);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 大文件的分块压缩 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//一个大的文本文件，分别整体压缩和分块压缩，比较打包的速度和压缩后的大小；
+//分块压缩的资源包再分别用一个线程和线程池解压缩，比较ReadWholeFile的速度。
+#define SoBench_LargeEntrySize (64*1024*1024)
+#define SoBench_LargeEntryRound 4
+//分块压缩的资源包中再放一个大小不是块大小整数倍的文件，内容取大文件的开头，检查最后一个不完整的块。
+#define SoBench_LargeEntryTailSize (3*1024*1024 + 4321)
+//分块压缩的两个文件读出的内容都必须与原始内容逐字节相同。
+void SoBench_LargeEntryCheck(SoPackageFile& thePackage, const char* pSrc, char* pDest, const char* pszReadName)
+{
+	const soint64 nSizeList[2] = {SoBench_LargeEntrySize, SoBench_LargeEntryTailSize};
+	for (soint64 i=0; i<2; ++i)
+	{
+		SoPackageFile::stSingleFileInfo theInfo;
+		const SoPackageFile::OperationResult eInfo = thePackage.GetSingleFileInfo(i, theInfo);
+		memset(pDest, 0, (size_t)nSizeList[i]);
+		const SoPackageFile::OperationResult eRead = thePackage.ReadWholeFile(i, pDest, SoBench_LargeEntrySize);
+		SoBench_Check(eInfo == SoPackageFile::Result_OK && (theInfo.uiFlags & SoPackageFile::SingleFile_Blocked) != 0
+			&& theInfo.nOriginalFileSize == nSizeList[i] && eRead == SoPackageFile::Result_OK
+			&& memcmp(pSrc, pDest, (size_t)nSizeList[i]) == 0,
+			"LargeEntry/read_%s: blocked entry of %lld bytes does not read back, result %d", pszReadName, (long long)nSizeList[i], (int)eRead);
+	}
+}
+void SoBench_LargeEntry()
+{
+	const char* pszPackage = SoBench_TempDir "large.sof";
+	SoCorpus theCorpus;
+	char* pSrc = (char*)malloc(SoBench_LargeEntrySize);
+	char* pDest = (char*)malloc(SoBench_LargeEntrySize);
+	if (pSrc == 0 || pDest == 0)
+	{
+		printf("LargeEntry: out of memory\n");
+		free(pSrc);
+		free(pDest);
+		return;
+	}
+	theCorpus.FillContent(0, pSrc, SoBench_LargeEntrySize, SoCorpus::Content_Text);
+	SoBench_MakeDir(SoBench_TempDir);
+	const char* pszPackName[2] = {"whole", "blocked"};
+	printf("LargeEntry: one entry, %d MB, %u CPUs\n", SoBench_LargeEntrySize / (1024 * 1024), SoThread_GetCPUCount());
+	printf("%10s %12s %12s %14s\n", "pack", "seconds", "MB/s", "embeded MB");
+	for (int nPack=0; nPack<2; ++nPack)
+	{
+		remove(pszPackage);
+		SoPackageFile thePackage;
+		thePackage.SetBlockCompress((nPack == 0) ? 0 : 1024*1024, 0);
+		const double fStart = SoBench_Now();
+		SoPackageFile::OperationResult eResult = thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Write);
+		if (eResult == SoPackageFile::Result_OK)
+		{
+			eResult = thePackage.InsertSingleFileFromMemory("large/entry.txt", pSrc, SoBench_LargeEntrySize);
+		}
+		thePackage.FlushPackageFile();
+		const double fSeconds = SoBench_Now() - fStart;
+		//不计入打包时间。
+		if (eResult == SoPackageFile::Result_OK && nPack == 1)
+		{
+			eResult = thePackage.InsertSingleFileFromMemory("large/tail.txt", pSrc, SoBench_LargeEntryTailSize);
+			thePackage.FlushPackageFile();
+		}
+		SoPackageFile::stSingleFileInfo theInfo;
+		thePackage.GetSingleFileInfo(0, theInfo);
+		thePackage.ReleasePackageFile();
+		if (eResult != SoPackageFile::Result_OK)
+		{
+			printf("LargeEntry: create package fail, result %d\n", (int)eResult);
+			break;
+		}
+		printf("%10s %12.3f %12.1f %14.1f\n", pszPackName[nPack], fSeconds, SoBench_LargeEntrySize / fSeconds / (1024.0 * 1024.0),
+			theInfo.nEmbededFileSize / (1024.0 * 1024.0));
+		SoBench_Report("MB/s", SoBench_LargeEntrySize / fSeconds / (1024.0 * 1024.0), "LargeEntry/pack_%s", pszPackName[nPack]);
+	}
+	//最后写入的是分块压缩的资源包。
+	const char* pszReadName[2] = {"serial", "parallel"};
+	printf("%10s %12s %12s\n", "read", "seconds", "MB/s");
+	for (int nRead=0; nRead<2; ++nRead)
+	{
+		SoPackageFile thePackage;
+		thePackage.SetEntryCacheSize(0);
+		thePackage.SetParallelInflate(0, (nRead == 0) ? 1 : 0);
+		if (thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read) != SoPackageFile::Result_OK)
+		{
+			break;
+		}
+		//第一遍读取让资源包进入系统缓存，并创建线程池，不计时。
+		//同时检查单线程和并行解压缩的结果。
+		SoBench_LargeEntryCheck(thePackage, pSrc, pDest, pszReadName[nRead]);
+		const double fStart = SoBench_Now();
+		for (int r=0; r<SoBench_LargeEntryRound; ++r)
+		{
+			thePackage.ReadWholeFile(0, pDest, SoBench_LargeEntrySize);
+		}
+		const double fSeconds = SoBench_Now() - fStart;
+		const double fMegaBytes = (double)SoBench_LargeEntrySize * SoBench_LargeEntryRound / (1024.0 * 1024.0);
+		printf("%10s %12.3f %12.1f\n", pszReadName[nRead], fSeconds, fMegaBytes / fSeconds);
+		SoBench_Report("MB/s", fMegaBytes / fSeconds, "LargeEntry/read_%s", pszReadName[nRead]);
+		thePackage.ReleasePackageFile();
+	}
+	//只有一两个CPU时"parallel"实际上不并行，固定用4个线程再检查一遍并行解压缩。
+	{
+		SoPackageFile thePackage;
+		thePackage.SetEntryCacheSize(0);
+		thePackage.SetParallelInflate(0, 4);
+		const SoPackageFile::OperationResult eResult = thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+		SoBench_Check(eResult == SoPackageFile::Result_OK, "LargeEntry: open %s fail, result %d", pszPackage, (int)eResult);
+		if (eResult == SoPackageFile::Result_OK)
+		{
+			SoBench_LargeEntryCheck(thePackage, pSrc, pDest, "4t");
+		}
+		thePackage.ReleasePackageFile();
+	}
+	free(pSrc);
+	free(pDest);
+	remove(pszPackage);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 解压整个资源包 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//ExtractAll分别用一个线程和所有CPU解压到临时目录，比较速度，并逐个检查写出的文件与ReadWholeFile读到的内容相同。
+#define SoBench_ExtractCount 2000
+#define SoBench_ExtractDir SoBench_TempDir "extract"
+void SoBench_Extract()
+{
+	const char* pszPackage = SoBench_TempDir "extract.sof";
+	const souint32 uiFileCount = SoBench_CreatePackage(pszPackage, SoBench_ExtractCount, 16*1024, 1024*1024);
+	SoPackageFile thePackage;
+	thePackage.SetEntryCacheSize(0);
+	if (uiFileCount == 0 || thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read) != SoPackageFile::Result_OK)
+	{
+		SoBench_Check(false, "Extract: create package fail");
+		return;
+	}
+	printf("Extract: %u entries, %u CPUs\n", uiFileCount, SoThread_GetCPUCount());
+	printf("%10s %12s %12s %10s\n", "threads", "seconds", "MB/s", "failed");
+	const souint32 uiThreadList[2] = {1, 0};
+	const char* pszThreadName[2] = {"1t", "all"};
+	for (int t=0; t<2; ++t)
+	{
+		SoPackageFile::stExtractStats theStats;
+		const double fStart = SoBench_Now();
+		const SoPackageFile::OperationResult eResult = thePackage.ExtractAll(SoBench_ExtractDir, uiThreadList[t], 0, &theStats);
+		const double fSeconds = SoBench_Now() - fStart;
+		const double fMegaBytes = (double)theStats.nExtractedBytes / (1024.0 * 1024.0);
+		printf("%10s %12.3f %12.1f %10lld\n", pszThreadName[t], fSeconds, fMegaBytes / fSeconds, (long long)theStats.nFailedCount);
+		SoBench_Report("MB/s", fMegaBytes / fSeconds, "Extract/%s", pszThreadName[t]);
+		SoBench_Check(eResult == SoPackageFile::Result_OK && theStats.nExtractedCount == (soint64)uiFileCount,
+			"Extract/%s: result %d, extracted %lld of %u", pszThreadName[t], (int)eResult, (long long)theStats.nExtractedCount, uiFileCount);
+	}
+	//包内的文件名是相对路径，直接放在解压目录下。
+	SoPackageFile::stSingleFileInfo theInfo;
+	char szPath[SoPackageFileMAX_PATH * 2];
+	char* pExpect = (char*)malloc(1024*1024);
+	char* pActual = (char*)malloc(1024*1024 + 1);
+	souint32 uiMismatch = 0;
+	for (soint64 i=0; i<thePackage.GetFileCount(); ++i)
+	{
+		thePackage.GetSingleFileInfo(i, theInfo);
+		sprintf(szPath, "%s/%s", SoBench_ExtractDir, theInfo.szFileName);
+		const soint64 nExpectSize = theInfo.nOriginalFileSize;
+		const SoPackageFile::OperationResult eResult = thePackage.ReadWholeFile(i, pExpect, 1024*1024);
+		size_t nActualSize = 0;
+		FILE* pFile = fopen(szPath, "rb");
+		if (pFile)
+		{
+			nActualSize = fread(pActual, 1, 1024*1024 + 1, pFile);
+			fclose(pFile);
+		}
+		if (eResult != SoPackageFile::Result_OK || pFile == 0 || (soint64)nActualSize != nExpectSize || memcmp(pExpect, pActual, nActualSize) != 0)
+		{
+			++uiMismatch;
+		}
+		remove(szPath);
+	}
+	SoBench_Check(uiMismatch == 0, "Extract: %u extracted files differ from the package", uiMismatch);
+	free(pExpect);
+	free(pActual);
+	thePackage.ReleasePackageFile();
+	remove(pszPackage);
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//<<<<<<<<<<<<<<<<<<<<<<<< 性能回归测试 <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//固定的一组操作：打包、打开资源包、查找文件、混合读取。
+//除了时间，还记录操作的次数：申请内存的次数、读写资源包的次数、哈希表的平均探测次数。
+//这些次数与机器的快慢和负载无关，在时间受干扰的机器上也能发现问题。
+//与--baseline指定的基准文件比较，见SoBench_CompareBaseline。
+#define SoBench_RegressionSpec "text:70:64-8K,binary:25:1K-64K,media:5:16K-256K"
+#define SoBench_RegressionCount 4000
+#define SoBench_RegressionLookupCount 1000000
+#define SoBench_RegressionMissCount 2000
+void SoBench_Regression()
+{
+	const char* pszPackage = SoBench_TempDir "regression.sof";
+	SoCorpus theCorpus;
+	theCorpus.SetSpec(SoBench_RegressionSpec);
+	SoAllocator_Malloc theAllocator;
+	SoPackageFile::stStats theStats;
+	double* pValueList = (double*)malloc(g_uiRepeat * sizeof(double));
+	SoBench_MakeDir(SoBench_TempDir);
+	printf("Regression: %u entries, median of %u runs\n", SoBench_RegressionCount, g_uiRepeat);
+	//打包。次数取最后一次的结果，每次都相同。
+	soint64 nAllocCount = 0;
+	for (souint32 r=0; r<g_uiRepeat; ++r)
+	{
+		remove(pszPackage);
+		SoPackageFile thePackage;
+		thePackage.SetAllocator(&theAllocator);
+		const soint64 nAllocStart = SoBench_AllocCount(&theAllocator);
+		const double fStart = SoBench_Now();
+		SoPackageFile::OperationResult eResult = thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Write);
+		if (eResult == SoPackageFile::Result_OK)
+		{
+			eResult = theCorpus.WritePackage(thePackage, 0, SoBench_RegressionCount, 0);
+		}
+		if (eResult == SoPackageFile::Result_OK)
+		{
+			eResult = thePackage.FlushPackageFile();
+		}
+		pValueList[r] = (SoBench_Now() - fStart) * 1000.0;
+		thePackage.GetStats(theStats);
+		thePackage.ReleasePackageFile();
+		nAllocCount = SoBench_AllocCount(&theAllocator) - nAllocStart;
+		if (eResult != SoPackageFile::Result_OK)
+		{
+			printf("Regression: create package fail, result %d\n", (int)eResult);
+			free(pValueList);
+			remove(pszPackage);
+			return;
+		}
+	}
+	double fMedian = SoBench_Median(pValueList, g_uiRepeat);
+	printf("%-14s %10.3f ms, allocs %lld, writes %lld, bytes %lld\n", "pack", fMedian,
+		(long long)nAllocCount, (long long)theStats.nDiskWriteCount, (long long)theStats.nDiskWriteBytes);
+	SoBench_Report("ms", fMedian, "Regression/pack/time");
+	SoBench_Report("count", (double)nAllocCount, "Regression/pack/allocs");
+	SoBench_Report("count", (double)theStats.nDiskWriteCount, "Regression/pack/writes");
+	SoBench_Report("bytes", (double)theStats.nDiskWriteBytes, "Regression/pack/bytes");
+	//打开资源包。
+	fMedian = SoBench_MeasureOpen(pszPackage, &theAllocator, &nAllocCount);
+	printf("%-14s %10.3f ms, allocs %lld\n", "open", fMedian, (long long)nAllocCount);
+	SoBench_Report("ms", fMedian, "Regression/open/time");
+	SoBench_Report("count", (double)nAllocCount, "Regression/open/allocs");
+	//查找存在和不存在的文件。
+	SoPackageFile thePackage;
+	thePackage.SetAllocator(&theAllocator);
+	thePackage.SetEntryCacheSize(0);
+	thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+	char* pNameBuff = (char*)malloc(SoBench_RegressionCount * SoPackageFileMAX_PATH);
+	char* pMissNameBuff = (char*)malloc(SoBench_RegressionCount * SoPackageFileMAX_PATH);
+	soint64* pFileSizeList = (soint64*)malloc(SoBench_RegressionCount * sizeof(soint64));
+	SoCorpus::ContentKind eKind = SoCorpus::Content_Text;
+	for (souint32 i=0; i<SoBench_RegressionCount; ++i)
+	{
+		theCorpus.GetEntry(i, pNameBuff + i * SoPackageFileMAX_PATH, pFileSizeList[i], eKind);
+		sprintf(pMissNameBuff + i * SoPackageFileMAX_PATH, "missing/%s", pNameBuff + i * SoPackageFileMAX_PATH);
+	}
+	for (int nMiss=0; nMiss<2; ++nMiss)
+	{
+		fMedian = SoBench_MeasureLookup(thePackage, nMiss ? pMissNameBuff : pNameBuff, SoBench_RegressionCount,
+			nMiss ? SoBench_RegressionMissCount : SoBench_RegressionLookupCount, &theAllocator, &nAllocCount, &theStats);
+		const double fProbe = (theStats.nOpenCount > 0) ? (double)theStats.nProbeCount / theStats.nOpenCount : 0.0;
+		const char* pszKind = nMiss ? "miss" : "hit";
+		printf("%-14s %10.1f ns/op, probes %.2f, allocs %lld\n", nMiss ? "lookup miss" : "lookup hit", fMedian, fProbe, (long long)nAllocCount);
+		SoBench_Report("ns", fMedian, "Regression/lookup_%s/time", pszKind);
+		SoBench_Report("count", fProbe, "Regression/lookup_%s/probes", pszKind);
+		SoBench_Report("count", (double)nAllocCount, "Regression/lookup_%s/allocs", pszKind);
+	}
+	//混合读取：大小和压缩率各不相同的文件，按随机顺序读取，不使用文件缓存。
+	soint64* pFileIDList = (soint64*)malloc(SoBench_RegressionCount * sizeof(soint64));
+	SoBenchRandom theOrder(57);
+	for (souint32 i=0; i<SoBench_RegressionCount; ++i)
+	{
+		SoPackageFile::stReadSingleFile theFile;
+		thePackage.Open(pNameBuff + i * SoPackageFileMAX_PATH, theFile);
+		pFileIDList[i] = theFile.nFileID;
+	}
+	for (souint32 i=SoBench_RegressionCount-1; i>0; --i)
+	{
+		const souint32 j = theOrder.Next() % (i + 1);
+		const soint64 nFileID = pFileIDList[i];
+		pFileIDList[i] = pFileIDList[j];
+		pFileIDList[j] = nFileID;
+		const soint64 nFileSize = pFileSizeList[i];
+		pFileSizeList[i] = pFileSizeList[j];
+		pFileSizeList[j] = nFileSize;
+	}
+	const soint64 nBuffSize = theCorpus.GetMaxSize() + 1;
+	char* pBuff = (char*)malloc((size_t)nBuffSize);
+	//先读一遍，让每个线程的临时缓存和zlib的状态准备好，之后的申请次数只反映每次读取的开销。
+	for (souint32 i=0; i<SoBench_RegressionCount; ++i)
+	{
+		thePackage.ReadWholeFile(pFileIDList[i], pBuff, nBuffSize);
+	}
+	fMedian = SoBench_MeasureRead(thePackage, pFileIDList, pFileSizeList, SoBench_RegressionCount, nBuffSize, 1, &theAllocator, &nAllocCount, &theStats);
+	printf("%-14s %10.1f MB/s, reads %lld, allocs %lld\n", "read mix", fMedian,
+		(long long)theStats.nDiskReadCount, (long long)nAllocCount);
+	SoBench_Report("MB/s", fMedian, "Regression/read/throughput");
+	SoBench_Report("count", (double)theStats.nDiskReadCount, "Regression/read/reads");
+	SoBench_Report("count", (double)nAllocCount, "Regression/read/allocs");
+	thePackage.ReleasePackageFile();
+	free(pBuff);
+	free(pFileIDList);
+	free(pFileSizeList);
+	free(pMissNameBuff);
+	free(pNameBuff);
+	free(pValueList);
+	remove(pszPackage);
+}
+//-----------------------------------------------------------------------------
+//基准文件的格式与--json的输出相同，每个指标多一个"tolerance"，为允许变差的比例。
+//单位以"/s"结尾的指标越大越好，其他的越小越好。
+#define SoBench_TimeTolerance 0.5
+#define SoBench_CountTolerance 0.05
+struct stBaselineItem
+{
+	char szName[128];
+	char szUnit[16];
+	double fValue;
+	double fTolerance;
+};
+stBaselineItem g_BaselineList[SoBench_MaxResultCount];
+souint32 g_uiBaselineCount = 0;
+bool SoBench_IsHigherBetter(const char* pszUnit)
+{
+	const size_t nLength = strlen(pszUnit);
+	return nLength >= 2 && strcmp(pszUnit + nLength - 2, "/s") == 0;
+}
+double SoBench_DefaultTolerance(const char* pszUnit)
+{
+	return (strcmp(pszUnit, "count") == 0 || strcmp(pszUnit, "bytes") == 0) ? SoBench_CountTolerance : SoBench_TimeTolerance;
+}
+//在一个JSON对象中查找"pszKey": 之后的值，找不到返回0。对象以'}'结束，不支持嵌套。
+const char* SoBench_FindJsonValue(const char* pszObject, const char* pszKey)
+{
+	char szPattern[64];
+	sprintf(szPattern, "\"%s\"", pszKey);
+	const char* pszEnd = strchr(pszObject, '}');
+	const char* pszFound = strstr(pszObject, szPattern);
+	if (pszFound == 0 || (pszEnd && pszFound > pszEnd))
+	{
+		return 0;
+	}
+	pszFound += strlen(szPattern);
+	while (*pszFound == ' ' || *pszFound == ':')
+	{
+		++pszFound;
+	}
+	return pszFound;
+}
+bool SoBench_CopyJsonString(const char* pszValue, char* pszOut, size_t nMaxLength)
+{
+	if (pszValue == 0 || *pszValue != '"')
+	{
+		return false;
+	}
+	++pszValue;
+	size_t nLength = 0;
+	while (pszValue[nLength] && pszValue[nLength] != '"' && nLength + 1 < nMaxLength)
+	{
+		pszOut[nLength] = pszValue[nLength];
+		++nLength;
+	}
+	pszOut[nLength] = 0;
+	return pszValue[nLength] == '"';
+}
+bool SoBench_LoadBaseline(const char* pszFileName)
+{
+	g_uiBaselineCount = 0;
+	FILE* pFile = fopen(pszFileName, "rb");
+	if (pFile == 0)
+	{
+		return false;
+	}
+	fseek(pFile, 0, SEEK_END);
+	const long nFileSize = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+	char* pText = (char*)malloc(nFileSize + 1);
+	const bool bOK = (fread(pText, 1, nFileSize, pFile) == (size_t)nFileSize);
+	fclose(pFile);
+	pText[bOK ? nFileSize : 0] = 0;
+	for (const char* p = strstr(pText, "{\"name\""); p && g_uiBaselineCount < SoBench_MaxResultCount; p = strstr(p + 1, "{\"name\""))
+	{
+		stBaselineItem& theItem = g_BaselineList[g_uiBaselineCount];
+		const char* pszValue = SoBench_FindJsonValue(p, "value");
+		const char* pszTolerance = SoBench_FindJsonValue(p, "tolerance");
+		if (!SoBench_CopyJsonString(SoBench_FindJsonValue(p, "name"), theItem.szName, sizeof(theItem.szName))
+			|| !SoBench_CopyJsonString(SoBench_FindJsonValue(p, "unit"), theItem.szUnit, sizeof(theItem.szUnit))
+			|| pszValue == 0)
+		{
+			continue;
+		}
+		theItem.fValue = atof(pszValue);
+		theItem.fTolerance = pszTolerance ? atof(pszTolerance) : SoBench_DefaultTolerance(theItem.szUnit);
+		++g_uiBaselineCount;
+	}
+	free(pText);
+	return bOK;
+}
+const stBaselineItem* SoBench_FindBaseline(const char* pszName)
+{
+	for (souint32 i=0; i<g_uiBaselineCount; ++i)
+	{
+		if (strcmp(g_BaselineList[i].szName, pszName) == 0)
+		{
+			return &g_BaselineList[i];
+		}
+	}
+	return 0;
+}
+//把这次的结果写成基准文件。已有的基准文件中的容差保留下来，新的指标使用默认的容差。
+bool SoBench_SaveBaseline(const char* pszFileName)
+{
+	SoBench_LoadBaseline(pszFileName);
+	FILE* pFile = fopen(pszFileName, "wb");
+	if (pFile == 0)
+	{
+		return false;
+	}
+	fprintf(pFile, "{\n\"package_version\": %d,\n\"repeat\": %u,\n\"results\": [", SoPackageFileVersion, g_uiRepeat);
+	for (souint32 i=0; i<g_uiResultCount; ++i)
+	{
+		const stBaselineItem* pOld = SoBench_FindBaseline(g_ResultList[i].szName);
+		fprintf(pFile, "%s\n{\"name\": \"%s\", \"value\": %.10g, \"unit\": \"%s\", \"tolerance\": %.3g}", i == 0 ? "" : ",",
+			g_ResultList[i].szName, g_ResultList[i].fValue, g_ResultList[i].pszUnit,
+			pOld ? pOld->fTolerance : SoBench_DefaultTolerance(g_ResultList[i].pszUnit));
+	}
+	fprintf(pFile, "\n]\n}\n");
+	fclose(pFile);
+	return true;
+}
+//返回变差超过容差的指标个数。bRequireAll为true时，基准中有而这次没有运行的指标也算作失败。
+souint32 SoBench_CompareBaseline(bool bRequireAll)
+{
+	souint32 uiFailCount = 0;
+	printf("%-36s %12s %12s %8s %6s\n", "metric", "baseline", "current", "change", "limit");
+	for (souint32 i=0; i<g_uiBaselineCount; ++i)
+	{
+		const stBaselineItem& theItem = g_BaselineList[i];
+		const stBenchResult* pResult = 0;
+		for (souint32 k=0; k<g_uiResultCount; ++k)
+		{
+			if (strcmp(g_ResultList[k].szName, theItem.szName) == 0)
+			{
+				pResult = &g_ResultList[k];
+				break;
+			}
+		}
+		if (pResult == 0)
+		{
+			if (bRequireAll)
+			{
+				printf("%-36s %12.6g %12s %8s %6s  MISSING\n", theItem.szName, theItem.fValue, "-", "-", "-");
+				++uiFailCount;
+			}
+			continue;
+		}
+		const double fCurrent = pResult->fValue;
+		const double fChange = (theItem.fValue != 0.0) ? (fCurrent - theItem.fValue) / theItem.fValue : 0.0;
+		//基准为0时，越小越好的指标只要不为0就算变差。
+		const bool bHigherBetter = SoBench_IsHigherBetter(theItem.szUnit);
+		const bool bWorse = bHigherBetter ? (fCurrent < theItem.fValue * (1.0 - theItem.fTolerance))
+			: (fCurrent > theItem.fValue * (1.0 + theItem.fTolerance));
+		const bool bBetter = bHigherBetter ? (fCurrent > theItem.fValue * (1.0 + theItem.fTolerance))
+			: (fCurrent < theItem.fValue * (1.0 - theItem.fTolerance));
+		printf("%-36s %12.6g %12.6g %+7.1f%% %5.0f%%  %s\n", theItem.szName, theItem.fValue, fCurrent, fChange * 100.0,
+			theItem.fTolerance * 100.0, bWorse ? "REGRESSION" : (bBetter ? "improved" : "ok"));
+		if (bWorse)
+		{
+			++uiFailCount;
+		}
+	}
+	return uiFailCount;
+}
+//>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
+//-----------------------------------------------------------------------------
+//--trace最多记录的事件个数。
+#define SoBench_TraceEventCount (4*1024*1024)
+struct stBenchCase
+{
+	const char* pszName;
+	void (*pFunc)();
+};
+int main(int argc, char* argv[])
+{
+	const stBenchCase theCaseList[] = {
+		{"FormatName", SoBench_FormatName},
+		{"LookupScaling", SoBench_LookupScaling},
+		{"LookupLatency", SoBench_LookupLatency},
+		{"OpenPackage", SoBench_OpenPackage},
+		{"ReadMany", SoBench_ReadMany},
+		{"PriorityLatency", SoBench_PriorityLatency},
+		{"ReadWholeFile", SoBench_ReadWholeFile},
+		{"ReadThroughput", SoBench_ReadThroughput},
+		{"SmallEntry", SoBench_SmallEntry},
+		{"PackThroughput", SoBench_PackThroughput},
+		{"CorpusPack", SoBench_CorpusPack},
+		{"ReadVerify", SoBench_ReadVerify},
+		{"LargeEntry", SoBench_LargeEntry},
+		{"Extract", SoBench_Extract},
+		{"Coroutine", SoBench_Coroutine},
+		{"Regression", SoBench_Regression},
+	};
+	const souint32 uiCaseCount = sizeof(theCaseList) / sizeof(theCaseList[0]);
+	const char* pszFilter = 0;
+	const char* pszJsonFile = 0;
+	const char* pszBaselineFile = 0;
+	const char* pszNewBaselineFile = 0;
+	const char* pszTraceFile = 0;
+	for (int i=1; i<argc; ++i)
+	{
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			pszFilter = argv[++i];
+		}
+		else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+		{
+			pszJsonFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+		{
+			g_uiRepeat = (souint32)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+		{
+			pszBaselineFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--write-baseline") == 0 && i + 1 < argc)
+		{
+			pszNewBaselineFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			pszTraceFile = argv[++i];
+		}
+		else
+		{
+			printf("usage: %s [--filter name] [--repeat count] [--json file] [--baseline file] [--write-baseline file] [--trace file]\n", argv[0]);
+			return 1;
+		}
+	}
+	//先读入基准文件，文件有问题时不必运行测试。
+	if (pszBaselineFile && (!SoBench_LoadBaseline(pszBaselineFile) || g_uiBaselineCount == 0))
+	{
+		printf("read baseline %s fail\n", pszBaselineFile);
+		return 1;
+	}
+	if (pszTraceFile && !SoTrace_Start(SoBench_TraceEventCount))
+	{
+		printf("start trace fail\n");
+		return 1;
+	}
+	for (souint32 i=0; i<uiCaseCount; ++i)
+	{
+		if (pszFilter == 0 || strstr(theCaseList[i].pszName, pszFilter))
+		{
+			theCaseList[i].pFunc();
+		}
+	}
+	if (pszTraceFile)
+	{
+		SoTrace_Stop();
+		if (!SoTrace_Save(pszTraceFile))
+		{
+			printf("write %s fail\n", pszTraceFile);
+			return 1;
+		}
+		printf("%lld trace events (%lld dropped) written to %s\n", (long long)SoTrace_GetEventCount(), (long long)SoTrace_GetDroppedCount(), pszTraceFile);
+	}
+	const double fPeakMemory = SoBench_PeakMemory();
+	printf("PeakMemory: %.1f MB\n", fPeakMemory / (1024.0 * 1024.0));
+	SoBench_Report("bytes", fPeakMemory, "Process/peak_memory");
+	if (pszJsonFile)
+	{
+		if (!SoBench_SaveJson(pszJsonFile))
+		{
+			printf("write %s fail\n", pszJsonFile);
+			return 1;
+		}
+		printf("%u results written to %s\n", g_uiResultCount, pszJsonFile);
+	}
+	if (pszNewBaselineFile)
+	{
+		if (!SoBench_SaveBaseline(pszNewBaselineFile))
+		{
+			printf("write %s fail\n", pszNewBaselineFile);
+			return 1;
+		}
+		printf("baseline written to %s\n", pszNewBaselineFile);
+	}
+	if (pszBaselineFile)
+	{
+		//SoBench_SaveBaseline会覆盖g_BaselineList，重新读入。
+		SoBench_LoadBaseline(pszBaselineFile);
+		const souint32 uiFailCount = SoBench_CompareBaseline(pszFilter == 0);
+		if (uiFailCount > 0)
+		{
+			printf("%u metrics regressed against %s\n", uiFailCount, pszBaselineFile);
+			return 2;
+		}
+		printf("no regression against %s\n", pszBaselineFile);
+	}
+	if (g_uiCheckFailCount > 0)
+	{
+		printf("%u checks failed\n", g_uiCheckFailCount);
+		return 3;
+	}
+	return 0;
+}
+//-----------------------------------------------------------------------------
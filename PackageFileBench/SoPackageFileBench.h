@@ -0,0 +1,33 @@
+﻿//-----------------------------------------------------------------------------
+// SoPackageFileBench
+// (C) oil
+// 2013-10-30
+//
+// 性能测试程序中多个文件共用的函数。
+//-----------------------------------------------------------------------------
+#ifndef _SoPackageFileBench_h_
+#define _SoPackageFileBench_h_
+//-----------------------------------------------------------------------------
+#include "SoBaseTypeDefine.h"
+//-----------------------------------------------------------------------------
+//所有测试用的临时文件都放在这个目录中。
+#define SoBench_TempDir "sobench_tmp/"
+//-----------------------------------------------------------------------------
+//新测试场景的重复次数，结果取中位数。
+extern GGUI::souint32 g_uiRepeat;
+//返回以秒为单位的时间。
+double SoBench_Now();
+//记录一个指标。pszUnit必须是常量字符串。
+void SoBench_Report(const char* pszUnit, double fValue, const char* pszFormat, ...);
+//正确性检查，bOK为false时打印失败原因，main最终返回3。
+void SoBench_Check(bool bOK, const char* pszFormat, ...);
+//第i个测试文件的文件名。
+void SoBench_MakeEntryName(char* pszOut, GGUI::souint32 i);
+//生成一个包含uiFileCount个文件的资源包，返回生成的文件总个数，失败返回0。
+GGUI::souint32 SoBench_CreatePackage(const char* pszPackage, GGUI::souint32 uiFileCount, GGUI::souint32 uiFileSize, GGUI::souint32 uiLargeFileSize);
+//-----------------------------------------------------------------------------
+//各个文件中的测试场景。
+void SoBench_Coroutine();
+//-----------------------------------------------------------------------------
+#endif //_SoPackageFileBench_h_
+//-----------------------------------------------------------------------------
@@ -0,0 +1,122 @@
+﻿//-----------------------------------------------------------------------------
+// SoCorpusTool
+// (C) oil
+// 2013-10-29
+//
+// 生成测试用的资源文件集合，用于测试和比较打包、读取的性能。
+// 用法：PackageFileCorpus --count 文件个数 [--seed 种子] [--spec 分布] [--depth 最少层数-最多层数] (--dir 目录 | --package 资源包)
+// --dir在磁盘上生成目录树；--package不经过磁盘，直接把文件写入资源包。
+// 分布的格式见SoCorpus::SetSpec，默认为SoCorpus_DefaultSpec。
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SoCorpus.h"
+#include "SoThread.h"
+using namespace GGUI;
+//-----------------------------------------------------------------------------
+void SoCorpusTool_PrintUsage(const char* pszExe)
+{
+	printf("usage: %s --count N [--seed S] [--spec SPEC] [--depth MIN-MAX] (--dir DIR | --package FILE)\n", pszExe);
+	printf("  SPEC: comma separated kind:weight:min-max, kind is text, binary or media, sizes accept K/M/G\n");
+	printf("  default SPEC: %s\n", SoCorpus_DefaultSpec);
+}
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	soint64 nEntryCount = 0;
+	souint32 uiSeed = 1;
+	const char* pszSpec = SoCorpus_DefaultSpec;
+	souint32 uiMinDepth = 1;
+	souint32 uiMaxDepth = 6;
+	const char* pszDir = 0;
+	const char* pszPackage = 0;
+	for (int i=1; i<argc; ++i)
+	{
+		if (strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+		{
+			nEntryCount = (soint64)strtod(argv[++i], 0);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			uiSeed = (souint32)strtoul(argv[++i], 0, 10);
+		}
+		else if (strcmp(argv[i], "--spec") == 0 && i + 1 < argc)
+		{
+			pszSpec = argv[++i];
+		}
+		else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+		{
+			unsigned int uiMin = 0;
+			unsigned int uiMax = 0;
+			if (sscanf(argv[++i], "%u-%u", &uiMin, &uiMax) != 2 || uiMin > uiMax)
+			{
+				SoCorpusTool_PrintUsage(argv[0]);
+				return 1;
+			}
+			uiMinDepth = uiMin;
+			uiMaxDepth = uiMax;
+		}
+		else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+		{
+			pszDir = argv[++i];
+		}
+		else if (strcmp(argv[i], "--package") == 0 && i + 1 < argc)
+		{
+			pszPackage = argv[++i];
+		}
+		else
+		{
+			SoCorpusTool_PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+	if (nEntryCount <= 0 || (pszDir == 0) == (pszPackage == 0))
+	{
+		SoCorpusTool_PrintUsage(argv[0]);
+		return 1;
+	}
+	SoCorpus theCorpus;
+	if (!theCorpus.SetSpec(pszSpec))
+	{
+		printf("invalid spec: %s\n", pszSpec);
+		return 1;
+	}
+	theCorpus.SetSeed(uiSeed);
+	theCorpus.SetPathDepth(uiMinDepth, uiMaxDepth);
+	soint64 nTotalBytes = 0;
+	const soint64 nStartTime = SoThread_GetNanoseconds();
+	if (pszDir)
+	{
+		if (!theCorpus.WriteDirectory(pszDir, nEntryCount, &nTotalBytes))
+		{
+			printf("write directory %s fail\n", pszDir);
+			return 1;
+		}
+	}
+	else
+	{
+		remove(pszPackage);
+		SoPackageFile thePackage;
+		SoPackageFile::OperationResult eResult = thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Write);
+		if (eResult == SoPackageFile::Result_OK)
+		{
+			eResult = theCorpus.WritePackage(thePackage, 0, nEntryCount, &nTotalBytes);
+		}
+		if (eResult == SoPackageFile::Result_OK)
+		{
+			eResult = thePackage.FlushPackageFile();
+		}
+		thePackage.ReleasePackageFile();
+		if (eResult != SoPackageFile::Result_OK)
+		{
+			printf("write package %s fail, result %d\n", pszPackage, (int)eResult);
+			return 1;
+		}
+	}
+	const double fSeconds = (SoThread_GetNanoseconds() - nStartTime) * 1e-9;
+	printf("entries %lld, bytes %lld, seconds %.3f, %.1f MB/s\n", (long long)nEntryCount, (long long)nTotalBytes, fSeconds,
+		(fSeconds > 0.0) ? (double)nTotalBytes / fSeconds / (1024.0 * 1024.0) : 0.0);
+	return 0;
+}
+//-----------------------------------------------------------------------------
@@ -0,0 +1,118 @@
+﻿//-----------------------------------------------------------------------------
+// SoExtractTool
+// (C) oil
+// 2013-11-04
+//
+// 把资源包内的所有文件解压到磁盘目录，用于调试和重新打包。
+// 用法：PackageFileExtract [--threads 线程数] [--no-verify] [--limit 个数] 资源包 目标目录
+// 1，使用SoPackageFile::ExtractAll，多个线程并行读取、解压缩和写出，原样存储的文件在内核中复制。
+//    绝对路径的文件名去掉开头的"/"和盘符，放在目标目录下。
+// 2，--no-verify不检查uiOriginalCRC（ReadVerify_Never）；--limit为最多列出的失败文件个数，默认为10。
+// 3，有文件解压失败时返回2，无法打开资源包等其他错误返回1。
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SoPackageFile.h"
+using namespace GGUI;
+//-----------------------------------------------------------------------------
+double SoExtract_MB(soint64 nBytes)
+{
+	return (double)nBytes / (1024.0 * 1024.0);
+}
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	const char* pszPackage = 0;
+	const char* pszDestDir = 0;
+	souint32 uiThreadCount = 0;
+	bool bVerify = true;
+	soint64 nLimit = 10;
+	for (int i=1; i<argc; ++i)
+	{
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			uiThreadCount = (souint32)strtoul(argv[++i], 0, 10);
+		}
+		else if (strcmp(argv[i], "--no-verify") == 0)
+		{
+			bVerify = false;
+		}
+		else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc)
+		{
+			nLimit = (soint64)strtod(argv[++i], 0);
+		}
+		else if (argv[i][0] != '-' && pszPackage == 0)
+		{
+			pszPackage = argv[i];
+		}
+		else if (argv[i][0] != '-' && pszDestDir == 0)
+		{
+			pszDestDir = argv[i];
+		}
+		else
+		{
+			pszPackage = 0;
+			break;
+		}
+	}
+	if (pszPackage == 0 || pszDestDir == 0)
+	{
+		printf("usage: %s [--threads count] [--no-verify] [--limit count] package destdir\n", argv[0]);
+		return 1;
+	}
+	SoPackageFile thePackage;
+	thePackage.SetReadVerify(bVerify ? SoPackageFile::ReadVerify_Always : SoPackageFile::ReadVerify_Never);
+	//只在ExtractAll中按顺序读取一遍，文件缓存没有用处。
+	thePackage.SetEntryCacheSize(0);
+	SoPackageFile::OperationResult eResult = thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+	if (eResult != SoPackageFile::Result_OK)
+	{
+		printf("open %s fail, result %d\n", pszPackage, (int)eResult);
+		return 1;
+	}
+	const soint64 nCount = thePackage.GetFileCount();
+	SoPackageFile::OperationResult* pResultList = (SoPackageFile::OperationResult*)malloc((size_t)(nCount > 0 ? nCount : 1) * sizeof(SoPackageFile::OperationResult));
+	if (pResultList == 0)
+	{
+		printf("out of memory\n");
+		thePackage.ReleasePackageFile();
+		return 1;
+	}
+	SoPackageFile::stExtractStats theStats;
+	const soint64 nStartTime = SoThread_GetNanoseconds();
+	eResult = thePackage.ExtractAll(pszDestDir, uiThreadCount, pResultList, &theStats);
+	const double fSeconds = (SoThread_GetNanoseconds() - nStartTime) * 1e-9;
+	int nExitCode = 0;
+	if (eResult != SoPackageFile::Result_OK && theStats.nFailedCount == 0)
+	{
+		printf("extract to %s fail, result %d\n", pszDestDir, (int)eResult);
+		nExitCode = 1;
+	}
+	else
+	{
+		printf("extracted %lld entries, %.1f MB in %.3f seconds (%.1f MB/s), kernel copy %lld, failed %lld\n",
+			(long long)theStats.nExtractedCount, SoExtract_MB(theStats.nExtractedBytes), fSeconds,
+			(fSeconds > 0.0) ? SoExtract_MB(theStats.nExtractedBytes) / fSeconds : 0.0,
+			(long long)theStats.nKernelCopyCount, (long long)theStats.nFailedCount);
+		if (theStats.nFailedCount > 0)
+		{
+			printf("%8s %6s  %s\n", "id", "result", "name");
+			SoPackageFile::stSingleFileInfo theInfo;
+			soint64 nPrinted = 0;
+			for (soint64 i=0; i<nCount && nPrinted<nLimit; ++i)
+			{
+				if (pResultList[i] != SoPackageFile::Result_OK && thePackage.GetSingleFileInfo(i, theInfo) == SoPackageFile::Result_OK)
+				{
+					printf("%8lld %6d  %s\n", (long long)i, (int)pResultList[i], theInfo.szFileName);
+					++nPrinted;
+				}
+			}
+			nExitCode = 2;
+		}
+	}
+	free(pResultList);
+	thePackage.ReleasePackageFile();
+	return nExitCode;
+}
+//-----------------------------------------------------------------------------
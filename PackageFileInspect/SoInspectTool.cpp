@@ -0,0 +1,583 @@
+﻿//-----------------------------------------------------------------------------
+// SoInspectTool
+// (C) oil
+// 2013-10-30
+//
+// 检查资源包的结构，找出读取慢、占用空间大的原因。
+// 用法：PackageFileInspect [--entries] [--limit 个数] [--verify [--inflate] [--threads 线程数]] 资源包
+// 1，压缩：总的和每个文件的压缩率，压缩之后反而变大的文件。
+// 2，哈希表：按BuildHashList建立的哈希表计算每个文件的探测长度，三个哈希值的冲突个数。
+// 3，布局：文件之间的空隙和重叠，偏移量的顺序，按512和4096字节对齐的比例。
+// 4，建议：压缩收益太小、不如原样存储的文件；适合合并成块一起压缩的小文件。
+// --entries列出每个文件的信息；--limit为每类建议最多列出的文件个数，默认为10。
+// --verify用SoPackageFile::Verify检查每个文件的校验值，--inflate同时解压缩检查，发现损坏的文件时返回2。
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SoPackageFile.h"
+using namespace GGUI;
+//-----------------------------------------------------------------------------
+//压缩之后的大小超过原始大小的这个比例时，解压缩的开销不值得，不如原样存储。
+#define SoInspect_StoreRatio 0.9
+//小于这个大小的文件单独压缩效果很差，适合合并成块一起压缩。
+#define SoInspect_SmallFileSize 4096
+#define SoInspect_PageSize 4096
+#define SoInspect_SectorSize 512
+//-----------------------------------------------------------------------------
+struct stInspectEntry
+{
+	SoPackageFile::stSingleFileInfo theInfo;
+	soint64 nFileID;
+	//在哈希表中查找这个文件需要探测的位置个数。
+	souint32 uiProbeLength;
+};
+//-----------------------------------------------------------------------------
+double SoInspect_Ratio(const SoPackageFile::stSingleFileInfo& theInfo)
+{
+	return (theInfo.nOriginalFileSize > 0) ? (double)theInfo.nEmbededFileSize / (double)theInfo.nOriginalFileSize : 1.0;
+}
+double SoInspect_MB(soint64 nBytes)
+{
+	return (double)nBytes / (1024.0 * 1024.0);
+}
+int SoInspect_CompareOffset(const void* pLeft, const void* pRight)
+{
+	const stInspectEntry* pA = *(const stInspectEntry* const*)pLeft;
+	const stInspectEntry* pB = *(const stInspectEntry* const*)pRight;
+	if (pA->theInfo.nOffset != pB->theInfo.nOffset)
+	{
+		return (pA->theInfo.nOffset < pB->theInfo.nOffset) ? -1 : 1;
+	}
+	return (pA->nFileID < pB->nFileID) ? -1 : 1;
+}
+int SoInspect_CompareHash(const void* pLeft, const void* pRight)
+{
+	const stInspectEntry* pA = *(const stInspectEntry* const*)pLeft;
+	const stInspectEntry* pB = *(const stInspectEntry* const*)pRight;
+	if (pA->theInfo.uiHashA != pB->theInfo.uiHashA)
+	{
+		return (pA->theInfo.uiHashA < pB->theInfo.uiHashA) ? -1 : 1;
+	}
+	if (pA->theInfo.uiHashB != pB->theInfo.uiHashB)
+	{
+		return (pA->theInfo.uiHashB < pB->theInfo.uiHashB) ? -1 : 1;
+	}
+	if (pA->theInfo.uiHashC != pB->theInfo.uiHashC)
+	{
+		return (pA->theInfo.uiHashC < pB->theInfo.uiHashC) ? -1 : 1;
+	}
+	return 0;
+}
+//按原始大小从大到小。
+int SoInspect_CompareSize(const void* pLeft, const void* pRight)
+{
+	const stInspectEntry* pA = *(const stInspectEntry* const*)pLeft;
+	const stInspectEntry* pB = *(const stInspectEntry* const*)pRight;
+	if (pA->theInfo.nOriginalFileSize != pB->theInfo.nOriginalFileSize)
+	{
+		return (pA->theInfo.nOriginalFileSize > pB->theInfo.nOriginalFileSize) ? -1 : 1;
+	}
+	return (pA->nFileID < pB->nFileID) ? -1 : 1;
+}
+//按压缩率从高到低，即压缩效果从差到好。
+int SoInspect_CompareRatio(const void* pLeft, const void* pRight)
+{
+	const stInspectEntry* pA = *(const stInspectEntry* const*)pLeft;
+	const stInspectEntry* pB = *(const stInspectEntry* const*)pRight;
+	const double fA = SoInspect_Ratio(pA->theInfo);
+	const double fB = SoInspect_Ratio(pB->theInfo);
+	if (fA != fB)
+	{
+		return (fA > fB) ? -1 : 1;
+	}
+	return (pA->nFileID < pB->nFileID) ? -1 : 1;
+}
+int SoInspect_CompareUInt32(const void* pLeft, const void* pRight)
+{
+	const souint32 uiA = *(const souint32*)pLeft;
+	const souint32 uiB = *(const souint32*)pRight;
+	return (uiA < uiB) ? -1 : ((uiA > uiB) ? 1 : 0);
+}
+const char* SoInspect_Format(const SoPackageFile::stSingleFileInfo& theInfo)
+{
+	if (theInfo.uiFlags & SoPackageFile::SingleFile_Stored)
+	{
+		return "stored";
+	}
+	//分块压缩的文件加上"+b"。
+	const bool bBlocked = (theInfo.uiFlags & SoPackageFile::SingleFile_Blocked) != 0;
+	if (theInfo.uiFlags & SoPackageFile::SingleFile_RawDeflate)
+	{
+		return bBlocked ? "raw+b" : "raw";
+	}
+	return bBlocked ? "zlib+b" : "zlib";
+}
+void SoInspect_PrintEntry(const stInspectEntry& theEntry)
+{
+	const SoPackageFile::stSingleFileInfo& theInfo = theEntry.theInfo;
+	printf("%8lld %12lld %12lld %12lld %6.1f%% %-6s %6u  %s\n", (long long)theEntry.nFileID, (long long)theInfo.nOffset,
+		(long long)theInfo.nOriginalFileSize, (long long)theInfo.nEmbededFileSize, SoInspect_Ratio(theInfo) * 100.0,
+		SoInspect_Format(theInfo), theEntry.uiProbeLength, theInfo.szFileName);
+}
+void SoInspect_PrintEntryHead()
+{
+	printf("%8s %12s %12s %12s %7s %-6s %6s  %s\n", "id", "offset", "original", "embedded", "ratio", "flags", "probe", "name");
+}
+//-----------------------------------------------------------------------------
+void SoInspect_Compression(stInspectEntry* pEntryList, soint64 nCount)
+{
+	soint64 nOriginalBytes = 0;
+	soint64 nEmbededBytes = 0;
+	soint64 nStoredCount = 0;
+	soint64 nStoredBytes = 0;
+	soint64 nGrownCount = 0;
+	soint64 nGrownBytes = 0;
+	soint64 nBlockedCount = 0;
+	soint64 nBlockCount = 0;
+	//压缩率的分布，最后一格为变大的文件。
+	const double fBoundList[] = {0.1, 0.25, 0.5, 0.75, 0.9, 1.0};
+	const int nBoundCount = sizeof(fBoundList) / sizeof(fBoundList[0]);
+	soint64 nBucketList[nBoundCount + 1];
+	memset(nBucketList, 0, sizeof(nBucketList));
+	for (soint64 i=0; i<nCount; ++i)
+	{
+		const SoPackageFile::stSingleFileInfo& theInfo = pEntryList[i].theInfo;
+		nOriginalBytes += theInfo.nOriginalFileSize;
+		nEmbededBytes += theInfo.nEmbededFileSize;
+		if (theInfo.uiFlags & SoPackageFile::SingleFile_Stored)
+		{
+			++nStoredCount;
+			nStoredBytes += theInfo.nOriginalFileSize;
+			continue;
+		}
+		if (theInfo.uiFlags & SoPackageFile::SingleFile_Blocked)
+		{
+			++nBlockedCount;
+			nBlockCount += SoPackageFile::GetBlockCount(theInfo);
+		}
+		if (theInfo.nEmbededFileSize > theInfo.nOriginalFileSize)
+		{
+			++nGrownCount;
+			nGrownBytes += theInfo.nEmbededFileSize - theInfo.nOriginalFileSize;
+		}
+		const double fRatio = SoInspect_Ratio(theInfo);
+		int nBucket = 0;
+		while (nBucket < nBoundCount && fRatio >= fBoundList[nBucket])
+		{
+			++nBucket;
+		}
+		++nBucketList[nBucket];
+	}
+	printf("\n== compression ==\n");
+	printf("original %.2f MB, embedded %.2f MB, ratio %.1f%%\n", SoInspect_MB(nOriginalBytes), SoInspect_MB(nEmbededBytes),
+		(nOriginalBytes > 0) ? (double)nEmbededBytes * 100.0 / (double)nOriginalBytes : 100.0);
+	printf("compressed entries %lld, stored entries %lld (%.2f MB)\n", (long long)(nCount - nStoredCount), (long long)nStoredCount, SoInspect_MB(nStoredBytes));
+	printf("block compressed entries %lld, %lld blocks\n", (long long)nBlockedCount, (long long)nBlockCount);
+	printf("grown after compression: %lld entries, %lld extra bytes\n", (long long)nGrownCount, (long long)nGrownBytes);
+	printf("ratio of compressed entries:");
+	for (int i=0; i<=nBoundCount; ++i)
+	{
+		if (i < nBoundCount)
+		{
+			printf(" <%.0f%%:%lld", fBoundList[i] * 100.0, (long long)nBucketList[i]);
+		}
+		else
+		{
+			printf(" >=100%%:%lld", (long long)nBucketList[i]);
+		}
+	}
+	printf("\n");
+}
+//-----------------------------------------------------------------------------
+void SoInspect_HashList(SoPackageFile& thePackage, stInspectEntry* pEntryList, stInspectEntry** pSortList, soint64 nCount)
+{
+	printf("\n== hash index ==\n");
+	if (nCount == 0)
+	{
+		printf("empty\n");
+		return;
+	}
+	//按照BuildHashList的规则，文件应该放在uiHashA % nCount，被占用时顺延。
+	soint64 nEmptySlot = 0;
+	for (soint64 nSlot=0; nSlot<nCount; ++nSlot)
+	{
+		SoPackageFile::stHashInfo theSlot;
+		if (thePackage.GetHashSlot(nSlot, theSlot) != SoPackageFile::Result_OK
+			|| (theSlot.uiHashA == 0 && theSlot.uiHashB == 0 && theSlot.uiHashC == 0)
+			|| theSlot.uiIndex_SingleFileInfoList >= (souint32)nCount)
+		{
+			++nEmptySlot;
+			continue;
+		}
+		const soint64 nHome = theSlot.uiHashA % (souint32)nCount;
+		pEntryList[theSlot.uiIndex_SingleFileInfoList].uiProbeLength = (souint32)((nSlot - nHome + nCount) % nCount + 1);
+	}
+	souint32* pProbeList = (souint32*)malloc((size_t)nCount * sizeof(souint32));
+	double fProbeSum = 0.0;
+	for (soint64 i=0; i<nCount; ++i)
+	{
+		pProbeList[i] = pEntryList[i].uiProbeLength;
+		fProbeSum += pProbeList[i];
+	}
+	qsort(pProbeList, (size_t)nCount, sizeof(souint32), SoInspect_CompareUInt32);
+	printf("slots %lld, empty %lld, load %.1f%%\n", (long long)nCount, (long long)nEmptySlot, (double)(nCount - nEmptySlot) * 100.0 / (double)nCount);
+	printf("probe length of hits: mean %.2f, p50 %u, p90 %u, p99 %u, max %u\n", fProbeSum / (double)nCount,
+		pProbeList[nCount / 2], pProbeList[nCount * 9 / 10], pProbeList[nCount * 99 / 100], pProbeList[nCount - 1]);
+	//按2的幂分组的分布。
+	printf("probe length histogram:");
+	souint32 uiLow = 1;
+	soint64 nPos = 0;
+	while (nPos < nCount)
+	{
+		const souint32 uiHigh = uiLow * 2 - 1;
+		soint64 nBucket = 0;
+		while (nPos < nCount && pProbeList[nPos] <= uiHigh)
+		{
+			++nBucket;
+			++nPos;
+		}
+		if (uiLow == uiHigh)
+		{
+			printf(" %u:%lld", uiLow, (long long)nBucket);
+		}
+		else
+		{
+			printf(" %u-%u:%lld", uiLow, uiHigh, (long long)nBucket);
+		}
+		uiLow *= 2;
+	}
+	printf("\n");
+	free(pProbeList);
+	//查找不存在的文件时，GetIndex_SingleFileInfoList一直探测到比较完所有位置为止。
+	printf("probe length of misses: %lld (every slot is compared)\n", (long long)nCount);
+	//三个哈希值的冲突。uiHashA相同的文件探测链更长，三个都相同的文件无法区分，其中只有一个能被找到。
+	for (soint64 i=0; i<nCount; ++i)
+	{
+		pSortList[i] = &pEntryList[i];
+	}
+	qsort(pSortList, (size_t)nCount, sizeof(stInspectEntry*), SoInspect_CompareHash);
+	soint64 nSameA = 0;
+	soint64 nSameAB = 0;
+	soint64 nSameABC = 0;
+	for (soint64 i=1; i<nCount; ++i)
+	{
+		const SoPackageFile::stSingleFileInfo& thePrev = pSortList[i - 1]->theInfo;
+		const SoPackageFile::stSingleFileInfo& theInfo = pSortList[i]->theInfo;
+		if (theInfo.uiHashA != thePrev.uiHashA)
+		{
+			continue;
+		}
+		++nSameA;
+		if (theInfo.uiHashB != thePrev.uiHashB)
+		{
+			continue;
+		}
+		++nSameAB;
+		if (theInfo.uiHashC == thePrev.uiHashC)
+		{
+			++nSameABC;
+			printf("  unreachable: %s collides with %s\n", theInfo.szFileName, thePrev.szFileName);
+		}
+	}
+	printf("hash collisions (entries sharing the hash with another entry): A %lld, A+B %lld, A+B+C %lld\n",
+		(long long)nSameA, (long long)nSameAB, (long long)nSameABC);
+	if (nEmptySlot == 0 && fProbeSum / (double)nCount > 4.0)
+	{
+		printf("  warning: the table is full, hits probe %.1f slots on average and every miss scans the whole table\n", fProbeSum / (double)nCount);
+	}
+}
+//-----------------------------------------------------------------------------
+void SoInspect_Layout(const SoPackageFile::stPackageHead& theHead, soint64 nPackageFileSize, stInspectEntry** pSortList, soint64 nCount)
+{
+	printf("\n== layout ==\n");
+	const soint64 nTocOffset = theHead.nOffsetForFirstSingleFileInfo;
+	const soint64 nTocSize = nCount * SoPackageFile::GetSingleFileInfoSize(theHead.nVersion);
+	printf("head %lld bytes, toc at %lld (%lld bytes), file %lld bytes\n", (long long)sizeof(SoPackageFile::stPackageHead),
+		(long long)nTocOffset, (long long)nTocSize, (long long)nPackageFileSize);
+	qsort(pSortList, (size_t)nCount, sizeof(stInspectEntry*), SoInspect_CompareOffset);
+	soint64 nGapCount = 0;
+	soint64 nGapBytes = 0;
+	soint64 nOverlapCount = 0;
+	soint64 nOutsideCount = 0;
+	soint64 nSectorAligned = 0;
+	soint64 nPageAligned = 0;
+	soint64 nExtraPages = 0;
+	soint64 nEnd = (soint64)sizeof(SoPackageFile::stPackageHead);
+	for (soint64 i=0; i<nCount; ++i)
+	{
+		const SoPackageFile::stSingleFileInfo& theInfo = pSortList[i]->theInfo;
+		const soint64 nSize = theInfo.nEmbededFileSize;
+		if (theInfo.nOffset > nEnd)
+		{
+			++nGapCount;
+			nGapBytes += theInfo.nOffset - nEnd;
+		}
+		else if (theInfo.nOffset < nEnd && nSize > 0)
+		{
+			++nOverlapCount;
+		}
+		if (theInfo.nOffset < 0 || theInfo.nOffset + nSize > nPackageFileSize
+			|| (theInfo.nOffset < nTocOffset + nTocSize && theInfo.nOffset + nSize > nTocOffset && nSize > 0))
+		{
+			++nOutsideCount;
+		}
+		if (theInfo.nOffset + nSize > nEnd)
+		{
+			nEnd = theInfo.nOffset + nSize;
+		}
+		if (nSize == 0)
+		{
+			continue;
+		}
+		if (theInfo.nOffset % SoInspect_SectorSize == 0)
+		{
+			++nSectorAligned;
+		}
+		if (theInfo.nOffset % SoInspect_PageSize == 0)
+		{
+			++nPageAligned;
+		}
+		//跨越的页数比最少需要的页数多出来的部分，读取和内存映射时要多读这些页。
+		const soint64 nSpanPages = (theInfo.nOffset + nSize - 1) / SoInspect_PageSize - theInfo.nOffset / SoInspect_PageSize + 1;
+		nExtraPages += nSpanPages - (nSize + SoInspect_PageSize - 1) / SoInspect_PageSize;
+	}
+	if (nTocOffset > nEnd)
+	{
+		++nGapCount;
+		nGapBytes += nTocOffset - nEnd;
+	}
+	const soint64 nTail = nPackageFileSize - (nTocOffset + nTocSize);
+	printf("data %.2f MB, gaps %lld (%lld bytes), overlaps %lld, outside data area %lld, bytes after toc %lld\n",
+		SoInspect_MB(nEnd - (soint64)sizeof(SoPackageFile::stPackageHead)), (long long)nGapCount, (long long)nGapBytes,
+		(long long)nOverlapCount, (long long)nOutsideCount, (long long)nTail);
+	//文件ID的顺序与偏移量的顺序不一致时，按ID顺序读取会在资源包中来回跳跃。
+	soint64 nBackward = 0;
+	for (soint64 i=1; i<nCount; ++i)
+	{
+		if (pSortList[i]->nFileID < pSortList[i - 1]->nFileID)
+		{
+			++nBackward;
+		}
+	}
+	printf("entries out of id order: %lld\n", (long long)nBackward);
+	const soint64 nNonEmpty = (nCount > 0) ? nCount : 1;
+	printf("aligned to %d: %.1f%%, to %d: %.1f%%, extra pages touched by unaligned entries: %lld\n",
+		SoInspect_SectorSize, (double)nSectorAligned * 100.0 / (double)nNonEmpty,
+		SoInspect_PageSize, (double)nPageAligned * 100.0 / (double)nNonEmpty, (long long)nExtraPages);
+}
+//-----------------------------------------------------------------------------
+void SoInspect_Suggestion(stInspectEntry** pSortList, soint64 nCount, soint64 nLimit)
+{
+	printf("\n== suggestions ==\n");
+	qsort(pSortList, (size_t)nCount, sizeof(stInspectEntry*), SoInspect_CompareSize);
+	//压缩收益很小的文件：每次读取都要解压缩，只节省了很少的空间；原样存储时还可以使用内存映射。
+	//按原始大小从大到小列出，越大的文件解压缩越浪费。
+	soint64 nStoreCount = 0;
+	soint64 nStoreBytes = 0;
+	soint64 nStoreSaving = 0;
+	for (soint64 i=0; i<nCount; ++i)
+	{
+		const SoPackageFile::stSingleFileInfo& theInfo = pSortList[i]->theInfo;
+		if ((theInfo.uiFlags & SoPackageFile::SingleFile_Stored) == 0 && theInfo.nOriginalFileSize > 0
+			&& SoInspect_Ratio(theInfo) > SoInspect_StoreRatio)
+		{
+			++nStoreCount;
+			nStoreBytes += theInfo.nOriginalFileSize;
+			nStoreSaving += theInfo.nOriginalFileSize - theInfo.nEmbededFileSize;
+		}
+	}
+	printf("cheaper stored (compressed size > %.0f%% of original): %lld entries, %.2f MB inflated per full read to save %.2f MB\n",
+		SoInspect_StoreRatio * 100.0, (long long)nStoreCount, SoInspect_MB(nStoreBytes), SoInspect_MB(nStoreSaving));
+	if (nStoreCount > 0)
+	{
+		SoInspect_PrintEntryHead();
+		soint64 nPrinted = 0;
+		for (soint64 i=0; i<nCount && nPrinted<nLimit; ++i)
+		{
+			const SoPackageFile::stSingleFileInfo& theInfo = pSortList[i]->theInfo;
+			if ((theInfo.uiFlags & SoPackageFile::SingleFile_Stored) == 0 && theInfo.nOriginalFileSize > 0
+				&& SoInspect_Ratio(theInfo) > SoInspect_StoreRatio)
+			{
+				SoInspect_PrintEntry(*pSortList[i]);
+				++nPrinted;
+			}
+		}
+	}
+	//单独压缩的小文件：每个zlib流都有头尾，并且不能利用其他文件中重复的内容。
+	soint64 nSmallCount = 0;
+	soint64 nSmallOriginal = 0;
+	soint64 nSmallEmbeded = 0;
+	for (soint64 i=0; i<nCount; ++i)
+	{
+		const SoPackageFile::stSingleFileInfo& theInfo = pSortList[i]->theInfo;
+		if (theInfo.nOriginalFileSize > 0 && theInfo.nOriginalFileSize < SoInspect_SmallFileSize)
+		{
+			++nSmallCount;
+			nSmallOriginal += theInfo.nOriginalFileSize;
+			nSmallEmbeded += theInfo.nEmbededFileSize;
+		}
+	}
+	printf("solid-block candidates (smaller than %d bytes): %lld entries, %.2f MB, ratio %.1f%%\n", SoInspect_SmallFileSize,
+		(long long)nSmallCount, SoInspect_MB(nSmallOriginal), (nSmallOriginal > 0) ? (double)nSmallEmbeded * 100.0 / (double)nSmallOriginal : 100.0);
+	if (nSmallCount > 0)
+	{
+		//最差的几个：压缩率最高（压缩效果最差）的小文件。
+		qsort(pSortList, (size_t)nCount, sizeof(stInspectEntry*), SoInspect_CompareRatio);
+		SoInspect_PrintEntryHead();
+		soint64 nPrinted = 0;
+		for (soint64 i=0; i<nCount && nPrinted<nLimit; ++i)
+		{
+			const SoPackageFile::stSingleFileInfo& theInfo = pSortList[i]->theInfo;
+			if (theInfo.nOriginalFileSize > 0 && theInfo.nOriginalFileSize < SoInspect_SmallFileSize)
+			{
+				SoInspect_PrintEntry(*pSortList[i]);
+				++nPrinted;
+			}
+		}
+	}
+}
+//-----------------------------------------------------------------------------
+//返回损坏的文件个数，检查失败返回-1。
+soint64 SoInspect_Verify(SoPackageFile& thePackage, stInspectEntry* pEntryList, soint64 nCount, souint32 uiThreadCount, bool bInflate, soint64 nLimit)
+{
+	printf("\n== verify ==\n");
+	SoPackageFile::OperationResult* pResultList = (SoPackageFile::OperationResult*)malloc((size_t)(nCount > 0 ? nCount : 1) * sizeof(SoPackageFile::OperationResult));
+	if (pResultList == 0)
+	{
+		printf("out of memory\n");
+		return -1;
+	}
+	SoPackageFile::stVerifyStats theStats;
+	const soint64 nStartTime = SoThread_GetNanoseconds();
+	const SoPackageFile::OperationResult eResult = thePackage.Verify(uiThreadCount,
+		bInflate ? SoPackageFile::Verify_Inflate : SoPackageFile::Verify_Embeded, pResultList, &theStats);
+	const double fSeconds = (SoThread_GetNanoseconds() - nStartTime) * 1e-9;
+	if (eResult != SoPackageFile::Result_OK && theStats.nBadCount == 0)
+	{
+		printf("verify fail, result %d\n", (int)eResult);
+		free(pResultList);
+		return -1;
+	}
+	printf("%s: checked %lld entries, %.1f MB in %.3f seconds (%.1f MB/s), skipped %lld without checksum, bad %lld\n",
+		bInflate ? "inflate" : "embedded", (long long)theStats.nCheckedCount, SoInspect_MB(theStats.nCheckedBytes), fSeconds,
+		(fSeconds > 0.0) ? SoInspect_MB(theStats.nCheckedBytes) / fSeconds : 0.0, (long long)theStats.nSkippedCount, (long long)theStats.nBadCount);
+	if (theStats.nBadCount > 0)
+	{
+		printf("%8s %6s  %s\n", "id", "result", "name");
+		soint64 nPrinted = 0;
+		for (soint64 i=0; i<nCount && nPrinted<nLimit; ++i)
+		{
+			if (pResultList[i] != SoPackageFile::Result_OK)
+			{
+				printf("%8lld %6d  %s\n", (long long)i, (int)pResultList[i], pEntryList[i].theInfo.szFileName);
+				++nPrinted;
+			}
+		}
+	}
+	free(pResultList);
+	return theStats.nBadCount;
+}
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	const char* pszPackage = 0;
+	bool bListEntries = false;
+	soint64 nLimit = 10;
+	bool bVerify = false;
+	bool bInflate = false;
+	souint32 uiThreadCount = 0;
+	for (int i=1; i<argc; ++i)
+	{
+		if (strcmp(argv[i], "--entries") == 0)
+		{
+			bListEntries = true;
+		}
+		else if (strcmp(argv[i], "--verify") == 0)
+		{
+			bVerify = true;
+		}
+		else if (strcmp(argv[i], "--inflate") == 0)
+		{
+			bVerify = true;
+			bInflate = true;
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			uiThreadCount = (souint32)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc)
+		{
+			nLimit = atoi(argv[++i]);
+		}
+		else if (argv[i][0] != '-' && pszPackage == 0)
+		{
+			pszPackage = argv[i];
+		}
+		else
+		{
+			pszPackage = 0;
+			break;
+		}
+	}
+	if (pszPackage == 0)
+	{
+		printf("usage: %s [--entries] [--limit count] [--verify [--inflate] [--threads count]] package\n", argv[0]);
+		return 1;
+	}
+	SoPackageFile thePackage;
+	//只需要读取结构，不使用文件缓存。
+	thePackage.SetEntryCacheSize(0);
+	const SoPackageFile::OperationResult eResult = thePackage.InitPackageFile(pszPackage, SoPackageFile::Mode_Read);
+	if (eResult != SoPackageFile::Result_OK)
+	{
+		printf("open %s fail, result %d\n", pszPackage, (int)eResult);
+		return 1;
+	}
+	SoPackageFile::stPackageHead theHead;
+	thePackage.GetPackageHead(theHead);
+	const soint64 nCount = thePackage.GetFileCount();
+	const soint64 nPackageFileSize = thePackage.GetPackageFileSize();
+	printf("%s: version %lld, %lld entries, %lld bytes\n", pszPackage, (long long)theHead.nVersion, (long long)nCount, (long long)nPackageFileSize);
+	stInspectEntry* pEntryList = (stInspectEntry*)malloc((size_t)(nCount > 0 ? nCount : 1) * sizeof(stInspectEntry));
+	stInspectEntry** pSortList = (stInspectEntry**)malloc((size_t)(nCount > 0 ? nCount : 1) * sizeof(stInspectEntry*));
+	if (pEntryList == 0 || pSortList == 0)
+	{
+		printf("out of memory\n");
+		return 1;
+	}
+	for (soint64 i=0; i<nCount; ++i)
+	{
+		thePackage.GetSingleFileInfo(i, pEntryList[i].theInfo);
+		pEntryList[i].nFileID = i;
+		pEntryList[i].uiProbeLength = 0;
+		pSortList[i] = &pEntryList[i];
+	}
+	SoInspect_Compression(pEntryList, nCount);
+	SoInspect_HashList(thePackage, pEntryList, pSortList, nCount);
+	SoInspect_Layout(theHead, nPackageFileSize, pSortList, nCount);
+	SoInspect_Suggestion(pSortList, nCount, nLimit);
+	if (bListEntries)
+	{
+		printf("\n== entries ==\n");
+		SoInspect_PrintEntryHead();
+		for (soint64 i=0; i<nCount; ++i)
+		{
+			SoInspect_PrintEntry(pEntryList[i]);
+		}
+	}
+	soint64 nBadCount = 0;
+	if (bVerify)
+	{
+		nBadCount = SoInspect_Verify(thePackage, pEntryList, nCount, uiThreadCount, bInflate, nLimit);
+	}
+	free(pSortList);
+	free(pEntryList);
+	thePackage.ReleasePackageFile();
+	if (nBadCount < 0)
+	{
+		return 1;
+	}
+	return (nBadCount > 0) ? 2 : 0;
+}
+//-----------------------------------------------------------------------------